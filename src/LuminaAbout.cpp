@@ -1,3 +1,5 @@
+#include <cstdio>
+#include <string>
 #include <imgui.h>
 #include "LuminaAbout.h"
 
@@ -18,7 +20,7 @@ bool LuminaAbout::IsVisible() const
     return m_Visible;
 }
 
-void LuminaAbout::Render()
+void LuminaAbout::Render(const LuminaStartupProfile& startupProfile)
 {
     if (!m_Visible)
     {
@@ -29,7 +31,7 @@ void LuminaAbout::Render()
     float heightPadding = 40.0f; // top + bottom
     float frameHeight = ImGui::GetFrameHeight();
     float lineHeight = ImGui::GetTextLineHeightWithSpacing();
-    float textHeight = lineHeight * 2.0f;
+    float textHeight = lineHeight * 3.0f;
     float totalHeight = (frameHeight * 2) + textHeight + (heightPadding * 2);
 
     ImVec2 center = ImVec2(ImGui::GetIO().DisplaySize.x * 0.5f, ImGui::GetIO().DisplaySize.y * 0.5f);
@@ -64,6 +66,35 @@ void LuminaAbout::Render()
             ImGui::SetCursorPosX(text2StartX);
         }
         ImGui::Text("GitHub: hchia93/bt-lumina");
+
+        // Startup timings, with per-phase detail on hover
+        auto firstFrameMs = startupProfile.GetFirstFrameMs();
+        auto interactiveMs = startupProfile.GetInteractiveMs();
+        char startupText[96];
+        snprintf(startupText, sizeof(startupText), "First frame: %.0f ms, interactive: %s",
+            firstFrameMs.value_or(0.0), interactiveMs ? (std::to_string(static_cast<int>(*interactiveMs)) + " ms").c_str() : "pending");
+        float text3StartX = (availWidth - ImGui::CalcTextSize(startupText).x) * 0.5f;
+        if (text3StartX > 0)
+        {
+            ImGui::SetCursorPosX(text3StartX);
+        }
+        ImGui::TextDisabled("%s", startupText);
+        if (ImGui::IsItemHovered())
+        {
+            ImGui::BeginTooltip();
+            for (const auto& phase : startupProfile.GetPhases())
+            {
+                if (phase.done)
+                {
+                    ImGui::Text("%s: %.1f ms (at %.1f ms)", phase.name.c_str(), phase.endMs - phase.startMs, phase.startMs);
+                }
+                else
+                {
+                    ImGui::Text("%s: running", phase.name.c_str());
+                }
+            }
+            ImGui::EndTooltip();
+        }
         ImGui::Dummy(ImVec2(0.0f, 5.0f));
 
         float buttonWidth = ImGui::CalcTextSize("Back").x + 40.0f;
@@ -1,11 +1,12 @@
 #pragma once
+#include "LuminaStartupProfile.h"
 
 class LuminaAbout
 {
 public:
     void Show();
     void Hide();
-    void Render();
+    void Render(const LuminaStartupProfile& startupProfile);
     bool IsVisible() const;
 
 private:
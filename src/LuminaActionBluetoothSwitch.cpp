@@ -1,158 +1,332 @@
 #include <winrt/Windows.Foundation.Collections.h>
 #include <winrt/Windows.Devices.Radios.h>
-#include <winrt/Windows.System.Threading.h>
+#include <winrt/Windows.Devices.Enumeration.h>
 #include "LuminaActionBluetoothSwitch.h"
+#include "LuminaHelper.h"
+
+using namespace winrt;
+using namespace Windows::Devices::Enumeration;
+using namespace Windows::Devices::Radios;
 
 LuminaActionBluetoothSwitch::LuminaActionBluetoothSwitch()
 {
 
 }
 
-bool LuminaActionBluetoothSwitch::GetIsBluetoothEnabled()
+LuminaActionBluetoothSwitch::~LuminaActionBluetoothSwitch()
+{
+    StopTracking();
+}
+
+bool LuminaActionBluetoothSwitch::GetIsBluetoothEnabled() const
+{
+    return ((m_Snapshot.load(std::memory_order_acquire) >> 15) & SnapshotCountMask) > 0;
+}
+
+bool LuminaActionBluetoothSwitch::HasBluetoothState() const
+{
+    return (m_Snapshot.load(std::memory_order_acquire) & SnapshotKnownBit) != 0;
+}
+
+int LuminaActionBluetoothSwitch::GetAdapterCount() const
+{
+    return static_cast<int>(m_Snapshot.load(std::memory_order_acquire) & SnapshotCountMask);
+}
+
+int LuminaActionBluetoothSwitch::GetEnabledAdapterCount() const
+{
+    return static_cast<int>((m_Snapshot.load(std::memory_order_acquire) >> 15) & SnapshotCountMask);
+}
+
+bool LuminaActionBluetoothSwitch::GetIsStateRequested() const
+{
+    return !HasBluetoothState() || m_PendingToggles > 0;
+}
+
+std::vector<LuminaActionBluetoothSwitch::AdapterState> LuminaActionBluetoothSwitch::GetAdapters() const
+{
+    std::lock_guard<std::mutex> lock(m_AdaptersMutex);
+    std::vector<AdapterState> adapters;
+    for (const auto& pair : m_Adapters)
+    {
+        adapters.push_back(pair.second.state);
+    }
+    return adapters;
+}
+
+void LuminaActionBluetoothSwitch::RequestGetIsBluetoothEnabled()
 {
-    return m_IsBluetoothEnabled.value_or(false);
+    if (m_RadioWatcher)
+    {
+        return;
+    }
+
+    try
+    {
+        m_RadioWatcher = DeviceInformation::CreateWatcher(Radio::GetDeviceSelector());
+        m_AddedToken = m_RadioWatcher.Added([this](DeviceWatcher const&, DeviceInformation const& info)
+            {
+                TrackRadio(info.Id());
+            });
+        // Added/Removed are only raised once Updated has a handler too
+        m_UpdatedToken = m_RadioWatcher.Updated([](DeviceWatcher const&, DeviceInformationUpdate const&) {});
+        m_RemovedToken = m_RadioWatcher.Removed([this](DeviceWatcher const&, DeviceInformationUpdate const& update)
+            {
+                OnRadioRemoved(update.Id());
+            });
+        m_EnumerationCompletedToken = m_RadioWatcher.EnumerationCompleted([this](DeviceWatcher const&, Windows::Foundation::IInspectable const&)
+            {
+                m_IsEnumerated = true;
+                PublishSnapshot();
+            });
+        m_RadioWatcher.Start();
+    }
+    catch (winrt::hresult_error const& ex)
+    {
+        if (m_EventBus)
+        {
+            std::wstring error = L"Bluetooth state query failed: " + std::wstring(ex.message());
+            PublishNotification(Lumina::Severity::Error, LuminaHelper::WideStringToUtf8(error));
+        }
+        // Nothing more will arrive; publish an empty but known state
+        m_IsEnumerated = true;
+        PublishSnapshot();
+    }
 }
 
-void LuminaActionBluetoothSwitch::GetIsBluetoothEnabledAsync_Internal()
+void LuminaActionBluetoothSwitch::RequestToogleBluetoothEnabled()
 {
-    m_Requested = true;
-    auto op = winrt::Windows::Devices::Radios::Radio::GetRadiosAsync();
-    op.Completed([this](auto&& asyncOp, auto&& status)
+    if (GetIsStateRequested())
+    {
+        return;
+    }
+
+    RadioState target = GetIsBluetoothEnabled() ? RadioState::Off : RadioState::On;
+    std::vector<Radio> radios;
+    {
+        std::lock_guard<std::mutex> lock(m_AdaptersMutex);
+        for (const auto& pair : m_Adapters)
+        {
+            radios.push_back(pair.second.radio);
+        }
+    }
+
+    // The new state is not assumed here; it arrives through StateChanged
+    for (const auto& radio : radios)
+    {
         {
-            winrt::Windows::Foundation::Collections::IVectorView<winrt::Windows::Devices::Radios::Radio> radios;
-            switch (status)
+            // Counted under the lock, like lookups, so StopTracking can wait for every completion handler
+            std::lock_guard<std::mutex> lock(m_AdaptersMutex);
+            if (m_IsStopping)
             {
-            case winrt::Windows::Foundation::AsyncStatus::Completed:
-                radios = asyncOp.GetResults();
-                for (const auto& radio : radios)
+                return;
+            }
+            ++m_PendingToggles;
+        }
+        try
+        {
+            auto setOp = radio.SetStateAsync(target);
+            setOp.Completed([this](auto&& asyncOp, auto&& setStatus)
                 {
-                    if (radio.Kind() == winrt::Windows::Devices::Radios::RadioKind::Bluetooth)
+                    switch (setStatus)
                     {
-                        m_IsBluetoothEnabled = (radio.State() == winrt::Windows::Devices::Radios::RadioState::On);
+                    case winrt::Windows::Foundation::AsyncStatus::Completed:
+                        if (asyncOp.GetResults() != RadioAccessStatus::Allowed)
+                        {
+                            PublishNotification(Lumina::Severity::Error, "Bluetooth toggle was denied.");
+                        }
+                        FinishToggle();
+                        break;
+                    case winrt::Windows::Foundation::AsyncStatus::Canceled:
+                        PublishNotification(Lumina::Severity::Info, "Bluetooth toggle was canceled.");
+                        FinishToggle();
+                        break;
+                    case winrt::Windows::Foundation::AsyncStatus::Error:
+                        PublishNotification(Lumina::Severity::Error, "Bluetooth toggle failed.");
+                        FinishToggle();
+                        break;
+                    case winrt::Windows::Foundation::AsyncStatus::Started:
+                        break;
+                    default:
+                        FinishToggle();
                         break;
                     }
-                }
-                m_Requested = false;
-                break;
-            case winrt::Windows::Foundation::AsyncStatus::Canceled:
-                if (m_OnErrorMessageGenerated)
-                {
-                    m_OnErrorMessageGenerated("Bluetooth state query was canceled.");
-                }
-                m_Requested = false;
-                break;
-            case winrt::Windows::Foundation::AsyncStatus::Error:
-                if (m_OnErrorMessageGenerated)
+                });
+        }
+        catch (...)
+        {
+            PublishNotification(Lumina::Severity::Error, "Bluetooth toggle failed.");
+            FinishToggle();
+        }
+    }
+}
+
+void LuminaActionBluetoothSwitch::FinishToggle()
+{
+    // Notified under the lock: once the count reaches 0 the object may be destroyed
+    std::lock_guard<std::mutex> lock(m_AdaptersMutex);
+    --m_PendingToggles;
+    m_CallbacksDone.notify_all();
+}
+
+winrt::fire_and_forget LuminaActionBluetoothSwitch::TrackRadio(winrt::hstring id)
+{
+    {
+        // Counted before the first suspension so StopTracking can wait for this coroutine to finish with `this`
+        std::lock_guard<std::mutex> lock(m_AdaptersMutex);
+        if (m_IsStopping)
+        {
+            co_return;
+        }
+        ++m_RunningLookups;
+    }
+    ++m_PendingRadioLookups;
+    try
+    {
+        Radio radio = co_await Radio::FromIdAsync(id);
+        if (radio && radio.Kind() == RadioKind::Bluetooth)
+        {
+            std::lock_guard<std::mutex> lock(m_AdaptersMutex);
+            if (!m_IsStopping)
+            {
+                Adapter adapter;
+                adapter.radio = radio;
+                adapter.state.name = winrt::to_string(radio.Name());
+                adapter.state.isOn = (radio.State() == RadioState::On);
+                adapter.stateChangedToken = radio.StateChanged({ this, &LuminaActionBluetoothSwitch::OnRadioStateChanged });
+
+                // The watcher can report the same radio twice; the entry it replaces must not keep its handler
+                auto existing = m_Adapters.find(id);
+                if (existing != m_Adapters.end())
                 {
-                    m_OnErrorMessageGenerated("Bluetooth state query failed.");
+                    existing->second.radio.StateChanged(existing->second.stateChangedToken);
                 }
-                m_Requested = false;
-                break;
-            case winrt::Windows::Foundation::AsyncStatus::Started:
-                break;
-            default:
-                m_Requested = false;
-                break;
+                m_Adapters[id] = adapter;
             }
-        });
+        }
+    }
+    catch (...)
+    {
+        // Radio disappeared or access was denied; it simply is not tracked
+    }
+    --m_PendingRadioLookups;
+    if (!m_IsStopping)
+    {
+        PublishSnapshot();
+    }
+
+    // Notified under the lock: once the count reaches 0 the object may be destroyed
+    std::lock_guard<std::mutex> lock(m_AdaptersMutex);
+    --m_RunningLookups;
+    m_CallbacksDone.notify_all();
+}
+
+void LuminaActionBluetoothSwitch::OnRadioRemoved(winrt::hstring const& id)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_AdaptersMutex);
+        auto it = m_Adapters.find(id);
+        if (it == m_Adapters.end())
+        {
+            return;
+        }
+        it->second.radio.StateChanged(it->second.stateChangedToken);
+        m_Adapters.erase(it);
+    }
+    PublishSnapshot();
 }
 
-void LuminaActionBluetoothSwitch::SetBluetoothEnabledAsync_Internal()
+void LuminaActionBluetoothSwitch::OnRadioStateChanged(Radio const& sender, Windows::Foundation::IInspectable const&)
 {
-    m_Requested = true;
-    auto op = winrt::Windows::Devices::Radios::Radio::GetRadiosAsync();
-    op.Completed([this](auto&& asyncOp, auto&& status)
+    {
+        std::lock_guard<std::mutex> lock(m_AdaptersMutex);
+        for (auto& pair : m_Adapters)
         {
-            switch (status)
+            if (pair.second.radio == sender)
             {
-            case winrt::Windows::Foundation::AsyncStatus::Completed:
-                try
-                {
-                    auto radios = asyncOp.GetResults();
-                    for (const auto& radio : radios)
-                    {
-                        if (radio.Kind() == winrt::Windows::Devices::Radios::RadioKind::Bluetooth)
-                        {
-                            auto setOp = radio.SetStateAsync(!m_IsBluetoothEnabled.value() ? winrt::Windows::Devices::Radios::RadioState::On : winrt::Windows::Devices::Radios::RadioState::Off);
-                            setOp.Completed([this](auto&&, auto&& setStatus)
-                                {
-                                    switch (setStatus)
-                                    {
-                                    case winrt::Windows::Foundation::AsyncStatus::Completed:
-                                        m_IsBluetoothEnabled.value() = !m_IsBluetoothEnabled.value();
-                                        m_Requested = false;
-                                        break;
-                                    case winrt::Windows::Foundation::AsyncStatus::Canceled:
-                                        if (m_OnErrorMessageGenerated)
-                                        {
-                                            m_OnErrorMessageGenerated("Bluetooth toggle was canceled.");
-                                        }
-                                        m_Requested = false;
-                                        break;
-                                    case winrt::Windows::Foundation::AsyncStatus::Error:
-                                        if (m_OnErrorMessageGenerated)
-                                        {
-                                            m_OnErrorMessageGenerated("Bluetooth toggle failed.");
-                                        }
-                                        m_Requested = false;
-                                        break;
-                                    case winrt::Windows::Foundation::AsyncStatus::Started:
-                                        break;
-                                    default:
-                                        m_Requested = false;
-                                        break;
-                                    }
-                                });
-                            return;
-                        }
-                    }
-                }
-                catch (...)
-                {
-                    m_Requested = false;
-                }
-                break;
-            case winrt::Windows::Foundation::AsyncStatus::Canceled:
-                if (m_OnErrorMessageGenerated)
-                {
-                    m_OnErrorMessageGenerated("Bluetooth state query was canceled.");
-                }
-                m_Requested = false;
-                break;
-            case winrt::Windows::Foundation::AsyncStatus::Error:
-                if (m_OnErrorMessageGenerated)
-                {
-                    m_OnErrorMessageGenerated("Bluetooth state query failed.");
-                }
-                m_Requested = false;
-                break;
-            case winrt::Windows::Foundation::AsyncStatus::Started:
-                break;
-            default:
-                m_Requested = false;
+                pair.second.state.isOn = (sender.State() == RadioState::On);
                 break;
             }
-        });
+        }
+    }
+    PublishSnapshot();
 }
 
-
-void LuminaActionBluetoothSwitch::RequestGetIsBluetoothEnabled()
+void LuminaActionBluetoothSwitch::PublishSnapshot()
 {
-    if (!m_Requested && !m_IsBluetoothEnabled.has_value())
+    uint32_t count = 0;
+    uint32_t enabled = 0;
+    uint32_t previous = 0;
+    {
+        // Stored under the lock so concurrent publishers cannot leave an older view behind
+        std::lock_guard<std::mutex> lock(m_AdaptersMutex);
+        for (const auto& pair : m_Adapters)
+        {
+            ++count;
+            enabled += pair.second.state.isOn ? 1 : 0;
+        }
+
+        uint32_t snapshot = (count & SnapshotCountMask) | ((enabled & SnapshotCountMask) << 15);
+        previous = m_Snapshot.load(std::memory_order_relaxed);
+        if (m_IsEnumerated && m_PendingRadioLookups == 0)
+        {
+            snapshot |= SnapshotKnownBit;
+        }
+        else
+        {
+            // Keep the known bit once set, so a hot-plugged adapter does not grey out the UI
+            snapshot |= previous & SnapshotKnownBit;
+        }
+        m_Snapshot.store(snapshot, std::memory_order_release);
+    }
+
+    uint32_t previousCount = previous & SnapshotCountMask;
+    uint32_t previousEnabled = (previous >> 15) & SnapshotCountMask;
+    if (m_EventBus && (count != previousCount || enabled != previousEnabled))
     {
-        GetIsBluetoothEnabledAsync_Internal();
+        m_EventBus->Publish(Lumina::RadioEvent{ static_cast<int>(count), static_cast<int>(enabled) });
     }
 }
 
-void LuminaActionBluetoothSwitch::RequestToogleBluetoothEnabled()
+void LuminaActionBluetoothSwitch::PublishNotification(Lumina::Severity severity, const std::string& message)
 {
-    if (!m_Requested && m_IsBluetoothEnabled.has_value())
+    if (m_EventBus)
     {
-        SetBluetoothEnabledAsync_Internal();
+        m_EventBus->Publish(Lumina::NotificationEvent{ severity, "Radio", message });
     }
 }
 
-bool LuminaActionBluetoothSwitch::GetIsStateRequested() const
+void LuminaActionBluetoothSwitch::StopTracking()
 {
-    return m_Requested;
-}
\ No newline at end of file
+    try
+    {
+        if (m_RadioWatcher)
+        {
+            m_RadioWatcher.Added(m_AddedToken);
+            m_RadioWatcher.Updated(m_UpdatedToken);
+            m_RadioWatcher.Removed(m_RemovedToken);
+            m_RadioWatcher.EnumerationCompleted(m_EnumerationCompletedToken);
+            auto status = m_RadioWatcher.Status();
+            if (status == DeviceWatcherStatus::Started || status == DeviceWatcherStatus::EnumerationCompleted)
+            {
+                m_RadioWatcher.Stop();
+            }
+            m_RadioWatcher = nullptr;
+        }
+
+        // Lookups still in flight would register handlers on a destroyed object, and toggle completions
+        // would write to it
+        std::unique_lock<std::mutex> lock(m_AdaptersMutex);
+        m_IsStopping = true;
+        m_CallbacksDone.wait(lock, [this] { return m_RunningLookups == 0 && m_PendingToggles == 0; });
+        for (auto& pair : m_Adapters)
+        {
+            pair.second.radio.StateChanged(pair.second.stateChangedToken);
+        }
+        m_Adapters.clear();
+    }
+    catch (...)
+    {
+        // Ignore errors during cleanup
+    }
+}
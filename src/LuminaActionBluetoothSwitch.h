@@ -1,34 +1,82 @@
 #pragma once
 #include <winrt/Windows.Devices.Radios.h>
-#include <optional>
+#include <winrt/Windows.Devices.Enumeration.h>
 #include <atomic>
+#include <condition_variable>
 #include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "LuminaEventBus.h"
 
 class LuminaActionBluetoothSwitch
 {
 public:
+    struct AdapterState
+    {
+        std::string name;
+        bool isOn;
+    };
+
     LuminaActionBluetoothSwitch();
+    ~LuminaActionBluetoothSwitch();
     LuminaActionBluetoothSwitch(const LuminaActionBluetoothSwitch&) = delete;
     LuminaActionBluetoothSwitch& operator=(const LuminaActionBluetoothSwitch&) = delete;
 
-    // Polling from cache.
-    bool GetIsBluetoothEnabled();
+    // Read from the atomic snapshot, safe to call every frame. Enabled means any adapter is on.
+    bool GetIsBluetoothEnabled() const;
     bool GetIsStateRequested() const;
+    bool HasBluetoothState() const;
+    int GetAdapterCount() const;
+    int GetEnabledAdapterCount() const;
+    std::vector<AdapterState> GetAdapters() const;
 
-    // State management methods
+    // Starts tracking every Bluetooth radio. State then arrives through radio events, including adapter hot-plug.
     void RequestGetIsBluetoothEnabled();
+    // Turns all adapters on if none is on, otherwise turns them all off.
     void RequestToogleBluetoothEnabled();
 
-    void HandleOnErrorMessage(const std::function<void(const std::string&)>& callback) { m_OnErrorMessageGenerated = callback; }
+    // Errors go out as NotificationEvent, adapter count changes as RadioEvent
+    void SetEventBus(LuminaEventBus* eventBus) { m_EventBus = eventBus; }
 
 private:
-    // tracks async state
-    std::atomic<bool> m_Requested = false;
+    struct Adapter
+    {
+        winrt::Windows::Devices::Radios::Radio radio{ nullptr };
+        winrt::event_token stateChangedToken;
+        AdapterState state;
+    };
+
+    // Watches radio devices so adapters plugged in or removed at runtime are picked up
+    winrt::Windows::Devices::Enumeration::DeviceWatcher m_RadioWatcher{ nullptr };
+    winrt::event_token m_AddedToken;
+    winrt::event_token m_UpdatedToken;
+    winrt::event_token m_RemovedToken;
+    winrt::event_token m_EnumerationCompletedToken;
+
+    std::map<winrt::hstring, Adapter> m_Adapters;
+    mutable std::mutex m_AdaptersMutex;
+    std::condition_variable m_CallbacksDone;
+    int m_RunningLookups = 0;           // TrackRadio coroutines not yet finished; guarded by m_AdaptersMutex
+    std::atomic<bool> m_IsStopping = false;
+
+    // Bits 0-14: adapter count, bits 15-29: adapters on, bit 31: initial enumeration done
+    static constexpr uint32_t SnapshotCountMask = 0x7FFF;
+    static constexpr uint32_t SnapshotKnownBit = 0x80000000u;
+    std::atomic<uint32_t> m_Snapshot = 0;
+
+    std::atomic<bool> m_IsEnumerated = false;
+    std::atomic<int> m_PendingRadioLookups = 0;
+    std::atomic<int> m_PendingToggles = 0;  // SetStateAsync completions not yet run; changed under m_AdaptersMutex
 
-    std::optional<bool> m_IsBluetoothEnabled;
-    
-    std::function<void(const std::string&)> m_OnErrorMessageGenerated;
+    LuminaEventBus* m_EventBus = nullptr;
 
-    void GetIsBluetoothEnabledAsync_Internal();
-    void SetBluetoothEnabledAsync_Internal();
-};
\ No newline at end of file
+    winrt::fire_and_forget TrackRadio(winrt::hstring id);
+    void FinishToggle();
+    void OnRadioRemoved(winrt::hstring const& id);
+    void OnRadioStateChanged(winrt::Windows::Devices::Radios::Radio const& sender, winrt::Windows::Foundation::IInspectable const& args);
+    void PublishSnapshot();
+    void PublishNotification(Lumina::Severity severity, const std::string& message);
+    void StopTracking();
+};
@@ -1,7 +1,8 @@
 #include <algorithm>
+#include <cctype>
 #include <chrono>
-#include <sstream>
-#include <iomanip>
+#include <cstring>
+#ifdef _WIN32
 #include <winrt/base.h>
 #include <winrt/Windows.Devices.Bluetooth.h>
 #include <winrt/Windows.Devices.Enumeration.h>
@@ -9,31 +10,37 @@
 #include <winrt/Windows.Devices.Bluetooth.Advertisement.h>
 #include <winrt/Windows.System.Threading.h>
 #include <winrt/Windows.Storage.Streams.h>
+#endif
 #include "LuminaActionDiscoverDevice.h"
 #include "LuminaDevice.h"
 #include "LuminaHelper.h"
 
+#ifdef _WIN32
 using namespace winrt;
 using namespace Windows::Devices::Bluetooth::Advertisement;
 using namespace Windows::System::Threading;
+#endif
 
 LuminaActionDiscoverDevice::LuminaActionDiscoverDevice()
     : m_Requested(false)
     , m_ScanTimeoutSeconds(30)
 {
-    try
-    {
-        winrt::init_apartment();
-    }
-    catch (...)
-    {
-        // Handle initialization error
-    }
 }
 
 LuminaActionDiscoverDevice::~LuminaActionDiscoverDevice()
 {
     StopScanning_Internal();
+#ifndef _WIN32
+    {
+        std::lock_guard<std::mutex> lock(m_TimerMutex);
+        m_IsTimerStopping = true;
+    }
+    m_TimerWake.notify_all();
+    if (m_TimerThread.joinable())
+    {
+        m_TimerThread.join();
+    }
+#endif
 }
 
 void LuminaActionDiscoverDevice::RequestScan()
@@ -64,18 +71,60 @@ void LuminaActionDiscoverDevice::StartBluetoothLEScanning()
         {
             std::lock_guard<std::mutex> lock(m_devicesMutex);
             m_discoveredDevices.clear();
+
+            std::string error;
+            if (!m_SharedTable.IsOpen() && !m_SharedTable.Open(LuminaConfig::SharedTableName, error))
+            {
+                PublishNotification(Lumina::Severity::Warning, error);
+            }
+            m_SharedTable.Clear();
+
+            if (!m_QueryServer.IsRunning() && !m_QueryServer.Start(LuminaConfig::QuerySocketPath, error))
+            {
+                PublishNotification(Lumina::Severity::Warning, error);
+            }
+            m_QueryServer.ClearDevices();
+        }
+        // The last scan's ingest has drained, so no shard is using its coalescer
+        WaitForIngest();
+        for (auto& shard : m_IngestShards)
+        {
+            shard.coalescer.Clear();
+        }
+        m_AddressLinker.Clear();
+        m_UnchangedAdverts = 0;
+        m_ChangedAdverts = 0;
+        m_IngestDropped = 0;
+        m_OversizedSections = 0;
+        m_IngestFilter.ResetCounters();
+        m_RpaResolver.ResetCounters();
+        ReloadIngestFilter();
+        ReloadIrkStore();
+        if (m_IsExportEnabled)
+        {
+            StartExport();
         }
 
+        m_ScanMerger.HandleOnSample([this](const Lumina::AdvertisementSample& sample) { QueueIngest(sample); });
+#ifdef _WIN32
+        m_ScanMerger.Start(ScanLaneCount);
+
         // Create the watcher
         m_watcher = BluetoothLEAdvertisementWatcher();
 
-        // Configure scanning parameters
-        m_watcher.ScanningMode(BluetoothLEScanningMode::Active);
-
-        // Set signal strength filter to catch devices in pairing mode
-        m_watcher.SignalStrengthFilter().InRangeThresholdInDBm(-70);
-        m_watcher.SignalStrengthFilter().OutOfRangeThresholdInDBm(-80);
-        m_watcher.SignalStrengthFilter().OutOfRangeTimeout(Windows::Foundation::TimeSpan(std::chrono::seconds(5)));
+        // Configure scanning parameters from the selected profile
+        const Lumina::ScanProfile& profile = Lumina::GetScanProfile(m_ScanProfile);
+        m_watcher.ScanningMode(profile.isActive ? BluetoothLEScanningMode::Active : BluetoothLEScanningMode::Passive);
+        if (profile.inRangeDbm != Lumina::ScanProfile::NoThreshold)
+        {
+            m_watcher.SignalStrengthFilter().InRangeThresholdInDBm(profile.inRangeDbm);
+            m_watcher.SignalStrengthFilter().OutOfRangeThresholdInDBm(profile.outOfRangeDbm);
+            m_watcher.SignalStrengthFilter().OutOfRangeTimeout(Windows::Foundation::TimeSpan(profile.outOfRangeTimeout));
+        }
+        if (profile.allowExtendedAdvertisements)
+        {
+            m_watcher.AllowExtendedAdvertisements(true);
+        }
 
         // Set up event handlers
         m_receivedToken = m_watcher.Received({ this, &LuminaActionDiscoverDevice::OnAdvertisementReceived });
@@ -90,35 +139,47 @@ void LuminaActionDiscoverDevice::StartBluetoothLEScanning()
             [this](ThreadPoolTimer const&) { OnScanTimeout(); },
             timeout
         );
-
-        if (m_OnErrorMessageGenerated)
+        m_filterReloadTimer = ThreadPoolTimer::CreatePeriodicTimer(
+            [this](ThreadPoolTimer const&)
+            {
+                ReloadIngestFilter();
+                ReloadIrkStore();
+            },
+            Windows::Foundation::TimeSpan(std::chrono::seconds(LuminaConfig::IngestFilterReloadSeconds))
+        );
+#else
+        if (!StartBluezScanning())
         {
-            m_OnErrorMessageGenerated("Started Bluetooth LE scanning for " + std::to_string(m_ScanTimeoutSeconds) + " seconds...");
+            m_Requested = false;
+            return;
         }
+#endif
+
+        PublishNotification(Lumina::Severity::Info, "Started Bluetooth LE scanning for " + std::to_string(m_ScanTimeoutSeconds) + " seconds...");
     }
+#ifdef _WIN32
     catch (winrt::hresult_error const& ex)
     {
-        if (m_OnErrorMessageGenerated)
+        if (m_EventBus)
         {
             std::wstring error = L"Failed to start BLE scanning: " + std::wstring(ex.message());
             std::string errorStr = LuminaHelper::WideStringToUtf8(error);
 
-            m_OnErrorMessageGenerated(errorStr);
+            PublishNotification(Lumina::Severity::Error, errorStr);
         }
         m_Requested = false;
     }
+#endif
     catch (...)
     {
-        if (m_OnErrorMessageGenerated)
-        {
-            m_OnErrorMessageGenerated("Bluetooth LE scanning threw an exception.");
-        }
+        PublishNotification(Lumina::Severity::Error, "Bluetooth LE scanning threw an exception.");
         m_Requested = false;
     }
 }
 
 void LuminaActionDiscoverDevice::StopScanning_Internal()
 {
+    std::lock_guard<std::mutex> stopLock(m_StopMutex);
     if (!m_Requested)
     {
         return;
@@ -126,12 +187,18 @@ void LuminaActionDiscoverDevice::StopScanning_Internal()
 
     try
     {
+#ifdef _WIN32
         // Cancel timeout timer
         if (m_timeoutTimer)
         {
             m_timeoutTimer.Cancel();
             m_timeoutTimer = nullptr;
         }
+        if (m_filterReloadTimer)
+        {
+            m_filterReloadTimer.Cancel();
+            m_filterReloadTimer = nullptr;
+        }
 
         // Stop watcher
         if (m_watcher)
@@ -154,6 +221,19 @@ void LuminaActionDiscoverDevice::StopScanning_Internal()
             }
             m_watcher = nullptr;
         }
+#else
+        {
+            std::lock_guard<std::mutex> lock(m_TimerMutex);
+            m_IsTimerArmed = false;
+        }
+        // Leaving the bus ends this client's discovery session, and no sample is pushed once it returns
+        m_Bluez.Stop();
+#endif
+
+        // Drains samples still held for reordering and lets ingest catch up, then closes the session files
+        m_ScanMerger.Stop();
+        WaitForIngest();
+        m_ScanExporter.Stop();
 
         m_Requested = false;
     }
@@ -164,53 +244,424 @@ void LuminaActionDiscoverDevice::StopScanning_Internal()
     }
 }
 
+#ifdef _WIN32
 void LuminaActionDiscoverDevice::OnAdvertisementReceived(
     BluetoothLEAdvertisementWatcher const& sender,
     BluetoothLEAdvertisementReceivedEventArgs const& args)
 {
     try
     {
-        DiscoveredDeviceInfo deviceInfo = ExtractDeviceInfo(args);
+        // Copy the raw sections out of WinRT; everything after this point is platform independent
+        Lumina::AdvertisementSample sample;
+        sample.address = args.BluetoothAddress();
+        sample.timestamp = std::chrono::steady_clock::now();
+        sample.rssi = args.RawSignalStrengthInDBm();
+        sample.advertisementType = static_cast<uint8_t>(args.AdvertisementType());
+        sample.addressType = static_cast<uint8_t>(args.BluetoothAddressType());
+        auto pushFragment = [this, &sample]()
+        {
+            sample.dataStatus = Lumina::AdvertisementSample::DataMoreToCome;
+            m_ScanMerger.Push(WatcherLane, sample);
+            sample.payloadLength = 0;
+        };
+        for (auto const& section : args.Advertisement().DataSections())
+        {
+            auto data = section.Data();
+            if (sample.AppendSection(section.DataType(), data.data(), data.Length()))
+            {
+                continue;
+            }
+            if (data.Length() > 254)
+            {
+                ++m_OversizedSections;
+                continue;
+            }
+            // Extended adverts can outgrow one sample: send what fits as a fragment and carry on in the next
+            if (sample.payloadLength > 0)
+            {
+                pushFragment();
+            }
+            if (!sample.AppendSection(section.DataType(), data.data(), data.Length()))
+            {
+                // A 254-byte structure is one byte too long for any sample, so it straddles two; reassembly
+                // joins fragments byte for byte
+                constexpr size_t Head = Lumina::AdvertisementSample::MaxPayloadSize - 2;
+                sample.payload[0] = static_cast<uint8_t>(data.Length() + 1);
+                sample.payload[1] = section.DataType();
+                std::memcpy(sample.payload + 2, data.data(), Head);
+                sample.payloadLength = static_cast<uint16_t>(Lumina::AdvertisementSample::MaxPayloadSize);
+                pushFragment();
+                std::memcpy(sample.payload, data.data() + Head, data.Length() - Head);
+                sample.payloadLength = static_cast<uint16_t>(data.Length() - Head);
+            }
+        }
+        sample.dataStatus = Lumina::AdvertisementSample::DataComplete;
 
-        bool isNewDevice = false;
+        m_ScanMerger.Push(WatcherLane, sample);
+    }
+    catch (...)
+    {
+        // Handle parsing errors silently
+    }
+}
+#else
+bool LuminaActionDiscoverDevice::StartBluezScanning()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_devicesMutex);
+        m_PairedAddresses.clear();
+    }
+    m_Bluez.HandleOnSample([this](const Lumina::AdvertisementSample& sample) { m_ScanMerger.Push(sample.adapterIndex, sample); });
+    m_Bluez.HandleOnDeviceState([this](const LuminaBluezBackend::DeviceState& state)
         {
             std::lock_guard<std::mutex> lock(m_devicesMutex);
+            if (state.isPaired && !state.isRemoved)
+            {
+                m_PairedAddresses.insert(state.address);
+            }
+            else
+            {
+                m_PairedAddresses.erase(state.address);
+            }
+        });
+
+    std::string error;
+    if (!m_Bluez.Start(LuminaBluezBackend::Options(), error))
+    {
+        PublishNotification(Lumina::Severity::Error, "Failed to start BLE scanning: " + error);
+        return false;
+    }
+
+    // The adapters are known once the backend has started, and no sample arrives before discovery does
+    int laneCount = 1;
+    for (const auto& adapter : m_Bluez.GetAdapters())
+    {
+        laneCount = std::max(laneCount, adapter.index + 1);
+    }
+    m_ScanMerger.Start(laneCount);
+
+    // Only the profile's in-range threshold has a BlueZ counterpart
+    LuminaBluezBackend::DiscoveryFilter filter;
+    const Lumina::ScanProfile& profile = Lumina::GetScanProfile(m_ScanProfile);
+    if (profile.inRangeDbm != Lumina::ScanProfile::NoThreshold)
+    {
+        filter.minRssi = profile.inRangeDbm;
+    }
+    m_Bluez.StartDiscovery(filter, [this](bool isSucceeded, const std::string& error)
+        {
+            if (!isSucceeded)
+            {
+                PublishNotification(Lumina::Severity::Error, "Failed to start BLE scanning: " + error);
+            }
+        });
+
+    {
+        std::lock_guard<std::mutex> lock(m_TimerMutex);
+        auto now = std::chrono::steady_clock::now();
+        m_ScanDeadline = now + std::chrono::seconds(m_ScanTimeoutSeconds);
+        m_NextReload = now + std::chrono::seconds(LuminaConfig::IngestFilterReloadSeconds);
+        m_IsTimerArmed = true;
+        if (!m_TimerThread.joinable())
+        {
+            m_TimerThread = std::thread([this] { RunScanTimer(); });
+        }
+    }
+    m_TimerWake.notify_all();
+    return true;
+}
+
+void LuminaActionDiscoverDevice::RunScanTimer()
+{
+    std::unique_lock<std::mutex> lock(m_TimerMutex);
+    while (!m_IsTimerStopping)
+    {
+        if (!m_IsTimerArmed)
+        {
+            m_TimerWake.wait(lock);
+            continue;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now >= m_ScanDeadline)
+        {
+            m_IsTimerArmed = false;
+            lock.unlock();
+            OnScanTimeout();
+            lock.lock();
+        }
+        else if (now >= m_NextReload)
+        {
+            m_NextReload = now + std::chrono::seconds(LuminaConfig::IngestFilterReloadSeconds);
+            lock.unlock();
+            ReloadIngestFilter();
+            ReloadIrkStore();
+            lock.lock();
+        }
+        else
+        {
+            m_TimerWake.wait_until(lock, std::min(m_ScanDeadline, m_NextReload));
+        }
+    }
+}
+#endif
 
-            // Check if this is a new device
-            auto it = m_discoveredDevices.find(deviceInfo.bluetoothAddress);
-            isNewDevice = (it == m_discoveredDevices.end());
+void LuminaActionDiscoverDevice::QueueIngest(const Lumina::AdvertisementSample& sample)
+{
+    // A bonded device's private addresses all become its identity address, so every rotation lands in one device
+    const uint64_t address = m_RpaResolver.Resolve(sample.address);
 
-            // Update device info
-            m_discoveredDevices[deviceInfo.bluetoothAddress] = deviceInfo;
+    // Mixed first: addresses from one vendor share their high bytes
+    IngestShard& shard = m_IngestShards[((address * 0x9E3779B97F4A7C15ull) >> 32) % IngestShardCount];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.pending.size() >= MaxPendingPerShard)
+        {
+            ++m_IngestDropped;
+            return;
+        }
+        shard.pending.push_back(sample);
+        if (address != sample.address)
+        {
+            shard.pending.back().address = address;
+            shard.pending.back().addressType = Lumina::AdvertisementSample::AddressResolved;
         }
+        if (shard.isScheduled)
+        {
+            return;
+        }
+        shard.isScheduled = true;
+    }
+    LuminaWorkerPool::Get().Submit([this, &shard] { DrainIngestShard(shard); }, LuminaWorkerPool::Priority::High);
+}
 
+void LuminaActionDiscoverDevice::DrainIngestShard(IngestShard& shard)
+{
+    // At most one drain per shard runs at a time; it takes whatever has queued up as one batch
+    std::vector<Lumina::AdvertisementSample> batch;
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (shard.pending.empty())
+            {
+                shard.isScheduled = false;
+                shard.idle.notify_all();
+                return;
+            }
+            batch.swap(shard.pending);
+        }
+        for (const auto& sample : batch)
+        {
+            IngestSample(sample, shard.coalescer);
+        }
+        batch.clear();
+    }
+}
+
+void LuminaActionDiscoverDevice::WaitForIngest()
+{
+    for (auto& shard : m_IngestShards)
+    {
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        shard.idle.wait(lock, [&shard] { return !shard.isScheduled; });
+    }
+}
+
+void LuminaActionDiscoverDevice::IngestSample(const Lumina::AdvertisementSample& sample, LuminaAdvertCoalescer& coalescer)
+{
+    auto ingestStart = std::chrono::steady_clock::now();
+    if (m_DiscoveryLatency)
+    {
+        m_DiscoveryLatency->Record(LuminaDiscoveryLatency::Stage::IngestQueue, ingestStart - sample.timestamp);
+    }
+
+    // Drop unwanted addresses before parsing or touching the device map
+    LuminaIngestFilter::Verdict verdict = m_IngestFilter.CheckAddress(sample.address);
+    if (verdict == LuminaIngestFilter::Verdict::Reject)
+    {
+        return;
+    }
+
+    // Fold the advert, scan response or fragment into the device's record; slots whose bytes repeat are not re-parsed
+    LuminaAdvertCoalescer::MergeResult merge = coalescer.Merge(sample);
+    if (!merge.record)
+    {
+        // An incomplete chain can only be judged by service once it is whole; until then it is not exported
+        if (verdict == LuminaIngestFilter::Verdict::Accept)
+        {
+            m_ScanExporter.RecordAdvert(sample, nullptr);
+        }
+        return;
+    }
+    // Service rules see the UUIDs from the advert and the scan response together. A rejected device's record is
+    // dropped, so it holds no memory and is judged afresh from its next sample.
+    if (verdict == LuminaIngestFilter::Verdict::CheckServices && !m_IngestFilter.CheckServices(sample.address, merge.record->serviceUuids))
+    {
+        coalescer.Remove(sample.address);
+        return;
+    }
+    if (m_Waterfall)
+    {
+        m_Waterfall->Record(sample.address, sample.rssi, sample.timestamp);
+    }
+    std::optional<LuminaAddressLinker::Link> link;
+    if (m_IsAddressLinkingEnabled)
+    {
+        link = m_AddressLinker.Observe(sample);
+    }
+
+    // Fast path: nothing in the merged record moved, only the signal strength and timestamp. This replaces a
+    // per-address payload hash, which an advert and its scan response kept flipping under active scanning.
+    bool isUnchanged = false;
+    if (merge.changed == 0 && !link)
+    {
+        std::lock_guard<std::mutex> lock(m_devicesMutex);
+        auto it = m_discoveredDevices.find(sample.address);
+        if (it != m_discoveredDevices.end())
+        {
+            UpdateSighting(it->second, sample);
+            PublishDeviceState(it->second);
+            ++m_UnchangedAdverts;
+            isUnchanged = true;
+        }
+    }
+    if (isUnchanged)
+    {
+        m_ScanExporter.RecordAdvert(sample, nullptr);
+        return;
+    }
+    ++m_ChangedAdverts;
+
+    DiscoveredDeviceInfo deviceInfo;
+    bool isNewDevice = false;
+    {
+        std::lock_guard<std::mutex> lock(m_devicesMutex);
+        auto [it, isInserted] = m_discoveredDevices.try_emplace(sample.address);
+        isNewDevice = isInserted;
+        DiscoveredDeviceInfo& stored = it->second;
         if (isNewDevice)
         {
-            // Convert to DeviceInformation and notify
-            ConvertToDeviceInformation(deviceInfo);
+            stored.bluetoothAddress = sample.address;
+            std::fill(std::begin(stored.adapterRssi), std::end(stored.adapterRssi), Lumina::AdvertisementSample::NoRssi);
+        }
+        UpdateSighting(stored, sample);
+        // Only the fields that changed are rewritten, so a scan response never blanks the advert's name or UUIDs
+        ApplyAdvertRecord(stored, *merge.record, isNewDevice ? LuminaAdvertCoalescer::ChangeAll : merge.changed);
+        if (link)
+        {
+            stored.linkedAddress = link->linkedAddress;
+            stored.linkConfidence = link->confidence;
         }
+        deviceInfo = stored;
+        PublishDeviceState(deviceInfo);
     }
-    catch (...)
+    m_ScanExporter.RecordAdvert(sample, &deviceInfo.name);
+
+    if (m_EventBus)
     {
-        // Handle parsing errors silently
+        Lumina::DeviceUpdatedEvent event;
+        event.address = deviceInfo.bluetoothAddress;
+        event.name = deviceInfo.name;
+        event.rssi = deviceInfo.rssi;
+        event.isConnectable = deviceInfo.isConnectable;
+        event.isNew = isNewDevice;
+        m_EventBus->Publish(event);
+        if (link)
+        {
+            m_EventBus->Publish(Lumina::DeviceLinkedEvent{ link->address, link->linkedAddress, link->confidence });
+        }
+    }
+
+    if (isNewDevice)
+    {
+        if (m_DiscoveryLatency)
+        {
+            m_DiscoveryLatency->Record(LuminaDiscoveryLatency::Stage::Ingest, std::chrono::steady_clock::now() - ingestStart);
+        }
+        // Convert to DeviceInformation and notify
+        ConvertToDeviceInformation(deviceInfo);
+    }
+}
+
+std::optional<LuminaIntervalEstimator::Estimate> LuminaActionDiscoverDevice::GetAdvertisingInterval(uint64_t address)
+{
+    std::lock_guard<std::mutex> lock(m_devicesMutex);
+    auto it = m_discoveredDevices.find(address);
+    if (it == m_discoveredDevices.end())
+    {
+        return std::nullopt;
+    }
+    return it->second.advertisingInterval.GetEstimate();
+}
+
+void LuminaActionDiscoverDevice::SetExportEnabled(bool enabled)
+{
+    m_IsExportEnabled = enabled;
+    if (!enabled)
+    {
+        m_ScanExporter.Stop();
+    }
+    else if (m_Requested && !m_ScanExporter.IsRunning())
+    {
+        StartExport();
     }
 }
 
+void LuminaActionDiscoverDevice::StartExport()
+{
+    std::string error;
+    if (!m_ScanExporter.Start(LuminaConfig::ExportDirectory, error))
+    {
+        PublishNotification(Lumina::Severity::Warning, error);
+    }
+}
+
+void LuminaActionDiscoverDevice::PublishDeviceState(const DiscoveredDeviceInfo& deviceInfo)
+{
+    Lumina::SharedTable::Row row;
+    row.address = deviceInfo.bluetoothAddress;
+    row.rssi = deviceInfo.rssi;
+    row.flags = deviceInfo.isConnectable ? Lumina::SharedTable::FlagConnectable : 0;
+    std::memcpy(row.name, deviceInfo.name.data(), std::min(deviceInfo.name.size(), Lumina::SharedTable::NameSize - 1));
+
+    // lastSeen is a steady_clock reading; other processes need wall-clock time
+    auto age = std::chrono::steady_clock::now() - deviceInfo.lastSeen;
+    row.lastSeenUnixMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        (std::chrono::system_clock::now() - age).time_since_epoch()).count();
+
+    m_SharedTable.Publish(row);
+
+    if (m_RssiHistory)
+    {
+        m_RssiHistory->Record(deviceInfo.bluetoothAddress, row.lastSeenUnixMs, deviceInfo.rssi);
+    }
+
+    if (m_QueryServer.IsRunning())
+    {
+        Lumina::QueryDevice device;
+        device.address = deviceInfo.bluetoothAddress;
+        device.name = deviceInfo.name;
+        device.rssi = deviceInfo.rssi;
+        device.isConnectable = deviceInfo.isConnectable;
+        device.lastSeenUnixMs = row.lastSeenUnixMs;
+        device.serviceUuids = deviceInfo.serviceUuids;
+        m_QueryServer.PublishDevice(device);
+    }
+}
+
+#ifdef _WIN32
 void LuminaActionDiscoverDevice::OnScanStopped(
     BluetoothLEAdvertisementWatcher const& sender,
     BluetoothLEAdvertisementWatcherStoppedEventArgs const& args)
 {
-    m_Requested = false;
-
-    // Check if stopped due to error
+    // Only reached when the watcher stopped by itself (radio off, error): StopScanning_Internal revokes this
+    // handler before stopping it. The merger, ingest, reload timers and export still need tearing down.
     if (args.Error() != Windows::Devices::Bluetooth::BluetoothError::Success)
     {
-        if (m_OnErrorMessageGenerated)
-        {
-            m_OnErrorMessageGenerated("Bluetooth scanning stopped due to error.");
-        }
+        PublishNotification(Lumina::Severity::Error, "Bluetooth scanning stopped due to error.");
     }
+    StopScanning_Internal();
 }
+#endif
 
 void LuminaActionDiscoverDevice::OnScanTimeout()
 {
@@ -224,143 +675,168 @@ void LuminaActionDiscoverDevice::OnScanTimeout()
         }
     }
 
-    if (finalDevices.empty() && m_OnErrorMessageGenerated)
+    if (finalDevices.empty())
     {
-        m_OnErrorMessageGenerated("No new devices found during scan.");
+        PublishNotification(Lumina::Severity::Info, "No new devices found during scan.");
     }
 
     // Stop scanning
     StopScanning_Internal();
 }
 
-LuminaActionDiscoverDevice::DiscoveredDeviceInfo LuminaActionDiscoverDevice::ExtractDeviceInfo(
-    const BluetoothLEAdvertisementReceivedEventArgs& args)
+void LuminaActionDiscoverDevice::ReloadIngestFilter()
 {
-    DiscoveredDeviceInfo info;
-    info.bluetoothAddress = args.BluetoothAddress();
-    info.rssi = args.RawSignalStrengthInDBm();
-    info.lastSeen = std::chrono::steady_clock::now();
-    info.isConnectable = false;
-
-    // Extract device name
-    std::wstring localName;
-    if (localName.empty())
+    std::string error;
+    if (!m_IngestFilter.ReloadIfChanged(LuminaConfig::IngestFilterPath, error))
     {
-        // Try to get name from advertisement data
-        auto advertisement = args.Advertisement();
-        if (!advertisement.LocalName().empty())
-        {
-            localName = advertisement.LocalName().c_str();
-        }
-        else
-        {
-            // Fallback: create name from address
-            localName = L"BLE Device " + std::to_wstring(info.bluetoothAddress & 0xFFFF);
-        }
+        PublishNotification(Lumina::Severity::Warning, error);
     }
-    info.name = LuminaHelper::WideStringToUtf8(localName);
+}
 
-    // Check if device is connectable by looking at advertisement flags
-    auto advertisement = args.Advertisement();
+void LuminaActionDiscoverDevice::ReloadIrkStore()
+{
+    std::string error;
+    if (!m_RpaResolver.ReloadIfChanged(LuminaConfig::IrkStorePath, error))
+    {
+        PublishNotification(Lumina::Severity::Warning, error);
+    }
+}
 
-    // Check advertisement flags for connectability
-    for (auto const& section : advertisement.DataSections())
+void LuminaActionDiscoverDevice::UpdateSighting(DiscoveredDeviceInfo& deviceInfo, const Lumina::AdvertisementSample& sample)
+{
+    deviceInfo.rssi = sample.rssi;
+    deviceInfo.lastSeen = sample.timestamp;
+    if (sample.advertisementType != Lumina::AdvertisementSample::ScanResponseType)
+    {
+        deviceInfo.advertisingInterval.Add(sample.timestamp);
+    }
+    for (size_t i = 0; i < Lumina::AdvertisementSample::MaxAdapters; ++i)
     {
-        if (section.DataType() == 0x01) // Flags data type
+        if (sample.adapterRssi[i] != Lumina::AdvertisementSample::NoRssi)
         {
-            try
-            {
-                auto reader = Windows::Storage::Streams::DataReader::FromBuffer(section.Data());
-                if (section.Data().Length() > 0)
-                {
-                    uint8_t flags = reader.ReadByte();
-                    // Check if LE General Discoverable Mode flag is set
-                    info.isConnectable = (flags & 0x02) != 0;
-                }
-            }
-            catch (...)
-            {
-                // Ignore errors reading flags
-            }
+            deviceInfo.adapterRssi[i] = sample.adapterRssi[i];
         }
     }
+}
 
-    // If no flags found, assume connectable for devices with names or service UUIDs
-    if (!info.isConnectable)
+void LuminaActionDiscoverDevice::ApplyAdvertRecord(DiscoveredDeviceInfo& deviceInfo, const LuminaAdvertCoalescer::Record& record, uint32_t changed)
+{
+    if (changed & LuminaAdvertCoalescer::ChangeName)
     {
-        info.isConnectable = !localName.empty() || (advertisement.ServiceUuids().Size() != 0);
+        // AD names should be UTF-8 but are raw bytes off the air. Repair them once here, so the table, the
+        // export and the NDJSON stream all get valid text. Fall back to a name made from the address.
+        deviceInfo.name = !record.name.empty() ? record.name : "BLE Device " + std::to_string(deviceInfo.bluetoothAddress & 0xFFFF);
+        LuminaHelper::ReplaceInvalidUtf8(deviceInfo.name);
     }
+    if (changed & LuminaAdvertCoalescer::ChangeServices)
+    {
+        deviceInfo.serviceUuids = record.serviceUuids;
+    }
+
+    // Check if LE General Discoverable Mode flag is set
+    deviceInfo.isConnectable = record.flags && (*record.flags & 0x02) != 0;
 
-    return info;
+    // If no flags found, assume connectable for devices with names or service UUIDs
+    if (!deviceInfo.isConnectable)
+    {
+        deviceInfo.isConnectable = !deviceInfo.name.empty() || !deviceInfo.serviceUuids.empty();
+    }
 }
 
-winrt::fire_and_forget LuminaActionDiscoverDevice::ConvertToDeviceInformation(const DiscoveredDeviceInfo& deviceInfo)
+#ifdef _WIN32
+winrt::fire_and_forget LuminaActionDiscoverDevice::ConvertToDeviceInformation(DiscoveredDeviceInfo deviceInfo)
 {
     try
     {
         // Try to get the actual Bluetooth device
         auto bluetoothAddress = deviceInfo.bluetoothAddress;
+        auto resolveStart = std::chrono::steady_clock::now();
         auto bluetoothDevice = co_await Windows::Devices::Bluetooth::BluetoothLEDevice::FromBluetoothAddressAsync(bluetoothAddress);
+        if (m_DiscoveryLatency)
+        {
+            m_DiscoveryLatency->Record(LuminaDiscoveryLatency::Stage::Resolve, std::chrono::steady_clock::now() - resolveStart);
+        }
 
         if (bluetoothDevice != nullptr)
         {
             // Get DeviceInformation from the Bluetooth device
             auto deviceInfo_winrt = bluetoothDevice.DeviceInformation();
 
-            std::vector<Windows::Devices::Enumeration::DeviceInformation> devices;
-            devices.push_back(deviceInfo_winrt);
-
-            if (m_OnDevicesDiscovered)
+            if (m_EventBus)
             {
-                m_OnDevicesDiscovered(devices);
+                Lumina::DeviceDiscoveredEvent event;
+                event.device.SetName(winrt::to_string(deviceInfo_winrt.Name()));
+                event.device.SetDeviceId(winrt::to_string(deviceInfo_winrt.Id()));
+                event.device.SetPaired(deviceInfo_winrt.Pairing().IsPaired());
+                event.device.signalStrength = static_cast<int8_t>(std::clamp<int>(deviceInfo.rssi, INT8_MIN, INT8_MAX));
+                event.device.deviceType = Lumina::DeviceType::LowEnergy;
+                event.firstAdvertTime = deviceInfo.lastSeen;
+                event.scanProfile = m_ScanProfile;
+                event.publishTime = std::chrono::steady_clock::now();
+                m_EventBus->Publish(event);
             }
         }
         else
         {
             // Create a mock DeviceInformation-like structure for BLE devices that can't be directly accessed
             // This is a fallback - you might need to modify your callback to handle BLE-specific data
-            if (m_OnErrorMessageGenerated)
+            if (m_EventBus)
             {
                 std::string msg = "Found BLE device: " + deviceInfo.name +
-                    " (" + BluetoothAddressToString(deviceInfo.bluetoothAddress) +
+                    " (" + LuminaHelper::BluetoothAddressToString(deviceInfo.bluetoothAddress) +
                     "), RSSI: " + std::to_string(deviceInfo.rssi) + " dBm";
-                m_OnErrorMessageGenerated(msg);
+                PublishNotification(Lumina::Severity::Info, msg, "devices found");
             }
         }
     }
     catch (...)
     {
         // Device might not be accessible yet - this is common for BLE devices in pairing mode
-        if (m_OnErrorMessageGenerated)
+        if (m_EventBus)
         {
             std::string msg = "Detected BLE device in pairing mode: " + deviceInfo.name +
-                " (" + BluetoothAddressToString(deviceInfo.bluetoothAddress) +
+                " (" + LuminaHelper::BluetoothAddressToString(deviceInfo.bluetoothAddress) +
                 "), RSSI: " + std::to_string(deviceInfo.rssi) + " dBm";
-            m_OnErrorMessageGenerated(msg);
+            PublishNotification(Lumina::Severity::Info, msg, "devices in pairing mode");
         }
     }
 }
-
-std::string LuminaActionDiscoverDevice::BluetoothAddressToString(uint64_t address)
+#else
+void LuminaActionDiscoverDevice::ConvertToDeviceInformation(const DiscoveredDeviceInfo& deviceInfo)
 {
-    std::stringstream ss;
-    ss << std::hex << std::uppercase << std::setfill('0');
-
-    for (int i = 5; i >= 0; --i)
+    // BlueZ already holds the device, so there is nothing to resolve: the event is built from the advert
+    if (!m_EventBus)
     {
-        if (i < 5) ss << ":";
-        ss << std::setw(2) << ((address >> (i * 8)) & 0xFF);
+        return;
     }
+    std::string deviceId = LuminaHelper::BluetoothAddressToString(deviceInfo.bluetoothAddress);
+    std::transform(deviceId.begin(), deviceId.end(), deviceId.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
 
-    return ss.str();
+    Lumina::DeviceDiscoveredEvent event;
+    event.device.SetName(deviceInfo.name);
+    event.device.SetDeviceId("bluez-" + deviceId);
+    {
+        std::lock_guard<std::mutex> lock(m_devicesMutex);
+        event.device.SetPaired(m_PairedAddresses.count(deviceInfo.bluetoothAddress) != 0);
+    }
+    event.device.signalStrength = static_cast<int8_t>(std::clamp<int>(deviceInfo.rssi, INT8_MIN, INT8_MAX));
+    event.device.deviceType = Lumina::DeviceType::LowEnergy;
+    event.firstAdvertTime = deviceInfo.lastSeen;
+    event.scanProfile = m_ScanProfile;
+    event.publishTime = std::chrono::steady_clock::now();
+    m_EventBus->Publish(event);
 }
+#endif
 
 bool LuminaActionDiscoverDevice::GetIsScanRequested() const
 {
     return m_Requested;
 }
 
-void LuminaActionDiscoverDevice::HandleOnDevicesDiscovered(const std::function<void(const std::vector<winrt::Windows::Devices::Enumeration::DeviceInformation>&)>& callback)
+void LuminaActionDiscoverDevice::PublishNotification(Lumina::Severity severity, const std::string& message, const char* summary)
 {
-    m_OnDevicesDiscovered = callback;
+    if (m_EventBus)
+    {
+        m_EventBus->Publish(Lumina::NotificationEvent{ severity, "Scan", message, summary ? summary : "" });
+    }
 }
\ No newline at end of file
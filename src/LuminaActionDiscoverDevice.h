@@ -1,4 +1,6 @@
 #pragma once
+#include <array>
+#include <condition_variable>
 #include <vector>
 #include <string>
 #include <chrono>
@@ -6,13 +8,50 @@
 #include <atomic>
 #include <mutex>
 #include <map>
+#ifdef _WIN32
 #include <winrt/Windows.Devices.Enumeration.h>
 #include <winrt/Windows.Devices.Bluetooth.Advertisement.h>
 #include <winrt/Windows.System.Threading.h>
+#else
+#include <thread>
+#include <unordered_set>
+#include "LuminaBluezBackend.h"
+#endif
+#include "LuminaIngestFilter.h"
+#include "LuminaRpaResolver.h"
+#include "LuminaAdvertisement.h"
+#include "LuminaAdvertCoalescer.h"
+#include "LuminaAddressLinker.h"
+#include "LuminaIntervalEstimator.h"
+#include "LuminaScanMerger.h"
+#include "LuminaSharedTable.h"
+#include "LuminaQueryServer.h"
+#include "LuminaScanExporter.h"
+#include "LuminaRssiHistory.h"
+#include "LuminaEventBus.h"
+#include "LuminaWorkerPool.h"
+#include "LuminaScanProfile.h"
+#include "LuminaDiscoveryLatency.h"
+#include "LuminaWaterfall.h"
 
 class LuminaActionDiscoverDevice
 {
 public:
+    // Parsed state of one advertising device, merged across its adverts and scan responses
+    struct DiscoveredDeviceInfo
+    {
+        uint64_t bluetoothAddress;
+        std::string name;
+        int16_t rssi;
+        std::chrono::steady_clock::time_point lastSeen;
+        bool isConnectable;
+        int8_t adapterRssi[Lumina::AdvertisementSample::MaxAdapters]; // Per adapter, NoRssi if not seen by it
+        std::vector<Lumina::ServiceUuid> serviceUuids;
+        uint64_t linkedAddress = 0;     // Earlier address of the same device, when address linking found one
+        float linkConfidence = 0.0f;
+        LuminaIntervalEstimator advertisingInterval;    // From the arrival times of its adverts, scan responses excluded
+    };
+
     LuminaActionDiscoverDevice();
     ~LuminaActionDiscoverDevice();
     LuminaActionDiscoverDevice(const LuminaActionDiscoverDevice&) = delete;
@@ -25,55 +64,159 @@ public:
     // Set scan timeout in seconds (default: 30 seconds)
     void SetScanTimeout(int timeoutSeconds) { m_ScanTimeoutSeconds = timeoutSeconds; }
     int GetScanTimeout() const { return m_ScanTimeoutSeconds; }
+    // Applied when the next scan starts
+    void SetScanProfile(Lumina::ScanProfileId profile) { m_ScanProfile = profile; }
+    Lumina::ScanProfileId GetScanProfile() const { return m_ScanProfile; }
+
+    // Publishes DeviceDiscoveredEvent, DeviceUpdatedEvent, DeviceLinkedEvent and NotificationEvent. Set before scanning; must outlive it.
+    void SetEventBus(LuminaEventBus* eventBus) { m_EventBus = eventBus; }
+
+    // Ingest statistics for the current scan: adverts that changed nothing in their device's merged record, and the rest
+    uint64_t GetUnchangedAdvertCount() const { return m_UnchangedAdverts; }
+    uint64_t GetChangedAdvertCount() const { return m_ChangedAdverts; }
+    // Adverts dropped because ingest fell too far behind the radio
+    uint64_t GetIngestDroppedCount() const { return m_IngestDropped; }
+    // AD structures longer than one length byte can describe, dropped from their advert
+    uint64_t GetOversizedSectionCount() const { return m_OversizedSections; }
+    const LuminaIngestFilter& GetIngestFilter() const { return m_IngestFilter; }
+    const LuminaRpaResolver& GetRpaResolver() const { return m_RpaResolver; }
+    LuminaQueryServer::Stats GetQueryServerStats() const { return m_QueryServer.GetStats(); }
+
+    // Record each scan session to LuminaConfig::ExportDirectory; takes effect immediately, also mid-scan
+    void SetExportEnabled(bool enabled);
+    bool GetIsExportEnabled() const { return m_IsExportEnabled; }
+    LuminaScanExporter::Stats GetExportStats() const { return m_ScanExporter.GetStats(); }
+    LuminaScanMerger::Stats GetScanMergerStats() const { return m_ScanMerger.GetStats(); }
 
-    // Set callback to report discovered devices
-    void HandleOnDevicesDiscovered(const std::function<void(const std::vector<winrt::Windows::Devices::Enumeration::DeviceInformation>&)>& callback);
-    void HandleOnErrorMessage(const std::function<void(const std::string&)>& callback) { m_OnErrorMessageGenerated = callback; }
+    // Guess which rotating random addresses belong to one device; takes effect immediately, also mid-scan
+    void SetAddressLinkingEnabled(bool enabled) { m_IsAddressLinkingEnabled = enabled; }
+    bool GetIsAddressLinkingEnabled() const { return m_IsAddressLinkingEnabled; }
+    LuminaAddressLinker::Stats GetAddressLinkerStats() const { return m_AddressLinker.GetStats(); }
+
+    // Advertising interval of a device seen in the current scan; nullopt if it has not been seen
+    std::optional<LuminaIntervalEstimator::Estimate> GetAdvertisingInterval(uint64_t address);
+
+    // Every sighting is offered to the history, which keeps one sample per device per second. Must outlive scanning.
+    void SetRssiHistory(LuminaRssiHistory* history) { m_RssiHistory = history; }
+    // Records the ingest and resolve stages. Must outlive scanning.
+    void SetDiscoveryLatency(LuminaDiscoveryLatency* latency) { m_DiscoveryLatency = latency; }
+    // Every advert that passes the ingest filter is recorded. Must outlive scanning.
+    void SetWaterfall(LuminaWaterfall* waterfall) { m_Waterfall = waterfall; }
 
 private:
-    // Bluetooth LE Advertisement Watcher
+#ifdef _WIN32
+    // Bluetooth LE Advertisement Watcher. WinRT only scans on the default adapter, so this is lane 0 of the merger.
     winrt::Windows::Devices::Bluetooth::Advertisement::BluetoothLEAdvertisementWatcher m_watcher{ nullptr };
+    static constexpr int WatcherLane = 0;
+    static constexpr int ScanLaneCount = 1;
+#else
+    // BlueZ scans on every powered adapter; each adapter's hci index is its lane of the merger
+    LuminaBluezBackend m_Bluez;
+    std::unordered_set<uint64_t> m_PairedAddresses;  // As BlueZ reports them; under m_devicesMutex
+#endif
 
-    // Timer for scan timeout
-    winrt::Windows::System::Threading::ThreadPoolTimer m_timeoutTimer{ nullptr };
+    // Orders and de-duplicates sightings from all lanes before ingest
+    LuminaScanMerger m_ScanMerger;
 
-    // Device tracking
-    struct DiscoveredDeviceInfo
+    // Ingest runs on the worker pool, sharded by address so each device's adverts keep their order
+    static constexpr size_t IngestShardCount = 16;
+    static constexpr size_t MaxPendingPerShard = 4096;
+    struct IngestShard
     {
-        uint64_t bluetoothAddress;
-        std::string name;
-        int16_t rssi;
-        std::chrono::steady_clock::time_point lastSeen;
-        bool isConnectable;
+        std::mutex mutex;
+        std::condition_variable idle;
+        std::vector<Lumina::AdvertisementSample> pending;
+        bool isScheduled = false;
+        LuminaAdvertCoalescer coalescer; // Only used by the shard's running drain
     };
+    std::array<IngestShard, IngestShardCount> m_IngestShards;
+    std::atomic<uint64_t> m_IngestDropped = 0;
+    std::atomic<uint64_t> m_OversizedSections = 0;
+
+#ifdef _WIN32
+    // Timer for scan timeout
+    winrt::Windows::System::Threading::ThreadPoolTimer m_timeoutTimer{ nullptr };
+#else
+    // Scan timeout and the periodic reloads. One thread for the object's lifetime, idle between scans, so a
+    // scan that times out can stop itself without joining its own thread.
+    std::thread m_TimerThread;
+    std::mutex m_TimerMutex;
+    std::condition_variable m_TimerWake;
+    bool m_IsTimerArmed = false;
+    bool m_IsTimerStopping = false;
+    std::chrono::steady_clock::time_point m_ScanDeadline;
+    std::chrono::steady_clock::time_point m_NextReload;
+#endif
+
+    // Allow/deny filtering applied before any parsing, hot-reloaded by a periodic timer while scanning
+    LuminaIngestFilter m_IngestFilter;
+    LuminaRpaResolver m_RpaResolver;
+    LuminaAddressLinker m_AddressLinker;
+    std::atomic<bool> m_IsAddressLinkingEnabled = false;
+#ifdef _WIN32
+    winrt::Windows::System::Threading::ThreadPoolTimer m_filterReloadTimer{ nullptr };
+#endif
 
     std::map<uint64_t, DiscoveredDeviceInfo> m_discoveredDevices;
     std::mutex m_devicesMutex;
 
+    // Mirrors of m_discoveredDevices for other processes; written under m_devicesMutex
+    LuminaSharedTableWriter m_SharedTable;
+    LuminaQueryServer m_QueryServer;
+
+    LuminaScanExporter m_ScanExporter;
+    std::atomic<bool> m_IsExportEnabled = false;
+
+    LuminaRssiHistory* m_RssiHistory = nullptr;
+    LuminaDiscoveryLatency* m_DiscoveryLatency = nullptr;
+    LuminaWaterfall* m_Waterfall = nullptr;
+
     // State tracking
     std::atomic<bool> m_Requested = false;
+    std::mutex m_StopMutex;     // The UI, the scan timeout and the watcher stopping by itself can all stop a scan
     int m_ScanTimeoutSeconds = 30;
+    Lumina::ScanProfileId m_ScanProfile = Lumina::ScanProfileId::LowLatency;
+    std::atomic<uint64_t> m_UnchangedAdverts = 0;
+    std::atomic<uint64_t> m_ChangedAdverts = 0;
 
+#ifdef _WIN32
     // Event tokens for cleanup
     winrt::event_token m_receivedToken;
     winrt::event_token m_stoppedToken;
+#endif
 
-    // Callbacks
-    std::function<void(const std::vector<winrt::Windows::Devices::Enumeration::DeviceInformation>&)> m_OnDevicesDiscovered;
-    std::function<void(const std::string&)> m_OnErrorMessageGenerated;
+    LuminaEventBus* m_EventBus = nullptr;
 
     // Internal methods
     void StartBluetoothLEScanning();
     void StopScanning_Internal();
+#ifdef _WIN32
     void OnAdvertisementReceived(
         winrt::Windows::Devices::Bluetooth::Advertisement::BluetoothLEAdvertisementWatcher const& sender,
         winrt::Windows::Devices::Bluetooth::Advertisement::BluetoothLEAdvertisementReceivedEventArgs const& args);
     void OnScanStopped(
         winrt::Windows::Devices::Bluetooth::Advertisement::BluetoothLEAdvertisementWatcher const& sender,
         winrt::Windows::Devices::Bluetooth::Advertisement::BluetoothLEAdvertisementWatcherStoppedEventArgs const& args);
+#else
+    bool StartBluezScanning();
+    void RunScanTimer();
+#endif
     void OnScanTimeout();
+    void ReloadIngestFilter();
+    void ReloadIrkStore();
+    void QueueIngest(const Lumina::AdvertisementSample& sample);
+    void DrainIngestShard(IngestShard& shard);
+    void WaitForIngest();
+    void IngestSample(const Lumina::AdvertisementSample& sample, LuminaAdvertCoalescer& coalescer);
+    void PublishDeviceState(const DiscoveredDeviceInfo& deviceInfo);
+    void StartExport();
+    void PublishNotification(Lumina::Severity severity, const std::string& message, const char* summary = nullptr);
 
-    DiscoveredDeviceInfo ExtractDeviceInfo(const winrt::Windows::Devices::Bluetooth::Advertisement::BluetoothLEAdvertisementReceivedEventArgs& args);
-    winrt::fire_and_forget ConvertToDeviceInformation(const DiscoveredDeviceInfo& deviceInfo);
-    std::string BluetoothAddressToString(uint64_t address);
+    static void UpdateSighting(DiscoveredDeviceInfo& deviceInfo, const Lumina::AdvertisementSample& sample);
+    static void ApplyAdvertRecord(DiscoveredDeviceInfo& deviceInfo, const LuminaAdvertCoalescer::Record& record, uint32_t changed);
+#ifdef _WIN32
+    winrt::fire_and_forget ConvertToDeviceInformation(DiscoveredDeviceInfo deviceInfo);
+#else
+    void ConvertToDeviceInformation(const DiscoveredDeviceInfo& deviceInfo);
+#endif
 };
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include <array>
+#include <winrt/base.h>
+#include <winrt/Windows.Devices.Bluetooth.h>
+#include <winrt/Windows.Devices.Bluetooth.GenericAttributeProfile.h>
+#include <winrt/Windows.Devices.Enumeration.h>
+#include <winrt/Windows.Foundation.Collections.h>
+#include <winrt/Windows.Storage.Streams.h>
+#include "LuminaActionProvisionDevice.h"
+#include "LuminaHelper.h"
+
+using namespace winrt;
+using namespace Windows::Devices::Bluetooth;
+using namespace Windows::Devices::Bluetooth::GenericAttributeProfile;
+using namespace Windows::Devices::Enumeration;
+
+namespace
+{
+    winrt::guid ToGuid(const Lumina::ServiceUuid& uuid)
+    {
+        std::array<uint8_t, 8> tail{};
+        for (size_t i = 0; i < tail.size(); ++i)
+        {
+            tail[i] = static_cast<uint8_t>(uuid.low >> (56 - 8 * i));
+        }
+        return winrt::guid(static_cast<uint32_t>(uuid.high >> 32), static_cast<uint16_t>(uuid.high >> 16),
+            static_cast<uint16_t>(uuid.high), tail);
+    }
+
+    std::string ToError(const char* step, const winrt::hresult_error& ex)
+    {
+        return std::string(step) + ": " + LuminaHelper::WideStringToUtf8(std::wstring(ex.message()));
+    }
+
+    winrt::fire_and_forget PairAsync(uint64_t address, LuminaProvisioningTransport::Completion completion)
+    {
+        std::string error;
+        try
+        {
+            auto device = co_await BluetoothLEDevice::FromBluetoothAddressAsync(address);
+            if (device == nullptr)
+            {
+                error = "Device not reachable";
+            }
+            else if (!device.DeviceInformation().Pairing().IsPaired())
+            {
+                auto pairing = device.DeviceInformation().Pairing();
+                if (!pairing.CanPair())
+                {
+                    error = "Device does not accept pairing";
+                }
+                else
+                {
+                    auto result = co_await pairing.PairAsync();
+                    auto status = result.Status();
+                    if (status != DevicePairingResultStatus::Paired && status != DevicePairingResultStatus::AlreadyPaired)
+                    {
+                        error = "Pairing failed with status " + std::to_string(static_cast<int>(status));
+                    }
+                }
+            }
+        }
+        catch (winrt::hresult_error const& ex)
+        {
+            error = ToError("Pairing", ex);
+        }
+        catch (...)
+        {
+            error = "Pairing threw an exception";
+        }
+        completion(error);
+    }
+
+    winrt::fire_and_forget WriteConfigAsync(uint64_t address, Lumina::GattConfigWrite write, LuminaProvisioningTransport::Completion completion)
+    {
+        std::string error;
+        try
+        {
+            auto device = co_await BluetoothLEDevice::FromBluetoothAddressAsync(address);
+            if (device == nullptr)
+            {
+                error = "Device not reachable";
+            }
+            else
+            {
+                auto services = co_await device.GetGattServicesForUuidAsync(ToGuid(write.service), BluetoothCacheMode::Uncached);
+                if (services.Status() != GattCommunicationStatus::Success || services.Services().Size() == 0)
+                {
+                    error = "Config service not found";
+                }
+                else
+                {
+                    auto characteristics = co_await services.Services().GetAt(0).GetCharacteristicsForUuidAsync(ToGuid(write.characteristic), BluetoothCacheMode::Uncached);
+                    if (characteristics.Status() != GattCommunicationStatus::Success || characteristics.Characteristics().Size() == 0)
+                    {
+                        error = "Config characteristic not found";
+                    }
+                    else
+                    {
+                        Windows::Storage::Streams::DataWriter writer;
+                        writer.WriteBytes(write.value);
+                        auto result = co_await characteristics.Characteristics().GetAt(0).WriteValueWithResultAsync(writer.DetachBuffer(), GattWriteOption::WriteWithResponse);
+                        if (result.Status() != GattCommunicationStatus::Success)
+                        {
+                            error = "Config write failed with status " + std::to_string(static_cast<int>(result.Status()));
+                        }
+                    }
+                }
+                device.Close();
+            }
+        }
+        catch (winrt::hresult_error const& ex)
+        {
+            error = ToError("Config write", ex);
+        }
+        catch (...)
+        {
+            error = "Config write threw an exception";
+        }
+        completion(error);
+    }
+}
+
+void LuminaActionProvisionDevice::Pair(uint64_t address, Completion completion)
+{
+    PairAsync(address, std::move(completion));
+}
+
+void LuminaActionProvisionDevice::WriteConfig(uint64_t address, const Lumina::GattConfigWrite& write, Completion completion)
+{
+    WriteConfigAsync(address, write, std::move(completion));
+}
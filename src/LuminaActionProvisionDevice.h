@@ -0,0 +1,12 @@
+#pragma once
+#include "LuminaProvisioner.h"
+
+// Provisioning over the system Bluetooth stack: pairs through the device's pairing API and writes
+// configuration with a GATT write-with-response. Operations hold no reference to this object, so it
+// may be destroyed while some are still in flight.
+class LuminaActionProvisionDevice : public LuminaProvisioningTransport
+{
+public:
+    void Pair(uint64_t address, Completion completion) override;
+    void WriteConfig(uint64_t address, const Lumina::GattConfigWrite& write, Completion completion) override;
+};
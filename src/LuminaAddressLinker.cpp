@@ -0,0 +1,551 @@
+#include <algorithm>
+#include <cmath>
+#include "LuminaAddressLinker.h"
+#include "LuminaHelper.h"
+
+namespace
+{
+    constexpr size_t MaxSampleTokens = 24;
+    constexpr float RssiSmoothing = 0.2f;
+    constexpr float HandoverScale = 1.0f;                           // Seconds of silence that halve the timing score
+    constexpr float RssiScale = 6.0f;                               // dB apart that halve the signal score
+    constexpr float AmbiguityMargin = 0.25f;                        // Lead over the next best candidate for full confidence
+    constexpr std::chrono::milliseconds HandoverOverlap{ 1000 };    // The old address may still be in flight when the new one starts
+    constexpr std::chrono::milliseconds MinInterval{ 15 };          // Shorter gaps are the same advert seen twice
+
+    // Feature kinds, kept in the top byte so equal values of different kinds never collide
+    enum TokenKind : uint64_t
+    {
+        TokenLayout = 1,
+        TokenManufacturerLength,
+        TokenManufacturerType,
+        TokenService,
+        TokenServiceData,
+        TokenTxPower,
+        TokenFlags,
+        TokenAppearance,
+        TokenName,
+        TokenInterval,
+    };
+
+    constexpr uint64_t Mix64(uint64_t value)
+    {
+        value ^= value >> 30;
+        value *= 0xbf58476d1ce4e5b9ull;
+        value ^= value >> 27;
+        value *= 0x94d049bb133111ebull;
+        value ^= value >> 31;
+        return value;
+    }
+
+    constexpr uint64_t Token(TokenKind kind, uint64_t value)
+    {
+        return Mix64((static_cast<uint64_t>(kind) << 56) ^ value);
+    }
+
+    // One (a * x + b) >> 32 hash per signature row; a is odd
+    struct MinHashSeeds
+    {
+        std::array<uint64_t, LuminaAddressLinker::SignatureSize> multipliers{};
+        std::array<uint64_t, LuminaAddressLinker::SignatureSize> offsets{};
+    };
+
+    constexpr MinHashSeeds MakeSeeds()
+    {
+        MinHashSeeds seeds;
+        uint64_t state = 0x4c756d696e61ull;
+        for (int i = 0; i < LuminaAddressLinker::SignatureSize; ++i)
+        {
+            state += 0x9e3779b97f4a7c15ull;
+            seeds.multipliers[i] = Mix64(state) | 1;
+            state += 0x9e3779b97f4a7c15ull;
+            seeds.offsets[i] = Mix64(state);
+        }
+        return seeds;
+    }
+    constexpr MinHashSeeds Seeds = MakeSeeds();
+
+    struct SampleTokens
+    {
+        std::array<uint64_t, MaxSampleTokens> values{};
+        size_t count = 0;
+        uint64_t hash = 0;  // Order-independent, to spot a repeated sample without touching the entry's tokens
+
+        void Add(TokenKind kind, uint64_t value)
+        {
+            if (count < values.size())
+            {
+                values[count] = Token(kind, value);
+                hash += values[count];
+                ++count;
+            }
+        }
+    };
+
+    size_t UuidListWidth(uint8_t type)
+    {
+        switch (type)
+        {
+        case 0x02: case 0x03: return 2;
+        case 0x04: case 0x05: return 4;
+        case 0x06: case 0x07: return 16;
+        default: return 0;
+        }
+    }
+
+    size_t ServiceDataUuidWidth(uint8_t type)
+    {
+        switch (type)
+        {
+        case 0x16: return 2;
+        case 0x20: return 4;
+        case 0x21: return 16;
+        default: return 0;
+        }
+    }
+
+    // What an advert says about the kind of device sending it, leaving out counters, nonces and other fields
+    // that change between adverts: the AD structure layout, manufacturer data by company, length and leading
+    // type byte, services, TX power, flags, appearance and name
+    SampleTokens ExtractTokens(const Lumina::AdvertisementSample& sample)
+    {
+        SampleTokens tokens;
+        const bool isScanResponse = sample.advertisementType == Lumina::AdvertisementSample::ScanResponseType;
+        uint64_t layout = LuminaHelper::HashSeed ^ static_cast<uint64_t>(isScanResponse);
+        Lumina::AdvertisementParser::ForEachSection(sample.payload, sample.payloadLength,
+            [&](uint8_t type, const uint8_t* data, size_t size)
+            {
+                layout = LuminaHelper::HashBytes(&type, 1, layout);
+                if (size_t width = UuidListWidth(type))
+                {
+                    for (size_t offset = 0; offset + width <= size; offset += width)
+                    {
+                        tokens.Add(TokenService, LuminaHelper::HashBytes(data + offset, width));
+                    }
+                }
+                else if (size_t uuidWidth = ServiceDataUuidWidth(type))
+                {
+                    if (size >= uuidWidth)
+                    {
+                        tokens.Add(TokenServiceData, LuminaHelper::HashBytes(data, uuidWidth) ^ size);
+                    }
+                }
+                else if (type == 0xFF && size >= 2)
+                {
+                    const uint64_t company = data[0] | (data[1] << 8);
+                    tokens.Add(TokenManufacturerLength, (company << 16) | size);
+                    if (size >= 3)
+                    {
+                        tokens.Add(TokenManufacturerType, (company << 8) | data[2]);
+                    }
+                }
+                else if (type == 0x0A && size >= 1)
+                {
+                    tokens.Add(TokenTxPower, data[0]);
+                }
+                else if (type == 0x01 && size >= 1)
+                {
+                    tokens.Add(TokenFlags, data[0]);
+                }
+                else if (type == 0x19 && size >= 2)
+                {
+                    tokens.Add(TokenAppearance, data[0] | (data[1] << 8));
+                }
+                else if ((type == 0x08 || type == 0x09) && size > 0)
+                {
+                    tokens.Add(TokenName, LuminaHelper::HashBytes(data, size));
+                }
+                return true;
+            });
+        tokens.Add(TokenLayout, layout);
+        return tokens;
+    }
+
+    // Merges into the sorted set up to its cap; returns true if anything was added
+    bool AddTokens(std::vector<uint64_t>& set, const uint64_t* tokens, size_t count)
+    {
+        bool isAdded = false;
+        for (size_t i = 0; i < count && set.size() < LuminaAddressLinker::MaxTokens; ++i)
+        {
+            auto it = std::lower_bound(set.begin(), set.end(), tokens[i]);
+            if (it == set.end() || *it != tokens[i])
+            {
+                set.insert(it, tokens[i]);
+                isAdded = true;
+            }
+        }
+        return isAdded;
+    }
+
+    float Jaccard(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b)
+    {
+        size_t shared = 0;
+        auto itA = a.begin();
+        auto itB = b.begin();
+        while (itA != a.end() && itB != b.end())
+        {
+            if (*itA < *itB)
+            {
+                ++itA;
+            }
+            else if (*itB < *itA)
+            {
+                ++itB;
+            }
+            else
+            {
+                ++shared;
+                ++itA;
+                ++itB;
+            }
+        }
+        const size_t total = a.size() + b.size() - shared;
+        return total > 0 ? static_cast<float>(shared) / static_cast<float>(total) : 0.0f;
+    }
+}
+
+LuminaAddressLinker::LuminaAddressLinker()
+    : LuminaAddressLinker(Options{})
+{
+}
+
+LuminaAddressLinker::LuminaAddressLinker(const Options& options)
+    : m_Options(options)
+{
+}
+
+bool LuminaAddressLinker::IsRotatingAddress(const Lumina::AdvertisementSample& sample)
+{
+    const uint64_t topBits = sample.address >> 46;
+    switch (sample.addressType)
+    {
+    case Lumina::AdvertisementSample::AddressRandom:
+        return topBits != 0x3;  // 0b11 is a static random address
+    case Lumina::AdvertisementSample::AddressUnknown:
+        return topBits == 0x1;  // Only a resolvable private address can be told apart by its bits
+    default:
+        return false;
+    }
+}
+
+std::optional<LuminaAddressLinker::Link> LuminaAddressLinker::Observe(const Lumina::AdvertisementSample& sample)
+{
+    // Fragments are partial payloads; the completed advert is what describes the device
+    if (!IsRotatingAddress(sample) || sample.dataStatus == Lumina::AdvertisementSample::DataMoreToCome)
+    {
+        return std::nullopt;
+    }
+
+    const SampleTokens tokens = ExtractTokens(sample);
+    const auto now = sample.timestamp;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (now >= m_NextSweep)
+    {
+        Sweep_Internal(now);
+        m_NextSweep = now + SweepPeriod;
+    }
+
+    auto [indexed, isInserted] = m_Index.try_emplace(sample.address, 0);
+    if (isInserted)
+    {
+        uint32_t id;
+        if (!m_FreeEntries.empty())
+        {
+            id = m_FreeEntries.back();
+            m_FreeEntries.pop_back();
+        }
+        else
+        {
+            id = static_cast<uint32_t>(m_Entries.size());
+            m_Entries.emplace_back();
+        }
+        indexed->second = id;
+
+        // Reused entries keep their token storage
+        Entry& entry = m_Entries[id];
+        std::vector<uint64_t> storage = std::move(entry.tokens);
+        storage.clear();
+        entry = Entry{};
+        entry.tokens = std::move(storage);
+        entry.isInUse = true;
+        entry.address = sample.address;
+        entry.firstSeen = now;
+        entry.lastSeen = now;
+        entry.rssi = sample.rssi;
+    }
+
+    const uint32_t id = indexed->second;
+    Entry& entry = m_Entries[id];
+    entry.lastSeen = std::max(entry.lastSeen, now);
+    entry.isQuiet = false;
+    entry.rssi += (static_cast<float>(sample.rssi) - entry.rssi) * RssiSmoothing;
+
+    bool isChanged = false;
+    if (sample.advertisementType != Lumina::AdvertisementSample::ScanResponseType && entry.intervalCount < IntervalSamples)
+    {
+        // The shortest gap is the interval itself; longer ones are adverts that were missed
+        const auto interval = now - entry.lastPrimary;
+        if (entry.lastPrimary == std::chrono::steady_clock::time_point{})
+        {
+            entry.lastPrimary = now;
+        }
+        else if (interval >= MinInterval)
+        {
+            if (entry.intervalCount == 0 || interval < entry.shortestInterval)
+            {
+                entry.shortestInterval = interval;
+            }
+            entry.lastPrimary = now;
+            if (++entry.intervalCount == IntervalSamples)
+            {
+                // Half-octave buckets absorb the controller's random advertising delay
+                const double milliseconds = std::chrono::duration<double, std::milli>(entry.shortestInterval).count();
+                const uint64_t token = Token(TokenInterval, static_cast<uint64_t>(std::lround(2.0 * std::log2(milliseconds))));
+                isChanged |= AddTokens(entry.tokens, &token, 1);
+            }
+        }
+    }
+
+    if (tokens.hash != entry.lastSampleHash)
+    {
+        entry.lastSampleHash = tokens.hash;
+        isChanged |= AddTokens(entry.tokens, tokens.values.data(), tokens.count);
+    }
+
+    if (isChanged)
+    {
+        Fingerprint_Internal(id);
+    }
+    else if (!entry.isIndexed && !entry.tokens.empty())
+    {
+        // Back after a long silence
+        Index_Internal(id);
+    }
+
+    if (entry.isLinkPending && now - entry.firstSeen >= ConfirmDelay)
+    {
+        entry.isLinkPending = false;
+        return FindLink_Internal(id);
+    }
+    return std::nullopt;
+}
+
+void LuminaAddressLinker::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Entries.clear();
+    m_FreeEntries.clear();
+    m_Index.clear();
+    for (auto& band : m_Bands)
+    {
+        band.clear();
+    }
+    m_NextSweep = {};
+    m_Stats = {};
+}
+
+LuminaAddressLinker::Stats LuminaAddressLinker::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Stats stats = m_Stats;
+    stats.activeAddresses = m_Index.size();
+    return stats;
+}
+
+void LuminaAddressLinker::Fingerprint_Internal(uint32_t id)
+{
+    Entry& entry = m_Entries[id];
+    entry.signature.fill(UINT32_MAX);
+    for (uint64_t token : entry.tokens)
+    {
+        for (int i = 0; i < SignatureSize; ++i)
+        {
+            const uint32_t value = static_cast<uint32_t>((token * Seeds.multipliers[i] + Seeds.offsets[i]) >> 32);
+            entry.signature[i] = std::min(entry.signature[i], value);
+        }
+    }
+
+    Unindex_Internal(id);
+    for (int band = 0; band < BandCount; ++band)
+    {
+        uint64_t key = Mix64(static_cast<uint64_t>(band) + 1);
+        for (int row = 0; row < RowsPerBand; ++row)
+        {
+            key = Mix64(key ^ entry.signature[band * RowsPerBand + row]);
+        }
+        entry.bandKeys[band] = key;
+    }
+    Index_Internal(id);
+
+    entry.isLinkPending = true;
+    ++m_Stats.fingerprints;
+}
+
+void LuminaAddressLinker::Index_Internal(uint32_t id)
+{
+    Entry& entry = m_Entries[id];
+    for (int band = 0; band < BandCount; ++band)
+    {
+        m_Bands[band][entry.bandKeys[band]].push_back(id);
+    }
+    entry.isIndexed = true;
+}
+
+void LuminaAddressLinker::Unindex_Internal(uint32_t id)
+{
+    Entry& entry = m_Entries[id];
+    if (!entry.isIndexed)
+    {
+        return;
+    }
+    for (int band = 0; band < BandCount; ++band)
+    {
+        auto bucket = m_Bands[band].find(entry.bandKeys[band]);
+        if (bucket == m_Bands[band].end())
+        {
+            continue;
+        }
+        // Erased in place: buckets stay ordered by when entries went quiet
+        auto& ids = bucket->second;
+        ids.erase(std::find(ids.begin(), ids.end(), id));
+        if (ids.empty())
+        {
+            m_Bands[band].erase(bucket);
+        }
+    }
+    entry.isIndexed = false;
+}
+
+void LuminaAddressLinker::Remove_Internal(uint32_t id)
+{
+    Entry& entry = m_Entries[id];
+    Unindex_Internal(id);
+    m_Index.erase(entry.address);
+    entry.isInUse = false;
+    m_FreeEntries.push_back(id);
+}
+
+std::optional<LuminaAddressLinker::Link> LuminaAddressLinker::FindLink_Internal(uint32_t id)
+{
+    if (++m_Visit == 0)
+    {
+        for (Entry& other : m_Entries)
+        {
+            other.visit = 0;
+        }
+        m_Visit = 1;
+    }
+
+    Entry& entry = m_Entries[id];
+    entry.visit = m_Visit;
+    Entry* best = nullptr;
+    float bestConfidence = 0.0f;
+    float runnerUpConfidence = 0.0f;
+    for (int band = 0; band < BandCount; ++band)
+    {
+        auto bucket = m_Bands[band].find(entry.bandKeys[band]);
+        if (bucket == m_Bands[band].end())
+        {
+            continue;
+        }
+
+        // Newest first: the back of a bucket holds the addresses that went quiet most recently
+        const auto& ids = bucket->second;
+        size_t checked = 0;
+        for (auto it = ids.rbegin(); it != ids.rend() && checked < MaxCandidatesPerBucket; ++it)
+        {
+            Entry& candidate = m_Entries[*it];
+            if (candidate.visit == m_Visit)
+            {
+                continue;
+            }
+            candidate.visit = m_Visit;
+            ++checked;
+            ++m_Stats.candidatesChecked;
+
+            // Must have gone quiet about when this address started, and not already be continued by another
+            const auto gap = entry.firstSeen - candidate.lastSeen;
+            if (candidate.firstSeen >= entry.firstSeen || gap < -HandoverOverlap || gap > m_Options.maxHandoverGap ||
+                (candidate.hasSuccessor && candidate.address != entry.predecessor))
+            {
+                continue;
+            }
+
+            const float similarity = Jaccard(entry.tokens, candidate.tokens);
+            const float gapSeconds = std::max(0.0f, std::chrono::duration<float>(gap).count());
+            const float timeScore = 1.0f / (1.0f + gapSeconds / HandoverScale);
+            const float rssiDelta = (entry.rssi - candidate.rssi) / RssiScale;
+            const float rssiScore = 1.0f / (1.0f + rssiDelta * rssiDelta);
+            const float confidence = similarity * (0.5f + 0.5f * timeScore) * (0.5f + 0.5f * rssiScore);
+            if (confidence > bestConfidence)
+            {
+                best = &candidate;
+                runnerUpConfidence = bestConfidence;
+                bestConfidence = confidence;
+            }
+            else if (confidence > runnerUpConfidence)
+            {
+                runnerUpConfidence = confidence;
+            }
+        }
+    }
+
+    // A close second means several look-alike devices handed over at once; the margin is what the guess is worth
+    if (best)
+    {
+        bestConfidence *= std::min(1.0f, (bestConfidence - runnerUpConfidence) / AmbiguityMargin);
+    }
+    if (!best || bestConfidence < m_Options.minConfidence || (entry.predecessor != 0 && bestConfidence <= entry.hopConfidence))
+    {
+        return std::nullopt;
+    }
+
+    if (entry.predecessor != best->address)
+    {
+        auto previous = m_Index.find(entry.predecessor);
+        if (entry.predecessor != 0 && previous != m_Index.end())
+        {
+            m_Entries[previous->second].hasSuccessor = false;
+        }
+        best->hasSuccessor = true;
+        ++m_Stats.links;
+    }
+
+    // Chains collapse onto their first address, as sure as their weakest hop
+    entry.predecessor = best->address;
+    entry.hopConfidence = bestConfidence;
+    entry.linkedAddress = best->linkedAddress != 0 ? best->linkedAddress : best->address;
+    entry.linkConfidence = best->linkedAddress != 0 ? std::min(best->linkConfidence, bestConfidence) : bestConfidence;
+    return Link{ entry.address, entry.linkedAddress, entry.linkConfidence };
+}
+
+void LuminaAddressLinker::Sweep_Internal(std::chrono::steady_clock::time_point now)
+{
+    for (uint32_t id = 0; id < m_Entries.size(); ++id)
+    {
+        Entry& entry = m_Entries[id];
+        if (!entry.isInUse)
+        {
+            continue;
+        }
+
+        const auto silent = now - entry.lastSeen;
+        if (silent > m_Options.expireAfter)
+        {
+            Remove_Internal(id);
+        }
+        else if (silent > 2 * m_Options.maxHandoverGap)
+        {
+            // Too long gone to hand over to a new address, with slack for slow advertisers confirming late
+            Unindex_Internal(id);
+        }
+        else if (!entry.isQuiet && silent > QuietAfter && entry.isIndexed)
+        {
+            // Moved to the back, where lookups start
+            Unindex_Internal(id);
+            Index_Internal(id);
+            entry.isQuiet = true;
+        }
+    }
+}
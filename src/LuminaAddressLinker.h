@@ -0,0 +1,112 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "LuminaAdvertisement.h"
+
+// Links the rotating random addresses of devices whose IRK we do not have. Each address is fingerprinted by
+// what its adverts look like: AD structure layout, manufacturer data layout, services, TX power, name and
+// advertising interval, as a set of feature tokens summarised by a MinHash signature. LSH bands put addresses
+// whose signatures agree on a whole band into one bucket, so candidates come from a few bucket lookups rather
+// than a pass over every address. A candidate becomes a link when it looks alike, went quiet just before the
+// new address appeared, and was heard at a similar signal strength.
+class LuminaAddressLinker
+{
+public:
+    static constexpr int SignatureSize = 32;
+    static constexpr int BandCount = 8;
+    static constexpr int RowsPerBand = SignatureSize / BandCount;
+    static constexpr size_t MaxTokens = 32;                 // Per address; later features are ignored
+    static constexpr size_t MaxCandidatesPerBucket = 64;    // Entries checked per crowded bucket, most recently quiet first
+
+    struct Options
+    {
+        float minConfidence = 0.6f;
+        std::chrono::milliseconds maxHandoverGap{ 15000 };  // The new address must appear within this of the old going quiet
+        std::chrono::milliseconds expireAfter{ 300000 };    // Addresses silent this long are forgotten
+    };
+
+    struct Link
+    {
+        uint64_t address = 0;
+        uint64_t linkedAddress = 0;     // First address of the chain this one continues
+        float confidence = 0.0f;        // Of the weakest hop in the chain
+    };
+
+    struct Stats
+    {
+        size_t activeAddresses = 0;
+        uint64_t fingerprints = 0;      // Signatures computed
+        uint64_t candidatesChecked = 0;
+        uint64_t links = 0;
+    };
+
+    LuminaAddressLinker();
+    explicit LuminaAddressLinker(const Options& options);
+
+    // Thread-safe. Returns the link this sample created or improved, if any.
+    std::optional<Link> Observe(const Lumina::AdvertisementSample& sample);
+    void Clear();
+    Stats GetStats() const;
+
+    // Random addresses other than static ones; public addresses never rotate
+    static bool IsRotatingAddress(const Lumina::AdvertisementSample& sample);
+
+private:
+    static constexpr int IntervalSamples = 8;   // Primary adverts timed before the interval joins the fingerprint
+
+    // A new address is only matched once it has been heard for a while, so that an address still advertising
+    // after it appeared has shown it is a different device
+    static constexpr std::chrono::milliseconds ConfirmDelay{ 3000 };
+    static constexpr std::chrono::milliseconds QuietAfter{ 2000 };
+    static constexpr std::chrono::milliseconds SweepPeriod{ 1000 };
+
+    struct Entry
+    {
+        bool isInUse = false;
+        uint64_t address = 0;
+        std::chrono::steady_clock::time_point firstSeen;
+        std::chrono::steady_clock::time_point lastSeen;
+        float rssi = 0.0f;                      // Smoothed
+
+        uint64_t lastSampleHash = 0;            // Token hash of the last sample, to skip repeats
+        std::vector<uint64_t> tokens;           // Sorted
+        std::array<uint32_t, SignatureSize> signature{};
+        std::array<uint64_t, BandCount> bandKeys{};
+        bool isIndexed = false;
+        bool isQuiet = false;                   // Moved to the back of its buckets by the sweep
+        bool isLinkPending = false;             // Fingerprint changed since candidates were last looked up
+        uint32_t visit = 0;                     // Marks candidates already checked in this lookup
+
+        std::chrono::steady_clock::time_point lastPrimary;
+        std::chrono::steady_clock::duration shortestInterval{};
+        int intervalCount = 0;
+
+        uint64_t predecessor = 0;               // Address this one took over from
+        float hopConfidence = 0.0f;
+        uint64_t linkedAddress = 0;
+        float linkConfidence = 0.0f;
+        bool hasSuccessor = false;
+    };
+
+    Options m_Options;
+    mutable std::mutex m_Mutex;
+    std::vector<Entry> m_Entries;
+    std::vector<uint32_t> m_FreeEntries;
+    std::unordered_map<uint64_t, uint32_t> m_Index;
+    std::array<std::unordered_map<uint64_t, std::vector<uint32_t>>, BandCount> m_Bands;
+    std::chrono::steady_clock::time_point m_NextSweep;
+    uint32_t m_Visit = 0;
+    Stats m_Stats;
+
+    void Fingerprint_Internal(uint32_t id);
+    void Index_Internal(uint32_t id);
+    void Unindex_Internal(uint32_t id);
+    void Remove_Internal(uint32_t id);
+    std::optional<Link> FindLink_Internal(uint32_t id);
+    void Sweep_Internal(std::chrono::steady_clock::time_point now);
+};
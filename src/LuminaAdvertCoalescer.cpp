@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cstring>
+#include "LuminaAdvertCoalescer.h"
+#include "LuminaHelper.h"
+
+LuminaAdvertCoalescer::LuminaAdvertCoalescer()
+    : m_Assemblies(AssemblyCount)
+{
+    m_Records.reserve(InitialCapacity);
+    m_Index.reserve(InitialCapacity);
+}
+
+LuminaAdvertCoalescer::MergeResult LuminaAdvertCoalescer::Merge(const Lumina::AdvertisementSample& sample)
+{
+    auto [indexed, isInserted] = m_Index.try_emplace(sample.address, static_cast<uint32_t>(m_Records.size()));
+    if (isInserted)
+    {
+        m_Records.emplace_back();
+        m_Records.back().address = sample.address;
+    }
+    const uint32_t recordIndex = indexed->second;
+    Record& record = m_Records[recordIndex];
+    const bool isScanResponse = sample.advertisementType == Lumina::AdvertisementSample::ScanResponseType;
+
+    const uint8_t* payload = sample.payload;
+    size_t length = sample.payloadLength;
+    Assembly* assembly = record.assembly >= 0 ? &m_Assemblies[record.assembly] : nullptr;
+    if (assembly && assembly->isScanResponse != isScanResponse)
+    {
+        // The other slot started sending before this chain finished; its tail is lost
+        AbandonAssembly(record, sample.timestamp, true);
+        assembly = nullptr;
+    }
+    if (!assembly && record.isTailLost && record.isLostTailScanResponse == isScanResponse)
+    {
+        if (sample.timestamp - record.tailLostTime <= LostTailWindow)
+        {
+            // The rest of an abandoned chain: on its own it would replace the slot with a fragment
+            if (sample.dataStatus != Lumina::AdvertisementSample::DataMoreToCome)
+            {
+                record.isTailLost = false;
+            }
+            ++m_Stats.orphanFragments;
+            return {};
+        }
+        record.isTailLost = false;
+    }
+    if (!assembly && sample.dataStatus == Lumina::AdvertisementSample::DataMoreToCome)
+    {
+        assembly = TakeAssembly(recordIndex, isScanResponse, sample.timestamp);
+    }
+    if (assembly)
+    {
+        if (assembly->length + length > MaxAssembledSize)
+        {
+            AbandonAssembly(record, sample.timestamp, sample.dataStatus == Lumina::AdvertisementSample::DataMoreToCome);
+            return {};
+        }
+        std::memcpy(assembly->data + assembly->length, sample.payload, length);
+        assembly->length += length;
+        if (sample.dataStatus == Lumina::AdvertisementSample::DataMoreToCome)
+        {
+            return {};
+        }
+        // Complete, or truncated by the controller: either way this is all of it
+        payload = assembly->data;
+        length = assembly->length;
+        ++m_Stats.reassembled;
+    }
+
+    // A payload the controller cut short only fills an empty slot; it would drop the name or UUIDs of a whole one
+    const Slot& slot = isScanResponse ? record.scanResponse : record.primary;
+    if (sample.dataStatus == Lumina::AdvertisementSample::DataTruncated && slot.isFilled)
+    {
+        if (assembly)
+        {
+            ReleaseAssembly(record);
+        }
+        ++m_Stats.truncatedIgnored;
+        MergeResult result;
+        result.record = &record;
+        return result;
+    }
+
+    // New once something has actually been merged, not when its first fragment arrived
+    MergeResult result;
+    result.record = &record;
+    result.isNew = !record.primary.isFilled && !record.scanResponse.isFilled;
+    result.changed = MergeSlot(record, isScanResponse, payload, length);
+    if (result.isNew)
+    {
+        result.changed = ChangeAll;
+    }
+    if (assembly)
+    {
+        ReleaseAssembly(record);
+    }
+
+    ++m_Stats.merged;
+    if (result.changed == 0)
+    {
+        ++m_Stats.unchanged;
+    }
+    return result;
+}
+
+void LuminaAdvertCoalescer::Remove(uint64_t address)
+{
+    auto indexed = m_Index.find(address);
+    if (indexed == m_Index.end())
+    {
+        return;
+    }
+    const uint32_t recordIndex = indexed->second;
+    m_Index.erase(indexed);
+    ReleaseAssembly(m_Records[recordIndex]);
+
+    // The last record takes the freed place; its index entry and chain follow it
+    if (recordIndex + 1 != m_Records.size())
+    {
+        Record& moved = m_Records[recordIndex];
+        moved = std::move(m_Records.back());
+        m_Index[moved.address] = recordIndex;
+        if (moved.assembly >= 0)
+        {
+            m_Assemblies[moved.assembly].record = recordIndex;
+        }
+    }
+    m_Records.pop_back();
+}
+
+void LuminaAdvertCoalescer::Clear()
+{
+    // Keeps the storage, however far it grew, for the next scan
+    m_Records.clear();
+    m_Index.clear();
+    for (Assembly& assembly : m_Assemblies)
+    {
+        assembly.isInUse = false;
+    }
+    m_Stats = {};
+}
+
+LuminaAdvertCoalescer::Assembly* LuminaAdvertCoalescer::TakeAssembly(uint32_t record, bool isScanResponse, std::chrono::steady_clock::time_point time)
+{
+    // A free entry, or else the oldest chain: it has most likely lost its last fragment
+    auto it = std::find_if(m_Assemblies.begin(), m_Assemblies.end(), [](const Assembly& assembly) { return !assembly.isInUse; });
+    if (it == m_Assemblies.end())
+    {
+        it = std::min_element(m_Assemblies.begin(), m_Assemblies.end(),
+            [](const Assembly& a, const Assembly& b) { return a.started < b.started; });
+        AbandonAssembly(m_Records[it->record], time, true);
+    }
+
+    it->isInUse = true;
+    it->record = record;
+    it->isScanResponse = isScanResponse;
+    it->started = time;
+    it->length = 0;
+    m_Records[record].assembly = static_cast<int>(it - m_Assemblies.begin());
+    return &*it;
+}
+
+void LuminaAdvertCoalescer::ReleaseAssembly(Record& record)
+{
+    if (record.assembly >= 0)
+    {
+        m_Assemblies[record.assembly].isInUse = false;
+        record.assembly = -1;
+    }
+}
+
+void LuminaAdvertCoalescer::AbandonAssembly(Record& record, std::chrono::steady_clock::time_point time, bool isTailPending)
+{
+    record.isTailLost = isTailPending;
+    record.isLostTailScanResponse = m_Assemblies[record.assembly].isScanResponse;
+    record.tailLostTime = time;
+    ReleaseAssembly(record);
+    ++m_Stats.droppedFragments;
+}
+
+uint32_t LuminaAdvertCoalescer::MergeSlot(Record& record, bool isScanResponse, const uint8_t* payload, size_t length)
+{
+    Slot& slot = isScanResponse ? record.scanResponse : record.primary;
+    uint64_t hash = LuminaHelper::HashBytes(payload, length);
+    if (slot.isFilled && slot.hash == hash)
+    {
+        return 0;
+    }
+
+    slot.isFilled = true;
+    slot.hash = hash;
+    slot.flags = Lumina::AdvertisementParser::GetFlags(payload, length);
+    auto name = Lumina::AdvertisementParser::GetLocalName(payload, length, &slot.isNameComplete);
+    slot.name.assign(name ? *name : std::string());
+    slot.serviceUuids.clear();
+    Lumina::AdvertisementParser::GetServiceUuids(payload, length, slot.serviceUuids);
+
+    // Rebuild the merged view from both slots and report what moved
+    uint32_t changed = 0;
+    const Slot& primary = record.primary;
+    const Slot& scanResponse = record.scanResponse;
+    const std::string* mergedName = &primary.name;
+    if (primary.name.empty() || (!primary.isNameComplete && scanResponse.isNameComplete && !scanResponse.name.empty()))
+    {
+        mergedName = scanResponse.name.empty() ? &primary.name : &scanResponse.name;
+    }
+    if (record.name != *mergedName)
+    {
+        record.name = *mergedName;
+        changed |= ChangeName;
+    }
+
+    std::optional<uint8_t> mergedFlags = primary.flags ? primary.flags : scanResponse.flags;
+    if (record.flags != mergedFlags)
+    {
+        record.flags = mergedFlags;
+        changed |= ChangeFlags;
+    }
+
+    m_MergedUuids.assign(primary.serviceUuids.begin(), primary.serviceUuids.end());
+    for (const Lumina::ServiceUuid& uuid : scanResponse.serviceUuids)
+    {
+        if (std::find(m_MergedUuids.begin(), m_MergedUuids.end(), uuid) == m_MergedUuids.end())
+        {
+            m_MergedUuids.push_back(uuid);
+        }
+    }
+    if (record.serviceUuids != m_MergedUuids)
+    {
+        record.serviceUuids.swap(m_MergedUuids);
+        changed |= ChangeServices;
+    }
+    return changed;
+}
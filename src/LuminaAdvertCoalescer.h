@@ -0,0 +1,108 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "LuminaAdvertisement.h"
+
+// Folds everything one device advertises into a single record. Active scanning delivers the advert and its
+// scan response as separate samples, and extended adverts too long for one sample arrive as fragments; each
+// kind keeps its own slot, so a sample only replaces what it actually carries. A slot is re-parsed only when
+// its bytes change, and the merged fields report which of them moved.
+//
+// Not thread-safe: give each ingest shard its own.
+class LuminaAdvertCoalescer
+{
+public:
+    static constexpr size_t MaxAssembledSize = 1650;  // Longest extended advertising data
+    static constexpr size_t AssemblyCount = 8;        // Fragment chains in flight at once
+    static constexpr size_t InitialCapacity = 256;    // Records reserved at construction; grows with the devices seen
+    // Fragments of a chain arrive within one advertising event. Once a chain is abandoned, further fragments
+    // of that slot within this window are its tail rather than a new advert.
+    static constexpr std::chrono::milliseconds LostTailWindow{ 100 };
+
+    // Bits of MergeResult::changed
+    static constexpr uint32_t ChangeName = 1 << 0;
+    static constexpr uint32_t ChangeServices = 1 << 1;
+    static constexpr uint32_t ChangeFlags = 1 << 2;
+    static constexpr uint32_t ChangeAll = ChangeName | ChangeServices | ChangeFlags;
+
+    struct Slot
+    {
+        bool isFilled = false;
+        uint64_t hash = 0;
+        std::optional<uint8_t> flags;
+        std::string name;
+        bool isNameComplete = false;
+        std::vector<Lumina::ServiceUuid> serviceUuids;
+    };
+
+    struct Record
+    {
+        uint64_t address = 0;
+        Slot primary;
+        Slot scanResponse;
+        int assembly = -1;  // Index into the assembly pool while fragments are arriving
+
+        // Set when a chain was abandoned before its last fragment, so the rest of it is dropped instead of
+        // being merged as if it were a whole advert
+        bool isTailLost = false;
+        bool isLostTailScanResponse = false;
+        std::chrono::steady_clock::time_point tailLostTime;
+
+        // Merged view: the complete name wins over a shortened one, the primary advert over the scan response
+        std::string name;   // Empty if neither slot carries one
+        std::optional<uint8_t> flags;
+        std::vector<Lumina::ServiceUuid> serviceUuids;
+    };
+
+    struct MergeResult
+    {
+        const Record* record = nullptr;  // nullptr while a fragmented advert is incomplete; valid until the next Merge
+        uint32_t changed = 0;            // 0 when the sample repeated what the record already had
+        bool isNew = false;
+    };
+
+    struct Stats
+    {
+        uint64_t merged = 0;
+        uint64_t unchanged = 0;
+        uint64_t reassembled = 0;        // Extended adverts put back together from fragments
+        uint64_t droppedFragments = 0;   // Chains abandoned: overflowed, interrupted or evicted
+        uint64_t orphanFragments = 0;    // Later fragments of abandoned chains, dropped
+        uint64_t truncatedIgnored = 0;   // Cut-short payloads kept out of a slot that already had a whole one
+    };
+
+    LuminaAdvertCoalescer();
+
+    MergeResult Merge(const Lumina::AdvertisementSample& sample);
+    // Forgets one device, including a chain it has in flight; its next sample starts a fresh record
+    void Remove(uint64_t address);
+    void Clear();
+    const Stats& GetStats() const { return m_Stats; }
+
+private:
+    struct Assembly
+    {
+        bool isInUse = false;
+        uint32_t record = 0;
+        bool isScanResponse = false;
+        std::chrono::steady_clock::time_point started;
+        size_t length = 0;
+        uint8_t data[MaxAssembledSize];
+    };
+
+    std::vector<Record> m_Records;
+    std::unordered_map<uint64_t, uint32_t> m_Index;
+    std::vector<Assembly> m_Assemblies;
+    std::vector<Lumina::ServiceUuid> m_MergedUuids;   // Scratch for rebuilding the merged list
+    Stats m_Stats;
+
+    Assembly* TakeAssembly(uint32_t record, bool isScanResponse, std::chrono::steady_clock::time_point time);
+    void ReleaseAssembly(Record& record);
+    // Drops the record's chain; if more fragments are still to come, they are dropped as they arrive
+    void AbandonAssembly(Record& record, std::chrono::steady_clock::time_point time, bool isTailPending);
+    uint32_t MergeSlot(Record& record, bool isScanResponse, const uint8_t* payload, size_t length);
+};
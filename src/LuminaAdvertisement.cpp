@@ -0,0 +1,134 @@
+#include <cstring>
+#include "LuminaAdvertisement.h"
+
+namespace
+{
+    constexpr uint8_t AdTypeFlags = 0x01;
+    constexpr uint8_t AdTypeShortenedLocalName = 0x08;
+    constexpr uint8_t AdTypeCompleteLocalName = 0x09;
+
+    uint64_t ReadLittleEndian(const uint8_t* data, size_t size)
+    {
+        uint64_t value = 0;
+        for (size_t i = size; i > 0; --i)
+        {
+            value = (value << 8) | data[i - 1];
+        }
+        return value;
+    }
+}
+
+namespace Lumina
+{
+    bool AdvertisementSample::AppendSection(uint8_t type, const uint8_t* data, size_t size)
+    {
+        if (size > 254 || payloadLength + 2 + size > MaxPayloadSize)
+        {
+            return false;
+        }
+        payload[payloadLength++] = static_cast<uint8_t>(size + 1);
+        payload[payloadLength++] = type;
+        if (size > 0)
+        {
+            std::memcpy(payload + payloadLength, data, size);
+        }
+        payloadLength = static_cast<uint16_t>(payloadLength + size);
+        return true;
+    }
+
+    bool AdvertisementSample::HasSamePayload(const AdvertisementSample& other) const
+    {
+        return advertisementType == other.advertisementType &&
+            dataStatus == other.dataStatus &&
+            payloadLength == other.payloadLength &&
+            std::memcmp(payload, other.payload, payloadLength) == 0;
+    }
+
+    namespace AdvertisementParser
+    {
+        std::optional<uint8_t> GetFlags(const AdvertisementSample& sample)
+        {
+            return GetFlags(sample.payload, sample.payloadLength);
+        }
+
+        std::optional<std::string> GetLocalName(const AdvertisementSample& sample)
+        {
+            return GetLocalName(sample.payload, sample.payloadLength);
+        }
+
+        void GetServiceUuids(const AdvertisementSample& sample, std::vector<ServiceUuid>& uuids)
+        {
+            GetServiceUuids(sample.payload, sample.payloadLength, uuids);
+        }
+
+        std::optional<uint8_t> GetFlags(const uint8_t* payload, size_t length)
+        {
+            std::optional<uint8_t> flags;
+            ForEachSection(payload, length, [&flags](uint8_t type, const uint8_t* data, size_t size)
+                {
+                    if (type == AdTypeFlags && size > 0)
+                    {
+                        flags = data[0];
+                        return false;
+                    }
+                    return true;
+                });
+            return flags;
+        }
+
+        std::optional<std::string> GetLocalName(const uint8_t* payload, size_t length, bool* isComplete)
+        {
+            // Prefer the complete name, fall back to the shortened one
+            std::optional<std::string> name;
+            bool isCompleteName = false;
+            ForEachSection(payload, length, [&name, &isCompleteName](uint8_t type, const uint8_t* data, size_t size)
+                {
+                    if (type == AdTypeCompleteLocalName)
+                    {
+                        name = std::string(reinterpret_cast<const char*>(data), size);
+                        isCompleteName = true;
+                        return false;
+                    }
+                    if (type == AdTypeShortenedLocalName && !name)
+                    {
+                        name = std::string(reinterpret_cast<const char*>(data), size);
+                    }
+                    return true;
+                });
+            if (isComplete)
+            {
+                *isComplete = isCompleteName;
+            }
+            return name;
+        }
+
+        void GetServiceUuids(const uint8_t* payload, size_t length, std::vector<ServiceUuid>& uuids)
+        {
+            ForEachSection(payload, length, [&uuids](uint8_t type, const uint8_t* data, size_t size)
+                {
+                    // 0x02/0x03: 16-bit, 0x04/0x05: 32-bit, 0x06/0x07: 128-bit, all little-endian
+                    size_t width = (type == 0x02 || type == 0x03) ? 2
+                        : (type == 0x04 || type == 0x05) ? 4
+                        : (type == 0x06 || type == 0x07) ? 16
+                        : 0;
+                    for (size_t offset = 0; width > 0 && offset + width <= size; offset += width)
+                    {
+                        ServiceUuid uuid;
+                        if (width == 16)
+                        {
+                            uuid.low = ReadLittleEndian(data + offset, 8);
+                            uuid.high = ReadLittleEndian(data + offset + 8, 8);
+                        }
+                        else
+                        {
+                            // Short aliases expand onto the Bluetooth base UUID
+                            uuid.high = (ReadLittleEndian(data + offset, width) << 32) | 0x00001000ull;
+                            uuid.low = 0x800000805f9b34fbull;
+                        }
+                        uuids.push_back(uuid);
+                    }
+                    return true;
+                });
+        }
+    }
+}
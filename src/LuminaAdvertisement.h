@@ -0,0 +1,88 @@
+#pragma once
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace Lumina
+{
+    // 128-bit service UUID in textual byte order (high = first 8 bytes).
+    struct ServiceUuid
+    {
+        uint64_t high;
+        uint64_t low;
+
+        bool operator==(const ServiceUuid& other) const { return high == other.high && low == other.low; }
+        bool operator<(const ServiceUuid& other) const { return high != other.high ? high < other.high : low < other.low; }
+    };
+
+    // One received advert, independent of the platform API that delivered it.
+    // The payload holds the raw AD structures: [length][type][data...] repeated.
+    struct AdvertisementSample
+    {
+        static constexpr size_t MaxPayloadSize = 255;
+        static constexpr size_t MaxAdapters = 8;
+        static constexpr int8_t NoRssi = 127;
+        static constexpr uint8_t ScanResponseType = 4;
+
+        // Address type as the platform reports it (same values as WinRT's BluetoothAddressType)
+        static constexpr uint8_t AddressPublic = 0;
+        static constexpr uint8_t AddressRandom = 1;
+        static constexpr uint8_t AddressUnknown = 2;
+        static constexpr uint8_t AddressResolved = 3;  // Ours: a private address already replaced by its owner's identity
+
+        // Extended adverts longer than one sample arrive as several, in order (HCI data status values)
+        static constexpr uint8_t DataComplete = 0;
+        static constexpr uint8_t DataMoreToCome = 1;
+        static constexpr uint8_t DataTruncated = 2;
+
+        uint64_t address = 0;
+        std::chrono::steady_clock::time_point timestamp;
+        int16_t rssi = 0;               // Strongest RSSI across adapters that saw this advert
+        uint8_t advertisementType = 0;  // 0-3 connectable/scannable/non-connectable variants, 4 = scan response
+        uint8_t adapterIndex = 0;       // Adapter that saw it first
+        uint8_t dataStatus = DataComplete;
+        uint8_t addressType = AddressUnknown;
+        uint16_t payloadLength = 0;
+        uint8_t payload[MaxPayloadSize] = {};
+        int8_t adapterRssi[MaxAdapters] = { NoRssi, NoRssi, NoRssi, NoRssi, NoRssi, NoRssi, NoRssi, NoRssi };
+
+        // Appends one AD structure; returns false if it does not fit
+        bool AppendSection(uint8_t type, const uint8_t* data, size_t size);
+        bool HasSamePayload(const AdvertisementSample& other) const;
+    };
+
+    // Minimal AD structure parsing over a sample's raw payload
+    namespace AdvertisementParser
+    {
+        // Calls visitor(type, data, size) for every well-formed AD structure until it returns false
+        template <typename Visitor>
+        void ForEachSection(const uint8_t* payload, size_t payloadLength, Visitor&& visitor)
+        {
+            size_t offset = 0;
+            while (offset + 1 < payloadLength)
+            {
+                uint8_t length = payload[offset];
+                if (length == 0 || offset + 1 + length > payloadLength)
+                {
+                    break;
+                }
+                if (!visitor(payload[offset + 1], payload + offset + 2, static_cast<size_t>(length - 1)))
+                {
+                    break;
+                }
+                offset += 1 + length;
+            }
+        }
+
+        std::optional<uint8_t> GetFlags(const AdvertisementSample& sample);
+        std::optional<std::string> GetLocalName(const AdvertisementSample& sample);
+        void GetServiceUuids(const AdvertisementSample& sample, std::vector<ServiceUuid>& uuids);
+
+        // The same over any run of AD structures, e.g. a reassembled extended advert
+        std::optional<uint8_t> GetFlags(const uint8_t* payload, size_t length);
+        std::optional<std::string> GetLocalName(const uint8_t* payload, size_t length, bool* isComplete = nullptr);
+        void GetServiceUuids(const uint8_t* payload, size_t length, std::vector<ServiceUuid>& uuids);
+    }
+}
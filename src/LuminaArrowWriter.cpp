@@ -0,0 +1,616 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include "LuminaArrowWriter.h"
+
+namespace
+{
+    // Just enough of a FlatBuffers encoder for Arrow's Schema/Message metadata.
+    // Objects are built as a tree, then laid out front to back: a parent is written first with
+    // placeholder offsets, and each child is appended after it and patched in (offsets always point forward).
+    struct FbNode
+    {
+        enum class Kind { Table, String, ScalarVector, OffsetVector };
+
+        struct Field
+        {
+            uint16_t slot;
+            uint8_t size;                   // Scalar size in bytes, or 4 for an offset
+            uint64_t bits = 0;
+            std::shared_ptr<FbNode> child;  // Set for offset fields
+        };
+
+        Kind kind = Kind::Table;
+        std::vector<Field> fields;
+        std::vector<uint8_t> bytes;         // String contents or packed vector elements
+        uint32_t elementCount = 0;
+        size_t elementAlignment = 4;
+        std::vector<std::shared_ptr<FbNode>> elements;
+
+        FbNode& Scalar(uint16_t slot, uint64_t value, uint8_t size)
+        {
+            fields.push_back({ slot, size, value, nullptr });
+            return *this;
+        }
+
+        FbNode& Offset(uint16_t slot, std::shared_ptr<FbNode> node)
+        {
+            fields.push_back({ slot, 4, 0, std::move(node) });
+            return *this;
+        }
+    };
+
+    using FbRef = std::shared_ptr<FbNode>;
+
+    FbRef FbTable()
+    {
+        return std::make_shared<FbNode>();
+    }
+
+    FbRef FbString(std::string_view value)
+    {
+        auto node = std::make_shared<FbNode>();
+        node->kind = FbNode::Kind::String;
+        node->bytes.assign(value.begin(), value.end());
+        return node;
+    }
+
+    // Vector of structs or scalars, already packed
+    FbRef FbStructVector(const void* data, uint32_t count, size_t elementSize, size_t alignment)
+    {
+        auto node = std::make_shared<FbNode>();
+        node->kind = FbNode::Kind::ScalarVector;
+        node->bytes.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + count * elementSize);
+        node->elementCount = count;
+        node->elementAlignment = std::max<size_t>(alignment, 4);
+        return node;
+    }
+
+    FbRef FbVector(std::vector<FbRef> elements)
+    {
+        auto node = std::make_shared<FbNode>();
+        node->kind = FbNode::Kind::OffsetVector;
+        node->elements = std::move(elements);
+        return node;
+    }
+
+    class FbSerializer
+    {
+    public:
+        std::vector<uint8_t> Finish(const FbNode& root)
+        {
+            m_Buffer.assign(8, 0); // Root offset, padded so the root table can be 8-aligned
+            uint32_t rootPos = Write(root);
+            Patch(0, rootPos);
+            return std::move(m_Buffer);
+        }
+
+    private:
+        std::vector<uint8_t> m_Buffer;
+
+        void PadTo(size_t position)
+        {
+            m_Buffer.resize(std::max(m_Buffer.size(), position), 0);
+        }
+
+        static size_t AlignUp(size_t value, size_t alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        template <typename T>
+        void Put(size_t position, T value)
+        {
+            std::memcpy(m_Buffer.data() + position, &value, sizeof(T));
+        }
+
+        void Patch(size_t fieldPos, size_t targetPos)
+        {
+            Put<uint32_t>(fieldPos, static_cast<uint32_t>(targetPos - fieldPos));
+        }
+
+        uint32_t Write(const FbNode& node)
+        {
+            switch (node.kind)
+            {
+            case FbNode::Kind::String:
+            {
+                PadTo(AlignUp(m_Buffer.size(), 4));
+                size_t pos = m_Buffer.size();
+                m_Buffer.resize(pos + 4 + node.bytes.size() + 1, 0);
+                Put<uint32_t>(pos, static_cast<uint32_t>(node.bytes.size()));
+                std::copy(node.bytes.begin(), node.bytes.end(), m_Buffer.begin() + pos + 4);
+                return static_cast<uint32_t>(pos);
+            }
+            case FbNode::Kind::ScalarVector:
+            {
+                // Length prefix sits right before the first element, which must be aligned
+                size_t pos = AlignUp(m_Buffer.size() + 4, node.elementAlignment) - 4;
+                PadTo(pos);
+                m_Buffer.resize(pos + 4 + node.bytes.size(), 0);
+                Put<uint32_t>(pos, node.elementCount);
+                std::copy(node.bytes.begin(), node.bytes.end(), m_Buffer.begin() + pos + 4);
+                return static_cast<uint32_t>(pos);
+            }
+            case FbNode::Kind::OffsetVector:
+            {
+                PadTo(AlignUp(m_Buffer.size(), 4));
+                size_t pos = m_Buffer.size();
+                m_Buffer.resize(pos + 4 + 4 * node.elements.size(), 0);
+                Put<uint32_t>(pos, static_cast<uint32_t>(node.elements.size()));
+                for (size_t i = 0; i < node.elements.size(); ++i)
+                {
+                    uint32_t childPos = Write(*node.elements[i]);
+                    Patch(pos + 4 + 4 * i, childPos);
+                }
+                return static_cast<uint32_t>(pos);
+            }
+            default:
+                return WriteTable(node);
+            }
+        }
+
+        uint32_t WriteTable(const FbNode& node)
+        {
+            // Largest fields first keeps padding down; the table itself starts 8-aligned
+            std::vector<const FbNode::Field*> ordered;
+            uint16_t slotCount = 0;
+            for (const auto& field : node.fields)
+            {
+                ordered.push_back(&field);
+                slotCount = std::max<uint16_t>(slotCount, static_cast<uint16_t>(field.slot + 1));
+            }
+            std::stable_sort(ordered.begin(), ordered.end(), [](const auto* a, const auto* b) { return a->size > b->size; });
+
+            std::vector<uint16_t> slotOffsets(slotCount, 0);
+            std::vector<size_t> fieldOffsets(ordered.size());
+            size_t tableSize = 4;
+            for (size_t i = 0; i < ordered.size(); ++i)
+            {
+                tableSize = AlignUp(tableSize, ordered[i]->size);
+                fieldOffsets[i] = tableSize;
+                slotOffsets[ordered[i]->slot] = static_cast<uint16_t>(tableSize);
+                tableSize += ordered[i]->size;
+            }
+
+            // vtable immediately before the table
+            size_t vtableSize = 4 + 2 * slotCount;
+            size_t tablePos = AlignUp(m_Buffer.size() + vtableSize, 8);
+            size_t vtablePos = tablePos - vtableSize;
+            PadTo(vtablePos);
+            m_Buffer.resize(tablePos + tableSize, 0);
+
+            Put<uint16_t>(vtablePos, static_cast<uint16_t>(vtableSize));
+            Put<uint16_t>(vtablePos + 2, static_cast<uint16_t>(tableSize));
+            for (uint16_t slot = 0; slot < slotCount; ++slot)
+            {
+                Put<uint16_t>(vtablePos + 4 + 2 * slot, slotOffsets[slot]);
+            }
+            Put<int32_t>(tablePos, static_cast<int32_t>(tablePos - vtablePos));
+
+            for (size_t i = 0; i < ordered.size(); ++i)
+            {
+                if (!ordered[i]->child)
+                {
+                    std::memcpy(m_Buffer.data() + tablePos + fieldOffsets[i], &ordered[i]->bits, ordered[i]->size);
+                }
+            }
+            for (size_t i = 0; i < ordered.size(); ++i)
+            {
+                if (ordered[i]->child)
+                {
+                    uint32_t childPos = Write(*ordered[i]->child);
+                    Patch(tablePos + fieldOffsets[i], childPos);
+                }
+            }
+            return static_cast<uint32_t>(tablePos);
+        }
+    };
+
+    // Arrow Schema.fbs / Message.fbs constants
+    constexpr uint16_t MetadataVersionV5 = 4;
+    constexpr uint8_t HeaderSchema = 1;
+    constexpr uint8_t HeaderDictionaryBatch = 2;
+    constexpr uint8_t HeaderRecordBatch = 3;
+    constexpr uint8_t TypeInt = 2;
+    constexpr uint8_t TypeFloatingPoint = 3;
+    constexpr uint8_t TypeBinary = 4;
+    constexpr uint8_t TypeUtf8 = 5;
+    constexpr uint8_t TypeBool = 6;
+    constexpr uint8_t TypeTimestamp = 10;
+    constexpr uint16_t PrecisionSingle = 1;
+    constexpr uint16_t TimeUnitMicrosecond = 2;
+
+    struct FieldNodeStruct
+    {
+        int64_t length;
+        int64_t nullCount;
+    };
+
+    struct BufferStruct
+    {
+        int64_t offset;
+        int64_t length;
+    };
+
+    FbRef IntType(int bitWidth, bool isSigned)
+    {
+        auto type = FbTable();
+        type->Scalar(0, static_cast<uint32_t>(bitWidth), 4).Scalar(1, isSigned ? 1 : 0, 1);
+        return type;
+    }
+
+    FbRef FieldFor(const LuminaArrowWriter::Column& column, int64_t dictionaryId)
+    {
+        using ColumnType = LuminaArrowWriter::ColumnType;
+
+        uint8_t typeId = TypeInt;
+        FbRef type;
+        switch (column.type)
+        {
+        case ColumnType::UInt8: type = IntType(8, false); break;
+        case ColumnType::Int16: type = IntType(16, true); break;
+        case ColumnType::UInt16: type = IntType(16, false); break;
+        case ColumnType::UInt32: type = IntType(32, false); break;
+        case ColumnType::Int64: type = IntType(64, true); break;
+        case ColumnType::Float32:
+            typeId = TypeFloatingPoint;
+            type = FbTable();
+            type->Scalar(0, PrecisionSingle, 2);
+            break;
+        case ColumnType::Bool:
+            typeId = TypeBool;
+            type = FbTable();
+            break;
+        case ColumnType::TimestampMicros:
+            typeId = TypeTimestamp;
+            type = FbTable();
+            type->Scalar(0, TimeUnitMicrosecond, 2).Offset(1, FbString("UTC"));
+            break;
+        case ColumnType::Binary:
+            typeId = TypeBinary;
+            type = FbTable();
+            break;
+        case ColumnType::DictionaryUtf8:
+            typeId = TypeUtf8;
+            type = FbTable();
+            break;
+        }
+
+        auto field = FbTable();
+        field->Offset(0, FbString(column.name))
+            .Scalar(1, column.isNullable ? 1 : 0, 1)
+            .Scalar(2, typeId, 1)
+            .Offset(3, type)
+            .Offset(5, FbVector({}));
+        if (column.type == ColumnType::DictionaryUtf8)
+        {
+            auto encoding = FbTable();
+            encoding->Scalar(0, static_cast<uint64_t>(dictionaryId), 8).Offset(1, IntType(32, true));
+            field->Offset(4, encoding);
+        }
+        return field;
+    }
+
+    std::vector<uint8_t> MessageFor(uint8_t headerType, FbRef header, int64_t bodyLength)
+    {
+        auto message = FbTable();
+        message->Scalar(0, MetadataVersionV5, 2)
+            .Scalar(1, headerType, 1)
+            .Offset(2, std::move(header))
+            .Scalar(3, static_cast<uint64_t>(bodyLength), 8);
+        return FbSerializer().Finish(*message);
+    }
+
+    // Accumulates the body buffers of one batch, each padded to 8 bytes
+    struct BodyBuilder
+    {
+        std::vector<uint8_t> body;
+        std::vector<BufferStruct> buffers;
+        std::vector<FieldNodeStruct> nodes;
+
+        void AddBuffer(const void* data, size_t size)
+        {
+            buffers.push_back({ static_cast<int64_t>(body.size()), static_cast<int64_t>(size) });
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            body.insert(body.end(), bytes, bytes + size);
+            body.resize((body.size() + 7) / 8 * 8, 0);
+        }
+
+        // A column without nulls still carries an (empty) validity buffer
+        void AddNode(size_t length)
+        {
+            nodes.push_back({ static_cast<int64_t>(length), 0 });
+            AddBuffer(nullptr, 0);
+        }
+
+        void AddNode(size_t length, size_t nullCount, const std::vector<uint8_t>& validity, std::vector<uint8_t>& packed)
+        {
+            if (nullCount == 0)
+            {
+                AddNode(length);
+                return;
+            }
+            nodes.push_back({ static_cast<int64_t>(length), static_cast<int64_t>(nullCount) });
+            packed.assign((length + 7) / 8, 0);
+            for (size_t i = 0; i < length; ++i)
+            {
+                packed[i / 8] |= static_cast<uint8_t>(validity[i] << (i % 8));
+            }
+            AddBuffer(packed.data(), packed.size());
+        }
+
+        FbRef RecordBatch(size_t length) const
+        {
+            auto batch = FbTable();
+            batch->Scalar(0, static_cast<uint64_t>(length), 8)
+                .Offset(1, FbStructVector(nodes.data(), static_cast<uint32_t>(nodes.size()), sizeof(FieldNodeStruct), 8))
+                .Offset(2, FbStructVector(buffers.data(), static_cast<uint32_t>(buffers.size()), sizeof(BufferStruct), 8));
+            return batch;
+        }
+    };
+
+    size_t FixedWidth(LuminaArrowWriter::ColumnType type)
+    {
+        using ColumnType = LuminaArrowWriter::ColumnType;
+        switch (type)
+        {
+        case ColumnType::UInt8:
+        case ColumnType::Bool: return 1;
+        case ColumnType::Int16:
+        case ColumnType::UInt16: return 2;
+        case ColumnType::UInt32:
+        case ColumnType::Float32: return 4;
+        case ColumnType::Int64:
+        case ColumnType::TimestampMicros: return 8;
+        default: return 0;
+        }
+    }
+}
+
+void LuminaArrowWriter::Batch::AppendInteger(size_t column, int64_t value)
+{
+    ColumnData& data = m_Columns[column];
+    size_t width = FixedWidth(data.type);
+    size_t offset = data.values.size();
+    data.values.resize(offset + width);
+    std::memcpy(data.values.data() + offset, &value, width); // Little-endian: the low bytes come first
+    if (data.isNullable)
+    {
+        data.validity.push_back(1);
+    }
+    ++data.count;
+}
+
+void LuminaArrowWriter::Batch::AppendFloat(size_t column, float value)
+{
+    ColumnData& data = m_Columns[column];
+    size_t offset = data.values.size();
+    data.values.resize(offset + sizeof(float));
+    std::memcpy(data.values.data() + offset, &value, sizeof(float));
+    if (data.isNullable)
+    {
+        data.validity.push_back(1);
+    }
+    ++data.count;
+}
+
+void LuminaArrowWriter::Batch::AppendBool(size_t column, bool value)
+{
+    ColumnData& data = m_Columns[column];
+    data.values.push_back(value ? 1 : 0); // Bit-packed on write
+    if (data.isNullable)
+    {
+        data.validity.push_back(1);
+    }
+    ++data.count;
+}
+
+void LuminaArrowWriter::Batch::AppendBytes(size_t column, std::string_view value)
+{
+    ColumnData& data = m_Columns[column];
+    data.values.insert(data.values.end(), value.begin(), value.end());
+    data.offsets.push_back(static_cast<int32_t>(data.values.size()));
+    ++data.count;
+}
+
+void LuminaArrowWriter::Batch::AppendNull(size_t column)
+{
+    // The slot keeps its width, zeroed; readers look at the validity bit instead
+    ColumnData& data = m_Columns[column];
+    data.values.resize(data.values.size() + std::max<size_t>(FixedWidth(data.type), 1));
+    data.validity.push_back(0);
+    ++data.nullCount;
+    ++data.count;
+}
+
+void LuminaArrowWriter::Batch::Clear()
+{
+    for (auto& column : m_Columns)
+    {
+        column.count = 0;
+        column.nullCount = 0;
+        column.values.clear();
+        column.offsets.assign(1, 0);
+        column.validity.clear();
+    }
+}
+
+LuminaArrowWriter::LuminaArrowWriter()
+{
+}
+
+LuminaArrowWriter::~LuminaArrowWriter()
+{
+    Close();
+}
+
+bool LuminaArrowWriter::Open(const std::filesystem::path& path, const std::vector<Column>& columns, std::string& error)
+{
+    Close();
+
+    m_File = std::fopen(path.string().c_str(), "wb");
+    if (!m_File)
+    {
+        error = "Failed to create " + path.string() + ": " + std::strerror(errno);
+        return false;
+    }
+    std::setvbuf(m_File, nullptr, _IOFBF, 1 << 20);
+
+    m_Columns = columns;
+    m_Dictionaries.assign(columns.size(), Dictionary());
+    m_BytesWritten = 0;
+
+    std::vector<FbRef> fields;
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        fields.push_back(FieldFor(columns[i], static_cast<int64_t>(i)));
+    }
+    auto schema = FbTable();
+    schema->Scalar(0, 0, 2).Offset(1, FbVector(std::move(fields)));
+
+    if (!WriteMessage(MessageFor(HeaderSchema, schema, 0), {}, error))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void LuminaArrowWriter::Close()
+{
+    if (!m_File)
+    {
+        return;
+    }
+
+    // End-of-stream: continuation marker followed by a zero length
+    const uint32_t endOfStream[2] = { 0xFFFFFFFFu, 0 };
+    std::fwrite(endOfStream, sizeof(endOfStream), 1, m_File);
+    std::fclose(m_File);
+    m_File = nullptr;
+    m_Dictionaries.clear();
+}
+
+LuminaArrowWriter::Batch LuminaArrowWriter::CreateBatch() const
+{
+    Batch batch;
+    for (const auto& column : m_Columns)
+    {
+        Batch::ColumnData data;
+        data.type = column.type;
+        data.isNullable = column.isNullable;
+        batch.m_Columns.push_back(std::move(data));
+    }
+    return batch;
+}
+
+bool LuminaArrowWriter::WriteBatch(const Batch& batch, std::string& error)
+{
+    if (!m_File)
+    {
+        error = "Arrow writer is not open";
+        return false;
+    }
+
+    size_t rowCount = batch.GetRowCount();
+    BodyBuilder record;
+    std::vector<int32_t> indices;
+    std::vector<uint8_t> packedBools;
+    std::vector<uint8_t> packedValidity;
+
+    for (size_t column = 0; column < m_Columns.size(); ++column)
+    {
+        const Batch::ColumnData& data = batch.m_Columns[column];
+        if (data.count != rowCount)
+        {
+            error = "Column '" + m_Columns[column].name + "' has " + std::to_string(data.count) + " values, expected " + std::to_string(rowCount);
+            return false;
+        }
+
+        record.AddNode(rowCount, data.nullCount, data.validity, packedValidity);
+        switch (data.type)
+        {
+        case ColumnType::Bool:
+            packedBools.assign((rowCount + 7) / 8, 0);
+            for (size_t i = 0; i < rowCount; ++i)
+            {
+                packedBools[i / 8] |= static_cast<uint8_t>(data.values[i] << (i % 8));
+            }
+            record.AddBuffer(packedBools.data(), packedBools.size());
+            break;
+        case ColumnType::Binary:
+            record.AddBuffer(data.offsets.data(), data.offsets.size() * sizeof(int32_t));
+            record.AddBuffer(data.values.data(), data.values.size());
+            break;
+        case ColumnType::DictionaryUtf8:
+        {
+            // Map each value to its dictionary index; unseen values go out first as a (delta) dictionary batch
+            Dictionary& dictionary = m_Dictionaries[column];
+            BodyBuilder delta;
+            std::vector<int32_t> deltaOffsets{ 0 };
+            std::vector<uint8_t> deltaValues;
+            indices.resize(rowCount);
+            for (size_t i = 0; i < rowCount; ++i)
+            {
+                std::string_view value(reinterpret_cast<const char*>(data.values.data()) + data.offsets[i],
+                    static_cast<size_t>(data.offsets[i + 1] - data.offsets[i]));
+                auto it = dictionary.indices.find(value);
+                if (it == dictionary.indices.end())
+                {
+                    it = dictionary.indices.emplace(std::string(value), static_cast<int32_t>(dictionary.indices.size())).first;
+                    deltaValues.insert(deltaValues.end(), value.begin(), value.end());
+                    deltaOffsets.push_back(static_cast<int32_t>(deltaValues.size()));
+                }
+                indices[i] = it->second;
+            }
+
+            size_t newEntries = deltaOffsets.size() - 1;
+            if (newEntries > 0 || !dictionary.isSent)
+            {
+                delta.AddNode(newEntries);
+                delta.AddBuffer(deltaOffsets.data(), deltaOffsets.size() * sizeof(int32_t));
+                delta.AddBuffer(deltaValues.data(), deltaValues.size());
+
+                auto dictionaryBatch = FbTable();
+                dictionaryBatch->Scalar(0, static_cast<uint64_t>(column), 8)
+                    .Offset(1, delta.RecordBatch(newEntries))
+                    .Scalar(2, dictionary.isSent ? 1 : 0, 1);
+                if (!WriteMessage(MessageFor(HeaderDictionaryBatch, dictionaryBatch, static_cast<int64_t>(delta.body.size())), delta.body, error))
+                {
+                    return false;
+                }
+                dictionary.isSent = true;
+            }
+            record.AddBuffer(indices.data(), indices.size() * sizeof(int32_t));
+            break;
+        }
+        default:
+            record.AddBuffer(data.values.data(), data.values.size());
+            break;
+        }
+    }
+
+    return WriteMessage(MessageFor(HeaderRecordBatch, record.RecordBatch(rowCount), static_cast<int64_t>(record.body.size())), record.body, error);
+}
+
+bool LuminaArrowWriter::WriteMessage(const std::vector<uint8_t>& metadata, const std::vector<uint8_t>& body, std::string& error)
+{
+    // <0xFFFFFFFF><int32 metadata size><flatbuffer, padded so the body starts 8-aligned><body>
+    uint32_t paddedSize = static_cast<uint32_t>((metadata.size() + 8 + 7) / 8 * 8 - 8);
+    const uint32_t prefix[2] = { 0xFFFFFFFFu, paddedSize };
+    static const uint8_t padding[8] = {};
+
+    bool isWritten = std::fwrite(prefix, sizeof(prefix), 1, m_File) == 1 &&
+        std::fwrite(metadata.data(), 1, metadata.size(), m_File) == metadata.size() &&
+        std::fwrite(padding, 1, paddedSize - metadata.size(), m_File) == paddedSize - metadata.size() &&
+        std::fwrite(body.data(), 1, body.size(), m_File) == body.size();
+    if (!isWritten)
+    {
+        error = std::string("Failed to write Arrow stream: ") + std::strerror(errno);
+        return false;
+    }
+    m_BytesWritten += sizeof(prefix) + paddedSize + body.size();
+    return true;
+}
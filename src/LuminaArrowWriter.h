@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Minimal Apache Arrow IPC stream writer (the .arrows format read by pyarrow.ipc.open_stream,
+// pandas and DuckDB). Supports flat columns of the types below; fixed-width columns may be nullable. String
+// columns are dictionary-encoded: the first batch sends the dictionary, later batches send only new entries as deltas.
+class LuminaArrowWriter
+{
+public:
+    enum class ColumnType
+    {
+        UInt8,
+        Int16,
+        UInt16,
+        UInt32,
+        Int64,
+        Float32,
+        Bool,
+        TimestampMicros, // UTC
+        Binary,
+        DictionaryUtf8,  // int32 indices into a per-column dictionary
+    };
+
+    struct Column
+    {
+        std::string name;
+        ColumnType type;
+        bool isNullable = false;    // Fixed-width types only
+    };
+
+    // Column-major rows for one record batch (row group). Append the same number of values to every column.
+    class Batch
+    {
+    public:
+        void AppendInteger(size_t column, int64_t value);
+        void AppendFloat(size_t column, float value);
+        void AppendBool(size_t column, bool value);
+        void AppendBytes(size_t column, std::string_view value); // Binary and DictionaryUtf8
+        void AppendNull(size_t column);                          // Nullable columns only
+
+        size_t GetRowCount() const { return m_Columns.empty() ? 0 : m_Columns[0].count; }
+        void Clear();
+
+    private:
+        friend class LuminaArrowWriter;
+
+        struct ColumnData
+        {
+            ColumnType type;
+            bool isNullable = false;
+            size_t count = 0;
+            size_t nullCount = 0;
+            std::vector<uint8_t> values;          // Fixed-width values, or concatenated bytes
+            std::vector<int32_t> offsets{ 0 };    // Binary and DictionaryUtf8 only
+            std::vector<uint8_t> validity;        // Nullable only: one byte per value, bit-packed on write
+        };
+        std::vector<ColumnData> m_Columns;
+    };
+
+    LuminaArrowWriter();
+    ~LuminaArrowWriter();
+    LuminaArrowWriter(const LuminaArrowWriter&) = delete;
+    LuminaArrowWriter& operator=(const LuminaArrowWriter&) = delete;
+
+    bool Open(const std::filesystem::path& path, const std::vector<Column>& columns, std::string& error);
+    // Writes the end-of-stream marker and closes the file
+    void Close();
+    bool IsOpen() const { return m_File != nullptr; }
+
+    Batch CreateBatch() const;
+    bool WriteBatch(const Batch& batch, std::string& error);
+
+    uint64_t GetBytesWritten() const { return m_BytesWritten; }
+
+private:
+    struct StringHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const { return std::hash<std::string_view>()(value); }
+    };
+
+    struct Dictionary
+    {
+        std::unordered_map<std::string, int32_t, StringHash, std::equal_to<>> indices;
+        bool isSent = false;
+    };
+
+    FILE* m_File = nullptr;
+    std::vector<Column> m_Columns;
+    std::vector<Dictionary> m_Dictionaries; // One per column; only used by DictionaryUtf8 columns
+    uint64_t m_BytesWritten = 0;
+
+    bool WriteMessage(const std::vector<uint8_t>& metadata, const std::vector<uint8_t>& body, std::string& error);
+};
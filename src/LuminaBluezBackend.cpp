@@ -0,0 +1,1102 @@
+#ifdef __linux__
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <dbus/dbus.h>
+#include "LuminaBluezBackend.h"
+#include "LuminaHelper.h"
+
+namespace
+{
+    constexpr const char* AdapterInterface = "org.bluez.Adapter1";
+    constexpr const char* DeviceInterface = "org.bluez.Device1";
+    constexpr const char* AgentInterface = "org.bluez.Agent1";
+    constexpr const char* ObjectManagerInterface = "org.freedesktop.DBus.ObjectManager";
+    constexpr const char* PropertiesInterface = "org.freedesktop.DBus.Properties";
+    constexpr std::chrono::milliseconds IdleWakeup{ 1000 };
+
+    // 16-bit alias if the UUID is on the Bluetooth base UUID, else -1
+    int ShortUuid(const Lumina::ServiceUuid& uuid)
+    {
+        if (uuid.low != 0x800000805f9b34fbull || (uuid.high & 0xFFFF0000FFFFFFFFull) != 0x00001000ull)
+        {
+            return -1;
+        }
+        return static_cast<int>((uuid.high >> 32) & 0xFFFF);
+    }
+
+    // AD fields carry UUIDs little-endian
+    void UuidToBytes(const Lumina::ServiceUuid& uuid, uint8_t bytes[16])
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            bytes[i] = static_cast<uint8_t>(uuid.low >> (8 * i));
+            bytes[8 + i] = static_cast<uint8_t>(uuid.high >> (8 * i));
+        }
+    }
+
+    uint64_t ParseAddress(const char* text)
+    {
+        uint64_t address = 0;
+        return text && LuminaHelper::ParseBluetoothAddress(text, address) ? address : 0;
+    }
+
+    // hciN of an adapter path, or of the adapter a device path sits under
+    int AdapterIndexFromPath(const std::string& path)
+    {
+        size_t position = path.find("/hci");
+        if (position == std::string::npos)
+        {
+            return 0;
+        }
+        int index = std::atoi(path.c_str() + position + 4);
+        return std::clamp(index, 0, static_cast<int>(Lumina::AdvertisementSample::MaxAdapters) - 1);
+    }
+
+    std::string AdapterPathFromDevicePath(const std::string& path)
+    {
+        size_t position = path.find("/dev_");
+        return position == std::string::npos ? path : path.substr(0, position);
+    }
+
+    // BlueZ names device objects dev_AA_BB_CC_DD_EE_FF, so a device first seen in a PropertiesChanged still has its address
+    uint64_t AddressFromDevicePath(const std::string& path)
+    {
+        size_t position = path.find("/dev_");
+        if (position == std::string::npos)
+        {
+            return 0;
+        }
+        std::string text = path.substr(position + 5, 17);
+        std::replace(text.begin(), text.end(), '_', ':');
+        return ParseAddress(text.c_str());
+    }
+
+    // Calls visitor(key iterator, value iterator) for each entry of a dictionary array
+    template <typename Visitor>
+    void ForEachEntry(DBusMessageIter* array, Visitor&& visitor)
+    {
+        if (dbus_message_iter_get_arg_type(array) != DBUS_TYPE_ARRAY)
+        {
+            return;
+        }
+        DBusMessageIter entries;
+        dbus_message_iter_recurse(array, &entries);
+        while (dbus_message_iter_get_arg_type(&entries) == DBUS_TYPE_DICT_ENTRY)
+        {
+            DBusMessageIter entry;
+            dbus_message_iter_recurse(&entries, &entry);
+            DBusMessageIter key = entry;
+            if (dbus_message_iter_next(&entry))
+            {
+                visitor(&key, &entry);
+            }
+            dbus_message_iter_next(&entries);
+        }
+    }
+
+    // Steps into a variant, or leaves a plain value where it is
+    DBusMessageIter Unwrap(DBusMessageIter* value)
+    {
+        DBusMessageIter inner = *value;
+        if (dbus_message_iter_get_arg_type(value) == DBUS_TYPE_VARIANT)
+        {
+            dbus_message_iter_recurse(value, &inner);
+        }
+        return inner;
+    }
+
+    const char* GetString(DBusMessageIter* value)
+    {
+        DBusMessageIter inner = Unwrap(value);
+        int type = dbus_message_iter_get_arg_type(&inner);
+        if (type != DBUS_TYPE_STRING && type != DBUS_TYPE_OBJECT_PATH)
+        {
+            return nullptr;
+        }
+        const char* text = nullptr;
+        dbus_message_iter_get_basic(&inner, &text);
+        return text;
+    }
+
+    template <typename T>
+    std::optional<T> GetBasic(DBusMessageIter* value, int type)
+    {
+        DBusMessageIter inner = Unwrap(value);
+        if (dbus_message_iter_get_arg_type(&inner) != type)
+        {
+            return std::nullopt;
+        }
+        T result{};
+        dbus_message_iter_get_basic(&inner, &result);
+        return result;
+    }
+
+    bool GetBytes(DBusMessageIter* value, std::vector<uint8_t>& bytes)
+    {
+        DBusMessageIter inner = Unwrap(value);
+        if (dbus_message_iter_get_arg_type(&inner) != DBUS_TYPE_ARRAY || dbus_message_iter_get_element_type(&inner) != DBUS_TYPE_BYTE)
+        {
+            return false;
+        }
+        DBusMessageIter array;
+        dbus_message_iter_recurse(&inner, &array);
+        const uint8_t* data = nullptr;
+        int length = 0;
+        dbus_message_iter_get_fixed_array(&array, &data, &length);
+        bytes.assign(data, data + length);
+        return true;
+    }
+
+    void AppendVariant(DBusMessageIter* dictionary, const char* key, int type, const void* value)
+    {
+        const char signature[2] = { static_cast<char>(type), '\0' };
+        DBusMessageIter entry;
+        DBusMessageIter variant;
+        dbus_message_iter_open_container(dictionary, DBUS_TYPE_DICT_ENTRY, nullptr, &entry);
+        dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &key);
+        dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT, signature, &variant);
+        dbus_message_iter_append_basic(&variant, type, value);
+        dbus_message_iter_close_container(&entry, &variant);
+        dbus_message_iter_close_container(dictionary, &entry);
+    }
+}
+
+LuminaBluezBackend::LuminaBluezBackend()
+{
+}
+
+LuminaBluezBackend::~LuminaBluezBackend()
+{
+    Stop();
+}
+
+bool LuminaBluezBackend::Start(const Options& options, std::string& error)
+{
+    if (m_IsRunning)
+    {
+        return true;
+    }
+    m_Options = options;
+    dbus_threads_init_default();
+
+    DBusError dbusError;
+    dbus_error_init(&dbusError);
+    auto fail = [&](const char* what)
+    {
+        error = std::string(what) + (dbus_error_is_set(&dbusError) ? std::string(": ") + dbusError.message : std::string());
+        dbus_error_free(&dbusError);
+        if (m_Connection)
+        {
+            dbus_connection_close(m_Connection);
+            dbus_connection_unref(m_Connection);
+            m_Connection = nullptr;
+        }
+        return false;
+    };
+
+    if (m_Options.busAddress.empty())
+    {
+        m_Connection = dbus_bus_get_private(DBUS_BUS_SYSTEM, &dbusError);
+    }
+    else
+    {
+        m_Connection = dbus_connection_open_private(m_Options.busAddress.c_str(), &dbusError);
+        if (m_Connection && !dbus_bus_register(m_Connection, &dbusError))
+        {
+            return fail("Cannot register on the D-Bus bus");
+        }
+    }
+    if (!m_Connection)
+    {
+        return fail("Cannot connect to D-Bus");
+    }
+    dbus_connection_set_exit_on_disconnect(m_Connection, false);
+
+    // Subscribe before the snapshot so nothing that changes in between is missed
+    const std::string sender = "sender='" + m_Options.serviceName + "'";
+    const std::string objectRule = "type='signal'," + sender + ",interface='" + ObjectManagerInterface + "'";
+    const std::string propertiesRule = "type='signal'," + sender + ",interface='" + PropertiesInterface + "',member='PropertiesChanged'";
+    dbus_bus_add_match(m_Connection, objectRule.c_str(), &dbusError);
+    if (!dbus_error_is_set(&dbusError))
+    {
+        dbus_bus_add_match(m_Connection, propertiesRule.c_str(), &dbusError);
+    }
+    if (dbus_error_is_set(&dbusError))
+    {
+        return fail("Cannot subscribe to BlueZ signals");
+    }
+    m_MethodCallCount += 2;
+
+    // Confirms Just Works pairings started from here. Without it BlueZ falls back to the system's default agent.
+    DBusMessage* registerAgent = dbus_message_new_method_call(m_Options.serviceName.c_str(), "/org/bluez", "org.bluez.AgentManager1", "RegisterAgent");
+    const char* agentPath = AgentPath;
+    const char* capability = "NoInputNoOutput";
+    dbus_message_append_args(registerAgent, DBUS_TYPE_OBJECT_PATH, &agentPath, DBUS_TYPE_STRING, &capability, DBUS_TYPE_INVALID);
+    if (DBusMessage* reply = dbus_connection_send_with_reply_and_block(m_Connection, registerAgent, static_cast<int>(m_Options.callTimeout.count()), &dbusError))
+    {
+        dbus_message_unref(reply);
+    }
+    dbus_error_free(&dbusError);
+    dbus_message_unref(registerAgent);
+    ++m_MethodCallCount;
+
+    // Every adapter and device with all their properties, in one round trip
+    DBusMessage* getObjects = dbus_message_new_method_call(m_Options.serviceName.c_str(), "/", ObjectManagerInterface, "GetManagedObjects");
+    DBusMessage* objects = dbus_connection_send_with_reply_and_block(m_Connection, getObjects, static_cast<int>(m_Options.callTimeout.count()), &dbusError);
+    dbus_message_unref(getObjects);
+    ++m_MethodCallCount;
+    if (!objects)
+    {
+        return fail("BlueZ is not available");
+    }
+    DBusMessageIter iter;
+    if (dbus_message_iter_init(objects, &iter))
+    {
+        HandleObjects(&iter);
+    }
+    dbus_message_unref(objects);
+    m_QueuedDevices.clear();
+
+    m_WakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_StopRequested = false;
+    m_IsRunning = true;
+    m_LoopThread = std::thread([this] { RunLoop(); });
+    return true;
+}
+
+void LuminaBluezBackend::Stop()
+{
+    if (!m_IsRunning)
+    {
+        return;
+    }
+    m_StopRequested = true;
+    uint64_t one = 1;
+    (void)!write(m_WakeFd, &one, sizeof(one));
+    if (m_LoopThread.joinable())
+    {
+        m_LoopThread.join();
+    }
+    m_IsRunning = false;
+
+    dbus_connection_close(m_Connection);
+    dbus_connection_unref(m_Connection);
+    m_Connection = nullptr;
+    close(m_WakeFd);
+    m_WakeFd = -1;
+
+    m_Devices.clear();
+    m_DevicePaths.clear();
+    std::lock_guard<std::mutex> lock(m_AdapterMutex);
+    m_Adapters.clear();
+}
+
+std::vector<LuminaBluezBackend::Adapter> LuminaBluezBackend::GetAdapters() const
+{
+    std::lock_guard<std::mutex> lock(m_AdapterMutex);
+    std::vector<Adapter> adapters;
+    for (const auto& [path, adapter] : m_Adapters)
+    {
+        adapters.push_back(adapter);
+    }
+    return adapters;
+}
+
+void LuminaBluezBackend::StartDiscovery(const DiscoveryFilter& discoveryFilter, Completion completion)
+{
+    Post([this, discoveryFilter, completion]
+        {
+            std::vector<std::string> paths;
+            {
+                std::lock_guard<std::mutex> lock(m_AdapterMutex);
+                for (const auto& [path, adapter] : m_Adapters)
+                {
+                    if (adapter.isPowered)
+                    {
+                        paths.push_back(path);
+                    }
+                }
+            }
+            if (paths.empty())
+            {
+                if (completion)
+                {
+                    completion(false, "No powered Bluetooth adapter");
+                }
+                return;
+            }
+
+            // Done once every adapter has answered both calls; the first error is reported
+            struct Progress
+            {
+                size_t remaining = 0;
+                std::string error;
+            };
+            auto progress = std::make_shared<Progress>();
+            progress->remaining = paths.size() * 2;
+            auto step = [completion, progress](bool succeeded, const std::string& error)
+            {
+                if (!succeeded && progress->error.empty())
+                {
+                    progress->error = error;
+                }
+                if (--progress->remaining == 0 && completion)
+                {
+                    completion(progress->error.empty(), progress->error);
+                }
+            };
+
+            for (const std::string& path : paths)
+            {
+                // LE only, an update for every advert rather than only for changed data, and the profile's threshold
+                DBusMessage* filter = dbus_message_new_method_call(m_Options.serviceName.c_str(), path.c_str(), AdapterInterface, "SetDiscoveryFilter");
+                DBusMessageIter args;
+                DBusMessageIter dictionary;
+                dbus_message_iter_init_append(filter, &args);
+                dbus_message_iter_open_container(&args, DBUS_TYPE_ARRAY, "{sv}", &dictionary);
+                const char* transport = "le";
+                dbus_bool_t duplicateData = TRUE;
+                AppendVariant(&dictionary, "Transport", DBUS_TYPE_STRING, &transport);
+                AppendVariant(&dictionary, "DuplicateData", DBUS_TYPE_BOOLEAN, &duplicateData);
+                if (discoveryFilter.minRssi)
+                {
+                    dbus_int16_t rssi = *discoveryFilter.minRssi;
+                    AppendVariant(&dictionary, "RSSI", DBUS_TYPE_INT16, &rssi);
+                }
+                dbus_message_iter_close_container(&args, &dictionary);
+                Send(filter, step, m_Options.callTimeout);
+
+                Send(dbus_message_new_method_call(m_Options.serviceName.c_str(), path.c_str(), AdapterInterface, "StartDiscovery"), step, m_Options.callTimeout);
+            }
+        }, completion);
+}
+
+void LuminaBluezBackend::StopDiscovery(Completion completion)
+{
+    Post([this, completion]
+        {
+            std::vector<std::string> paths;
+            {
+                std::lock_guard<std::mutex> lock(m_AdapterMutex);
+                for (const auto& [path, adapter] : m_Adapters)
+                {
+                    if (adapter.isDiscovering)
+                    {
+                        paths.push_back(path);
+                    }
+                }
+            }
+            auto remaining = std::make_shared<size_t>(paths.size());
+            if (paths.empty() && completion)
+            {
+                completion(true, std::string());
+            }
+            for (const std::string& path : paths)
+            {
+                Send(dbus_message_new_method_call(m_Options.serviceName.c_str(), path.c_str(), AdapterInterface, "StopDiscovery"),
+                    [completion, remaining](bool succeeded, const std::string& error)
+                    {
+                        if (--*remaining == 0 && completion)
+                        {
+                            completion(succeeded, error);
+                        }
+                    }, m_Options.callTimeout);
+            }
+        }, completion);
+}
+
+void LuminaBluezBackend::Pair(uint64_t address, Completion completion)
+{
+    Post([this, address, completion] { CallDevice(address, DeviceInterface, "Pair", m_Options.pairTimeout, completion); }, completion);
+}
+
+void LuminaBluezBackend::Connect(uint64_t address, Completion completion)
+{
+    Post([this, address, completion] { CallDevice(address, DeviceInterface, "Connect", m_Options.callTimeout, completion); }, completion);
+}
+
+void LuminaBluezBackend::Disconnect(uint64_t address, Completion completion)
+{
+    Post([this, address, completion] { CallDevice(address, DeviceInterface, "Disconnect", m_Options.callTimeout, completion); }, completion);
+}
+
+void LuminaBluezBackend::RemoveDevice(uint64_t address, Completion completion)
+{
+    Post([this, address, completion] { CallDevice(address, AdapterInterface, "RemoveDevice", m_Options.callTimeout, completion); }, completion);
+}
+
+void LuminaBluezBackend::Post(std::function<void()> command, const Completion& completion)
+{
+    if (!m_IsRunning)
+    {
+        if (completion)
+        {
+            completion(false, "Bluetooth backend is not running");
+        }
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_CommandMutex);
+        m_Commands.push_back(std::move(command));
+    }
+    uint64_t one = 1;
+    (void)!write(m_WakeFd, &one, sizeof(one));
+}
+
+void LuminaBluezBackend::CallDevice(uint64_t address, const char* interfaceName, const char* method, std::chrono::milliseconds timeout, Completion completion)
+{
+    auto it = m_DevicePaths.find(address);
+    if (it == m_DevicePaths.end())
+    {
+        if (completion)
+        {
+            completion(false, "Unknown device");
+        }
+        return;
+    }
+
+    DBusMessage* message = nullptr;
+    if (std::strcmp(interfaceName, AdapterInterface) == 0)
+    {
+        // Adapter methods name the device by its object path
+        std::string adapterPath = AdapterPathFromDevicePath(it->second);
+        message = dbus_message_new_method_call(m_Options.serviceName.c_str(), adapterPath.c_str(), interfaceName, method);
+        const char* devicePath = it->second.c_str();
+        dbus_message_append_args(message, DBUS_TYPE_OBJECT_PATH, &devicePath, DBUS_TYPE_INVALID);
+    }
+    else
+    {
+        message = dbus_message_new_method_call(m_Options.serviceName.c_str(), it->second.c_str(), interfaceName, method);
+    }
+    Send(message, std::move(completion), timeout);
+}
+
+void LuminaBluezBackend::Send(DBusMessage* message, Completion completion, std::chrono::milliseconds timeout)
+{
+    // Replies come back through the same queue as signals and are matched by serial
+    dbus_uint32_t serial = 0;
+    if (!dbus_connection_send(m_Connection, message, &serial))
+    {
+        dbus_message_unref(message);
+        if (completion)
+        {
+            completion(false, "Out of memory");
+        }
+        return;
+    }
+    dbus_message_unref(message);
+    m_PendingReplies[serial] = { std::move(completion), std::chrono::steady_clock::now() + timeout };
+    ++m_MethodCallCount;
+}
+
+void LuminaBluezBackend::RunLoop()
+{
+    int busFd = -1;
+    dbus_connection_get_unix_fd(m_Connection, &busFd);
+    std::vector<std::function<void()>> commands;
+
+    // Signals that arrived during Start's blocking calls are already queued
+    bool hasQueued = dbus_connection_get_dispatch_status(m_Connection) == DBUS_DISPATCH_DATA_REMAINS;
+    while (!m_StopRequested)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_CommandMutex);
+            commands.swap(m_Commands);
+        }
+        for (auto& command : commands)
+        {
+            command();
+        }
+        commands.clear();
+
+        if (!hasQueued)
+        {
+            int timeout = static_cast<int>(IdleWakeup.count());
+            auto now = std::chrono::steady_clock::now();
+            for (const auto& [serial, pending] : m_PendingReplies)
+            {
+                auto untilDeadline = std::chrono::duration_cast<std::chrono::milliseconds>(pending.deadline - now).count();
+                timeout = std::min<int>(timeout, static_cast<int>(std::max<int64_t>(untilDeadline, 0)));
+            }
+            pollfd fds[2] = {
+                { busFd, static_cast<short>(POLLIN | (dbus_connection_has_messages_to_send(m_Connection) ? POLLOUT : 0)), 0 },
+                { m_WakeFd, POLLIN, 0 },
+            };
+            poll(fds, 2, timeout);
+            if (fds[1].revents & POLLIN)
+            {
+                uint64_t count = 0;
+                (void)!read(m_WakeFd, &count, sizeof(count));
+            }
+        }
+        hasQueued = false;
+
+        // Read everything available, a few kilobytes per call, then handle it as one batch
+        for (int i = 0; i < MaxReadsPerBatch; ++i)
+        {
+            if (!dbus_connection_read_write(m_Connection, 0))
+            {
+                m_StopRequested = true;
+                break;
+            }
+            pollfd pending = { busFd, POLLIN, 0 };
+            if (poll(&pending, 1, 0) <= 0)
+            {
+                break;
+            }
+        }
+
+        auto receivedAt = std::chrono::steady_clock::now();
+        bool hasMessages = false;
+        while (DBusMessage* message = dbus_connection_pop_message(m_Connection))
+        {
+            hasMessages = true;
+            ++m_MessageCount;
+            HandleMessage(message);
+            dbus_message_unref(message);
+        }
+        if (hasMessages)
+        {
+            ++m_BatchCount;
+            EmitQueuedSamples(receivedAt);
+        }
+        ExpireReplies(std::chrono::steady_clock::now());
+    }
+
+    // Nothing more will answer
+    for (auto& [serial, pending] : m_PendingReplies)
+    {
+        if (pending.completion)
+        {
+            pending.completion(false, "Bluetooth backend stopped");
+        }
+    }
+    m_PendingReplies.clear();
+}
+
+void LuminaBluezBackend::HandleMessage(DBusMessage* message)
+{
+    const int type = dbus_message_get_type(message);
+    if (type == DBUS_MESSAGE_TYPE_METHOD_RETURN || type == DBUS_MESSAGE_TYPE_ERROR)
+    {
+        auto it = m_PendingReplies.find(dbus_message_get_reply_serial(message));
+        if (it == m_PendingReplies.end())
+        {
+            return;
+        }
+        Completion completion = std::move(it->second.completion);
+        m_PendingReplies.erase(it);
+        if (!completion)
+        {
+            return;
+        }
+        if (type == DBUS_MESSAGE_TYPE_METHOD_RETURN)
+        {
+            completion(true, std::string());
+            return;
+        }
+        const char* text = nullptr;
+        dbus_message_get_args(message, nullptr, DBUS_TYPE_STRING, &text, DBUS_TYPE_INVALID);
+        const char* name = dbus_message_get_error_name(message);
+        completion(false, text && *text ? text : (name ? name : "Failed"));
+        return;
+    }
+    if (type == DBUS_MESSAGE_TYPE_METHOD_CALL)
+    {
+        HandleAgentCall(message);
+        return;
+    }
+    if (type != DBUS_MESSAGE_TYPE_SIGNAL)
+    {
+        return;
+    }
+
+    DBusMessageIter iter;
+    if (!dbus_message_iter_init(message, &iter))
+    {
+        return;
+    }
+    if (dbus_message_is_signal(message, PropertiesInterface, "PropertiesChanged"))
+    {
+        const char* interfaceName = GetString(&iter);
+        if (!interfaceName || !dbus_message_iter_next(&iter))
+        {
+            return;
+        }
+        const char* path = dbus_message_get_path(message);
+        if (std::strcmp(interfaceName, DeviceInterface) == 0)
+        {
+            ApplyDeviceProperties(path, &iter, false);
+        }
+        else if (std::strcmp(interfaceName, AdapterInterface) == 0)
+        {
+            ApplyAdapterProperties(path, &iter);
+        }
+    }
+    else if (dbus_message_is_signal(message, ObjectManagerInterface, "InterfacesAdded"))
+    {
+        const char* path = GetString(&iter);
+        if (path && dbus_message_iter_next(&iter))
+        {
+            HandleInterfaces(path, &iter, false);
+        }
+    }
+    else if (dbus_message_is_signal(message, ObjectManagerInterface, "InterfacesRemoved"))
+    {
+        const char* path = GetString(&iter);
+        if (path && dbus_message_iter_next(&iter))
+        {
+            RemoveObject(path, &iter);
+        }
+    }
+}
+
+void LuminaBluezBackend::HandleAgentCall(DBusMessage* message)
+{
+    DBusMessage* reply = nullptr;
+    const char* path = dbus_message_get_path(message);
+    if (!path || std::strcmp(path, AgentPath) != 0 || !dbus_message_has_interface(message, AgentInterface))
+    {
+        reply = dbus_message_new_error(message, DBUS_ERROR_UNKNOWN_METHOD, "Unknown method");
+    }
+    else if (dbus_message_has_member(message, "RequestPinCode") || dbus_message_has_member(message, "RequestPasskey"))
+    {
+        // No way to enter a code here; the same pairings fail on Windows without a custom pairing UI
+        reply = dbus_message_new_error(message, "org.bluez.Error.Rejected", "Passkey entry is not supported");
+    }
+    else
+    {
+        // Confirmation and authorization are accepted, as a plain PairAsync does; display and Cancel need nothing
+        reply = dbus_message_new_method_return(message);
+    }
+    if (!dbus_message_get_no_reply(message))
+    {
+        dbus_connection_send(m_Connection, reply, nullptr);
+    }
+    dbus_message_unref(reply);
+}
+
+void LuminaBluezBackend::HandleObjects(DBusMessageIter* objects)
+{
+    ForEachEntry(objects, [this](DBusMessageIter* key, DBusMessageIter* interfaces)
+        {
+            if (const char* path = GetString(key))
+            {
+                HandleInterfaces(path, interfaces, true);
+            }
+        });
+}
+
+void LuminaBluezBackend::HandleInterfaces(const std::string& path, DBusMessageIter* interfaces, bool isInitial)
+{
+    ForEachEntry(interfaces, [&](DBusMessageIter* key, DBusMessageIter* properties)
+        {
+            const char* interfaceName = GetString(key);
+            if (!interfaceName)
+            {
+                return;
+            }
+            if (std::strcmp(interfaceName, AdapterInterface) == 0)
+            {
+                ApplyAdapterProperties(path, properties);
+            }
+            else if (std::strcmp(interfaceName, DeviceInterface) == 0)
+            {
+                ApplyDeviceProperties(path, properties, isInitial);
+            }
+        });
+}
+
+void LuminaBluezBackend::ApplyAdapterProperties(const std::string& path, DBusMessageIter* properties)
+{
+    std::lock_guard<std::mutex> lock(m_AdapterMutex);
+    auto [it, isInserted] = m_Adapters.try_emplace(path);
+    Adapter& adapter = it->second;
+    if (isInserted)
+    {
+        adapter.path = path;
+        adapter.index = AdapterIndexFromPath(path);
+    }
+    ForEachEntry(properties, [&](DBusMessageIter* key, DBusMessageIter* value)
+        {
+            const char* name = GetString(key);
+            if (!name)
+            {
+                return;
+            }
+            if (std::strcmp(name, "Address") == 0)
+            {
+                adapter.address = ParseAddress(GetString(value));
+            }
+            else if (std::strcmp(name, "Alias") == 0 || (std::strcmp(name, "Name") == 0 && adapter.name.empty()))
+            {
+                const char* text = GetString(value);
+                adapter.name = text ? text : "";
+            }
+            else if (std::strcmp(name, "Powered") == 0)
+            {
+                adapter.isPowered = GetBasic<dbus_bool_t>(value, DBUS_TYPE_BOOLEAN).value_or(false);
+            }
+            else if (std::strcmp(name, "Discovering") == 0)
+            {
+                adapter.isDiscovering = GetBasic<dbus_bool_t>(value, DBUS_TYPE_BOOLEAN).value_or(false);
+            }
+        });
+}
+
+void LuminaBluezBackend::ApplyDeviceProperties(std::string_view path, DBusMessageIter* properties, bool isInitial)
+{
+    // Looked up before inserting, since nearly every signal is for a device already known
+    auto it = m_Devices.find(path);
+    const bool isInserted = it == m_Devices.end();
+    if (isInserted)
+    {
+        it = m_Devices.try_emplace(std::string(path)).first;
+    }
+    Device& device = it->second;
+    if (isInserted)
+    {
+        device.path = path;
+        device.adapterIndex = AdapterIndexFromPath(device.path);
+        device.address = AddressFromDevicePath(device.path);
+    }
+
+    // RSSI arrives with every advert once DuplicateData is on; anything else also changes what the advert carries
+    bool isSighted = false;
+    bool isStateChanged = isInserted && isInitial;
+    ForEachEntry(properties, [&](DBusMessageIter* key, DBusMessageIter* value)
+        {
+            const char* name = GetString(key);
+            if (!name)
+            {
+                return;
+            }
+            if (std::strcmp(name, "RSSI") == 0)
+            {
+                device.rssi = GetBasic<dbus_int16_t>(value, DBUS_TYPE_INT16);
+                isSighted = device.rssi.has_value();
+            }
+            else if (std::strcmp(name, "ManufacturerData") == 0)
+            {
+                // Usually the same companies with new bytes, so their buffers are refilled rather than reallocated
+                std::vector<uint16_t> companies;
+                DBusMessageIter inner = Unwrap(value);
+                ForEachEntry(&inner, [&](DBusMessageIter* company, DBusMessageIter* data)
+                    {
+                        if (auto id = GetBasic<dbus_uint16_t>(company, DBUS_TYPE_UINT16))
+                        {
+                            GetBytes(data, device.manufacturerData[*id]);
+                            companies.push_back(*id);
+                        }
+                    });
+                std::erase_if(device.manufacturerData, [&](const auto& entry)
+                    {
+                        return std::find(companies.begin(), companies.end(), entry.first) == companies.end();
+                    });
+                device.isPayloadDirty = isSighted = true;
+            }
+            else if (std::strcmp(name, "ServiceData") == 0)
+            {
+                device.serviceData.clear();
+                DBusMessageIter inner = Unwrap(value);
+                ForEachEntry(&inner, [&](DBusMessageIter* uuid, DBusMessageIter* data)
+                    {
+                        if (const char* text = GetString(uuid))
+                        {
+                            GetBytes(data, device.serviceData[text]);
+                        }
+                    });
+                device.isPayloadDirty = isSighted = true;
+            }
+            else if (std::strcmp(name, "UUIDs") == 0)
+            {
+                device.uuids.clear();
+                DBusMessageIter inner = Unwrap(value);
+                if (dbus_message_iter_get_arg_type(&inner) == DBUS_TYPE_ARRAY)
+                {
+                    DBusMessageIter uuids;
+                    dbus_message_iter_recurse(&inner, &uuids);
+                    while (const char* text = GetString(&uuids))
+                    {
+                        device.uuids.push_back(text);
+                        dbus_message_iter_next(&uuids);
+                    }
+                }
+                device.isPayloadDirty = true;
+            }
+            else if (std::strcmp(name, "Name") == 0)
+            {
+                const char* text = GetString(value);
+                device.name = text ? text : "";
+                device.isPayloadDirty = true;
+            }
+            else if (std::strcmp(name, "TxPower") == 0)
+            {
+                auto power = GetBasic<dbus_int16_t>(value, DBUS_TYPE_INT16);
+                device.txPower = power ? std::optional<int8_t>(static_cast<int8_t>(*power)) : std::nullopt;
+                device.isPayloadDirty = true;
+            }
+            else if (std::strcmp(name, "Appearance") == 0)
+            {
+                device.appearance = GetBasic<dbus_uint16_t>(value, DBUS_TYPE_UINT16);
+                device.isPayloadDirty = true;
+            }
+            else if (std::strcmp(name, "AdvertisingFlags") == 0)
+            {
+                std::vector<uint8_t> flags;
+                device.flags = GetBytes(value, flags) && !flags.empty() ? std::optional<uint8_t>(flags[0]) : std::nullopt;
+                device.isPayloadDirty = true;
+            }
+            else if (std::strcmp(name, "Address") == 0)
+            {
+                device.address = ParseAddress(GetString(value));
+            }
+            else if (std::strcmp(name, "AddressType") == 0)
+            {
+                const char* text = GetString(value);
+                device.addressType = !text ? Lumina::AdvertisementSample::AddressUnknown
+                    : std::strcmp(text, "random") == 0 ? Lumina::AdvertisementSample::AddressRandom
+                    : Lumina::AdvertisementSample::AddressPublic;
+            }
+            else if (std::strcmp(name, "Paired") == 0)
+            {
+                device.isPaired = GetBasic<dbus_bool_t>(value, DBUS_TYPE_BOOLEAN).value_or(false);
+                isStateChanged = true;
+            }
+            else if (std::strcmp(name, "Connected") == 0)
+            {
+                device.isConnected = GetBasic<dbus_bool_t>(value, DBUS_TYPE_BOOLEAN).value_or(false);
+                isStateChanged = true;
+            }
+        });
+
+    if (isInserted && device.address != 0)
+    {
+        m_DevicePaths.try_emplace(device.address, device.path);
+    }
+    if (isStateChanged && m_OnDeviceState && (!isInitial || device.isPaired || device.isConnected))
+    {
+        m_OnDeviceState({ device.address, device.isPaired, device.isConnected, false });
+    }
+    // The snapshot's RSSI is from whenever BlueZ last heard the device; only live signals are sightings
+    if (isSighted && !isInitial && device.rssi && !device.isQueued)
+    {
+        device.isQueued = true;
+        m_QueuedDevices.push_back(&device);
+    }
+}
+
+void LuminaBluezBackend::RemoveObject(const std::string& path, DBusMessageIter* interfaces)
+{
+    if (dbus_message_iter_get_arg_type(interfaces) != DBUS_TYPE_ARRAY)
+    {
+        return;
+    }
+    DBusMessageIter names;
+    dbus_message_iter_recurse(interfaces, &names);
+    while (const char* interfaceName = GetString(&names))
+    {
+        if (std::strcmp(interfaceName, DeviceInterface) == 0)
+        {
+            ForgetDevice(path);
+        }
+        else if (std::strcmp(interfaceName, AdapterInterface) == 0)
+        {
+            // bluetoothd removes an adapter's devices first, but a crashed daemon or a yanked dongle may not
+            const std::string prefix = path + "/";
+            std::vector<std::string> devicePaths;
+            for (const auto& [devicePath, device] : m_Devices)
+            {
+                if (devicePath.compare(0, prefix.size(), prefix) == 0)
+                {
+                    devicePaths.push_back(devicePath);
+                }
+            }
+            for (const std::string& devicePath : devicePaths)
+            {
+                ForgetDevice(devicePath);
+            }
+            std::lock_guard<std::mutex> lock(m_AdapterMutex);
+            m_Adapters.erase(path);
+        }
+        dbus_message_iter_next(&names);
+    }
+}
+
+void LuminaBluezBackend::ForgetDevice(const std::string& path)
+{
+    auto it = m_Devices.find(path);
+    if (it == m_Devices.end())
+    {
+        return;
+    }
+    if (it->second.isQueued)
+    {
+        m_QueuedDevices.erase(std::find(m_QueuedDevices.begin(), m_QueuedDevices.end(), &it->second));
+    }
+    const uint64_t address = it->second.address;
+    m_Devices.erase(it);
+
+    // Another adapter may still know the address; calls go through its path from now on
+    auto pathIt = m_DevicePaths.find(address);
+    if (pathIt != m_DevicePaths.end() && pathIt->second == path)
+    {
+        m_DevicePaths.erase(pathIt);
+        for (const auto& [otherPath, other] : m_Devices)
+        {
+            if (other.address == address)
+            {
+                m_DevicePaths.emplace(address, otherPath);
+                break;
+            }
+        }
+    }
+    if (m_OnDeviceState && !m_DevicePaths.count(address))
+    {
+        m_OnDeviceState({ address, false, false, true });
+    }
+}
+
+void LuminaBluezBackend::EmitQueuedSamples(std::chrono::steady_clock::time_point receivedAt)
+{
+    // One sample per device per batch, however many of its properties changed
+    for (Device* queued : m_QueuedDevices)
+    {
+        Device& device = *queued;
+        device.isQueued = false;
+        if (device.isPayloadDirty)
+        {
+            BuildPayload(device);
+        }
+
+        Lumina::AdvertisementSample sample;
+        sample.address = device.address;
+        sample.addressType = device.addressType;
+        sample.timestamp = receivedAt;
+        sample.rssi = *device.rssi;
+        sample.adapterIndex = static_cast<uint8_t>(device.adapterIndex);
+        sample.adapterRssi[device.adapterIndex] = static_cast<int8_t>(std::clamp<int>(*device.rssi, -127, 20));
+        sample.payloadLength = device.payloadLength;
+        std::memcpy(sample.payload, device.payload, device.payloadLength);
+        ++m_SampleCount;
+        if (m_OnSample)
+        {
+            m_OnSample(sample);
+        }
+    }
+    m_QueuedDevices.clear();
+}
+
+void LuminaBluezBackend::ExpireReplies(std::chrono::steady_clock::time_point now)
+{
+    for (auto it = m_PendingReplies.begin(); it != m_PendingReplies.end();)
+    {
+        if (it->second.deadline > now)
+        {
+            ++it;
+            continue;
+        }
+        Completion completion = std::move(it->second.completion);
+        it = m_PendingReplies.erase(it);
+        if (completion)
+        {
+            completion(false, "Timed out");
+        }
+    }
+}
+
+void LuminaBluezBackend::BuildPayload(Device& device)
+{
+    // BlueZ hands out the advert already parsed; put the AD structures back together for the shared ingest path
+    Lumina::AdvertisementSample scratch;
+    if (device.flags)
+    {
+        scratch.AppendSection(0x01, &*device.flags, 1);
+    }
+
+    uint8_t shortUuids[Lumina::AdvertisementSample::MaxPayloadSize];
+    uint8_t longUuids[Lumina::AdvertisementSample::MaxPayloadSize];
+    size_t shortLength = 0;
+    size_t longLength = 0;
+    for (const std::string& text : device.uuids)
+    {
+        Lumina::ServiceUuid uuid;
+        if (!LuminaHelper::ParseServiceUuid(text, uuid))
+        {
+            continue;
+        }
+        int alias = ShortUuid(uuid);
+        if (alias >= 0 && shortLength + 2 <= sizeof(shortUuids))
+        {
+            shortUuids[shortLength++] = static_cast<uint8_t>(alias);
+            shortUuids[shortLength++] = static_cast<uint8_t>(alias >> 8);
+        }
+        else if (alias < 0 && longLength + 16 <= sizeof(longUuids))
+        {
+            UuidToBytes(uuid, longUuids + longLength);
+            longLength += 16;
+        }
+    }
+    if (shortLength > 0)
+    {
+        scratch.AppendSection(0x03, shortUuids, shortLength);
+    }
+    if (longLength > 0)
+    {
+        scratch.AppendSection(0x07, longUuids, longLength);
+    }
+    if (!device.name.empty())
+    {
+        scratch.AppendSection(0x09, reinterpret_cast<const uint8_t*>(device.name.data()), device.name.size());
+    }
+    if (device.txPower)
+    {
+        scratch.AppendSection(0x0A, reinterpret_cast<const uint8_t*>(&*device.txPower), 1);
+    }
+    if (device.appearance)
+    {
+        const uint8_t appearance[2] = { static_cast<uint8_t>(*device.appearance), static_cast<uint8_t>(*device.appearance >> 8) };
+        scratch.AppendSection(0x19, appearance, sizeof(appearance));
+    }
+    for (const auto& [company, data] : device.manufacturerData)
+    {
+        uint8_t section[Lumina::AdvertisementSample::MaxPayloadSize];
+        size_t length = std::min(data.size(), sizeof(section) - 2);
+        section[0] = static_cast<uint8_t>(company);
+        section[1] = static_cast<uint8_t>(company >> 8);
+        std::memcpy(section + 2, data.data(), length);
+        scratch.AppendSection(0xFF, section, length + 2);
+    }
+    for (const auto& [text, data] : device.serviceData)
+    {
+        Lumina::ServiceUuid uuid;
+        if (!LuminaHelper::ParseServiceUuid(text, uuid))
+        {
+            continue;
+        }
+        uint8_t section[Lumina::AdvertisementSample::MaxPayloadSize];
+        int alias = ShortUuid(uuid);
+        size_t uuidLength = alias >= 0 ? 2 : 16;
+        if (alias >= 0)
+        {
+            section[0] = static_cast<uint8_t>(alias);
+            section[1] = static_cast<uint8_t>(alias >> 8);
+        }
+        else
+        {
+            UuidToBytes(uuid, section);
+        }
+        size_t length = std::min(data.size(), sizeof(section) - uuidLength);
+        std::memcpy(section + uuidLength, data.data(), length);
+        scratch.AppendSection(alias >= 0 ? 0x16 : 0x21, section, uuidLength + length);
+    }
+
+    device.payloadLength = scratch.payloadLength;
+    std::memcpy(device.payload, scratch.payload, scratch.payloadLength);
+    device.isPayloadDirty = false;
+}
+#endif
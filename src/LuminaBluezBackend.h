@@ -0,0 +1,189 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "LuminaAdvertisement.h"
+
+struct DBusConnection;
+struct DBusMessage;
+struct DBusMessageIter;
+
+// Discovery, pairing and connection through BlueZ's D-Bus API, for Linux stations without WinRT.
+// One event-loop thread owns the connection and does all D-Bus work. Adapters and devices are read with a
+// single ObjectManager.GetManagedObjects call at start and kept current from InterfacesAdded,
+// InterfacesRemoved and PropertiesChanged signals, so no property is ever fetched on its own. Each wakeup
+// drains everything the bus has sent before acting on it, and a device whose properties changed several
+// times in one batch yields one sample.
+//
+// Samples carry the adapter's hci index in adapterIndex, so each adapter can feed its own LuminaScanMerger
+// lane. Handlers and completions run on the event-loop thread; keep them short.
+class LuminaBluezBackend
+{
+public:
+    struct Options
+    {
+        std::string busAddress;                             // Empty for the system bus; tests point this at a private bus
+        std::string serviceName = "org.bluez";
+        std::chrono::milliseconds callTimeout{ 25000 };
+        std::chrono::milliseconds pairTimeout{ 60000 };     // Pairing may wait on the peer
+    };
+
+    // What SetDiscoveryFilter can take from a scan profile. BlueZ discovery always scans actively and has no
+    // out-of-range timeout, so those parts of a profile apply to the Windows watcher only.
+    struct DiscoveryFilter
+    {
+        std::optional<int16_t> minRssi;                     // Adverts weaker than this are not reported
+    };
+
+    struct Adapter
+    {
+        std::string path;
+        int index = 0;              // N of hciN
+        uint64_t address = 0;
+        std::string name;
+        bool isPowered = false;
+        bool isDiscovering = false;
+    };
+
+    struct DeviceState
+    {
+        uint64_t address = 0;
+        bool isPaired = false;
+        bool isConnected = false;
+        bool isRemoved = false;     // BlueZ forgot the device, e.g. after RemoveDevice
+    };
+
+    struct Stats
+    {
+        uint64_t messages = 0;      // Signals and replies read
+        uint64_t batches = 0;       // Wakeups that found at least one message
+        uint64_t samples = 0;
+        uint64_t methodCalls = 0;   // Round trips made, including those at start
+    };
+
+    using SampleHandler = std::function<void(const Lumina::AdvertisementSample&)>;
+    using DeviceStateHandler = std::function<void(const DeviceState&)>;
+    using Completion = std::function<void(bool succeeded, const std::string& error)>;
+
+    LuminaBluezBackend();
+    ~LuminaBluezBackend();
+    LuminaBluezBackend(const LuminaBluezBackend&) = delete;
+    LuminaBluezBackend& operator=(const LuminaBluezBackend&) = delete;
+
+    // Set before Start
+    void HandleOnSample(const SampleHandler& handler) { m_OnSample = handler; }
+    // Pairing and connection changes, and the paired or connected devices found at start
+    void HandleOnDeviceState(const DeviceStateHandler& handler) { m_OnDeviceState = handler; }
+
+    // Connects, registers the pairing agent, reads every adapter and device, and starts the event loop
+    bool Start(const Options& options, std::string& error);
+    void Stop();
+    bool IsRunning() const { return m_IsRunning; }
+
+    // Thread-safe and asynchronous. The completion may be empty; it runs on the event-loop thread, or right
+    // away on the caller's if the backend is not running.
+    void StartDiscovery(const DiscoveryFilter& filter, Completion completion = {}); // Every powered adapter, LE only, every advert reported
+    void StopDiscovery(Completion completion = {});
+    void Pair(uint64_t address, Completion completion = {});
+    void Connect(uint64_t address, Completion completion = {});
+    void Disconnect(uint64_t address, Completion completion = {});
+    void RemoveDevice(uint64_t address, Completion completion = {}); // Unpairs and forgets
+
+    std::vector<Adapter> GetAdapters() const;
+    Stats GetStats() const { return { m_MessageCount, m_BatchCount, m_SampleCount, m_MethodCallCount }; }
+
+private:
+    static constexpr const char* AgentPath = "/org/lumina/agent";
+    static constexpr int MaxReadsPerBatch = 64;     // Socket reads folded into one batch before it is handled
+
+    // BlueZ's view of one device on one adapter
+    struct Device
+    {
+        std::string path;
+        uint64_t address = 0;
+        uint8_t addressType = Lumina::AdvertisementSample::AddressUnknown;
+        int adapterIndex = 0;
+        std::optional<int16_t> rssi;
+        std::optional<int8_t> txPower;
+        std::optional<uint16_t> appearance;
+        std::optional<uint8_t> flags;
+        std::string name;
+        std::vector<std::string> uuids;
+        std::map<uint16_t, std::vector<uint8_t>> manufacturerData;
+        std::map<std::string, std::vector<uint8_t>> serviceData;
+        bool isPaired = false;
+        bool isConnected = false;
+
+        // Advert rebuilt from the properties only when one of them changed
+        bool isPayloadDirty = true;
+        uint16_t payloadLength = 0;
+        uint8_t payload[Lumina::AdvertisementSample::MaxPayloadSize] = {};
+        bool isQueued = false;  // Has a sample due at the end of this batch
+    };
+
+    // Lets a device be found by the path in a signal without building a string for it
+    struct PathHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view path) const { return std::hash<std::string_view>{}(path); }
+    };
+
+    struct PendingReply
+    {
+        Completion completion;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    Options m_Options;
+    DBusConnection* m_Connection = nullptr;
+    int m_WakeFd = -1;
+    std::thread m_LoopThread;
+    std::atomic<bool> m_IsRunning = false;
+    std::atomic<bool> m_StopRequested = false;
+
+    std::mutex m_CommandMutex;
+    std::vector<std::function<void()>> m_Commands;
+
+    SampleHandler m_OnSample;
+    DeviceStateHandler m_OnDeviceState;
+
+    mutable std::mutex m_AdapterMutex;
+    std::map<std::string, Adapter> m_Adapters;  // By path; written on the loop thread
+
+    // Loop thread only
+    std::unordered_map<std::string, Device, PathHash, std::equal_to<>> m_Devices;  // By object path
+    std::unordered_map<uint64_t, std::string> m_DevicePaths;    // Address to one adapter's object path, the first while it lasts
+    std::vector<Device*> m_QueuedDevices;
+    std::unordered_map<uint32_t, PendingReply> m_PendingReplies;
+
+    std::atomic<uint64_t> m_MessageCount = 0;
+    std::atomic<uint64_t> m_BatchCount = 0;
+    std::atomic<uint64_t> m_SampleCount = 0;
+    std::atomic<uint64_t> m_MethodCallCount = 0;
+
+    void Post(std::function<void()> command, const Completion& completion);
+    void RunLoop();
+    void HandleMessage(DBusMessage* message);
+    void HandleAgentCall(DBusMessage* message);
+    void HandleObjects(DBusMessageIter* objects);
+    void HandleInterfaces(const std::string& path, DBusMessageIter* interfaces, bool isInitial);
+    void ApplyAdapterProperties(const std::string& path, DBusMessageIter* properties);
+    void ApplyDeviceProperties(std::string_view path, DBusMessageIter* properties, bool isInitial);
+    void RemoveObject(const std::string& path, DBusMessageIter* interfaces);
+    // Drops one object path's device; reported removed once no adapter knows its address
+    void ForgetDevice(const std::string& path);
+    void EmitQueuedSamples(std::chrono::steady_clock::time_point receivedAt);
+    void ExpireReplies(std::chrono::steady_clock::time_point now);
+    void CallDevice(uint64_t address, const char* interfaceName, const char* method, std::chrono::milliseconds timeout, Completion completion);
+    void Send(DBusMessage* message, Completion completion, std::chrono::milliseconds timeout);
+    static void BuildPayload(Device& device);
+};
@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <cctype>
+#include "LuminaDevice.h"
+#include "LuminaHelper.h"
+
+namespace
+{
+    constexpr size_t AddressLength = 17; // "aa:bb:cc:dd:ee:ff"
+
+    std::string FormatIdAddress(uint64_t address)
+    {
+        // Device IDs spell the address in lower case
+        std::string text = LuminaHelper::BluetoothAddressToString(address);
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return text;
+    }
+}
+
+namespace Lumina
+{
+    const char* DeviceTypeToString(DeviceType type)
+    {
+        switch (type)
+        {
+        case DeviceType::LowEnergy: return "Low Energy";
+        case DeviceType::Classic: return "Classic";
+        default: return "Unknown";
+        }
+    }
+
+    DeviceType DeviceTypeFromString(std::string_view text)
+    {
+        if (text == "Low Energy")
+        {
+            return DeviceType::LowEnergy;
+        }
+        if (text == "Classic")
+        {
+            return DeviceType::Classic;
+        }
+        return DeviceType::Unknown;
+    }
+
+    std::string BluetoothDevice::GetDeviceId() const
+    {
+        const std::string& prefix = LuminaStringPool::Get().Lookup(deviceIdPrefixId);
+        return (flags & FlagOpaqueDeviceId) ? prefix : prefix + FormatIdAddress(address);
+    }
+
+    void BluetoothDevice::SetDeviceId(const std::string& deviceId)
+    {
+        address = LuminaHelper::DeviceIdToAddress(deviceId);
+
+        // Keep only the prefix when the address can be spelled back exactly, otherwise the whole ID
+        size_t prefixLength = deviceId.size() >= AddressLength ? deviceId.size() - AddressLength : 0;
+        bool isExact = deviceId.size() >= AddressLength && deviceId.compare(prefixLength, AddressLength, FormatIdAddress(address)) == 0;
+        deviceIdPrefixId = LuminaStringPool::Get().Intern(isExact ? std::string_view(deviceId).substr(0, prefixLength) : std::string_view(deviceId));
+        flags = static_cast<uint8_t>(isExact ? (flags & ~FlagOpaqueDeviceId) : (flags | FlagOpaqueDeviceId));
+    }
+
+    std::string BluetoothDevice::GetAddressString() const
+    {
+        return LuminaHelper::BluetoothAddressToString(address);
+    }
+}
@@ -1,15 +1,52 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include "LuminaStringPool.h"
 
 namespace Lumina
 {
+    enum class DeviceType : uint8_t
+    {
+        Unknown,
+        LowEnergy,
+        Classic,
+    };
+
+    const char* DeviceTypeToString(DeviceType type);
+    DeviceType DeviceTypeFromString(std::string_view text);
+
+    // Packed device record, copied by value between the discovered/paired/connected lists.
+    // Strings live in LuminaStringPool and are referenced by ID.
     struct BluetoothDevice
     {
-        std::string name;
-        std::string address;
-        bool isConnected;
-        bool isPaired;
-        int signalStrength; // RSSI value. Not available in this API
-        std::string deviceType; // Ideally should be enum after knowing all possible device type
+        static constexpr uint8_t FlagConnected = 0x01;
+        static constexpr uint8_t FlagPaired = 0x02;
+        static constexpr uint8_t FlagOpaqueDeviceId = 0x04; // deviceIdPrefixId holds the whole platform ID
+
+        uint64_t address = 0;           // Peer address, see LuminaHelper::DeviceIdToAddress
+        LuminaStringPool::Id deviceIdPrefixId = LuminaStringPool::EmptyId; // Platform ID up to the address, shared per adapter
+        LuminaStringPool::Id nameId = LuminaStringPool::EmptyId;
+        LuminaStringPool::Id labelId = LuminaStringPool::EmptyId;          // User label, persisted in the device registry
+        int8_t signalStrength = 0;      // RSSI value. Not available in this API
+        DeviceType deviceType = DeviceType::Unknown;
+        uint8_t flags = 0;
+
+        bool IsConnected() const { return (flags & FlagConnected) != 0; }
+        bool IsPaired() const { return (flags & FlagPaired) != 0; }
+        void SetConnected(bool value) { flags = static_cast<uint8_t>(value ? (flags | FlagConnected) : (flags & ~FlagConnected)); }
+        void SetPaired(bool value) { flags = static_cast<uint8_t>(value ? (flags | FlagPaired) : (flags & ~FlagPaired)); }
+
+        const std::string& GetName() const { return LuminaStringPool::Get().Lookup(nameId); }
+        const std::string& GetLabel() const { return LuminaStringPool::Get().Lookup(labelId); }
+        void SetName(std::string_view value) { nameId = LuminaStringPool::Get().Intern(value); }
+        void SetLabel(std::string_view value) { labelId = LuminaStringPool::Get().Intern(value); }
+
+        // Platform device ID (e.g. for DeviceInformation::CreateFromIdAsync); also sets the address
+        std::string GetDeviceId() const;
+        void SetDeviceId(const std::string& deviceId);
+        // "AA:BB:CC:DD:EE:FF"
+        std::string GetAddressString() const;
     };
-}
\ No newline at end of file
+    static_assert(sizeof(BluetoothDevice) == 24, "BluetoothDevice is meant to stay packed");
+}
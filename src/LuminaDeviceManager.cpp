@@ -10,6 +10,7 @@
 #include <winrt/Windows.Devices.Radios.h>
 #include <imgui.h>
 #include "LuminaDeviceManager.h"
+#include "LuminaHelper.h"
 
 using namespace winrt;
 using namespace Windows::Devices::Enumeration;
@@ -17,14 +18,6 @@ using namespace Windows::Devices::Enumeration;
 LuminaDeviceManager::LuminaDeviceManager()
     : m_IsShuttingDown(false)
 {
-    try
-    {
-        winrt::init_apartment();
-    }
-    catch (...)
-    {
-        // Handle initialization error
-    }
 }
 
 LuminaDeviceManager::~LuminaDeviceManager()
@@ -36,6 +29,13 @@ void LuminaDeviceManager::Cleanup()
 {
     m_IsShuttingDown = true;
 
+    if (m_KnownDevicesLoad.valid())
+    {
+        m_KnownDevicesLoad.wait();
+    }
+    m_Registry.Close();
+    m_RssiHistory.Close();
+
     // Clear all device lists
     m_DiscoveredDevices.clear();
     m_PairedDevices.clear();
@@ -51,38 +51,49 @@ void LuminaDeviceManager::AddDevice(const Lumina::BluetoothDevice& device)
     if (it == m_PairedDevices.end())
     {
         Lumina::BluetoothDevice newDevice = device;
-        newDevice.isPaired = true;
+        newDevice.SetPaired(true);
         m_PairedDevices.push_back(newDevice);
+        SaveKnownDevice(newDevice);
     }
 }
 
-void LuminaDeviceManager::RemoveDevice(const std::string& deviceAddress)
+void LuminaDeviceManager::RemoveDevice(uint64_t address)
 {
     if (m_IsShuttingDown)
     {
         return;
     }
 
+    // The platform ID is rebuilt from the record, so take it before the record goes away
+    Lumina::BluetoothDevice* device = GetDeviceByAddress(address);
+    if (!device)
+    {
+        return;
+    }
+    std::string deviceId = device->GetDeviceId();
+
     // Remove from paired devices
     auto it = std::remove_if(m_PairedDevices.begin(), m_PairedDevices.end(),
-        [&deviceAddress](const Lumina::BluetoothDevice& device) { return device.address == deviceAddress; });
+        [address](const Lumina::BluetoothDevice& device) { return device.address == address; });
     if (it != m_PairedDevices.end())
     {
         m_PairedDevices.erase(it, m_PairedDevices.end());
     }
+    m_Registry.Remove(address);
     // Remove from connected devices
     it = std::remove_if(m_ConnectedDevices.begin(), m_ConnectedDevices.end(),
-        [&deviceAddress](const Lumina::BluetoothDevice& device) { return device.address == deviceAddress; });
+        [address](const Lumina::BluetoothDevice& device) { return device.address == address; });
     if (it != m_ConnectedDevices.end())
     {
         m_ConnectedDevices.erase(it, m_ConnectedDevices.end());
     }
+    PublishConnection(address, Lumina::ConnectionEvent::State::Removed);
 
     try
     {
         // Use WinRT to unpair (remove) the device from the system
-        auto asyncOp = DeviceInformation::CreateFromIdAsync(winrt::to_hstring(deviceAddress));
-        asyncOp.Completed([this, deviceAddress](auto const& op, auto const& status)
+        auto asyncOp = DeviceInformation::CreateFromIdAsync(winrt::to_hstring(deviceId));
+        asyncOp.Completed([this](auto const& op, auto const& status)
             {
                 if (m_IsShuttingDown) return;
 
@@ -118,20 +129,20 @@ void LuminaDeviceManager::RemoveDevice(const std::string& deviceAddress)
     }
 }
 
-void LuminaDeviceManager::ConnectToDevice(const std::string& deviceAddress)
+void LuminaDeviceManager::ConnectToDevice(uint64_t address)
 {
     if (m_IsShuttingDown)
     {
         return;
     }
 
-    Lumina::BluetoothDevice* device = GetDeviceByAddress(deviceAddress);
-    if (device && !device->isConnected)
+    Lumina::BluetoothDevice* device = GetDeviceByAddress(address);
+    if (device && !device->IsConnected())
     {
         try
         {
             // Use WinRT to pair (connect) the device
-            std::string id = device->address;
+            std::string id = device->GetDeviceId();
             auto idH = winrt::to_hstring(id);
             auto asyncOp = DeviceInformation::CreateFromIdAsync(idH);
             asyncOp.Completed([this, device](auto const& op, auto const& status)
@@ -158,8 +169,9 @@ void LuminaDeviceManager::ConnectToDevice(const std::string& deviceAddress)
                                                 if (result.Status() == Windows::Devices::Enumeration::DevicePairingResultStatus::Paired ||
                                                     result.Status() == Windows::Devices::Enumeration::DevicePairingResultStatus::AlreadyPaired)
                                                 {
-                                                    device->isConnected = true;
-                                                    device->isPaired = true;
+                                                    device->SetConnected(true);
+                                                    device->SetPaired(true);
+                                                    SaveKnownDevice(*device);
                                                     // Add to connected devices list if not already there
                                                     auto it = std::find_if(m_ConnectedDevices.begin(), m_ConnectedDevices.end(),
                                                         [device](const Lumina::BluetoothDevice& d) { return d.address == device->address; });
@@ -167,6 +179,7 @@ void LuminaDeviceManager::ConnectToDevice(const std::string& deviceAddress)
                                                     {
                                                         m_ConnectedDevices.push_back(*device);
                                                     }
+                                                    PublishConnection(device->address, Lumina::ConnectionEvent::State::Connected);
                                                 }
                                             }
                                             catch (...)
@@ -199,21 +212,22 @@ void LuminaDeviceManager::ConnectToDevice(const std::string& deviceAddress)
     }
 }
 
-void LuminaDeviceManager::DisconnectFromDevice(const std::string& deviceAddress)
+void LuminaDeviceManager::DisconnectFromDevice(uint64_t address)
 {
-    Lumina::BluetoothDevice* device = GetDeviceByAddress(deviceAddress);
-    if (device && device->isConnected)
+    Lumina::BluetoothDevice* device = GetDeviceByAddress(address);
+    if (device && device->IsConnected())
     {
-        device->isConnected = false;
+        device->SetConnected(false);
 
         // Remove from connected devices list
         auto it = std::remove_if(m_ConnectedDevices.begin(), m_ConnectedDevices.end(),
-            [&deviceAddress](const Lumina::BluetoothDevice& d) { return d.address == deviceAddress; });
+            [address](const Lumina::BluetoothDevice& d) { return d.address == address; });
 
         if (it != m_ConnectedDevices.end())
         {
             m_ConnectedDevices.erase(it, m_ConnectedDevices.end());
         }
+        PublishConnection(address, Lumina::ConnectionEvent::State::Disconnected);
     }
 }
 
@@ -231,6 +245,14 @@ void LuminaDeviceManager::AddDiscoveredDevice(const Lumina::BluetoothDevice& dev
     {
         m_DiscoveredDevices.push_back(device);
     }
+
+    // Keep last-seen details of known devices current
+    if (auto record = m_Registry.Find(device.address))
+    {
+        record->lastRssi = static_cast<int16_t>(device.signalStrength);
+        record->lastSeen = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        m_Registry.Upsert(*record);
+    }
 }
 
 void LuminaDeviceManager::ClearDiscoveredDevices()
@@ -248,11 +270,11 @@ const std::vector<Lumina::BluetoothDevice>& LuminaDeviceManager::GetConnectedDev
     return m_ConnectedDevices;
 }
 
-Lumina::BluetoothDevice* LuminaDeviceManager::GetDeviceByAddress(const std::string& deviceAddress)
+Lumina::BluetoothDevice* LuminaDeviceManager::GetDeviceByAddress(uint64_t address)
 {
     // Search in paired devices first
     auto it = std::find_if(m_PairedDevices.begin(), m_PairedDevices.end(),
-        [&deviceAddress](const Lumina::BluetoothDevice& device) { return device.address == deviceAddress; });
+        [address](const Lumina::BluetoothDevice& device) { return device.address == address; });
 
     if (it != m_PairedDevices.end())
     {
@@ -261,7 +283,7 @@ Lumina::BluetoothDevice* LuminaDeviceManager::GetDeviceByAddress(const std::stri
 
     // Search in discovered devices
     it = std::find_if(m_DiscoveredDevices.begin(), m_DiscoveredDevices.end(),
-        [&deviceAddress](const Lumina::BluetoothDevice& device) { return device.address == deviceAddress; });
+        [address](const Lumina::BluetoothDevice& device) { return device.address == address; });
 
     if (it != m_DiscoveredDevices.end())
     {
@@ -271,22 +293,123 @@ Lumina::BluetoothDevice* LuminaDeviceManager::GetDeviceByAddress(const std::stri
     return nullptr;
 }
 
-bool LuminaDeviceManager::IsDeviceConnected(const std::string& deviceAddress) const
+bool LuminaDeviceManager::IsDeviceConnected(uint64_t address) const
 {
     auto it = std::find_if(m_ConnectedDevices.begin(), m_ConnectedDevices.end(),
-        [&deviceAddress](const Lumina::BluetoothDevice& device) { return device.address == deviceAddress; });
+        [address](const Lumina::BluetoothDevice& device) { return device.address == address; });
 
     return it != m_ConnectedDevices.end();
 }
 
-bool LuminaDeviceManager::IsDevicePaired(const std::string& deviceAddress) const
+bool LuminaDeviceManager::IsDevicePaired(uint64_t address) const
 {
     auto it = std::find_if(m_PairedDevices.begin(), m_PairedDevices.end(),
-        [&deviceAddress](const Lumina::BluetoothDevice& device) { return device.address == deviceAddress; });
+        [address](const Lumina::BluetoothDevice& device) { return device.address == address; });
 
     return it != m_PairedDevices.end();
 }
 
+void LuminaDeviceManager::SetDeviceLabel(uint64_t address, const std::string& label)
+{
+    Lumina::BluetoothDevice* device = GetDeviceByAddress(address);
+    if (device)
+    {
+        device->SetLabel(label);
+        if (IsDevicePaired(address))
+        {
+            SaveKnownDevice(*device);
+        }
+    }
+}
+
+void LuminaDeviceManager::OpenRegistry()
+{
+    if (IsRegistryLoading())
+    {
+        return;
+    }
+
+    m_Registry.HandleOnErrorMessage([this](const std::string& message) { PublishNotification(Lumina::Severity::Error, message); });
+    m_KnownDevicesLoad = std::async(std::launch::async, [this]() -> std::optional<std::vector<Lumina::BluetoothDevice>>
+        {
+            std::string error;
+            if (!m_RssiHistory.IsOpen() && !m_RssiHistory.Open(LuminaConfig::RegistryDirectory, LuminaConfig::RssiHistoryName, error))
+            {
+                PublishNotification(Lumina::Severity::Warning, error);
+                error.clear();
+            }
+            if (!m_Registry.Open(LuminaConfig::RegistryDirectory, LuminaConfig::RegistryName, error))
+            {
+                PublishNotification(Lumina::Severity::Error, error);
+                return std::nullopt;
+            }
+
+            std::vector<Lumina::BluetoothDevice> devices;
+            for (const auto& record : m_Registry.GetRecords())
+            {
+                Lumina::BluetoothDevice device;
+                device.SetName(record.name);
+                device.SetDeviceId(record.id);
+                device.SetPaired((record.flags & Lumina::RegistryRecord::FlagPaired) != 0);
+                device.signalStrength = static_cast<int8_t>(std::clamp<int>(record.lastRssi, INT8_MIN, INT8_MAX));
+                device.deviceType = Lumina::DeviceTypeFromString(record.deviceType);
+                device.SetLabel(record.label);
+                devices.push_back(device);
+            }
+            return devices;
+        });
+}
+
+bool LuminaDeviceManager::PollRegistryLoad()
+{
+    if (!IsRegistryLoading() || m_KnownDevicesLoad.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        return false;
+    }
+
+    auto devices = m_KnownDevicesLoad.get();
+    if (devices)
+    {
+        m_PairedDevices = std::move(*devices);
+    }
+    return true;
+}
+
+void LuminaDeviceManager::NewRegistry()
+{
+    if (IsRegistryLoading())
+    {
+        return;
+    }
+
+    m_Registry.Clear();
+    m_PairedDevices.clear();
+    m_ConnectedDevices.clear();
+}
+
+void LuminaDeviceManager::SaveRegistry()
+{
+    m_Registry.Flush();
+}
+
+void LuminaDeviceManager::SaveKnownDevice(const Lumina::BluetoothDevice& device)
+{
+    Lumina::RegistryRecord record;
+    if (auto existing = m_Registry.Find(device.address))
+    {
+        record = *existing; // Keep fields this device struct does not carry
+    }
+    record.address = device.address;
+    record.lastRssi = static_cast<int16_t>(device.signalStrength);
+    record.lastSeen = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    record.flags = device.IsPaired() ? Lumina::RegistryRecord::FlagPaired : 0;
+    record.SetId(device.GetDeviceId());
+    record.SetName(device.GetName());
+    record.SetDeviceType(Lumina::DeviceTypeToString(device.deviceType));
+    record.SetLabel(device.GetLabel());
+    m_Registry.Upsert(record);
+}
+
 void LuminaDeviceManager::Render()
 {
     ImGui::Begin("Device Manager");
@@ -302,16 +425,16 @@ void LuminaDeviceManager::Render()
     {
         for (const auto& device : m_DiscoveredDevices)
         {
-            ImGui::Text("%s (%s)", device.name.c_str(), device.address.c_str());
+            ImGui::Text("%s (%s)", device.GetName().c_str(), device.GetAddressString().c_str());
             ImGui::SameLine();
             ImGui::Text("Signal: %d dBm", device.signalStrength);
 
-            if (ImGui::Button(("Add##" + device.address).c_str(), ImVec2(60, 0)))
+            if (ImGui::Button(("Add##" + device.GetAddressString()).c_str(), ImVec2(60, 0)))
             {
                 AddDevice(device);
             }
             ImGui::SameLine();
-            if (ImGui::Button(("Connect##" + device.address).c_str(), ImVec2(60, 0)))
+            if (ImGui::Button(("Connect##" + device.GetAddressString()).c_str(), ImVec2(60, 0)))
             {
                 ConnectToDevice(device.address);
             }
@@ -332,9 +455,9 @@ void LuminaDeviceManager::Render()
     {
         for (const auto& device : m_PairedDevices)
         {
-            ImGui::Text("%s (%s)", device.name.c_str(), device.address.c_str());
+            ImGui::Text("%s (%s)", device.GetName().c_str(), device.GetAddressString().c_str());
             ImGui::SameLine();
-            if (device.isConnected)
+            if (device.IsConnected())
             {
                 ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "Connected");
             }
@@ -343,10 +466,10 @@ void LuminaDeviceManager::Render()
                 ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Disconnected");
             }
 
-            if (!device.isConnected)
+            if (!device.IsConnected())
             {
                 ImGui::SameLine();
-                if (ImGui::Button(("Connect##paired" + device.address).c_str(), ImVec2(60, 0)))
+                if (ImGui::Button(("Connect##paired" + device.GetAddressString()).c_str(), ImVec2(60, 0)))
                 {
                     ConnectToDevice(device.address);
                 }
@@ -354,14 +477,14 @@ void LuminaDeviceManager::Render()
             else
             {
                 ImGui::SameLine();
-                if (ImGui::Button(("Disconnect##paired" + device.address).c_str(), ImVec2(60, 0)))
+                if (ImGui::Button(("Disconnect##paired" + device.GetAddressString()).c_str(), ImVec2(60, 0)))
                 {
                     DisconnectFromDevice(device.address);
                 }
             }
 
             ImGui::SameLine();
-            if (ImGui::Button(("Remove##paired" + device.address).c_str(), ImVec2(60, 0)))
+            if (ImGui::Button(("Remove##paired" + device.GetAddressString()).c_str(), ImVec2(60, 0)))
             {
                 RemoveDevice(device.address);
             }
@@ -372,12 +495,28 @@ void LuminaDeviceManager::Render()
     ImGui::End();
 }
 
-void LuminaDeviceManager::UpdateDeviceStatus(const std::string& deviceAddress, bool connected, bool paired)
+void LuminaDeviceManager::UpdateDeviceStatus(uint64_t address, bool connected, bool paired)
 {
-    Lumina::BluetoothDevice* device = GetDeviceByAddress(deviceAddress);
+    Lumina::BluetoothDevice* device = GetDeviceByAddress(address);
     if (device)
     {
-        device->isConnected = connected;
-        device->isPaired = paired;
+        device->SetConnected(connected);
+        device->SetPaired(paired);
+    }
+}
+
+void LuminaDeviceManager::PublishNotification(Lumina::Severity severity, const std::string& message)
+{
+    if (m_EventBus)
+    {
+        m_EventBus->Publish(Lumina::NotificationEvent{ severity, "Devices", message });
     }
-}
\ No newline at end of file
+}
+
+void LuminaDeviceManager::PublishConnection(uint64_t address, Lumina::ConnectionEvent::State state)
+{
+    if (m_EventBus)
+    {
+        m_EventBus->Publish(Lumina::ConnectionEvent{ address, state });
+    }
+}
@@ -1,14 +1,20 @@
 #pragma once
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <chrono>
 #include <functional>
+#include <future>
+#include <optional>
 
 // Add WinRT Bluetooth includes
 #include <winrt/Windows.Foundation.h>
 #include <winrt/Windows.Devices.Bluetooth.h>
 #include <winrt/Windows.Devices.Enumeration.h>
 #include "LuminaDevice.h"
+#include "LuminaEventBus.h"
+#include "LuminaDeviceRegistry.h"
+#include "LuminaRssiHistory.h"
 
 class LuminaDeviceManager
 {
@@ -16,11 +22,11 @@ public:
     LuminaDeviceManager();
     ~LuminaDeviceManager();
 
-    // Device management
+    // Device management. Devices are keyed by their 48-bit address (Lumina::BluetoothDevice::address).
     void AddDevice(const Lumina::BluetoothDevice& device);
-    void RemoveDevice(const std::string& deviceAddress);
-    void ConnectToDevice(const std::string& deviceAddress);
-    void DisconnectFromDevice(const std::string& deviceAddress);
+    void RemoveDevice(uint64_t address);
+    void ConnectToDevice(uint64_t address);
+    void DisconnectFromDevice(uint64_t address);
 
     // Device queries
     const std::vector<Lumina::BluetoothDevice>& GetPairedDevices() const;
@@ -30,9 +36,25 @@ public:
     void ClearDiscoveredDevices();
 
     // Device information
-    Lumina::BluetoothDevice* GetDeviceByAddress(const std::string& deviceAddress);
-    bool IsDeviceConnected(const std::string& deviceAddress) const;
-    bool IsDevicePaired(const std::string& deviceAddress) const;
+    Lumina::BluetoothDevice* GetDeviceByAddress(uint64_t address);
+    bool IsDeviceConnected(uint64_t address) const;
+    bool IsDevicePaired(uint64_t address) const;
+    void SetDeviceLabel(uint64_t address, const std::string& label);
+
+    // Known device registry (File menu). Opening loads on a background thread;
+    // PollRegistryLoad publishes the result on the UI thread and returns true once it has.
+    void OpenRegistry();
+    bool IsRegistryLoading() const { return m_KnownDevicesLoad.valid(); }
+    bool PollRegistryLoad();
+    void NewRegistry();
+    void SaveRegistry();
+    const LuminaDeviceRegistry& GetRegistry() const { return m_Registry; }
+
+    // Opened together with the registry; scans record into it, the property window reads from it
+    LuminaRssiHistory& GetRssiHistory() { return m_RssiHistory; }
+
+    // Errors go out as NotificationEvent, connect/disconnect/remove as ConnectionEvent
+    void SetEventBus(LuminaEventBus* eventBus) { m_EventBus = eventBus; }
 
     void Render();
 
@@ -44,8 +66,18 @@ private:
     std::vector<Lumina::BluetoothDevice> m_PairedDevices;
     std::vector<Lumina::BluetoothDevice> m_ConnectedDevices;
 
+    // Paired/added devices are mirrored here so they survive restarts
+    LuminaDeviceRegistry m_Registry;
+    std::future<std::optional<std::vector<Lumina::BluetoothDevice>>> m_KnownDevicesLoad;
+    LuminaRssiHistory m_RssiHistory;
+
+    LuminaEventBus* m_EventBus = nullptr;
+
     // Flag to prevent new async operations during cleanup
     bool m_IsShuttingDown = false;
 
-    void UpdateDeviceStatus(const std::string& deviceAddress, bool connected, bool paired);
+    void UpdateDeviceStatus(uint64_t address, bool connected, bool paired);
+    void SaveKnownDevice(const Lumina::BluetoothDevice& device);
+    void PublishNotification(Lumina::Severity severity, const std::string& message);
+    void PublishConnection(uint64_t address, Lumina::ConnectionEvent::State state);
 };
\ No newline at end of file
@@ -4,32 +4,71 @@
 #include "LuminaDeviceManagerViewModel.h"
 #include "LuminaHelper.h"
 
-LuminaDeviceManagerViewModel::LuminaDeviceManagerViewModel()
+LuminaDeviceManagerViewModel::LuminaDeviceManagerViewModel(LuminaStartupProfile& startupProfile)
     : m_ShowDeviceDetails(false)
-    , m_SelectedDeviceAddress("")
+    , m_SelectedDeviceAddress(0)
     , m_PropertyViewModel()
     , m_ActionBluetoothSwitch()
+    , m_StartupProfile(startupProfile)
 {
-    BindActionOnDeviceDiscovered();
+    m_PropertyViewModel.SetDiscoverDevice(&m_ActionDiscoverDevice);
+    SubscribeEvents();
+    m_ActionBluetoothSwitch.SetEventBus(&m_EventBus);
+    m_ActionDiscoverDevice.SetEventBus(&m_EventBus);
+    m_DeviceManager.SetEventBus(&m_EventBus);
+    m_StartupProfile.Begin("Radio detection");
     m_ActionBluetoothSwitch.RequestGetIsBluetoothEnabled();
-    m_ActionBluetoothSwitch.HandleOnErrorMessage([this](const std::string& msg) { RaiseErrorMessage(msg); });
-    m_ActionDiscoverDevice.HandleOnErrorMessage([this](const std::string& msg) { RaiseErrorMessage(msg); });
+    m_ActionDiscoverDevice.SetRssiHistory(&m_DeviceManager.GetRssiHistory());
+    m_ActionDiscoverDevice.SetDiscoveryLatency(&m_DiscoveryLatency);
+    m_ActionDiscoverDevice.SetWaterfall(&m_Waterfall);
+    m_StartupProfile.Begin("Known devices");
+    m_DeviceManager.OpenRegistry();
 }
 
-void LuminaDeviceManagerViewModel::BindActionOnDeviceDiscovered()
+void LuminaDeviceManagerViewModel::PollStartupTasks()
 {
-    m_ActionDiscoverDevice.HandleOnDevicesDiscovered([this](const std::vector<winrt::Windows::Devices::Enumeration::DeviceInformation>& discovered)
+    if (m_DeviceManager.PollRegistryLoad())
+    {
+        m_StartupProfile.End("Known devices"); // No-op for later File > Open reloads
+    }
+    // Detection is over once the query returns, even if no radio was found
+    if (!m_IsRadioDetected && (m_ActionBluetoothSwitch.HasBluetoothState() || !m_ActionBluetoothSwitch.GetIsStateRequested()))
+    {
+        m_IsRadioDetected = true;
+        m_StartupProfile.End("Radio detection");
+    }
+}
+
+void LuminaDeviceManagerViewModel::SubscribeEvents()
+{
+    m_EventBus.Subscribe<Lumina::DeviceDiscoveredEvent>(m_UiExecutor, [this](const std::vector<Lumina::DeviceDiscoveredEvent>& events)
+        {
+            auto now = std::chrono::steady_clock::now();
+            for (const auto& event : events)
+            {
+                m_DeviceManager.AddDiscoveredDevice(event.device);
+                m_TimeToDiscovery[static_cast<size_t>(event.scanProfile)].Record(now - event.firstAdvertTime);
+                m_DiscoveryLatency.Record(LuminaDiscoveryLatency::Stage::Delivery, now - event.publishTime);
+                m_PendingFirstRender[event.device.address] = { event.firstAdvertTime, now };
+            }
+        });
+    m_EventBus.Subscribe<Lumina::DeviceLinkedEvent>(m_UiExecutor, [this](const std::vector<Lumina::DeviceLinkedEvent>& events)
         {
-            for (const auto& device : discovered)
+            for (const auto& event : events)
             {
-                Lumina::BluetoothDevice btDevice;
-                btDevice.name = winrt::to_string(device.Name());
-                btDevice.address = winrt::to_string(device.Id());
-                btDevice.isConnected = false;
-                btDevice.isPaired = device.Pairing().IsPaired();
-                btDevice.signalStrength = 0;
-                btDevice.deviceType = "Unknown";
-                m_DeviceManager.AddDiscoveredDevice(btDevice);
+                m_DeviceLinks[event.address] = event;
+            }
+        });
+    m_EventBus.Subscribe<Lumina::NotificationEvent>(m_UiExecutor, [this](const std::vector<Lumina::NotificationEvent>& events)
+        {
+            for (const auto& event : events)
+            {
+                m_NotificationLog.Add(event);
+                // Only errors interrupt
+                if (event.severity == Lumina::Severity::Error)
+                {
+                    RaiseErrorMessage(event.message);
+                }
             }
         });
 }
@@ -41,13 +80,52 @@ inline void LuminaDeviceManagerViewModel::RaiseErrorMessage(const std::string& m
 
 void LuminaDeviceManagerViewModel::Render()
 {
+    m_UiExecutor.RunPending();
+    PollStartupTasks();
     RenderActionList();
     ImGui::Separator();
     RenderDeviceTable();
+    ImGui::Separator();
+    m_NotificationLog.Render(150.0f);
 
     m_ErrorMessageInfo.Render();
 }
 
+void LuminaDeviceManagerViewModel::RenderLatency()
+{
+    m_UiExecutor.RunPending();
+    // The device table is hidden on this tab; time spent here is not render latency
+    m_PendingFirstRender.clear();
+    if (ImGui::Button("Reset"))
+    {
+        m_DiscoveryLatency.Reset();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export CSV"))
+    {
+        std::filesystem::path path;
+        std::string error;
+        if (m_DiscoveryLatency.ExportCsv(LuminaConfig::LatencyExportDirectory, path, error))
+        {
+            m_EventBus.Publish(Lumina::NotificationEvent{ Lumina::Severity::Info, "Latency", "Exported " + path.string() });
+        }
+        else
+        {
+            m_EventBus.Publish(Lumina::NotificationEvent{ Lumina::Severity::Error, "Latency", error });
+        }
+    }
+    ImGui::SameLine();
+    ImGui::TextDisabled("Advert received -> device row first drawn, per stage");
+    m_DiscoveryLatency.Render();
+}
+
+void LuminaDeviceManagerViewModel::RenderWaterfall()
+{
+    m_UiExecutor.RunPending();
+    m_PendingFirstRender.clear();
+    m_Waterfall.Render();
+}
+
 void LuminaDeviceManagerViewModel::RenderDeviceTable()
 {
 
@@ -62,6 +140,14 @@ void LuminaDeviceManagerViewModel::RenderDeviceTable()
     ImGui::Text("Actions");
     ImGui::NextColumn();
     ImGui::Separator();
+    if (m_DeviceManager.IsRegistryLoading())
+    {
+        ImGui::TextDisabled("Loading known devices...");
+        ImGui::NextColumn();
+        ImGui::NextColumn();
+        ImGui::NextColumn();
+        ImGui::NextColumn();
+    }
     const auto& discoveredDevices = m_DeviceManager.GetDiscoveredDevices();
     for (auto& device : discoveredDevices)
     {
@@ -75,9 +161,20 @@ void LuminaDeviceManagerViewModel::RenderDeviceTable()
 
 void LuminaDeviceManagerViewModel::RenderDeviceEntry(const Lumina::BluetoothDevice& device)
 {
-    ImGui::PushID(device.address.c_str());
+    if (!m_PendingFirstRender.empty())
+    {
+        auto pending = m_PendingFirstRender.find(device.address);
+        if (pending != m_PendingFirstRender.end())
+        {
+            auto now = std::chrono::steady_clock::now();
+            m_DiscoveryLatency.Record(LuminaDiscoveryLatency::Stage::Render, now - pending->second.addedTime);
+            m_DiscoveryLatency.Record(LuminaDiscoveryLatency::Stage::EndToEnd, now - pending->second.firstAdvertTime);
+            m_PendingFirstRender.erase(pending);
+        }
+    }
+    ImGui::PushID(static_cast<int>(device.address ^ (device.address >> 32)));
     bool selected = (m_SelectedDeviceAddress == device.address);
-    if (ImGui::Selectable(device.name.c_str(), selected, ImGuiSelectableFlags_AllowDoubleClick))
+    if (ImGui::Selectable(device.GetName().c_str(), selected, ImGuiSelectableFlags_AllowDoubleClick))
     {
         if (ImGui::IsMouseClicked(0))
         {
@@ -95,16 +192,23 @@ void LuminaDeviceManagerViewModel::RenderDeviceEntry(const Lumina::BluetoothDevi
     if (ImGui::IsItemHovered())
     {
         ImGui::BeginTooltip();
-        ImGui::Text("Address: %s", device.address.c_str());
-        ImGui::Text("Type: %s", device.deviceType.c_str());
+        ImGui::Text("Address: %s", device.GetAddressString().c_str());
+        ImGui::Text("Type: %s", Lumina::DeviceTypeToString(device.deviceType));
         ImGui::Text("Signal: %d dBm", device.signalStrength);
         ImGui::Text("Status: %s%s",
-            device.isConnected ? "Connected" : "",
-            device.isPaired ? (device.isConnected ? ", " : "") + std::string("Paired") : "");
+            device.IsConnected() ? "Connected" : "",
+            device.IsPaired() ? (device.IsConnected() ? ", " : "") + std::string("Paired") : "");
+        auto link = m_DeviceLinks.find(device.address);
+        if (link != m_DeviceLinks.end())
+        {
+            ImGui::Text("Likely same device as %s (%.0f%%)",
+                LuminaHelper::BluetoothAddressToString(link->second.linkedAddress).c_str(),
+                link->second.confidence * 100.0f);
+        }
         ImGui::EndTooltip();
     }
     ImGui::NextColumn();
-    if (device.isPaired)
+    if (device.IsPaired())
     {
         ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Paired");
     }
@@ -113,7 +217,7 @@ void LuminaDeviceManagerViewModel::RenderDeviceEntry(const Lumina::BluetoothDevi
         ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), "Unpaired");
     }
     ImGui::NextColumn();
-    if (device.isConnected)
+    if (device.IsConnected())
     {
         ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "Connected");
     }
@@ -122,7 +226,7 @@ void LuminaDeviceManagerViewModel::RenderDeviceEntry(const Lumina::BluetoothDevi
         ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), "Disconnected");
     }
     ImGui::NextColumn();
-    if (device.isConnected)
+    if (device.IsConnected())
     {
         if (ImGui::Button("Disconnect"))
         {
@@ -149,20 +253,20 @@ void LuminaDeviceManagerViewModel::RenderDeviceDetails(const Lumina::BluetoothDe
 {
     ImGui::Text("Device Details");
     ImGui::Separator();
-    ImGui::Text("Name: %s", device.name.c_str());
-    ImGui::Text("Address: %s", device.address.c_str());
-    ImGui::Text("Type: %s", device.deviceType.c_str());
+    ImGui::Text("Name: %s", device.GetName().c_str());
+    ImGui::Text("Address: %s", device.GetAddressString().c_str());
+    ImGui::Text("Type: %s", Lumina::DeviceTypeToString(device.deviceType));
     ImGui::Text("Signal Strength: %d dBm", device.signalStrength);
     ImGui::Text("Status: %s%s",
-        device.isConnected ? "Connected" : "",
-        device.isPaired ? (device.isConnected ? ", " : "") + std::string("Paired") : "");
+        device.IsConnected() ? "Connected" : "",
+        device.IsPaired() ? (device.IsConnected() ? ", " : "") + std::string("Paired") : "");
     ImGui::Separator();
 }
 
 void LuminaDeviceManagerViewModel::RenderDeviceActions(const Lumina::BluetoothDevice& device)
 {
     ImGui::Text("Actions:");
-    if (device.isConnected)
+    if (device.IsConnected())
     {
         if (ImGui::Button("Disconnect Device", ImVec2(120, 0)))
         {
@@ -185,19 +289,35 @@ void LuminaDeviceManagerViewModel::RenderDeviceActions(const Lumina::BluetoothDe
 
 void LuminaDeviceManagerViewModel::RenderActionList()
 {
+    // Neutral placeholder until the radio state is known
+    bool btKnown = m_ActionBluetoothSwitch.HasBluetoothState();
     bool btEnabled = m_ActionBluetoothSwitch.GetIsBluetoothEnabled();
-    ImVec4 btColor = btEnabled ? ImVec4(0.0f, 1.0f, 0.0f, 1.0f) : ImVec4(1.0f, 0.0f, 0.0f, 1.0f);
+    ImVec4 btColor = !btKnown ? ImGui::GetStyleColorVec4(ImGuiCol_Button)
+        : btEnabled ? ImVec4(0.0f, 1.0f, 0.0f, 1.0f) : ImVec4(1.0f, 0.0f, 0.0f, 1.0f);
     ImVec4 btColorHighlight = LuminaHelper::LightenColor(btColor, 0.15f);
     ImGui::PushStyleColor(ImGuiCol_Button, btColor);
     ImGui::PushStyleColor(ImGuiCol_ButtonHovered, btColorHighlight);
     ImGui::PushStyleColor(ImGuiCol_ButtonActive, btColorHighlight);
 
-    ImGui::BeginDisabled(m_ActionBluetoothSwitch.GetIsStateRequested());
-    if (ImGui::Button("BT", ImVec2(48, 0)))
+    ImGui::BeginDisabled(!btKnown || m_ActionBluetoothSwitch.GetIsStateRequested());
+    if (ImGui::Button(btKnown ? "BT" : "BT...", ImVec2(48, 0)))
     {
         m_ActionBluetoothSwitch.RequestToogleBluetoothEnabled();
     }
     ImGui::EndDisabled();
+    if (btKnown && ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
+    {
+        ImGui::BeginTooltip();
+        if (m_ActionBluetoothSwitch.GetAdapterCount() == 0)
+        {
+            ImGui::Text("No Bluetooth adapter found");
+        }
+        for (const auto& adapter : m_ActionBluetoothSwitch.GetAdapters())
+        {
+            ImGui::Text("%s: %s", adapter.name.c_str(), adapter.isOn ? "On" : "Off");
+        }
+        ImGui::EndTooltip();
+    }
 
     ImGui::PopStyleColor(3);
     ImGui::SameLine();
@@ -205,38 +325,140 @@ void LuminaDeviceManagerViewModel::RenderActionList()
     if (ImGui::Button("Scan", ImVec2(120, 0)))
     {
         m_DeviceManager.ClearDiscoveredDevices();
+        m_PendingFirstRender.clear();
+        m_DeviceLinks.clear();
         m_ActionDiscoverDevice.RequestScan();
     }
     ImGui::EndDisabled();
+    ImGui::SameLine();
+    RenderScanProfile();
     if (m_ActionDiscoverDevice.GetIsScanRequested())
     {
         ImGui::SameLine();
         ImGui::Text("Scanning...");
+        if (ImGui::IsItemHovered())
+        {
+            uint64_t hits = m_ActionDiscoverDevice.GetUnchangedAdvertCount();
+            uint64_t total = hits + m_ActionDiscoverDevice.GetChangedAdvertCount();
+            ImGui::BeginTooltip();
+            ImGui::Text("Adverts: %llu", static_cast<unsigned long long>(total));
+            ImGui::Text("Unchanged adverts: %.1f%%", total > 0 ? 100.0 * hits / total : 0.0);
+            if (uint64_t dropped = m_ActionDiscoverDevice.GetIngestDroppedCount())
+            {
+                ImGui::Text("Dropped under load: %llu", static_cast<unsigned long long>(dropped));
+            }
+            if (uint64_t oversized = m_ActionDiscoverDevice.GetOversizedSectionCount())
+            {
+                ImGui::Text("Oversized AD structures: %llu", static_cast<unsigned long long>(oversized));
+            }
+            const LuminaIngestFilter& filter = m_ActionDiscoverDevice.GetIngestFilter();
+            if (filter.HasRules())
+            {
+                ImGui::Text("Filtered out: %llu (%zu rules, %.1f KB)",
+                    static_cast<unsigned long long>(filter.GetRejectedCount()),
+                    filter.GetRuleCount(),
+                    filter.GetMemoryBytes() / 1024.0);
+            }
+            const LuminaRpaResolver& resolver = m_ActionDiscoverDevice.GetRpaResolver();
+            if (resolver.GetIrkCount() > 0)
+            {
+                LuminaRpaResolver::Stats resolverStats = resolver.GetStats();
+                ImGui::Text("Private addresses resolved: %llu of %llu (%zu IRKs%s)",
+                    static_cast<unsigned long long>(resolverStats.resolved),
+                    static_cast<unsigned long long>(resolverStats.checked),
+                    resolver.GetIrkCount(),
+                    resolver.GetIsUsingAesNi() ? ", AES-NI" : "");
+            }
+            if (m_ActionDiscoverDevice.GetIsAddressLinkingEnabled())
+            {
+                LuminaAddressLinker::Stats linkerStats = m_ActionDiscoverDevice.GetAddressLinkerStats();
+                ImGui::Text("Rotating addresses linked: %llu (%zu tracked)",
+                    static_cast<unsigned long long>(linkerStats.links),
+                    linkerStats.activeAddresses);
+            }
+            if (m_ActionDiscoverDevice.GetIsExportEnabled())
+            {
+                LuminaScanExporter::Stats exportStats = m_ActionDiscoverDevice.GetExportStats();
+                ImGui::Text("Exported: %llu adverts (%.1f MB)",
+                    static_cast<unsigned long long>(exportStats.adverts),
+                    exportStats.bytes / (1024.0 * 1024.0));
+            }
+            ImGui::EndTooltip();
+        }
+    }
+}
+
+void LuminaDeviceManagerViewModel::RenderScanProfile()
+{
+    const Lumina::ScanProfile& current = Lumina::GetScanProfile(m_ActionDiscoverDevice.GetScanProfile());
+    ImGui::SetNextItemWidth(130);
+    ImGui::BeginDisabled(m_ActionDiscoverDevice.GetIsScanRequested());
+    if (ImGui::BeginCombo("##ScanProfile", current.label))
+    {
+        for (size_t i = 0; i < Lumina::ScanProfileCount; ++i)
+        {
+            const Lumina::ScanProfile& profile = Lumina::GetScanProfile(static_cast<Lumina::ScanProfileId>(i));
+            if (ImGui::Selectable(profile.label, profile.id == current.id))
+            {
+                m_ActionDiscoverDevice.SetScanProfile(profile.id);
+            }
+            if (ImGui::IsItemHovered())
+            {
+                ImGui::SetTooltip("%s", profile.description);
+            }
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::EndDisabled();
+
+    // Time to discovery for the selected profile
+    const Lumina::DiscoveryHistogram& histogram = m_TimeToDiscovery[static_cast<size_t>(current.id)];
+    if (histogram.GetCount() == 0)
+    {
+        return;
+    }
+    ImGui::SameLine();
+    ImGui::TextDisabled("TTD p50 %.0f ms", histogram.GetPercentileMs(0.5));
+    if (ImGui::IsItemHovered())
+    {
+        float counts[Lumina::DiscoveryHistogram::BucketCount];
+        for (size_t i = 0; i < Lumina::DiscoveryHistogram::BucketCount; ++i)
+        {
+            counts[i] = static_cast<float>(histogram.GetBucket(i));
+        }
+        ImGui::BeginTooltip();
+        ImGui::Text("First advert to device table, %s", current.label);
+        ImGui::PlotHistogram("##TimeToDiscovery", counts, IM_ARRAYSIZE(counts), 0, nullptr, 0.0f, FLT_MAX, ImVec2(280, 60));
+        ImGui::TextDisabled("<25 ms ... >30 s");
+        ImGui::Text("Devices: %llu", static_cast<unsigned long long>(histogram.GetCount()));
+        ImGui::Text("p50 %.0f ms, p90 %.0f ms, p99 %.0f ms", histogram.GetPercentileMs(0.5), histogram.GetPercentileMs(0.9), histogram.GetPercentileMs(0.99));
+        ImGui::Text("Mean %.0f ms, max %.0f ms", histogram.GetMeanMs(), histogram.GetMaxMs());
+        ImGui::EndTooltip();
     }
 }
 
-void LuminaDeviceManagerViewModel::OnDeviceSelected(const std::string& deviceAddress)
+void LuminaDeviceManagerViewModel::OnDeviceSelected(uint64_t deviceAddress)
 {
     m_SelectedDeviceAddress = deviceAddress;
     m_ShowDeviceDetails = true;
 }
 
-void LuminaDeviceManagerViewModel::OnConnectDevice(const std::string& deviceAddress)
+void LuminaDeviceManagerViewModel::OnConnectDevice(uint64_t deviceAddress)
 {
     m_DeviceManager.ConnectToDevice(deviceAddress);
 }
 
-void LuminaDeviceManagerViewModel::OnDisconnectDevice(const std::string& deviceAddress)
+void LuminaDeviceManagerViewModel::OnDisconnectDevice(uint64_t deviceAddress)
 {
     m_DeviceManager.DisconnectFromDevice(deviceAddress);
 }
 
-void LuminaDeviceManagerViewModel::OnRemoveDevice(const std::string& deviceAddress)
+void LuminaDeviceManagerViewModel::OnRemoveDevice(uint64_t deviceAddress)
 {
     m_DeviceManager.RemoveDevice(deviceAddress);
     if (m_SelectedDeviceAddress == deviceAddress)
     {
-        m_SelectedDeviceAddress = "";
+        m_SelectedDeviceAddress = 0;
         m_ShowDeviceDetails = false;
     }
 }
\ No newline at end of file
@@ -1,34 +1,79 @@
 #pragma once
 #include "LuminaDeviceManager.h"
+#include <array>
 #include <string>
 #include <optional>
+#include <unordered_map>
 #include "LuminaDevicePropertyViewModel.h"
 #include "LuminaHelper.h"
 #include "LuminaActionBluetoothSwitch.h"
 #include "LuminaActionDiscoverDevice.h"
 #include "LuminaErrorMessageInfo.h"
+#include "LuminaNotificationLog.h"
+#include "LuminaStartupProfile.h"
 
 class LuminaDeviceManagerViewModel
 {
 public:
-    LuminaDeviceManagerViewModel();
+    explicit LuminaDeviceManagerViewModel(LuminaStartupProfile& startupProfile);
 
     void Render();
     void RaiseErrorMessage(const std::string& message);
 
+    // File menu
+    void NewRegistry() { m_DeviceManager.NewRegistry(); }
+    void OpenRegistry() { m_DeviceManager.OpenRegistry(); }
+    void SaveRegistry() { m_DeviceManager.SaveRegistry(); }
+    bool GetIsScanExportEnabled() const { return m_ActionDiscoverDevice.GetIsExportEnabled(); }
+    void SetScanExportEnabled(bool enabled) { m_ActionDiscoverDevice.SetExportEnabled(enabled); }
+    bool GetIsAddressLinkingEnabled() const { return m_ActionDiscoverDevice.GetIsAddressLinkingEnabled(); }
+    void SetAddressLinkingEnabled(bool enabled) { m_ActionDiscoverDevice.SetAddressLinkingEnabled(enabled); }
+
+    // Discovery Latency tab
+    void RenderLatency();
+    // Waterfall tab
+    void RenderWaterfall();
+
 private:
+    // Declared first so they outlive every publisher below. Batches run on the UI thread in Render.
+    LuminaEventBus m_EventBus;
+    LuminaQueuedExecutor m_UiExecutor;
+
     LuminaDeviceManager m_DeviceManager;
+    LuminaDiscoveryLatency m_DiscoveryLatency;
+    LuminaWaterfall m_Waterfall;
 
     LuminaActionBluetoothSwitch m_ActionBluetoothSwitch;
     LuminaActionDiscoverDevice m_ActionDiscoverDevice;
 
     bool m_ShowDeviceDetails;
-    std::string m_SelectedDeviceAddress;
+    uint64_t m_SelectedDeviceAddress;
     LuminaDevicePropertyViewModel m_PropertyViewModel;
 
+    // Time to discovery per scan profile, since startup
+    std::array<Lumina::DiscoveryHistogram, Lumina::ScanProfileCount> m_TimeToDiscovery;
+
+    // Devices added to the table whose row has not been drawn yet
+    struct PendingFirstRender
+    {
+        std::chrono::steady_clock::time_point firstAdvertTime;
+        std::chrono::steady_clock::time_point addedTime;
+    };
+    std::unordered_map<uint64_t, PendingFirstRender> m_PendingFirstRender;
+
+    // Rotating addresses judged to be the same device as an earlier one, this scan
+    std::unordered_map<uint64_t, Lumina::DeviceLinkedEvent> m_DeviceLinks;
+
+    LuminaNotificationLog m_NotificationLog;
     LuminaErrorMessageInfo m_ErrorMessageInfo;
 
-    void BindActionOnDeviceDiscovered();
+    // Radio detection and registry load finish in the background after the first frame
+    LuminaStartupProfile& m_StartupProfile;
+    bool m_IsRadioDetected = false;
+
+    void PollStartupTasks();
+
+    void SubscribeEvents();
 
     // UI helper methods
     void RenderDeviceTable();
@@ -36,9 +81,10 @@ private:
     void RenderDeviceDetails(const Lumina::BluetoothDevice& device);
     void RenderDeviceActions(const Lumina::BluetoothDevice& device);
     void RenderActionList();
+    void RenderScanProfile();
     // UI event handlers
-    void OnDeviceSelected(const std::string& deviceAddress);
-    void OnConnectDevice(const std::string& deviceAddress);
-    void OnDisconnectDevice(const std::string& deviceAddress);
-    void OnRemoveDevice(const std::string& deviceAddress);
+    void OnDeviceSelected(uint64_t deviceAddress);
+    void OnConnectDevice(uint64_t deviceAddress);
+    void OnDisconnectDevice(uint64_t deviceAddress);
+    void OnRemoveDevice(uint64_t deviceAddress);
 };
\ No newline at end of file
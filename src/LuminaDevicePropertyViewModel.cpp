@@ -1,27 +1,38 @@
 #include "LuminaDevicePropertyViewModel.h"
+#include <algorithm>
+#include <cstdio>
 #include <imgui.h>
 
+namespace
+{
+    const char* const HistoryRangeLabels[] = { "Last hour", "Last day", "Last week", "Last 30 days" };
+    constexpr int64_t HistoryRangeSpansMs[] = { 60ll * 60 * 1000, 24ll * 60 * 60 * 1000, 7ll * 24 * 60 * 60 * 1000, 30ll * 24 * 60 * 60 * 1000 };
+    constexpr int64_t MaxHistoryPoints = 360;
+    constexpr float EmptyBucketRssi = -100.0f;
+}
+
 LuminaDevicePropertyViewModel::LuminaDevicePropertyViewModel()
     : m_Visible(false)
-    , m_DeviceAddress("")
+    , m_DeviceAddress(0)
 {
 }
 
-void LuminaDevicePropertyViewModel::Show(const std::string& deviceAddress)
+void LuminaDevicePropertyViewModel::Show(uint64_t deviceAddress)
 {
     m_DeviceAddress = deviceAddress;
     m_Visible = true;
+    m_HistoryQueriedAt = {};
 }
 
 void LuminaDevicePropertyViewModel::Hide()
 {
     m_Visible = false;
-    m_DeviceAddress.clear();
+    m_DeviceAddress = 0;
 }
 
 bool LuminaDevicePropertyViewModel::IsVisible() const
 {
-    return m_Visible && !m_DeviceAddress.empty();
+    return m_Visible && m_DeviceAddress != 0;
 }
 
 void LuminaDevicePropertyViewModel::Render(LuminaDeviceManager& deviceManager)
@@ -37,19 +48,117 @@ void LuminaDevicePropertyViewModel::Render(LuminaDeviceManager& deviceManager)
         return;
     }
       
-    ImGui::SetNextWindowSize(ImVec2(350, 220), ImGuiCond_Appearing);
+    ImGui::SetNextWindowSize(ImVec2(350, 420), ImGuiCond_Appearing);
     if (ImGui::Begin("Device Properties", &m_Visible, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize))
     {
-        ImGui::Text("Device Name: %s", device->name.c_str());
-        ImGui::Text("Address: %s", device->address.c_str());
-        ImGui::Text("Type: %s", device->deviceType.c_str());
+        ImGui::Text("Device Name: %s", device->GetName().c_str());
+        ImGui::Text("Address: %s", device->GetAddressString().c_str());
+        ImGui::Text("Type: %s", Lumina::DeviceTypeToString(device->deviceType));
         ImGui::Text("Signal Strength: %d dBm", device->signalStrength);
-        ImGui::Text("Paired: %s", device->isPaired ? "Yes" : "No");
-        ImGui::Text("Connected: %s", device->isConnected ? "Yes" : "No");
+        ImGui::Text("Paired: %s", device->IsPaired() ? "Yes" : "No");
+        ImGui::Text("Connected: %s", device->IsConnected() ? "Yes" : "No");
+        RenderAdvertisingInterval(device->address);
+
+        char label[64];
+        snprintf(label, sizeof(label), "%s", device->GetLabel().c_str());
+        if (ImGui::InputText("Label", label, sizeof(label), ImGuiInputTextFlags_EnterReturnsTrue))
+        {
+            deviceManager.SetDeviceLabel(m_DeviceAddress, label);
+        }
+
+        ImGui::Separator();
+        RenderRssiHistory(deviceManager.GetRssiHistory(), device->address);
+
         if (ImGui::Button("Close"))
         {
             Hide();
         }
     }
     ImGui::End();
+}
+
+void LuminaDevicePropertyViewModel::RenderAdvertisingInterval(uint64_t address)
+{
+    auto estimate = m_DiscoverDevice ? m_DiscoverDevice->GetAdvertisingInterval(address) : std::nullopt;
+    if (!estimate)
+    {
+        return;
+    }
+    if (!estimate->isValid)
+    {
+        ImGui::TextDisabled("Advertising Interval: measuring...");
+        return;
+    }
+    ImGui::Text("Advertising Interval: %.1f ms", estimate->intervalMs);
+    if (ImGui::IsItemHovered())
+    {
+        ImGui::SetTooltip("Median time between adverts, including the 0-10 ms random delay\nthe controller adds to each one.");
+    }
+    ImGui::Text("Jitter: %.1f ms, %.0f%% missed", estimate->jitterMs, estimate->missedRatio * 100.0f);
+}
+
+void LuminaDevicePropertyViewModel::RenderRssiHistory(LuminaRssiHistory& history, uint64_t address)
+{
+    ImGui::Text("RSSI History");
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(120);
+    if (ImGui::Combo("##HistoryRange", &m_HistoryRange, HistoryRangeLabels, IM_ARRAYSIZE(HistoryRangeLabels)))
+    {
+        m_HistoryQueriedAt = {};
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_HistoryQueriedAt >= std::chrono::seconds(1))
+    {
+        m_HistoryQueriedAt = now;
+
+        // Wide ranges use buckets aligned to the history's chunks, so they are served from its index alone
+        int64_t spanMs = HistoryRangeSpansMs[m_HistoryRange];
+        int64_t bucketMs = (spanMs + MaxHistoryPoints - 1) / MaxHistoryPoints;
+        if (spanMs >= LuminaRssiHistory::ChunkAlignMs * 32)
+        {
+            bucketMs = (bucketMs + LuminaRssiHistory::ChunkAlignMs - 1) / LuminaRssiHistory::ChunkAlignMs * LuminaRssiHistory::ChunkAlignMs;
+        }
+        int64_t bucketCount = spanMs / bucketMs;
+        int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        int64_t toMs = (nowMs / bucketMs + 1) * bucketMs;
+        history.Query(address, toMs - bucketCount * bucketMs, toMs, static_cast<size_t>(bucketCount), m_HistoryPoints);
+
+        m_HistoryValues.clear();
+        for (const auto& point : m_HistoryPoints)
+        {
+            m_HistoryValues.push_back(point.count > 0 ? point.meanRssi : EmptyBucketRssi);
+        }
+    }
+
+    if (!history.IsOpen() || m_HistoryValues.empty())
+    {
+        ImGui::TextDisabled("History unavailable");
+        return;
+    }
+
+    uint32_t sampleCount = 0;
+    float minRssi = 0.0f;
+    float maxRssi = EmptyBucketRssi;
+    for (const auto& point : m_HistoryPoints)
+    {
+        if (point.count > 0)
+        {
+            minRssi = sampleCount > 0 ? std::min(minRssi, point.minRssi) : point.minRssi;
+            maxRssi = std::max(maxRssi, point.maxRssi);
+            sampleCount += point.count;
+        }
+    }
+
+    char overlay[64];
+    if (sampleCount > 0)
+    {
+        snprintf(overlay, sizeof(overlay), "%u samples, %.0f to %.0f dBm", sampleCount, minRssi, maxRssi);
+    }
+    else
+    {
+        snprintf(overlay, sizeof(overlay), "No samples");
+    }
+    ImGui::PlotLines("##RssiHistory", m_HistoryValues.data(), static_cast<int>(m_HistoryValues.size()), 0, overlay,
+        EmptyBucketRssi, -20.0f, ImVec2(-1, 100));
 }
\ No newline at end of file
@@ -1,16 +1,31 @@
 #pragma once
+#include <chrono>
 #include <string>
+#include <vector>
 #include "LuminaDeviceManager.h"
+#include "LuminaActionDiscoverDevice.h"
 
 class LuminaDevicePropertyViewModel
 {
 public:
     LuminaDevicePropertyViewModel();
-    void Show(const std::string& deviceAddress);
+    void Show(uint64_t deviceAddress);
     void Hide();
     void Render(LuminaDeviceManager& deviceManager);
     bool IsVisible() const;
+    // Source of the advertising interval while scanning. Must outlive this.
+    void SetDiscoverDevice(LuminaActionDiscoverDevice* discoverDevice) { m_DiscoverDevice = discoverDevice; }
 private:
-    std::string m_DeviceAddress;
+    uint64_t m_DeviceAddress;
     bool m_Visible;
+    LuminaActionDiscoverDevice* m_DiscoverDevice = nullptr;
+
+    // RSSI history plot, re-queried at most once per second
+    int m_HistoryRange = 0;
+    std::vector<Lumina::RssiHistoryPoint> m_HistoryPoints;
+    std::vector<float> m_HistoryValues;
+    std::chrono::steady_clock::time_point m_HistoryQueriedAt;
+
+    void RenderRssiHistory(LuminaRssiHistory& history, uint64_t address);
+    void RenderAdvertisingInterval(uint64_t address);
 };
\ No newline at end of file
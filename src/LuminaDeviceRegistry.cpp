@@ -0,0 +1,542 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include "LuminaDeviceRegistry.h"
+#include "LuminaHelper.h"
+#include "LuminaMappedFile.h"
+
+static_assert(std::is_trivially_copyable_v<Lumina::RegistryRecord>, "Registry records are written to disk as raw bytes");
+
+namespace
+{
+    constexpr char SnapshotMagic[4] = { 'L', 'U', 'M', 'R' };
+    constexpr uint32_t SnapshotVersion = 2;   // 2: records sorted by address
+
+    // Writer thread batches log syncs at this interval, and compacts once the log outgrows the live set
+    constexpr auto SyncInterval = std::chrono::milliseconds(500);
+    constexpr size_t CompactMinEntries = 1024;
+    constexpr size_t PendingWakeupEntries = 4096;
+
+    struct SnapshotHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t recordSize;
+        uint32_t reserved;
+        uint64_t count;
+    };
+
+    bool SyncFile(std::FILE* file)
+    {
+        if (std::fflush(file) != 0)
+        {
+            return false;
+        }
+#ifdef _WIN32
+        return _commit(_fileno(file)) == 0;
+#else
+        return fsync(fileno(file)) == 0;
+#endif
+    }
+}
+
+void Lumina::RegistryRecord::CopyField(char* field, size_t size, const std::string& value)
+{
+    size_t length = std::min(value.size(), size - 1);
+    std::memcpy(field, value.data(), length);
+    std::memset(field + length, 0, size - length);
+}
+
+LuminaDeviceRegistry::LuminaDeviceRegistry()
+{
+}
+
+LuminaDeviceRegistry::~LuminaDeviceRegistry()
+{
+    Close();
+}
+
+bool LuminaDeviceRegistry::Open(const std::filesystem::path& directory, const std::string& name, std::string& error)
+{
+    Close();
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    m_SnapshotPath = directory / (name + ".dat");
+    m_LogPath = directory / (name + ".wal");
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_SnapshotFile.reset();
+        m_SnapshotRecords = nullptr;
+        m_SnapshotCount = 0;
+        m_Compacting = Delta();
+        m_Delta = Delta();
+        m_RecordCount = 0;
+        m_Pending.clear();
+        m_FlushRequested = false;
+        m_StopRequested = false;
+    }
+
+    if (!LoadSnapshot(error))
+    {
+        return false;
+    }
+    ReplayLog();
+
+    m_Log = std::fopen(m_LogPath.string().c_str(), "ab");
+    if (!m_Log)
+    {
+        error = "Failed to open device registry log: " + m_LogPath.string();
+        return false;
+    }
+
+    m_LoadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m_IsOpen = true;
+    m_Writer = std::thread(&LuminaDeviceRegistry::WriterLoop, this);
+    return true;
+}
+
+void LuminaDeviceRegistry::Close()
+{
+    if (m_Writer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_StopRequested = true;
+        }
+        m_WriterWakeup.notify_one();
+        m_Writer.join();
+    }
+
+    if (m_Log)
+    {
+        std::fclose(m_Log);
+        m_Log = nullptr;
+    }
+    m_IsOpen = false;
+}
+
+void LuminaDeviceRegistry::Upsert(const Lumina::RegistryRecord& record)
+{
+    Append(Op::Upsert, record);
+}
+
+void LuminaDeviceRegistry::Remove(uint64_t address)
+{
+    Lumina::RegistryRecord record;
+    record.address = address;
+    Append(Op::Remove, record);
+}
+
+void LuminaDeviceRegistry::Clear()
+{
+    Append(Op::Clear, Lumina::RegistryRecord{});
+}
+
+void LuminaDeviceRegistry::Flush()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_FlushRequested = true;
+    }
+    m_WriterWakeup.notify_one();
+}
+
+std::optional<Lumina::RegistryRecord> LuminaDeviceRegistry::Find(uint64_t address) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return Lookup(address);
+}
+
+std::vector<Lumina::RegistryRecord> LuminaDeviceRegistry::GetRecords() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::vector<Lumina::RegistryRecord> records;
+    records.reserve(m_RecordCount);
+
+    // Each layer only contributes addresses the layers above it left alone
+    for (const auto& pair : m_Delta.changes)
+    {
+        if (pair.second)
+        {
+            records.push_back(*pair.second);
+        }
+    }
+    if (m_Delta.isCleared)
+    {
+        return records;
+    }
+    for (const auto& pair : m_Compacting.changes)
+    {
+        if (pair.second && m_Delta.changes.count(pair.first) == 0)
+        {
+            records.push_back(*pair.second);
+        }
+    }
+    if (m_Compacting.isCleared)
+    {
+        return records;
+    }
+    for (size_t i = 0; i < m_SnapshotCount; ++i)
+    {
+        Lumina::RegistryRecord record;
+        std::memcpy(&record, m_SnapshotRecords + i * sizeof(Lumina::RegistryRecord), sizeof(record));
+        if (m_Delta.changes.count(record.address) == 0 && m_Compacting.changes.count(record.address) == 0)
+        {
+            records.push_back(record);
+        }
+    }
+    return records;
+}
+
+size_t LuminaDeviceRegistry::GetRecordCount() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_RecordCount;
+}
+
+void LuminaDeviceRegistry::Append(Op op, const Lumina::RegistryRecord& record)
+{
+    LogEntry entry{ op, 0, record };
+    entry.checksum = Checksum(entry);
+
+    bool wakeWriter = false;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        Apply(entry);
+        m_Pending.push_back(entry);
+        wakeWriter = m_Pending.size() >= PendingWakeupEntries;
+    }
+    if (wakeWriter)
+    {
+        m_WriterWakeup.notify_one();
+    }
+}
+
+void LuminaDeviceRegistry::Apply(const LogEntry& entry)
+{
+    switch (entry.op)
+    {
+    case Op::Upsert:
+        if (!Lookup(entry.record.address))
+        {
+            ++m_RecordCount;
+        }
+        m_Delta.changes[entry.record.address] = entry.record;
+        break;
+    case Op::Remove:
+        if (Lookup(entry.record.address))
+        {
+            --m_RecordCount;
+            m_Delta.changes[entry.record.address] = std::nullopt;
+        }
+        break;
+    case Op::Clear:
+        m_Delta.changes.clear();
+        m_Delta.isCleared = true;
+        m_RecordCount = 0;
+        break;
+    }
+}
+
+std::optional<Lumina::RegistryRecord> LuminaDeviceRegistry::Lookup(uint64_t address) const
+{
+    for (const Delta* layer : { &m_Delta, &m_Compacting })
+    {
+        auto it = layer->changes.find(address);
+        if (it != layer->changes.end())
+        {
+            return it->second;
+        }
+        if (layer->isCleared)
+        {
+            return std::nullopt;
+        }
+    }
+    return FindInSnapshot(address);
+}
+
+std::optional<Lumina::RegistryRecord> LuminaDeviceRegistry::FindInSnapshot(uint64_t address) const
+{
+    // Records are copied out of the mapping rather than aliased, so the mapping needs no particular alignment
+    auto addressAt = [this](size_t index)
+    {
+        uint64_t value;
+        std::memcpy(&value, m_SnapshotRecords + index * sizeof(Lumina::RegistryRecord) + offsetof(Lumina::RegistryRecord, address), sizeof(value));
+        return value;
+    };
+
+    size_t low = 0;
+    size_t high = m_SnapshotCount;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (addressAt(middle) < address)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    if (low == m_SnapshotCount || addressAt(low) != address)
+    {
+        return std::nullopt;
+    }
+    Lumina::RegistryRecord record;
+    std::memcpy(&record, m_SnapshotRecords + low * sizeof(Lumina::RegistryRecord), sizeof(record));
+    return record;
+}
+
+std::vector<Lumina::RegistryRecord> LuminaDeviceRegistry::CollectCompacted() const
+{
+    std::vector<Lumina::RegistryRecord> records;
+    records.reserve((m_Compacting.isCleared ? 0 : m_SnapshotCount) + m_Compacting.changes.size());
+    for (size_t i = 0; i < m_SnapshotCount && !m_Compacting.isCleared; ++i)
+    {
+        Lumina::RegistryRecord record;
+        std::memcpy(&record, m_SnapshotRecords + i * sizeof(Lumina::RegistryRecord), sizeof(record));
+        if (m_Compacting.changes.count(record.address) == 0)
+        {
+            records.push_back(record);
+        }
+    }
+    for (const auto& pair : m_Compacting.changes)
+    {
+        if (pair.second)
+        {
+            records.push_back(*pair.second);
+        }
+    }
+    std::sort(records.begin(), records.end(), [](const Lumina::RegistryRecord& a, const Lumina::RegistryRecord& b) { return a.address < b.address; });
+    return records;
+}
+
+bool LuminaDeviceRegistry::LoadSnapshot(std::string& error)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!MapSnapshot(error))
+    {
+        return false;
+    }
+    m_RecordCount = m_SnapshotCount;
+    return true;
+}
+
+bool LuminaDeviceRegistry::MapSnapshot(std::string& error)
+{
+    std::error_code ec;
+    if (!std::filesystem::exists(m_SnapshotPath, ec))
+    {
+        return true; // First run
+    }
+
+    auto file = std::make_unique<LuminaMappedFile>(m_SnapshotPath);
+    if (!file->GetData() || file->GetSize() < sizeof(SnapshotHeader))
+    {
+        error = "Failed to map device registry: " + m_SnapshotPath.string();
+        return false;
+    }
+
+    SnapshotHeader header;
+    std::memcpy(&header, file->GetData(), sizeof(header));
+    if (std::memcmp(header.magic, SnapshotMagic, sizeof(SnapshotMagic)) != 0 ||
+        header.version != SnapshotVersion ||
+        header.recordSize != sizeof(Lumina::RegistryRecord) ||
+        header.count > (file->GetSize() - sizeof(SnapshotHeader)) / sizeof(Lumina::RegistryRecord))
+    {
+        error = "Device registry is corrupt or from an incompatible version: " + m_SnapshotPath.string();
+        return false;
+    }
+
+    // Records stay in the mapping; nothing is copied until a lookup finds one
+    m_SnapshotRecords = file->GetData() + sizeof(SnapshotHeader);
+    m_SnapshotCount = static_cast<size_t>(header.count);
+    m_SnapshotFile = std::move(file);
+    return true;
+}
+
+void LuminaDeviceRegistry::ReplayLog()
+{
+    m_LogEntryCount = 0;
+    std::FILE* log = std::fopen(m_LogPath.string().c_str(), "rb");
+    if (!log)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        LogEntry entry;
+        while (std::fread(&entry, sizeof(entry), 1, log) == 1 && entry.checksum == Checksum(entry))
+        {
+            Apply(entry);
+            ++m_LogEntryCount;
+        }
+    }
+    std::fclose(log);
+
+    // Drop a torn tail so new entries are not appended after garbage
+    std::error_code ec;
+    if (std::filesystem::file_size(m_LogPath, ec) != m_LogEntryCount * sizeof(LogEntry))
+    {
+        std::filesystem::resize_file(m_LogPath, m_LogEntryCount * sizeof(LogEntry), ec);
+    }
+}
+
+void LuminaDeviceRegistry::WriterLoop()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true)
+    {
+        m_WriterWakeup.wait_for(lock, SyncInterval, [this]
+            {
+                return m_StopRequested || m_FlushRequested || m_Pending.size() >= PendingWakeupEntries;
+            });
+
+        std::vector<LogEntry> batch;
+        batch.swap(m_Pending);
+
+        // The changes are frozen together with the batch, so the new snapshot covers exactly what the log holds
+        // after WriteBatch. Only this thread replaces m_Compacting or the snapshot, so it reads them unlocked.
+        bool compact = m_FlushRequested || m_LogEntryCount + batch.size() > std::max(CompactMinEntries, m_RecordCount);
+        if (compact)
+        {
+            m_Compacting = std::move(m_Delta);
+            m_Delta = Delta();
+        }
+        bool stop = m_StopRequested;
+        m_FlushRequested = false;
+
+        lock.unlock();
+        if (!batch.empty() && !WriteBatch(batch))
+        {
+            ReportError("Failed to write device registry log: " + m_LogPath.string());
+        }
+        bool isCompacted = !compact || Compact();
+        if (!isCompacted)
+        {
+            ReportError("Failed to compact device registry: " + m_SnapshotPath.string());
+        }
+        lock.lock();
+        if (!isCompacted)
+        {
+            FoldCompacting();
+        }
+
+        if (stop)
+        {
+            break;
+        }
+    }
+}
+
+bool LuminaDeviceRegistry::WriteBatch(const std::vector<LogEntry>& batch)
+{
+    if (!m_Log)
+    {
+        return false;
+    }
+    if (std::fwrite(batch.data(), sizeof(LogEntry), batch.size(), m_Log) != batch.size())
+    {
+        return false;
+    }
+    m_LogEntryCount += batch.size();
+    return SyncFile(m_Log);
+}
+
+bool LuminaDeviceRegistry::Compact()
+{
+    std::vector<Lumina::RegistryRecord> records = CollectCompacted();
+
+    std::filesystem::path tempPath = m_SnapshotPath;
+    tempPath += ".tmp";
+
+    std::FILE* file = std::fopen(tempPath.string().c_str(), "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SnapshotMagic, sizeof(SnapshotMagic));
+    header.version = SnapshotVersion;
+    header.recordSize = sizeof(Lumina::RegistryRecord);
+    header.count = records.size();
+
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+        std::fwrite(records.data(), sizeof(Lumina::RegistryRecord), records.size(), file) == records.size() &&
+        SyncFile(file);
+    std::fclose(file);
+    if (!written)
+    {
+        return false;
+    }
+
+    {
+        // Windows cannot replace a mapped file, so lookups wait while the snapshot is swapped
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_SnapshotFile.reset();
+        m_SnapshotRecords = nullptr;
+        m_SnapshotCount = 0;
+
+        std::error_code ec;
+        std::filesystem::rename(tempPath, m_SnapshotPath, ec);
+        std::string error;
+        bool isMapped = MapSnapshot(error); // The new snapshot, or the old one again if the rename failed
+        if (ec || !isMapped)
+        {
+            return false;
+        }
+        m_Compacting = Delta();
+    }
+
+    // Everything in the log is now part of the snapshot
+    if (m_Log)
+    {
+        std::fclose(m_Log);
+    }
+    m_Log = std::fopen(m_LogPath.string().c_str(), "wb");
+    m_LogEntryCount = 0;
+    return m_Log != nullptr;
+}
+
+void LuminaDeviceRegistry::FoldCompacting()
+{
+    // A failed compaction leaves its changes to the next one
+    if (!m_Delta.isCleared)
+    {
+        for (auto& pair : m_Delta.changes)
+        {
+            m_Compacting.changes[pair.first] = pair.second;
+        }
+        m_Delta = std::move(m_Compacting);
+    }
+    m_Compacting = Delta();
+}
+
+void LuminaDeviceRegistry::ReportError(const std::string& message)
+{
+    if (m_OnErrorMessageGenerated)
+    {
+        m_OnErrorMessageGenerated(message);
+    }
+}
+
+uint32_t LuminaDeviceRegistry::Checksum(const LogEntry& entry)
+{
+    uint64_t hash = LuminaHelper::HashBytes(reinterpret_cast<const uint8_t*>(&entry.op), sizeof(entry.op));
+    hash = LuminaHelper::HashBytes(reinterpret_cast<const uint8_t*>(&entry.record), sizeof(entry.record), hash);
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <functional>
+#include <optional>
+#include <memory>
+#include <unordered_map>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+
+class LuminaMappedFile;
+
+namespace Lumina
+{
+    // Fixed-size record stored as-is in both the snapshot and the write-ahead log.
+    struct RegistryRecord
+    {
+        uint64_t address = 0;   // Bluetooth address, or a hash of the device id when no address is known
+        int64_t lastSeen = 0;   // Unix time in seconds
+        int16_t lastRssi = 0;
+        uint8_t flags = 0;
+        uint8_t reserved[5] = {};
+        char id[96] = {};       // Platform device id, used to reconnect
+        char name[64] = {};
+        char deviceType[32] = {};
+        char label[64] = {};    // User label
+
+        static constexpr uint8_t FlagPaired = 0x01;
+
+        void SetId(const std::string& value) { CopyField(id, sizeof(id), value); }
+        void SetName(const std::string& value) { CopyField(name, sizeof(name), value); }
+        void SetDeviceType(const std::string& value) { CopyField(deviceType, sizeof(deviceType), value); }
+        void SetLabel(const std::string& value) { CopyField(label, sizeof(label), value); }
+
+    private:
+        static void CopyField(char* field, size_t size, const std::string& value);
+    };
+}
+
+// On-disk registry of known devices.
+// The snapshot file holds records sorted by address and stays memory-mapped while open: lookups binary-search
+// the mapping, and only changes since the snapshot live in memory. Every change is also appended to a
+// write-ahead log, which a background thread syncs in batches and folds into a new snapshot once it grows.
+class LuminaDeviceRegistry
+{
+public:
+    LuminaDeviceRegistry();
+    ~LuminaDeviceRegistry();
+    LuminaDeviceRegistry(const LuminaDeviceRegistry&) = delete;
+    LuminaDeviceRegistry& operator=(const LuminaDeviceRegistry&) = delete;
+
+    // Loads <directory>/<name>.dat and replays <name>.wal, then starts the writer thread.
+    bool Open(const std::filesystem::path& directory, const std::string& name, std::string& error);
+    void Close();
+    bool IsOpen() const { return m_IsOpen; }
+
+    void Upsert(const Lumina::RegistryRecord& record);
+    void Remove(uint64_t address);
+    void Clear();
+    // Syncs pending log entries and compacts immediately instead of waiting for the writer thread.
+    void Flush();
+
+    std::optional<Lumina::RegistryRecord> Find(uint64_t address) const;
+    std::vector<Lumina::RegistryRecord> GetRecords() const;
+    size_t GetRecordCount() const;
+    double GetLoadMilliseconds() const { return m_LoadMilliseconds; }
+
+    void HandleOnErrorMessage(const std::function<void(const std::string&)>& callback) { m_OnErrorMessageGenerated = callback; }
+
+private:
+    enum class Op : uint32_t
+    {
+        Upsert = 1,
+        Remove = 2,
+        Clear = 3
+    };
+
+    struct LogEntry
+    {
+        Op op;
+        uint32_t checksum; // Guards against a torn tail after a crash
+        Lumina::RegistryRecord record;
+    };
+
+    std::filesystem::path m_SnapshotPath;
+    std::filesystem::path m_LogPath;
+    std::FILE* m_Log = nullptr;
+    size_t m_LogEntryCount = 0;
+
+    // Changes over the layers below; nullopt removes a record. A cleared layer hides everything below it.
+    struct Delta
+    {
+        std::unordered_map<uint64_t, std::optional<Lumina::RegistryRecord>> changes;
+        bool isCleared = false;
+    };
+
+    // Lookups go m_Delta, then m_Compacting, then the mapped snapshot. While the writer thread compacts,
+    // m_Compacting holds the changes being folded in; it and the snapshot are only replaced under m_Mutex.
+    std::unique_ptr<LuminaMappedFile> m_SnapshotFile;
+    const uint8_t* m_SnapshotRecords = nullptr;
+    size_t m_SnapshotCount = 0;
+    Delta m_Compacting;
+    Delta m_Delta;
+    size_t m_RecordCount = 0;
+
+    std::vector<LogEntry> m_Pending;
+    mutable std::mutex m_Mutex;
+
+    std::thread m_Writer;
+    std::condition_variable m_WriterWakeup;
+    bool m_FlushRequested = false;
+    bool m_StopRequested = false;
+    std::atomic<bool> m_IsOpen = false;
+    double m_LoadMilliseconds = 0.0;
+
+    std::function<void(const std::string&)> m_OnErrorMessageGenerated;
+
+    void Append(Op op, const Lumina::RegistryRecord& record);
+    void Apply(const LogEntry& entry);
+    std::optional<Lumina::RegistryRecord> Lookup(uint64_t address) const;
+    std::optional<Lumina::RegistryRecord> FindInSnapshot(uint64_t address) const;
+    // Snapshot under m_Compacting, sorted by address
+    std::vector<Lumina::RegistryRecord> CollectCompacted() const;
+    bool LoadSnapshot(std::string& error);
+    bool MapSnapshot(std::string& error);
+    void ReplayLog();
+    void WriterLoop();
+    bool WriteBatch(const std::vector<LogEntry>& batch);
+    bool Compact();
+    void FoldCompacting();
+    void ReportError(const std::string& message);
+
+    static uint32_t Checksum(const LogEntry& entry);
+};
@@ -0,0 +1,134 @@
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <imgui.h>
+#include "LuminaDiscoveryLatency.h"
+
+namespace
+{
+    constexpr double Percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+
+    double ToMs(int64_t micros)
+    {
+        return micros / 1000.0;
+    }
+}
+
+const char* LuminaDiscoveryLatency::GetStageName(Stage stage)
+{
+    switch (stage)
+    {
+    case Stage::IngestQueue: return "Ingest queue";
+    case Stage::Ingest: return "Ingest";
+    case Stage::Resolve: return "OS resolve";
+    case Stage::Delivery: return "Event delivery";
+    case Stage::Render: return "First render";
+    case Stage::EndToEnd: return "End to end";
+    }
+    return "";
+}
+
+void LuminaDiscoveryLatency::Record(Stage stage, std::chrono::steady_clock::duration latency)
+{
+    m_Histograms[static_cast<size_t>(stage)].Record(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+}
+
+void LuminaDiscoveryLatency::Reset()
+{
+    for (auto& histogram : m_Histograms)
+    {
+        histogram.Reset();
+    }
+}
+
+bool LuminaDiscoveryLatency::ExportCsv(const std::filesystem::path& directory, std::filesystem::path& writtenPath, std::string& error) const
+{
+    std::time_t now = std::time(nullptr);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    char name[48];
+    std::strftime(name, sizeof(name), "latency-%Y%m%d-%H%M%S.csv", &local);
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    writtenPath = directory / name;
+    std::ofstream file(writtenPath);
+    if (!file)
+    {
+        error = "Cannot write " + writtenPath.string();
+        return false;
+    }
+
+    file << "stage,count,mean_us,min_us,p50_us,p90_us,p99_us,p999_us,max_us\n";
+    for (size_t i = 0; i < StageCount; ++i)
+    {
+        const LuminaHdrHistogram& histogram = m_Histograms[i];
+        file << GetStageName(static_cast<Stage>(i)) << "," << histogram.GetCount() << "," << histogram.GetMean() << "," << histogram.GetMin();
+        for (double percentile : Percentiles)
+        {
+            file << "," << histogram.GetValueAtPercentile(percentile);
+        }
+        file << "," << histogram.GetMax() << "\n";
+    }
+    if (!file)
+    {
+        error = "Failed writing " + writtenPath.string();
+        return false;
+    }
+    return true;
+}
+
+void LuminaDiscoveryLatency::Render()
+{
+    if (ImGui::BeginTable("LatencyStages", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+    {
+        ImGui::TableSetupColumn("Stage");
+        ImGui::TableSetupColumn("Count");
+        ImGui::TableSetupColumn("p50 ms");
+        ImGui::TableSetupColumn("p90 ms");
+        ImGui::TableSetupColumn("p99 ms");
+        ImGui::TableSetupColumn("p99.9 ms");
+        ImGui::TableSetupColumn("Max ms");
+        ImGui::TableHeadersRow();
+
+        for (size_t i = 0; i < StageCount; ++i)
+        {
+            const LuminaHdrHistogram& histogram = m_Histograms[i];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            if (ImGui::Selectable(GetStageName(static_cast<Stage>(i)), m_PlotStage == static_cast<int>(i), ImGuiSelectableFlags_SpanAllColumns))
+            {
+                m_PlotStage = static_cast<int>(i);
+            }
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", static_cast<unsigned long long>(histogram.GetCount()));
+            for (double percentile : Percentiles)
+            {
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", ToMs(histogram.GetValueAtPercentile(percentile)));
+            }
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", ToMs(histogram.GetMax()));
+        }
+        ImGui::EndTable();
+    }
+
+    // Percentile distribution of the selected stage, with the tail stretched out: point i is at 1 - 10^(-4i/n)
+    const LuminaHdrHistogram& histogram = m_Histograms[m_PlotStage];
+    constexpr int PointCount = 64;
+    float values[PointCount];
+    for (int i = 0; i < PointCount; ++i)
+    {
+        double percentile = 100.0 * (1.0 - std::pow(10.0, -4.0 * i / (PointCount - 1)));
+        values[i] = static_cast<float>(ToMs(histogram.GetValueAtPercentile(percentile)));
+    }
+    char overlay[64];
+    snprintf(overlay, sizeof(overlay), "%s: 0 -> 99.99th percentile", GetStageName(static_cast<Stage>(m_PlotStage)));
+    ImGui::PlotLines("##LatencyPercentiles", values, PointCount, 0, overlay, 0.0f, FLT_MAX, ImVec2(-1, 160));
+}
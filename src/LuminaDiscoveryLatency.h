@@ -0,0 +1,39 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include "LuminaHdrHistogram.h"
+
+// Latency from an advert reaching OnAdvertisementReceived to its device's row first being drawn, split at
+// every hand-off so a stall can be pinned on the OS resolve, our queues or the renderer. Values are kept
+// in microseconds in HDR histograms; stages may be recorded from any thread.
+class LuminaDiscoveryLatency
+{
+public:
+    enum class Stage : uint8_t
+    {
+        IngestQueue,    // Advert received -> ingest starts (every advert)
+        Ingest,         // Ingest starts -> platform resolve requested (new devices)
+        Resolve,        // BluetoothLEDevice lookup by the OS
+        Delivery,       // Discovery event published -> handled on the UI thread
+        Render,         // Added to the device table -> row first drawn
+        EndToEnd,       // Advert received -> row first drawn
+    };
+    static constexpr size_t StageCount = 6;
+
+    static const char* GetStageName(Stage stage);
+
+    void Record(Stage stage, std::chrono::steady_clock::duration latency);
+    void Reset();
+    const LuminaHdrHistogram& GetHistogram(Stage stage) const { return m_Histograms[static_cast<size_t>(stage)]; }
+
+    // Writes one summary row per stage to <directory>/latency-<time>.csv
+    bool ExportCsv(const std::filesystem::path& directory, std::filesystem::path& writtenPath, std::string& error) const;
+
+    void Render();
+
+private:
+    std::array<LuminaHdrHistogram, StageCount> m_Histograms;
+    int m_PlotStage = static_cast<int>(Stage::EndToEnd);
+};
@@ -3,7 +3,13 @@
 
 void LuminaErrorMessageInfo::Show(const std::string& message)
 {
+    if (m_Visible)
+    {
+        ++m_MoreCount;
+        return;
+    }
     m_Message = message;
+    m_MoreCount = 0;
     m_Visible = true;
 }
 
@@ -59,6 +65,10 @@ void LuminaErrorMessageInfo::Render()
             ImGui::SetCursorPosX(textStartX);
         }
         ImGui::TextWrapped("%s", m_Message.c_str());
+        if (m_MoreCount > 0)
+        {
+            ImGui::TextDisabled("%d more, see Notifications", m_MoreCount);
+        }
         ImGui::Dummy(ImVec2(0.0f, 10.0f));
 
         float buttonWidth = ImGui::CalcTextSize("OK").x + 40.0f;
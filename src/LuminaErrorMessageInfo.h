@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 
+// Modal for errors. Errors raised while it is open are counted rather than replacing the one shown.
 class LuminaErrorMessageInfo
 {
 public:
@@ -11,4 +12,5 @@ public:
 private:
     bool m_Visible = false;
     std::string m_Message;
+    int m_MoreCount = 0;
 };
\ No newline at end of file
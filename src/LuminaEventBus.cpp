@@ -0,0 +1,20 @@
+#include "LuminaEventBus.h"
+
+void LuminaQueuedExecutor::Post(std::function<void()> task)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Tasks.push_back(std::move(task));
+}
+
+void LuminaQueuedExecutor::RunPending()
+{
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        tasks.swap(m_Tasks);
+    }
+    for (auto& task : tasks)
+    {
+        task();
+    }
+}
@@ -0,0 +1,368 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "LuminaDevice.h"
+#include "LuminaScanProfile.h"
+#include "LuminaWorkerPool.h"
+
+namespace Lumina
+{
+    // A device was resolved to a platform device after its first advert
+    struct DeviceDiscoveredEvent
+    {
+        BluetoothDevice device;
+        std::chrono::steady_clock::time_point firstAdvertTime;  // When its first advert was received
+        std::chrono::steady_clock::time_point publishTime;
+        ScanProfileId scanProfile = ScanProfileId::LowLatency;
+    };
+
+    // A device's advert was parsed: first sighting or changed payload. Published on the ingest thread.
+    struct DeviceUpdatedEvent
+    {
+        uint64_t address = 0;
+        std::string name;
+        int16_t rssi = 0;
+        bool isConnectable = false;
+        bool isNew = false;
+    };
+
+    // A rotating random address was judged to be a later address of an earlier device. Published on the ingest thread.
+    struct DeviceLinkedEvent
+    {
+        uint64_t address = 0;
+        uint64_t linkedAddress = 0;     // The device's first address seen this scan
+        float confidence = 0.0f;        // 0-1
+    };
+
+    struct ConnectionEvent
+    {
+        enum class State : uint8_t
+        {
+            Connected,
+            Disconnected,
+            Removed,
+        };
+
+        uint64_t address = 0;
+        State state = State::Connected;
+    };
+
+    // Adapter counts changed, including hot-plug
+    struct RadioEvent
+    {
+        int adapterCount = 0;
+        int enabledAdapterCount = 0;
+    };
+
+    enum class Severity : uint8_t
+    {
+        Info,
+        Warning,
+        Error,
+    };
+
+    inline const char* SeverityToString(Severity severity)
+    {
+        switch (severity)
+        {
+        case Severity::Warning: return "warning";
+        case Severity::Error: return "error";
+        default: return "info";
+        }
+    }
+
+    // Status text for the user. Only errors interrupt with a modal; the rest goes to the notification log.
+    struct NotificationEvent
+    {
+        Severity severity = Severity::Info;
+        std::string source;     // Component that raised it; rate limits apply per source
+        std::string message;
+        std::string summary;    // Plural phrase for bursts, e.g. "devices found" shows as "37 devices found"
+    };
+}
+
+// Where a subscriber's batches run
+class LuminaEventExecutor
+{
+public:
+    virtual ~LuminaEventExecutor() = default;
+    virtual void Post(std::function<void()> task) = 0;
+};
+
+// Runs batches on the publishing thread, right away
+class LuminaInlineExecutor : public LuminaEventExecutor
+{
+public:
+    void Post(std::function<void()> task) override { task(); }
+};
+
+// Queues batches until the owning thread calls RunPending, e.g. once per UI frame
+class LuminaQueuedExecutor : public LuminaEventExecutor
+{
+public:
+    void Post(std::function<void()> task) override;
+    void RunPending();
+
+private:
+    std::mutex m_Mutex;
+    std::vector<std::function<void()>> m_Tasks;
+};
+
+// Runs batches on the worker pool
+class LuminaWorkerExecutor : public LuminaEventExecutor
+{
+public:
+    explicit LuminaWorkerExecutor(LuminaWorkerPool& pool = LuminaWorkerPool::Get(), LuminaWorkerPool::Priority priority = LuminaWorkerPool::Priority::Normal)
+        : m_Pool(pool), m_Priority(priority) {}
+
+    void Post(std::function<void()> task) override { m_Pool.Submit(std::move(task), m_Priority); }
+
+private:
+    LuminaWorkerPool& m_Pool;
+    LuminaWorkerPool::Priority m_Priority;
+};
+
+// Fan-out of one event type to any number of subscribers. Each subscriber has its own bounded lock-free
+// queue; Publish copies the event into every queue and, when a subscriber was idle, posts one drain task
+// to its executor. The drain task hands the subscriber everything queued so far as one batch.
+// Events that find a queue full are dropped and counted.
+template <typename Event>
+class LuminaEventChannel
+{
+public:
+    using Handler = std::function<void(const std::vector<Event>&)>;
+    using SubscriptionId = size_t;
+
+    static constexpr size_t MaxSubscribers = 16;
+    static constexpr size_t MaxBatchSize = 256;
+
+    LuminaEventChannel() = default;
+    LuminaEventChannel(const LuminaEventChannel&) = delete;
+    LuminaEventChannel& operator=(const LuminaEventChannel&) = delete;
+
+    // The executor must outlive the subscription; capacity is rounded up to a power of two
+    SubscriptionId Subscribe(LuminaEventExecutor& executor, Handler handler, size_t capacity = 4096)
+    {
+        std::lock_guard<std::mutex> lock(m_SubscribeMutex);
+        size_t index = m_SubscriberCount.load(std::memory_order_relaxed);
+        if (index >= MaxSubscribers)
+        {
+            return MaxSubscribers;
+        }
+        m_Storage[index] = std::make_unique<Subscriber>(executor, std::move(handler), capacity);
+        m_Subscribers[index].store(m_Storage[index].get(), std::memory_order_release);
+        m_SubscriberCount.store(index + 1, std::memory_order_release);
+        return index;
+    }
+
+    // Stops delivery; batches already running finish. The slot is not reused.
+    void Unsubscribe(SubscriptionId id)
+    {
+        if (id < MaxSubscribers)
+        {
+            if (Subscriber* subscriber = m_Subscribers[id].load(std::memory_order_acquire))
+            {
+                subscriber->isActive.store(false, std::memory_order_release);
+            }
+        }
+    }
+
+    // Lock-free unless it wakes an idle subscriber whose executor takes a lock to queue the batch
+    void Publish(const Event& event)
+    {
+        size_t count = m_SubscriberCount.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i)
+        {
+            Subscriber* subscriber = m_Subscribers[i].load(std::memory_order_acquire);
+            if (!subscriber->isActive.load(std::memory_order_relaxed))
+            {
+                continue;
+            }
+            if (!subscriber->queue.TryPush(event))
+            {
+                subscriber->dropped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            // The push above and this load are both seq_cst, as are Drain's going idle and its last look at the
+            // queue, so either we see the drain idle or it sees our event
+            if (!subscriber->isScheduled.load(std::memory_order_seq_cst) && !subscriber->isScheduled.exchange(true, std::memory_order_acq_rel))
+            {
+                subscriber->executor.Post([subscriber] { Drain(*subscriber); });
+            }
+        }
+    }
+
+    uint64_t GetDroppedCount() const
+    {
+        uint64_t dropped = 0;
+        size_t count = m_SubscriberCount.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i)
+        {
+            dropped += m_Subscribers[i].load(std::memory_order_acquire)->dropped.load(std::memory_order_relaxed);
+        }
+        return dropped;
+    }
+
+private:
+    // Bounded multi-producer queue (Vyukov); only the subscriber's drain task pops
+    class Queue
+    {
+    public:
+        explicit Queue(size_t capacity)
+        {
+            size_t size = 2;
+            while (size < capacity)
+            {
+                size *= 2;
+            }
+            m_Cells = std::make_unique<Cell[]>(size);
+            m_Mask = size - 1;
+            for (size_t i = 0; i < size; ++i)
+            {
+                m_Cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        bool TryPush(const Event& event)
+        {
+            size_t position = m_Tail.load(std::memory_order_relaxed);
+            while (true)
+            {
+                Cell& cell = m_Cells[position & m_Mask];
+                size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+                if (difference == 0)
+                {
+                    if (m_Tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        cell.event = event;
+                        cell.sequence.store(position + 1, std::memory_order_seq_cst);
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = m_Tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool IsEmpty() const
+        {
+            return m_Cells[m_Head & m_Mask].sequence.load(std::memory_order_seq_cst) != m_Head + 1;
+        }
+
+        bool TryPop(Event& event)
+        {
+            Cell& cell = m_Cells[m_Head & m_Mask];
+            if (cell.sequence.load(std::memory_order_acquire) != m_Head + 1)
+            {
+                return false;
+            }
+            event = std::move(cell.event);
+            cell.sequence.store(m_Head + m_Mask + 1, std::memory_order_release);
+            ++m_Head;
+            return true;
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            Event event;
+        };
+
+        std::unique_ptr<Cell[]> m_Cells;
+        size_t m_Mask = 0;
+        alignas(64) std::atomic<size_t> m_Tail = 0;
+        alignas(64) size_t m_Head = 0;
+    };
+
+    struct Subscriber
+    {
+        Subscriber(LuminaEventExecutor& executor, Handler handler, size_t capacity)
+            : executor(executor), handler(std::move(handler)), queue(capacity) {}
+
+        LuminaEventExecutor& executor;
+        Handler handler;
+        Queue queue;
+        std::atomic<bool> isActive = true;
+        std::atomic<bool> isScheduled = false;
+        std::atomic<uint64_t> dropped = 0;
+        std::vector<Event> batch; // Only touched by the drain task that holds isScheduled
+    };
+
+    std::array<std::atomic<Subscriber*>, MaxSubscribers> m_Subscribers = {};
+    std::array<std::unique_ptr<Subscriber>, MaxSubscribers> m_Storage;
+    std::atomic<size_t> m_SubscriberCount = 0;
+    std::mutex m_SubscribeMutex;
+
+    static void Drain(Subscriber& subscriber)
+    {
+        std::vector<Event>& batch = subscriber.batch;
+        Event event;
+        while (true)
+        {
+            while (batch.size() < MaxBatchSize && subscriber.queue.TryPop(event))
+            {
+                batch.push_back(std::move(event));
+            }
+            if (!batch.empty())
+            {
+                if (subscriber.isActive.load(std::memory_order_acquire))
+                {
+                    subscriber.handler(batch);
+                }
+                batch.clear();
+                continue;
+            }
+
+            // Go idle, then look once more: a publisher that still saw us scheduled did not post
+            subscriber.isScheduled.store(false, std::memory_order_seq_cst);
+            if (subscriber.queue.IsEmpty() || subscriber.isScheduled.exchange(true, std::memory_order_acq_rel))
+            {
+                return;
+            }
+        }
+    }
+};
+
+// One channel per event type. Publishers and subscribers share a bus instead of single-slot callbacks,
+// so any number of consumers can observe discovery, connections, radios and errors.
+// The bus must outlive every publisher and every executor that may still run its batches.
+class LuminaEventBus
+{
+public:
+    template <typename Event>
+    LuminaEventChannel<Event>& GetChannel() { return std::get<LuminaEventChannel<Event>>(m_Channels); }
+
+    template <typename Event>
+    void Publish(const Event& event) { GetChannel<Event>().Publish(event); }
+
+    template <typename Event>
+    size_t Subscribe(LuminaEventExecutor& executor, typename LuminaEventChannel<Event>::Handler handler)
+    {
+        return GetChannel<Event>().Subscribe(executor, std::move(handler));
+    }
+
+private:
+    std::tuple<
+        LuminaEventChannel<Lumina::DeviceDiscoveredEvent>,
+        LuminaEventChannel<Lumina::DeviceUpdatedEvent>,
+        LuminaEventChannel<Lumina::DeviceLinkedEvent>,
+        LuminaEventChannel<Lumina::ConnectionEvent>,
+        LuminaEventChannel<Lumina::RadioEvent>,
+        LuminaEventChannel<Lumina::NotificationEvent>> m_Channels;
+};
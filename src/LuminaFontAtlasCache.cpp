@@ -0,0 +1,302 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <vector>
+#include "LuminaFontAtlasCache.h"
+#include "LuminaHelper.h"
+
+static_assert(std::is_trivially_copyable_v<ImFontGlyph>, "Glyph tables are written to disk as raw bytes");
+
+namespace
+{
+    constexpr char CacheMagic[4] = { 'L', 'U', 'M', 'F' };
+    constexpr uint32_t CacheVersion = 1;
+    constexpr uint32_t MaxFonts = 64;
+    constexpr uint32_t MaxCustomRects = 1024;
+
+    struct CacheHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        int32_t texWidth;
+        int32_t texHeight;
+        uint32_t fontCount;
+        uint32_t customRectCount;
+        int32_t packIdMouseCursors;
+        int32_t packIdLines;
+        int32_t defaultFont;
+        uint32_t reserved;
+        ImVec2 texUvScale;
+        ImVec2 texUvWhitePixel;
+        ImVec4 texUvLines[IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1];
+    };
+
+    struct CacheFont
+    {
+        float size;
+        float ascent;
+        float descent;
+        uint32_t fallbackChar;
+        uint32_t ellipsisChar;
+        uint32_t glyphCount;
+        char name[40];
+    };
+
+    struct CacheRect
+    {
+        uint16_t width;
+        uint16_t height;
+        uint16_t x;
+        uint16_t y;
+        uint32_t glyphId;
+        float glyphAdvanceX;
+        ImVec2 glyphOffset;
+    };
+
+    // Bounds-checked reads from the mapped file
+    class Reader
+    {
+    public:
+        Reader(const uint8_t* data, size_t size) : m_Data(data), m_Size(size) {}
+
+        const uint8_t* Take(size_t size)
+        {
+            if (size > m_Size - m_Offset)
+            {
+                return nullptr;
+            }
+            const uint8_t* data = m_Data + m_Offset;
+            m_Offset += size;
+            return data;
+        }
+
+        template <typename T>
+        bool Read(T& value)
+        {
+            const uint8_t* data = Take(sizeof(T));
+            if (data)
+            {
+                std::memcpy(&value, data, sizeof(T));
+            }
+            return data != nullptr;
+        }
+
+        bool IsAtEnd() const { return m_Offset == m_Size; }
+
+    private:
+        const uint8_t* m_Data;
+        size_t m_Size;
+        size_t m_Offset = 0;
+    };
+}
+
+namespace LuminaFontAtlasCache
+{
+    uint64_t BeginKey()
+    {
+        // Any change to ImGui's structures or rasterizer invalidates the cache
+        const int layout[] = { IMGUI_VERSION_NUM, static_cast<int>(sizeof(ImFontGlyph)), static_cast<int>(sizeof(ImWchar)), static_cast<int>(CacheVersion) };
+        return AddKeyBytes(LuminaHelper::HashSeed, layout, sizeof(layout));
+    }
+
+    uint64_t AddKeyBytes(uint64_t key, const void* data, size_t size)
+    {
+        return LuminaHelper::HashBytes(static_cast<const uint8_t*>(data), size, key);
+    }
+
+    uint64_t AddKeyRanges(uint64_t key, const ImWchar* ranges)
+    {
+        size_t count = 0;
+        while (ranges && ranges[count] != 0)
+        {
+            ++count;
+        }
+        return AddKeyBytes(key, ranges, count * sizeof(ImWchar));
+    }
+
+    ImFontAtlas* Load(const uint8_t* data, size_t size, uint64_t key, ImFont*& defaultFont)
+    {
+        Reader reader(data, size);
+        CacheHeader header;
+        if (!reader.Read(header) || std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0 ||
+            header.version != CacheVersion || header.key != key || header.fontCount == 0 ||
+            header.fontCount > MaxFonts || header.customRectCount > MaxCustomRects ||
+            header.defaultFont < 0 || static_cast<uint32_t>(header.defaultFont) >= header.fontCount ||
+            header.texWidth <= 0 || header.texHeight <= 0)
+        {
+            return nullptr;
+        }
+
+        std::vector<CacheFont> fonts(header.fontCount);
+        std::vector<CacheRect> rects(header.customRectCount);
+        for (CacheFont& font : fonts)
+        {
+            if (!reader.Read(font))
+            {
+                return nullptr;
+            }
+        }
+        for (CacheRect& rect : rects)
+        {
+            if (!reader.Read(rect))
+            {
+                return nullptr;
+            }
+        }
+
+        ImFontAtlas* atlas = IM_NEW(ImFontAtlas)();
+        atlas->TexWidth = header.texWidth;
+        atlas->TexHeight = header.texHeight;
+        atlas->TexUvScale = header.texUvScale;
+        atlas->TexUvWhitePixel = header.texUvWhitePixel;
+        std::memcpy(atlas->TexUvLines, header.texUvLines, sizeof(header.texUvLines));
+        atlas->PackIdMouseCursors = header.packIdMouseCursors;
+        atlas->PackIdLines = header.packIdLines;
+        for (const CacheRect& rect : rects)
+        {
+            ImFontAtlasCustomRect customRect;
+            customRect.Width = rect.width;
+            customRect.Height = rect.height;
+            customRect.X = rect.x;
+            customRect.Y = rect.y;
+            customRect.GlyphID = rect.glyphId;
+            customRect.GlyphAdvanceX = rect.glyphAdvanceX;
+            customRect.GlyphOffset = rect.glyphOffset;
+            atlas->CustomRects.push_back(customRect);
+        }
+
+        // Configs first: ImVector may move them while growing, and fonts point into it
+        for (CacheFont& cached : fonts)
+        {
+            cached.name[sizeof(cached.name) - 1] = '\0';
+            ImFontConfig config;
+            config.FontDataOwnedByAtlas = false;
+            config.SizePixels = cached.size;
+            std::snprintf(config.Name, sizeof(config.Name), "%s", cached.name);
+            atlas->ConfigData.push_back(config);
+        }
+
+        bool isValid = true;
+        for (size_t i = 0; i < fonts.size() && isValid; ++i)
+        {
+            const CacheFont& cached = fonts[i];
+            ImFont* font = IM_NEW(ImFont)();
+            atlas->Fonts.push_back(font);
+            atlas->ConfigData[static_cast<int>(i)].DstFont = font;
+            font->ContainerAtlas = atlas;
+            font->ConfigData = &atlas->ConfigData[static_cast<int>(i)];
+            font->ConfigDataCount = 1;
+            font->FontSize = cached.size;
+            font->Ascent = cached.ascent;
+            font->Descent = cached.descent;
+            font->FallbackChar = static_cast<ImWchar>(cached.fallbackChar);
+            font->EllipsisChar = static_cast<ImWchar>(cached.ellipsisChar);
+
+            // Glyph tables go straight from the file into the font
+            const uint8_t* glyphs = reader.Take(cached.glyphCount * sizeof(ImFontGlyph));
+            isValid = glyphs != nullptr && cached.glyphCount > 0;
+            if (isValid)
+            {
+                font->Glyphs.resize(static_cast<int>(cached.glyphCount));
+                std::memcpy(font->Glyphs.Data, glyphs, cached.glyphCount * sizeof(ImFontGlyph));
+                font->BuildLookupTable();
+            }
+        }
+
+        // ImGui frees the pixels with the atlas, so they are copied into its allocator
+        size_t pixelBytes = static_cast<size_t>(header.texWidth) * static_cast<size_t>(header.texHeight);
+        const uint8_t* pixels = isValid ? reader.Take(pixelBytes) : nullptr;
+        if (!pixels || !reader.IsAtEnd())
+        {
+            IM_DELETE(atlas);
+            return nullptr;
+        }
+        atlas->TexPixelsAlpha8 = static_cast<unsigned char*>(IM_ALLOC(pixelBytes));
+        std::memcpy(atlas->TexPixelsAlpha8, pixels, pixelBytes);
+        atlas->TexReady = true;
+
+        defaultFont = atlas->Fonts[header.defaultFont];
+        return atlas;
+    }
+
+    bool Save(const std::filesystem::path& path, uint64_t key, const ImFontAtlas& atlas, const ImFont* defaultFont, std::string& error)
+    {
+        if (!atlas.TexPixelsAlpha8 || atlas.Fonts.Size == 0)
+        {
+            error = "Font atlas is not built";
+            return false;
+        }
+
+        CacheHeader header{};
+        std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+        header.version = CacheVersion;
+        header.key = key;
+        header.texWidth = atlas.TexWidth;
+        header.texHeight = atlas.TexHeight;
+        header.fontCount = static_cast<uint32_t>(atlas.Fonts.Size);
+        header.customRectCount = static_cast<uint32_t>(atlas.CustomRects.Size);
+        header.packIdMouseCursors = atlas.PackIdMouseCursors;
+        header.packIdLines = atlas.PackIdLines;
+        header.defaultFont = 0;
+        header.texUvScale = atlas.TexUvScale;
+        header.texUvWhitePixel = atlas.TexUvWhitePixel;
+        std::memcpy(header.texUvLines, atlas.TexUvLines, sizeof(header.texUvLines));
+        for (int i = 0; i < atlas.Fonts.Size; ++i)
+        {
+            if (atlas.Fonts[i] == defaultFont)
+            {
+                header.defaultFont = i;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+        std::filesystem::path tempPath = path;
+        tempPath += ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            for (const ImFont* font : atlas.Fonts)
+            {
+                CacheFont cached{};
+                cached.size = font->FontSize;
+                cached.ascent = font->Ascent;
+                cached.descent = font->Descent;
+                cached.fallbackChar = font->FallbackChar;
+                cached.ellipsisChar = font->EllipsisChar;
+                cached.glyphCount = static_cast<uint32_t>(font->Glyphs.Size);
+                if (font->ConfigData)
+                {
+                    std::snprintf(cached.name, sizeof(cached.name), "%s", font->ConfigData->Name);
+                }
+                file.write(reinterpret_cast<const char*>(&cached), sizeof(cached));
+            }
+            for (const ImFontAtlasCustomRect& customRect : atlas.CustomRects)
+            {
+                CacheRect rect{ customRect.Width, customRect.Height, customRect.X, customRect.Y,
+                    customRect.GlyphID, customRect.GlyphAdvanceX, customRect.GlyphOffset };
+                file.write(reinterpret_cast<const char*>(&rect), sizeof(rect));
+            }
+            for (const ImFont* font : atlas.Fonts)
+            {
+                file.write(reinterpret_cast<const char*>(font->Glyphs.Data), font->Glyphs.Size * sizeof(ImFontGlyph));
+            }
+            file.write(reinterpret_cast<const char*>(atlas.TexPixelsAlpha8), static_cast<std::streamsize>(atlas.TexWidth) * atlas.TexHeight);
+            if (!file.flush())
+            {
+                error = "Failed writing " + tempPath.string();
+                return false;
+            }
+        }
+
+        std::filesystem::rename(tempPath, path, ec);
+        if (ec)
+        {
+            error = "Cannot replace " + path.string() + ": " + ec.message();
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <imgui.h>
+
+// Baked font atlases saved to disk: texture pixels, glyph tables and the atlas' custom rects, written
+// in the in-memory layout of the ImGui build that made them. The key covers every input to the bake, so
+// a cache is only ever loaded by a build that would have produced the same atlas.
+namespace LuminaFontAtlasCache
+{
+    // Chain over each input in turn: font file contents, sizes, glyph ranges. Seeds with the ImGui version.
+    uint64_t BeginKey();
+    uint64_t AddKeyBytes(uint64_t key, const void* data, size_t size);
+    uint64_t AddKeyRanges(uint64_t key, const ImWchar* ranges);
+
+    // data is the whole cache file. Returns a built atlas ready for io.Fonts, or nullptr if the cache is
+    // empty, stale or damaged. Allocates through ImGui, so only on the thread that owns the context.
+    ImFontAtlas* Load(const uint8_t* data, size_t size, uint64_t key, ImFont*& defaultFont);
+
+    // atlas must be built. Written to a temporary file first, so readers never see a partial cache.
+    bool Save(const std::filesystem::path& path, uint64_t key, const ImFontAtlas& atlas, const ImFont* defaultFont, std::string& error);
+}
@@ -0,0 +1,135 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <imgui.h>
+#include "LuminaFontLoader.h"
+#include "LuminaFontAtlasCache.h"
+#include "LuminaHelper.h"
+#include "LuminaStartupProfile.h"
+
+namespace
+{
+    template <typename T>
+    std::vector<T> ReadWholeFile(const std::filesystem::path& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<T>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+}
+
+LuminaFontLoader::~LuminaFontLoader()
+{
+    if (m_Thread.joinable())
+    {
+        m_Thread.join();
+    }
+}
+
+void LuminaFontLoader::Start(const std::filesystem::path& fontPath, float fontSize, float defaultFontSize,
+    const std::filesystem::path& cachePath, LuminaStartupProfile* profile)
+{
+    if (m_Thread.joinable())
+    {
+        return;
+    }
+    m_FontPath = fontPath;
+    m_CachePath = cachePath;
+    m_FontSize = fontSize;
+    m_DefaultFontSize = defaultFontSize;
+    m_Profile = profile;
+    m_Thread = std::thread(&LuminaFontLoader::ReadFiles, this);
+}
+
+std::filesystem::path LuminaFontLoader::FindResource(const std::string& name)
+{
+    std::filesystem::path beside = LuminaHelper::GetExecutableDirectory() / "resources" / name;
+    std::error_code ec;
+    if (std::filesystem::exists(beside, ec))
+    {
+        return beside;
+    }
+    return std::filesystem::path("..") / "resources" / name;
+}
+
+void LuminaFontLoader::ReadFiles()
+{
+    // No ImGui calls here; see the class comment
+    if (m_Profile) m_Profile->Begin("Font file read");
+    m_FontData = ReadWholeFile<char>(m_FontPath);
+    if (!m_FontData.empty())
+    {
+        m_CacheData = ReadWholeFile<uint8_t>(m_CachePath);
+    }
+    if (m_Profile) m_Profile->End("Font file read");
+    m_Ready = true;
+}
+
+bool LuminaFontLoader::ApplyIfReady()
+{
+    if (m_Applied || !m_Ready)
+    {
+        return false;
+    }
+    m_Thread.join();
+    m_Applied = true;
+
+    std::vector<char> fontData = std::move(m_FontData);
+    std::vector<uint8_t> cacheData = std::move(m_CacheData);
+    if (fontData.empty())
+    {
+        return false; // Font missing; keep the built-in font
+    }
+
+    ImFontAtlas* atlas = IM_NEW(ImFontAtlas)();
+    const ImWchar* ranges = atlas->GetGlyphRangesDefault();
+    uint64_t key = LuminaFontAtlasCache::BeginKey();
+    key = LuminaFontAtlasCache::AddKeyBytes(key, fontData.data(), fontData.size());
+    const float sizes[] = { m_FontSize, m_DefaultFontSize };
+    key = LuminaFontAtlasCache::AddKeyBytes(key, sizes, sizeof(sizes));
+    key = LuminaFontAtlasCache::AddKeyRanges(key, ranges);
+
+    if (m_Profile) m_Profile->Begin("Font cache load");
+    ImFont* font = nullptr;
+    ImFontAtlas* cached = LuminaFontAtlasCache::Load(cacheData.data(), cacheData.size(), key, font);
+    if (m_Profile) m_Profile->End("Font cache load");
+    if (cached)
+    {
+        IM_DELETE(atlas);
+        atlas = cached;
+    }
+    else
+    {
+        if (m_Profile) m_Profile->Begin("Font rasterize");
+        ImFontConfig config;
+        config.SizePixels = m_DefaultFontSize;
+        atlas->AddFontDefault(&config);
+
+        // The atlas frees the TTF data with its own allocator
+        void* ttf = IM_ALLOC(fontData.size());
+        std::memcpy(ttf, fontData.data(), fontData.size());
+        ImFontConfig fontConfig;
+        std::snprintf(fontConfig.Name, sizeof(fontConfig.Name), "%s, %.0fpx", m_FontPath.filename().string().c_str(), m_FontSize);
+        font = atlas->AddFontFromMemoryTTF(ttf, static_cast<int>(fontData.size()), m_FontSize, &fontConfig, ranges);
+        bool isBuilt = font && atlas->Build();
+        if (m_Profile) m_Profile->End("Font rasterize");
+        if (!isBuilt)
+        {
+            IM_DELETE(atlas);
+            return false; // Failed to bake; keep the built-in font
+        }
+
+        if (m_Profile) m_Profile->Begin("Font cache write");
+        std::string error;
+        LuminaFontAtlasCache::Save(m_CachePath, key, *atlas, font, error); // A failed write only costs the next launch a rebake
+        if (m_Profile) m_Profile->End("Font cache write");
+    }
+
+    ImGuiIO& io = ImGui::GetIO();
+    ImFontAtlas* previous = io.Fonts;
+    io.Fonts = atlas;
+    io.FontDefault = font;
+    IM_DELETE(previous); // The context owns io.Fonts and frees the new atlas on shutdown
+    return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+class LuminaStartupProfile;
+
+// Reads the UI font and its baked atlas cache (see LuminaFontAtlasCache) on a background thread so the first
+// frame can use the built-in font. The atlas itself is built on the UI thread: ImGui's allocator reports every
+// allocation to the current context, so an ImFontAtlas cannot be created or built anywhere else. A cache hit
+// only copies glyph tables and pixels; the atlas is rasterized, and the cache rewritten, only when the font
+// file, sizes or glyph ranges change.
+class LuminaFontLoader
+{
+public:
+    LuminaFontLoader() = default;
+    ~LuminaFontLoader();
+    LuminaFontLoader(const LuminaFontLoader&) = delete;
+    LuminaFontLoader& operator=(const LuminaFontLoader&) = delete;
+
+    // Cache hits and rebuilds are recorded into profile as separate phases, if given
+    void Start(const std::filesystem::path& fontPath, float fontSize, float defaultFontSize,
+        const std::filesystem::path& cachePath, LuminaStartupProfile* profile = nullptr);
+    bool IsLoading() const { return m_Thread.joinable() && !m_Applied; }
+
+    // UI thread, outside NewFrame/Render. Once the files are read, builds the atlas and installs it into ImGui.
+    // Returns true when the renderer's font texture must be recreated.
+    bool ApplyIfReady();
+
+    // <executable dir>/resources/<name>, falling back to ../resources as laid out in the build tree
+    static std::filesystem::path FindResource(const std::string& name);
+
+private:
+    std::thread m_Thread;
+    std::atomic<bool> m_Ready = false;
+    bool m_Applied = false;
+
+    // Set by Start; read by the UI thread once m_Ready
+    std::filesystem::path m_FontPath;
+    std::filesystem::path m_CachePath;
+    float m_FontSize = 0.0f;
+    float m_DefaultFontSize = 0.0f;
+    LuminaStartupProfile* m_Profile = nullptr;
+
+    // Written by the background thread before m_Ready; plain std allocations only
+    std::vector<char> m_FontData;
+    std::vector<uint8_t> m_CacheData;
+
+    void ReadFiles();
+};
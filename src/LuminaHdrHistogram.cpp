@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include "LuminaHdrHistogram.h"
+
+LuminaHdrHistogram::LuminaHdrHistogram(int64_t highestTrackableValue, int significantFigures)
+    : m_HighestTrackableValue(std::max<int64_t>(highestTrackableValue, 2))
+{
+    // Enough linear sub-buckets per power of two to resolve the requested decimal digits
+    significantFigures = std::clamp(significantFigures, 1, 5);
+    int64_t largestSingleUnitResolution = 2 * static_cast<int64_t>(std::pow(10, significantFigures));
+    int subBucketCountMagnitude = static_cast<int>(std::ceil(std::log2(static_cast<double>(largestSingleUnitResolution))));
+    m_SubBucketHalfCountMagnitude = std::max(subBucketCountMagnitude, 1) - 1;
+    m_SubBucketHalfCount = int64_t(1) << m_SubBucketHalfCountMagnitude;
+    int64_t subBucketCount = m_SubBucketHalfCount * 2;
+    m_SubBucketMask = subBucketCount - 1;
+
+    // Each further bucket doubles the range covered
+    int bucketCount = 1;
+    for (int64_t smallestUntrackable = subBucketCount; smallestUntrackable <= m_HighestTrackableValue; smallestUntrackable <<= 1)
+    {
+        ++bucketCount;
+    }
+    m_CountsLength = static_cast<size_t>((bucketCount + 1) * m_SubBucketHalfCount);
+    m_Counts = std::make_unique<std::atomic<uint64_t>[]>(m_CountsLength);
+    Reset();
+}
+
+void LuminaHdrHistogram::Record(int64_t value)
+{
+    value = std::clamp<int64_t>(value, 0, m_HighestTrackableValue);
+    m_Counts[GetCountsIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    m_TotalCount.fetch_add(1, std::memory_order_relaxed);
+    m_Sum.fetch_add(value, std::memory_order_relaxed);
+
+    int64_t current = m_Max.load(std::memory_order_relaxed);
+    while (value > current && !m_Max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+    current = m_Min.load(std::memory_order_relaxed);
+    while (value < current && !m_Min.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+void LuminaHdrHistogram::Reset()
+{
+    for (size_t i = 0; i < m_CountsLength; ++i)
+    {
+        m_Counts[i].store(0, std::memory_order_relaxed);
+    }
+    m_TotalCount = 0;
+    m_Min = INT64_MAX;
+    m_Max = 0;
+    m_Sum = 0;
+}
+
+int64_t LuminaHdrHistogram::GetMin() const
+{
+    return GetCount() > 0 ? m_Min.load(std::memory_order_relaxed) : 0;
+}
+
+double LuminaHdrHistogram::GetMean() const
+{
+    uint64_t count = GetCount();
+    return count > 0 ? static_cast<double>(m_Sum.load(std::memory_order_relaxed)) / count : 0.0;
+}
+
+int64_t LuminaHdrHistogram::GetValueAtPercentile(double percentile) const
+{
+    uint64_t total = GetCount();
+    if (total == 0)
+    {
+        return 0;
+    }
+    double fraction = std::clamp(percentile, 0.0, 100.0) / 100.0;
+    uint64_t countAtPercentile = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(fraction * total)), 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < m_CountsLength; ++i)
+    {
+        seen += m_Counts[i].load(std::memory_order_relaxed);
+        if (seen >= countAtPercentile)
+        {
+            return std::min(GetHighestEquivalentValue(GetValueFromIndex(i)), GetMax());
+        }
+    }
+    return GetMax();
+}
+
+size_t LuminaHdrHistogram::GetCountsIndex(int64_t value) const
+{
+    // Bucket: which power of two the value falls in; sub-bucket: the linear step within it
+    int pow2Ceiling = 64 - std::countl_zero(static_cast<uint64_t>(value | m_SubBucketMask));
+    int bucketIndex = pow2Ceiling - (m_SubBucketHalfCountMagnitude + 1);
+    int64_t subBucketIndex = value >> bucketIndex;
+    return static_cast<size_t>(((static_cast<int64_t>(bucketIndex) + 1) << m_SubBucketHalfCountMagnitude) + (subBucketIndex - m_SubBucketHalfCount));
+}
+
+int64_t LuminaHdrHistogram::GetValueFromIndex(size_t index) const
+{
+    int64_t bucketIndex = static_cast<int64_t>(index >> m_SubBucketHalfCountMagnitude) - 1;
+    int64_t subBucketIndex = static_cast<int64_t>(index & (m_SubBucketHalfCount - 1)) + m_SubBucketHalfCount;
+    if (bucketIndex < 0)
+    {
+        subBucketIndex -= m_SubBucketHalfCount;
+        bucketIndex = 0;
+    }
+    return subBucketIndex << bucketIndex;
+}
+
+int64_t LuminaHdrHistogram::GetHighestEquivalentValue(int64_t value) const
+{
+    int pow2Ceiling = 64 - std::countl_zero(static_cast<uint64_t>(value | m_SubBucketMask));
+    int bucketIndex = pow2Ceiling - (m_SubBucketHalfCountMagnitude + 1);
+    int64_t lowest = (value >> bucketIndex) << bucketIndex;
+    return lowest + (int64_t(1) << bucketIndex) - 1;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// High dynamic range histogram (after Gil Tene's HdrHistogram). Values from 1 up to the highest trackable
+// value are kept to a fixed number of significant decimal digits: each power-of-two range is split into
+// the same number of linear sub-buckets, so 2 digits means every recorded value is within 1%.
+// Recording is lock-free and may happen on any thread; reads see a consistent-enough snapshot.
+class LuminaHdrHistogram
+{
+public:
+    explicit LuminaHdrHistogram(int64_t highestTrackableValue = 3600000000, int significantFigures = 2);
+    LuminaHdrHistogram(const LuminaHdrHistogram&) = delete;
+    LuminaHdrHistogram& operator=(const LuminaHdrHistogram&) = delete;
+
+    // Values outside [0, highest] are clamped
+    void Record(int64_t value);
+    // Not synchronised with Record; values recorded meanwhile may survive
+    void Reset();
+
+    uint64_t GetCount() const { return m_TotalCount.load(std::memory_order_relaxed); }
+    int64_t GetMin() const;
+    int64_t GetMax() const { return m_Max.load(std::memory_order_relaxed); }
+    double GetMean() const;
+    // Highest value equivalent to the one at the given percentile (0-100); 0 when empty
+    int64_t GetValueAtPercentile(double percentile) const;
+
+    size_t GetMemoryBytes() const { return m_CountsLength * sizeof(std::atomic<uint64_t>); }
+
+private:
+    int64_t m_HighestTrackableValue;
+    int m_SubBucketHalfCountMagnitude;
+    int64_t m_SubBucketHalfCount;
+    int64_t m_SubBucketMask;
+    size_t m_CountsLength;
+    std::unique_ptr<std::atomic<uint64_t>[]> m_Counts;
+
+    std::atomic<uint64_t> m_TotalCount = 0;
+    std::atomic<int64_t> m_Min = INT64_MAX;
+    std::atomic<int64_t> m_Max = 0;
+    std::atomic<int64_t> m_Sum = 0;
+
+    size_t GetCountsIndex(int64_t value) const;
+    int64_t GetValueFromIndex(size_t index) const;
+    int64_t GetHighestEquivalentValue(int64_t value) const;
+};
@@ -0,0 +1,445 @@
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include "LuminaHeadless.h"
+#include "LuminaHelper.h"
+
+namespace
+{
+    std::atomic<bool> s_StopRequested = false;
+
+    void OnStopSignal(int)
+    {
+        s_StopRequested = true;
+    }
+
+    int64_t UnixMilliseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    bool ParseInt(const char* text, int minimum, int& value)
+    {
+        char* end = nullptr;
+        long parsed = std::strtol(text, &end, 10);
+        if (end == text || *end != '\0' || parsed < minimum || parsed > INT32_MAX)
+        {
+            return false;
+        }
+        value = static_cast<int>(parsed);
+        return true;
+    }
+}
+
+bool LuminaHeadless::ParseArguments(int argc, char** argv, Options& options, std::string& error)
+{
+    bool isHeadless = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        int value = 0;
+
+        if (arg == "--headless")
+        {
+            isHeadless = true;
+        }
+        else if (arg == "--export")
+        {
+            options.isExportEnabled = true;
+        }
+        else if (arg == "--link-addresses")
+        {
+            options.isAddressLinkingEnabled = true;
+        }
+        else if (arg == "--output" && hasValue)
+        {
+            options.outputPath = argv[++i];
+        }
+        else if (arg == "--flush-ms" && hasValue && ParseInt(argv[i + 1], 1, value))
+        {
+            options.flushInterval = std::chrono::milliseconds(value);
+            ++i;
+        }
+        else if (arg == "--scan-timeout" && hasValue && ParseInt(argv[i + 1], 1, value))
+        {
+            options.scanTimeoutSeconds = value;
+            ++i;
+        }
+        else if (arg == "--profile" && hasValue && Lumina::FindScanProfile(argv[i + 1]))
+        {
+            options.scanProfile = Lumina::FindScanProfile(argv[++i])->id;
+        }
+        else if (arg == "--provision" && hasValue)
+        {
+            std::string listError;
+            if (!LuminaProvisioner::LoadAddressList(argv[++i], options.provisioning.addresses, listError))
+            {
+                error = listError;
+            }
+            isHeadless = options.isProvisioning = true;
+        }
+        else if (arg == "--provision-name" && hasValue)
+        {
+            options.provisioning.namePrefix = argv[++i];
+            isHeadless = options.isProvisioning = true;
+        }
+        else if (arg == "--provision-min-rssi" && hasValue && ParseInt(argv[i + 1], -127, value))
+        {
+            options.provisioning.minRssi = value;
+            ++i;
+        }
+        else if (arg == "--provision-count" && hasValue && ParseInt(argv[i + 1], 1, value))
+        {
+            options.provisioning.unitLimit = value;
+            ++i;
+        }
+        else if (arg == "--provision-write" && hasValue)
+        {
+            Lumina::GattConfigWrite write;
+            if (!Lumina::ParseGattConfigWrite(argv[++i], write))
+            {
+                error = "Expected --provision-write <service>/<characteristic>/<hex value>";
+            }
+            options.provisioning.configWrite = write;
+        }
+        else if (arg == "--provision-parallel" && hasValue && ParseInt(argv[i + 1], 1, value))
+        {
+            options.provisioning.maxInFlight = value;
+            ++i;
+        }
+        else if (arg == "--provision-attempts" && hasValue && ParseInt(argv[i + 1], 1, value))
+        {
+            options.provisioning.maxAttempts = value;
+            ++i;
+        }
+        else if (arg == "--provision-simulate" && hasValue && ParseInt(argv[i + 1], 1, value))
+        {
+            options.simulatedUnits = value;
+            isHeadless = options.isProvisioning = true;
+            ++i;
+        }
+        else
+        {
+            error = "Unrecognized or incomplete argument: " + arg;
+        }
+    }
+#ifndef _WIN32
+    if (options.isProvisioning && options.simulatedUnits == 0 && error.empty())
+    {
+        error = "Provisioning real units needs the Windows Bluetooth stack; use --provision-simulate";
+    }
+#endif
+    return isHeadless;
+}
+
+LuminaHeadless::LuminaHeadless(const Options& options)
+    : m_Options(options)
+{
+}
+
+LuminaHeadless::~LuminaHeadless()
+{
+    m_ActionDiscoverDevice.StopScan();
+}
+
+int LuminaHeadless::Run()
+{
+    std::string error;
+    if (!m_Writer.Open(m_Options.outputPath, m_Options.flushInterval, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    std::signal(SIGINT, OnStopSignal);
+    std::signal(SIGTERM, OnStopSignal);
+
+    m_EventBus.Subscribe<Lumina::NotificationEvent>(m_WriterExecutor, [this](const std::vector<Lumina::NotificationEvent>& events)
+        {
+            for (const auto& event : events)
+            {
+                WriteMessage(event);
+            }
+        });
+    m_EventBus.Subscribe<Lumina::DeviceUpdatedEvent>(m_WriterExecutor, [this](const std::vector<Lumina::DeviceUpdatedEvent>& events)
+        {
+            for (const auto& event : events)
+            {
+                WriteDeviceUpdate(event);
+            }
+        });
+    m_EventBus.Subscribe<Lumina::DeviceLinkedEvent>(m_WriterExecutor, [this](const std::vector<Lumina::DeviceLinkedEvent>& events)
+        {
+            for (const auto& event : events)
+            {
+                WriteDeviceLink(event);
+            }
+        });
+    m_EventBus.Subscribe<Lumina::DeviceDiscoveredEvent>(m_RunExecutor, [this](const std::vector<Lumina::DeviceDiscoveredEvent>& events)
+        {
+            for (const auto& event : events)
+            {
+#ifdef _WIN32
+                m_DeviceManager.AddDiscoveredDevice(event.device);
+#endif
+                m_DiscoveryLatency.Record(LuminaDiscoveryLatency::Stage::Delivery, std::chrono::steady_clock::now() - event.publishTime);
+            }
+        });
+#ifdef _WIN32
+    m_DeviceManager.SetEventBus(&m_EventBus);
+    m_ActionDiscoverDevice.SetRssiHistory(&m_DeviceManager.GetRssiHistory());
+#endif
+    m_ActionDiscoverDevice.SetEventBus(&m_EventBus);
+    m_ActionDiscoverDevice.SetScanTimeout(m_Options.scanTimeoutSeconds);
+    m_ActionDiscoverDevice.SetScanProfile(m_Options.scanProfile);
+    m_ActionDiscoverDevice.SetExportEnabled(m_Options.isExportEnabled);
+    m_ActionDiscoverDevice.SetAddressLinkingEnabled(m_Options.isAddressLinkingEnabled);
+    m_ActionDiscoverDevice.SetDiscoveryLatency(&m_DiscoveryLatency);
+
+    WriteEvent("started");
+#ifdef _WIN32
+    m_DeviceManager.OpenRegistry();
+#endif
+    if (m_Options.isProvisioning)
+    {
+        StartProvisioning();
+    }
+
+    while (!s_StopRequested)
+    {
+#ifdef _WIN32
+        if (m_DeviceManager.PollRegistryLoad())
+        {
+            WriteKnownDevices();
+        }
+#endif
+        m_RunExecutor.RunPending();
+
+        if (m_Provisioner)
+        {
+            PollProvisioning();
+            if (m_Provisioner->IsComplete())
+            {
+                break;
+            }
+        }
+
+        // Scans end on their own timeout; keep one running for as long as the daemon lives
+        if (!m_ProvisioningSimulator && !m_ActionDiscoverDevice.GetIsScanRequested())
+        {
+            m_ActionDiscoverDevice.RequestScan();
+            if (m_ActionDiscoverDevice.GetIsScanRequested())
+            {
+                std::string fields = ",\"timeout_s\":" + std::to_string(m_Options.scanTimeoutSeconds);
+                fields += ",\"profile\":\"";
+                fields += Lumina::GetScanProfile(m_Options.scanProfile).name;
+                fields += "\"";
+                WriteEvent("scan_started", fields);
+            }
+        }
+
+        // Provisioning steps take around a second; poll often enough not to add to them
+        std::this_thread::sleep_for(std::chrono::milliseconds(m_Provisioner ? 20 : 200));
+    }
+
+    m_ActionDiscoverDevice.StopScan();
+#ifdef _WIN32
+    m_DeviceManager.SaveRegistry();
+#endif
+    WriteLatency();
+    int exitCode = 0;
+    if (m_Provisioner)
+    {
+        WriteProvisioningReport();
+        exitCode = m_Provisioner->GetReport().failed > 0 ? 3 : 0;
+    }
+    WriteEvent("stopped", ",\"lines\":" + std::to_string(m_Writer.GetLineCount()));
+    m_Writer.Close();
+    return exitCode;
+}
+
+void LuminaHeadless::WriteEvent(const char* event, const std::string& fields)
+{
+    std::string line = "{\"ts\":" + std::to_string(UnixMilliseconds()) + ",\"event\":\"" + event + "\"";
+    line += fields;
+    line += "}";
+    m_Writer.WriteLine(line);
+}
+
+void LuminaHeadless::WriteMessage(const Lumina::NotificationEvent& event)
+{
+    std::string fields = ",\"level\":\"";
+    fields += Lumina::SeverityToString(event.severity);
+    fields += "\",\"source\":";
+    LuminaNdjsonWriter::AppendString(fields, event.source);
+    fields += ",\"text\":";
+    LuminaNdjsonWriter::AppendString(fields, event.message);
+    WriteEvent("message", fields);
+}
+
+void LuminaHeadless::WriteDeviceUpdate(const Lumina::DeviceUpdatedEvent& event)
+{
+    std::string fields = ",\"address\":";
+    LuminaNdjsonWriter::AppendString(fields, LuminaHelper::BluetoothAddressToString(event.address));
+    fields += ",\"name\":";
+    LuminaNdjsonWriter::AppendString(fields, event.name);
+    fields += ",\"rssi\":" + std::to_string(event.rssi);
+    fields += ",\"connectable\":";
+    fields += event.isConnectable ? "true" : "false";
+    fields += ",\"new\":";
+    fields += event.isNew ? "true" : "false";
+    WriteEvent("device", fields);
+}
+
+void LuminaHeadless::WriteDeviceLink(const Lumina::DeviceLinkedEvent& event)
+{
+    char confidence[16];
+    snprintf(confidence, sizeof(confidence), "%.2f", event.confidence);
+    std::string fields = ",\"address\":";
+    LuminaNdjsonWriter::AppendString(fields, LuminaHelper::BluetoothAddressToString(event.address));
+    fields += ",\"linked_address\":";
+    LuminaNdjsonWriter::AppendString(fields, LuminaHelper::BluetoothAddressToString(event.linkedAddress));
+    fields += ",\"confidence\":";
+    fields += confidence;
+    WriteEvent("link", fields);
+}
+
+void LuminaHeadless::WriteLatency()
+{
+    // No rows are drawn here, so the render and end-to-end stages stay empty
+    for (size_t i = 0; i < LuminaDiscoveryLatency::StageCount; ++i)
+    {
+        auto stage = static_cast<LuminaDiscoveryLatency::Stage>(i);
+        const LuminaHdrHistogram& histogram = m_DiscoveryLatency.GetHistogram(stage);
+        if (histogram.GetCount() == 0)
+        {
+            continue;
+        }
+        std::string fields = ",\"stage\":";
+        LuminaNdjsonWriter::AppendString(fields, LuminaDiscoveryLatency::GetStageName(stage));
+        fields += ",\"count\":" + std::to_string(histogram.GetCount());
+        fields += ",\"p50_us\":" + std::to_string(histogram.GetValueAtPercentile(50.0));
+        fields += ",\"p99_us\":" + std::to_string(histogram.GetValueAtPercentile(99.0));
+        fields += ",\"max_us\":" + std::to_string(histogram.GetMax());
+        WriteEvent("latency", fields);
+    }
+}
+
+void LuminaHeadless::StartProvisioning()
+{
+#ifdef _WIN32
+    LuminaProvisioningTransport* transport = &m_ActionProvisionDevice;
+#else
+    LuminaProvisioningTransport* transport = nullptr;  // ParseArguments only allows simulated units here
+#endif
+    if (m_Options.simulatedUnits > 0)
+    {
+        LuminaProvisioningSimulator::Options simulation;
+        simulation.unitCount = m_Options.simulatedUnits;
+        m_ProvisioningSimulator = std::make_unique<LuminaProvisioningSimulator>(simulation);
+        transport = m_ProvisioningSimulator.get();
+    }
+    m_Provisioner = std::make_unique<LuminaProvisioner>(*transport, m_Options.provisioning);
+
+    // Discovery feeds the pipeline on this thread, alongside the device manager
+    m_EventBus.Subscribe<Lumina::DeviceUpdatedEvent>(m_RunExecutor, [this](const std::vector<Lumina::DeviceUpdatedEvent>& events)
+        {
+            for (const auto& event : events)
+            {
+                m_Provisioner->OnDeviceSeen(event.address, event.name, event.rssi);
+            }
+        });
+
+    std::string fields = ",\"targets\":" + std::to_string(m_Options.provisioning.addresses.size());
+    fields += ",\"parallel\":" + std::to_string(m_Options.provisioning.maxInFlight);
+    fields += ",\"simulated\":";
+    fields += m_ProvisioningSimulator ? "true" : "false";
+    WriteEvent("provisioning_started", fields);
+}
+
+void LuminaHeadless::PollProvisioning()
+{
+    if (m_ProvisioningSimulator)
+    {
+        for (const auto& peripheral : m_ProvisioningSimulator->TakeArrivals())
+        {
+            m_Provisioner->OnDeviceSeen(peripheral.address, peripheral.name, peripheral.rssi);
+        }
+    }
+
+    std::vector<LuminaProvisioner::Unit> finished;
+    m_Provisioner->Poll(finished);
+    for (const auto& unit : finished)
+    {
+        bool isSucceeded = unit.state == LuminaProvisioner::UnitState::Succeeded;
+#ifdef _WIN32
+        // Paired units join the known device registry like ones paired from the UI
+        Lumina::BluetoothDevice* device = m_DeviceManager.GetDeviceByAddress(unit.address);
+        if (isSucceeded && device && !m_ProvisioningSimulator)
+        {
+            m_DeviceManager.AddDevice(*device);
+        }
+#endif
+
+        std::string fields = ",\"address\":";
+        LuminaNdjsonWriter::AppendString(fields, LuminaHelper::BluetoothAddressToString(unit.address));
+        fields += ",\"name\":";
+        LuminaNdjsonWriter::AppendString(fields, unit.name);
+        fields += ",\"result\":\"";
+        fields += LuminaProvisioner::GetUnitStateName(unit.state);
+        fields += "\",\"attempts\":" + std::to_string(unit.attempts);
+        fields += ",\"ms\":" + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(unit.finishTime - unit.startTime).count());
+        if (!isSucceeded)
+        {
+            fields += ",\"error\":";
+            LuminaNdjsonWriter::AppendString(fields, unit.lastError);
+        }
+        WriteEvent("provisioned", fields);
+    }
+}
+
+void LuminaHeadless::WriteProvisioningReport()
+{
+    LuminaProvisioner::Report report = m_Provisioner->GetReport();
+    char rates[96];
+    snprintf(rates, sizeof(rates), ",\"elapsed_s\":%.1f,\"units_per_minute\":%.1f,\"mean_unit_s\":%.2f",
+        report.elapsedSeconds, report.unitsPerMinute, report.meanUnitSeconds);
+    std::string fields = ",\"units\":" + std::to_string(report.unitCount);
+    fields += ",\"succeeded\":" + std::to_string(report.succeeded);
+    fields += ",\"failed\":" + std::to_string(report.failed);
+    fields += ",\"retries\":" + std::to_string(report.retries);
+    fields += rates;
+
+    std::filesystem::path path;
+    std::string error;
+    if (m_Provisioner->ExportCsv(LuminaConfig::ProvisioningReportDirectory, path, error))
+    {
+        fields += ",\"report\":";
+        LuminaNdjsonWriter::AppendString(fields, path.string());
+    }
+    else
+    {
+        WriteMessage(Lumina::NotificationEvent{ Lumina::Severity::Error, "Provisioning", error, "" });
+    }
+    WriteEvent("provisioning_report", fields);
+}
+
+#ifdef _WIN32
+void LuminaHeadless::WriteKnownDevices()
+{
+    for (const auto& device : m_DeviceManager.GetPairedDevices())
+    {
+        std::string fields = ",\"id\":";
+        LuminaNdjsonWriter::AppendString(fields, device.GetDeviceId());
+        fields += ",\"name\":";
+        LuminaNdjsonWriter::AppendString(fields, device.GetName());
+        fields += ",\"label\":";
+        LuminaNdjsonWriter::AppendString(fields, device.GetLabel());
+        fields += ",\"paired\":";
+        fields += device.IsPaired() ? "true" : "false";
+        WriteEvent("known_device", fields);
+    }
+}
+#endif
@@ -0,0 +1,79 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <memory>
+#include "LuminaActionDiscoverDevice.h"
+#ifdef _WIN32
+#include "LuminaActionProvisionDevice.h"
+#include "LuminaDeviceManager.h"
+#endif
+#include "LuminaEventBus.h"
+#include "LuminaNdjsonWriter.h"
+#include "LuminaProvisioner.h"
+#include "LuminaProvisioningSimulator.h"
+
+// Display-less daemon mode (--headless). Runs discovery, the device manager and the known device
+// registry without GLFW, OpenGL or ImGui, and streams events as NDJSON until interrupted.
+// On Linux it is the only mode: discovery runs over BlueZ, and there is no device manager or registry yet,
+// so only simulated units can be provisioned.
+class LuminaHeadless
+{
+public:
+    struct Options
+    {
+        std::string outputPath = "-";
+        std::chrono::milliseconds flushInterval{ 250 };
+        int scanTimeoutSeconds = 30;
+        bool isExportEnabled = false;
+        bool isAddressLinkingEnabled = false;
+        Lumina::ScanProfileId scanProfile = Lumina::ScanProfileId::LowLatency;
+
+        // Provisioning mode (--provision / --provision-name): exits once the batch is done
+        bool isProvisioning = false;
+        LuminaProvisioner::Options provisioning;
+        int simulatedUnits = 0;         // Provision simulated peripherals instead of using the radio
+    };
+
+    // Returns true if argv asks for headless mode; fills options and reports bad arguments through error
+    static bool ParseArguments(int argc, char** argv, Options& options, std::string& error);
+
+    explicit LuminaHeadless(const Options& options);
+    ~LuminaHeadless();
+    LuminaHeadless(const LuminaHeadless&) = delete;
+    LuminaHeadless& operator=(const LuminaHeadless&) = delete;
+
+    // Blocks until SIGINT/SIGTERM, or until provisioning is done; returns the process exit code.
+    // Provisioning returns 3 if any unit failed.
+    int Run();
+
+private:
+    Options m_Options;
+    LuminaNdjsonWriter m_Writer;
+
+    // Updates and messages are written straight from the publishing thread. Discovered devices
+    // wait for Run, the only thread that touches the device manager.
+    LuminaEventBus m_EventBus;
+    LuminaInlineExecutor m_WriterExecutor;
+    LuminaQueuedExecutor m_RunExecutor;
+    LuminaDiscoveryLatency m_DiscoveryLatency;
+
+    LuminaActionDiscoverDevice m_ActionDiscoverDevice;
+#ifdef _WIN32
+    LuminaDeviceManager m_DeviceManager;
+    LuminaActionProvisionDevice m_ActionProvisionDevice;
+#endif
+    std::unique_ptr<LuminaProvisioningSimulator> m_ProvisioningSimulator;
+    std::unique_ptr<LuminaProvisioner> m_Provisioner;
+
+    void WriteEvent(const char* event, const std::string& fields = std::string());
+    void WriteMessage(const Lumina::NotificationEvent& event);
+    void WriteDeviceUpdate(const Lumina::DeviceUpdatedEvent& event);
+    void WriteDeviceLink(const Lumina::DeviceLinkedEvent& event);
+#ifdef _WIN32
+    void WriteKnownDevices();
+#endif
+    void WriteLatency();
+    void StartProvisioning();
+    void PollProvisioning();
+    void WriteProvisioningReport();
+};
@@ -1,50 +1,283 @@
+#include <cstdio>
+#ifdef _WIN32
 #define NOMINMAX
-#include <algorithm>
-#include <imgui.h>
 #include <Windows.h>
+#endif
 #include "LuminaHelper.h"
 
 namespace LuminaHelper
 {
-    ImVec4 LightenColor(const ImVec4& color, float percent)
+#ifdef _WIN32
+    std::string WideStringToUtf8(const std::wstring& wstr)
+    {
+        if (wstr.empty())
+        {
+            return {};
+        }
+
+        int size_needed = WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), (int)wstr.size(), nullptr, 0, nullptr, nullptr);
+        std::string strTo(size_needed, 0);
+        WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), (int)wstr.size(), &strTo[0], size_needed, nullptr, nullptr);
+        return strTo;
+    }
+#endif
+
+    uint64_t HashBytes(const uint8_t* data, size_t size, uint64_t seed)
     {
-        float factor = 1.0f + percent;
-        return ImVec4(
-            std::min(color.x * factor, 1.0f),
-            std::min(color.y * factor, 1.0f),
-            std::min(color.z * factor, 1.0f),
-            color.w
-        );
+        uint64_t hash = seed;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= data[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
     }
 
-    ImVec4 DarkenColor(const ImVec4& color, float percent)
+    uint64_t DeviceIdToAddress(const std::string& deviceId)
     {
-        float factor = 1.0f - percent;
-        return ImVec4(
-            std::max(color.x * factor, 0.0f),
-            std::max(color.y * factor, 0.0f),
-            std::max(color.z * factor, 0.0f),
-            color.w
-        );
+        constexpr size_t AddressLength = 17; // "aa:bb:cc:dd:ee:ff"
+        uint64_t address = 0;
+        if (deviceId.size() >= AddressLength && ParseBluetoothAddress(std::string_view(deviceId).substr(deviceId.size() - AddressLength), address))
+        {
+            return address;
+        }
+        return HashBytes(reinterpret_cast<const uint8_t*>(deviceId.data()), deviceId.size());
     }
 
-    float GetMenuBarPosY()
+    std::string BluetoothAddressToString(uint64_t address)
     {
-        static float padding = 6.0f;
-        return ImGui::GetFontSize() + padding;
+        char text[18];
+        std::snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X",
+            static_cast<unsigned>((address >> 40) & 0xFF), static_cast<unsigned>((address >> 32) & 0xFF),
+            static_cast<unsigned>((address >> 24) & 0xFF), static_cast<unsigned>((address >> 16) & 0xFF),
+            static_cast<unsigned>((address >> 8) & 0xFF), static_cast<unsigned>(address & 0xFF));
+        return text;
     }
 
-    std::string WideStringToUtf8(const std::wstring& wstr)
+    int HexDigitValue(char c)
     {
-        if (wstr.empty())
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    bool ParseHex(std::string_view text, uint64_t& value)
+    {
+        if (text.empty() || text.size() > 16)
         {
-            return {};
+            return false;
+        }
+        value = 0;
+        for (char c : text)
+        {
+            int digit = HexDigitValue(c);
+            if (digit < 0)
+            {
+                return false;
+            }
+            value = (value << 4) | static_cast<uint64_t>(digit);
         }
+        return true;
+    }
 
-        int size_needed = WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), (int)wstr.size(), nullptr, 0, nullptr, nullptr);
-        std::string strTo(size_needed, 0);
-        WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), (int)wstr.size(), &strTo[0], size_needed, nullptr, nullptr);
-        return strTo;
+    bool ParseHexBytes(std::string_view text, std::vector<uint8_t>& bytes)
+    {
+        if (text.empty() || text.size() % 2 != 0)
+        {
+            return false;
+        }
+        bytes.clear();
+        for (size_t i = 0; i < text.size(); i += 2)
+        {
+            int high = HexDigitValue(text[i]);
+            int low = HexDigitValue(text[i + 1]);
+            if (high < 0 || low < 0)
+            {
+                return false;
+            }
+            bytes.push_back(static_cast<uint8_t>((high << 4) | low));
+        }
+        return true;
     }
-}
 
+    bool ParseBluetoothAddress(std::string_view text, uint64_t& address)
+    {
+        // Either every byte is followed by a colon but the last, or there are no colons at all
+        const bool hasColons = text.size() == 17;
+        if (!hasColons && text.size() != 12)
+        {
+            return false;
+        }
+        address = 0;
+        for (size_t i = 0; i < text.size(); ++i)
+        {
+            if (hasColons && i % 3 == 2)
+            {
+                if (text[i] != ':')
+                {
+                    return false;
+                }
+                continue;
+            }
+            int digit = HexDigitValue(text[i]);
+            if (digit < 0)
+            {
+                return false;
+            }
+            address = (address << 4) | static_cast<uint64_t>(digit);
+        }
+        return true;
+    }
+
+    bool ParseServiceUuid(std::string_view text, Lumina::ServiceUuid& uuid)
+    {
+        char hex[32];
+        size_t length = 0;
+        for (char c : text)
+        {
+            if (c == '-')
+            {
+                continue;
+            }
+            if (length == sizeof(hex))
+            {
+                return false;
+            }
+            hex[length++] = c;
+        }
+        const std::string_view digits(hex, length);
+        if (length == 4 || length == 8)
+        {
+            uint64_t alias = 0;
+            if (!ParseHex(digits, alias))
+            {
+                return false;
+            }
+            uuid.high = (alias << 32) | 0x00001000ull;
+            uuid.low = 0x800000805f9b34fbull;
+            return true;
+        }
+        return length == 32 && ParseHex(digits.substr(0, 16), uuid.high) && ParseHex(digits.substr(16), uuid.low);
+    }
+
+    namespace
+    {
+        // Length of the valid UTF-8 sequence at text[offset], or 0 if it is invalid. On 0, prefix is the number
+        // of bytes that began a sequence and must be replaced together (at least 1).
+        size_t DecodeUtf8(std::string_view text, size_t offset, size_t& prefix)
+        {
+            const uint8_t lead = static_cast<uint8_t>(text[offset]);
+            prefix = 1;
+            if (lead < 0x80)
+            {
+                return 1;
+            }
+
+            // Ranges for the second byte rule out overlong forms, surrogates and code points past U+10FFFF
+            size_t length = 0;
+            uint8_t low = 0x80;
+            uint8_t high = 0xBF;
+            if (lead >= 0xC2 && lead <= 0xDF) { length = 2; }
+            else if (lead == 0xE0) { length = 3; low = 0xA0; }
+            else if (lead == 0xED) { length = 3; high = 0x9F; }
+            else if (lead >= 0xE1 && lead <= 0xEF) { length = 3; }
+            else if (lead == 0xF0) { length = 4; low = 0x90; }
+            else if (lead == 0xF4) { length = 4; high = 0x8F; }
+            else if (lead >= 0xF1 && lead <= 0xF3) { length = 4; }
+            else { return 0; }
+
+            for (size_t i = 1; i < length; ++i)
+            {
+                if (offset + i >= text.size())
+                {
+                    return 0;
+                }
+                const uint8_t byte = static_cast<uint8_t>(text[offset + i]);
+                if (byte < (i == 1 ? low : 0x80) || byte > (i == 1 ? high : 0xBF))
+                {
+                    return 0;
+                }
+                prefix = i + 1;
+            }
+            return length;
+        }
+
+        // Offset of the first invalid sequence, or the size if there is none. Adverts are nearly always valid,
+        // so this runs without copying and skips ASCII a byte at a time.
+        size_t FindInvalidUtf8(std::string_view text)
+        {
+            size_t offset = 0;
+            size_t prefix = 0;
+            while (offset < text.size())
+            {
+                if (static_cast<uint8_t>(text[offset]) < 0x80)
+                {
+                    ++offset;
+                    continue;
+                }
+                size_t length = DecodeUtf8(text, offset, prefix);
+                if (length == 0)
+                {
+                    break;
+                }
+                offset += length;
+            }
+            return offset;
+        }
+    }
+
+    bool IsValidUtf8(std::string_view text)
+    {
+        return FindInvalidUtf8(text) == text.size();
+    }
+
+    bool ReplaceInvalidUtf8(std::string& text)
+    {
+        size_t offset = FindInvalidUtf8(text);
+        if (offset == text.size())
+        {
+            return false;
+        }
+
+        size_t prefix = 0;
+        std::string valid(text, 0, offset);
+        while (offset < text.size())
+        {
+            size_t length = DecodeUtf8(text, offset, prefix);
+            if (length == 0)
+            {
+                valid += "\xEF\xBF\xBD";
+                offset += prefix;
+            }
+            else
+            {
+                valid.append(text, offset, length);
+                offset += length;
+            }
+        }
+        text.swap(valid);
+        return true;
+    }
+
+    std::filesystem::path GetExecutableDirectory()
+    {
+#ifdef _WIN32
+        wchar_t path[MAX_PATH];
+        DWORD length = GetModuleFileNameW(nullptr, path, MAX_PATH);
+        if (length == 0 || length == MAX_PATH)
+        {
+            return std::filesystem::current_path();
+        }
+        return std::filesystem::path(path).parent_path();
+#else
+        std::error_code error;
+        std::filesystem::path path = std::filesystem::read_symlink("/proc/self/exe", error);
+        if (error)
+        {
+            return std::filesystem::current_path();
+        }
+        return path.parent_path();
+#endif
+    }
+}
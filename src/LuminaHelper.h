@@ -1,18 +1,92 @@
 #pragma once
-#include <imgui.h>
 #include <string>
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+#include "LuminaAdvertisement.h"
+
+struct ImVec4;
 
 namespace LuminaHelper
 {
+    // ImGui helpers, defined in LuminaHelperImGui.cpp so the rest of this file builds without ImGui
     ImVec4 DarkenColor(const ImVec4& color, float percent);
     ImVec4 LightenColor(const ImVec4& color, float percent);
     float GetMenuBarPosY();
+#ifdef _WIN32
     std::string WideStringToUtf8(const std::wstring& wstr);
+#endif
+
+    // 64-bit FNV-1a. Pass the previous result as seed to hash several chunks as one.
+    constexpr uint64_t HashSeed = 14695981039346656037ull;
+    uint64_t HashBytes(const uint8_t* data, size_t size, uint64_t seed = HashSeed);
+
+    // Device ids end in the peer address ("...-aa:bb:cc:dd:ee:ff"). Falls back to a hash of the id.
+    uint64_t DeviceIdToAddress(const std::string& deviceId);
+
+    // "AA:BB:CC:DD:EE:FF" from a 48-bit address
+    std::string BluetoothAddressToString(uint64_t address);
+
+    // Value of one hex digit, or -1
+    int HexDigitValue(char c);
+    // 1 to 16 hex digits, no prefix
+    bool ParseHex(std::string_view text, uint64_t& value);
+    // Pairs of hex digits, one byte each; fails on an empty or odd-length string
+    bool ParseHexBytes(std::string_view text, std::vector<uint8_t>& bytes);
+    // "AA:BB:CC:DD:EE:FF" or "AABBCCDDEEFF"
+    bool ParseBluetoothAddress(std::string_view text, uint64_t& address);
+    // Full 128-bit form with or without dashes, or a 16/32-bit alias expanded onto the Bluetooth base UUID
+    bool ParseServiceUuid(std::string_view text, Lumina::ServiceUuid& uuid);
+
+    bool IsValidUtf8(std::string_view text);
+    // Replaces each invalid UTF-8 sequence (its longest valid prefix, or a single byte) with U+FFFD.
+    // Returns false and leaves text untouched if it was already valid.
+    bool ReplaceInvalidUtf8(std::string& text);
+
+    // Directory of the running executable; resources are looked up relative to it, not the working directory
+    std::filesystem::path GetExecutableDirectory();
 }
 
 namespace LuminaConfig
 {
     constexpr int WindowWidth = 1200;
     constexpr int WindowHeight = 720;
+
+    // Allow/deny rules for incoming adverts, reloaded while scanning whenever the file changes
+    constexpr const char* IngestFilterPath = "lumina-filter.txt";
+    constexpr int IngestFilterReloadSeconds = 2;
+
+    // IRKs of bonded devices, used to fold their rotating private addresses into one device; reloaded with the filter
+    constexpr const char* IrkStorePath = "lumina-data/irks.txt";
+
+    // Known devices persist across runs in <RegistryDirectory>/<RegistryName>.dat/.wal
+    constexpr const char* RegistryDirectory = "lumina-data";
+    constexpr const char* RegistryName = "devices";
+
+    // Per-device RSSI history in <RegistryDirectory>/<RssiHistoryName>.dat/.idx
+    constexpr const char* RssiHistoryName = "rssi";
+
+    // Live device table exported to other processes (Local\<name> on Windows, /<name> in POSIX shared memory)
+    constexpr const char* SharedTableName = "lumina-devices";
+
+    // Local query/subscription socket for automation (see LuminaQueryServer)
+    constexpr const char* QuerySocketPath = "lumina-data/query.sock";
+
+    // Scan sessions exported as Arrow IPC streams when enabled (File > Export Scan Sessions, or --export)
+    constexpr const char* ExportDirectory = "lumina-data/sessions";
+
+    // Discovery latency summaries, one CSV per export (see LuminaDiscoveryLatency)
+    constexpr const char* LatencyExportDirectory = "lumina-data/latency";
+
+    // Per-unit provisioning results, one CSV per batch (see LuminaProvisioner)
+    constexpr const char* ProvisioningReportDirectory = "lumina-data/provisioning";
+
+    // Baked UI font atlas, rebuilt whenever the font file, sizes or glyph ranges change (see LuminaFontAtlasCache)
+    constexpr const char* FontCachePath = "lumina-data/fonts.cache";
+
+    // One row per run with per-phase startup timings
+    constexpr const char* StartupLogPath = "lumina-data/startup.csv";
 }
 
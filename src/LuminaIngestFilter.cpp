@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "LuminaIngestFilter.h"
+#include "LuminaHelper.h"
+
+namespace
+{
+    uint64_t Mix64(uint64_t key)
+    {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdull;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ull;
+        key ^= key >> 33;
+        return key;
+    }
+
+    uint64_t UuidKey(const Lumina::ServiceUuid& uuid)
+    {
+        return Mix64(uuid.high) ^ uuid.low;
+    }
+}
+
+namespace Lumina
+{
+    void BlockedBloomFilter::Build(const std::vector<uint64_t>& keys, int bitsPerKey)
+    {
+        m_Blocks.clear();
+        if (keys.empty())
+        {
+            return;
+        }
+
+        size_t totalBits = std::max<size_t>(keys.size() * bitsPerKey, 512);
+        m_Blocks.assign((totalBits + 511) / 512, Block{});
+
+        for (uint64_t key : keys)
+        {
+            uint64_t hash = Mix64(key);
+            Block& block = m_Blocks[(hash >> 32) % m_Blocks.size()];
+            uint64_t bits = hash * 0x9e3779b97f4a7c15ull;
+            for (int i = 0; i < 8; ++i)
+            {
+                // One bit per 64-bit word, position taken from successive 6-bit slices
+                block.words[i] |= 1ull << ((bits >> (i * 6)) & 63);
+            }
+        }
+    }
+
+    bool BlockedBloomFilter::MayContain(uint64_t key) const
+    {
+        if (m_Blocks.empty())
+        {
+            return false;
+        }
+
+        uint64_t hash = Mix64(key);
+        const Block& block = m_Blocks[(hash >> 32) % m_Blocks.size()];
+        uint64_t bits = hash * 0x9e3779b97f4a7c15ull;
+        for (int i = 0; i < 8; ++i)
+        {
+            if ((block.words[i] & (1ull << ((bits >> (i * 6)) & 63))) == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+bool LuminaIngestFilter::KeySet::ContainsAddress(uint64_t address) const
+{
+    return bloom.MayContain(address) && std::binary_search(addresses.begin(), addresses.end(), address);
+}
+
+bool LuminaIngestFilter::KeySet::ContainsUuid(const Lumina::ServiceUuid& uuid) const
+{
+    return bloom.MayContain(UuidKey(uuid)) && std::binary_search(uuids.begin(), uuids.end(), uuid);
+}
+
+void LuminaIngestFilter::KeySet::Finalize()
+{
+    std::sort(addresses.begin(), addresses.end());
+    addresses.erase(std::unique(addresses.begin(), addresses.end()), addresses.end());
+    addresses.shrink_to_fit();
+    std::sort(uuids.begin(), uuids.end());
+    uuids.erase(std::unique(uuids.begin(), uuids.end()), uuids.end());
+    uuids.shrink_to_fit();
+
+    std::vector<uint64_t> bloomKeys = addresses;
+    for (const auto& uuid : uuids)
+    {
+        bloomKeys.push_back(UuidKey(uuid));
+    }
+    bloom.Build(bloomKeys);
+}
+
+bool LuminaIngestFilter::ReloadIfChanged(const std::filesystem::path& path, std::string& error)
+{
+    std::lock_guard<std::mutex> lock(m_ReloadMutex);
+
+    std::error_code ec;
+    bool exists = std::filesystem::exists(path, ec);
+    if (!exists)
+    {
+        if (m_FileExisted)
+        {
+            m_Rules.store(nullptr);
+            m_FileExisted = false;
+        }
+        m_HasFailedWriteTime = false;
+        return true;
+    }
+
+    auto writeTime = std::filesystem::last_write_time(path, ec);
+    if (ec)
+    {
+        error = "Failed to read filter file time: " + ec.message();
+        return false;
+    }
+    if (m_FileExisted && writeTime == m_LastWriteTime)
+    {
+        return true;
+    }
+    // This version already failed and was reported; keep the current rules until the file is written again
+    if (m_HasFailedWriteTime && writeTime == m_FailedWriteTime)
+    {
+        return true;
+    }
+
+    std::ifstream file(path);
+    auto rules = std::make_shared<Rules>();
+    if (!file)
+    {
+        error = "Failed to open filter file: " + path.string();
+    }
+    if (!file || !ParseRules(file, *rules, error))
+    {
+        m_FailedWriteTime = writeTime;
+        m_HasFailedWriteTime = true;
+        return false;
+    }
+
+    m_Rules.store(std::move(rules));
+    m_LastWriteTime = writeTime;
+    m_FileExisted = true;
+    m_HasFailedWriteTime = false;
+    return true;
+}
+
+bool LuminaIngestFilter::ParseRules(std::istream& input, Rules& rules, std::string& error)
+{
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(input, line))
+    {
+        ++lineNumber;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.resize(comment);
+        }
+
+        std::istringstream tokens(line);
+        std::string action, kind, value;
+        if (!(tokens >> action))
+        {
+            continue;
+        }
+        if (!(tokens >> kind >> value) || (action != "allow" && action != "deny"))
+        {
+            error = "Filter file line " + std::to_string(lineNumber) + ": expected '<allow|deny> <address|service> <value>'";
+            return false;
+        }
+
+        bool allow = (action == "allow");
+        if (kind == "address")
+        {
+            uint64_t address = 0;
+            if (!LuminaHelper::ParseBluetoothAddress(value, address))
+            {
+                error = "Filter file line " + std::to_string(lineNumber) + ": invalid address '" + value + "'";
+                return false;
+            }
+            (allow ? rules.allowAddresses : rules.denyAddresses).addresses.push_back(address);
+        }
+        else if (kind == "service")
+        {
+            Lumina::ServiceUuid uuid{};
+            if (!LuminaHelper::ParseServiceUuid(value, uuid))
+            {
+                error = "Filter file line " + std::to_string(lineNumber) + ": invalid service UUID '" + value + "'";
+                return false;
+            }
+            (allow ? rules.allowServices : rules.denyServices).uuids.push_back(uuid);
+        }
+        else
+        {
+            error = "Filter file line " + std::to_string(lineNumber) + ": unknown rule kind '" + kind + "'";
+            return false;
+        }
+    }
+
+    rules.allowAddresses.Finalize();
+    rules.denyAddresses.Finalize();
+    rules.allowServices.Finalize();
+    rules.denyServices.Finalize();
+    return true;
+}
+
+LuminaIngestFilter::Verdict LuminaIngestFilter::CheckAddress(uint64_t address)
+{
+    std::shared_ptr<const Rules> rules = m_Rules.load();
+    if (!rules)
+    {
+        ++m_Accepted;
+        return Verdict::Accept;
+    }
+
+    Verdict verdict = Verdict::Accept;
+    bool hasAllowList = !rules->allowAddresses.IsEmpty() || !rules->allowServices.IsEmpty();
+    bool addressAllowed = rules->allowAddresses.ContainsAddress(address);
+
+    if (rules->denyAddresses.ContainsAddress(address))
+    {
+        verdict = Verdict::Reject;
+    }
+    else if (!rules->denyServices.IsEmpty() || (hasAllowList && !addressAllowed && !rules->allowServices.IsEmpty()))
+    {
+        // Either a denied service could still veto, or an allowed service could still admit
+        return Verdict::CheckServices;
+    }
+    else if (hasAllowList && !addressAllowed)
+    {
+        verdict = Verdict::Reject;
+    }
+
+    ++(verdict == Verdict::Accept ? m_Accepted : m_Rejected);
+    return verdict;
+}
+
+bool LuminaIngestFilter::CheckServices(uint64_t address, const std::vector<Lumina::ServiceUuid>& services)
+{
+    std::shared_ptr<const Rules> rules = m_Rules.load();
+    if (!rules)
+    {
+        ++m_Accepted;
+        return true;
+    }
+
+    bool denied = std::any_of(services.begin(), services.end(),
+        [&rules](const Lumina::ServiceUuid& uuid) { return rules->denyServices.ContainsUuid(uuid); });
+
+    bool accepted = !denied;
+    if (accepted && (!rules->allowAddresses.IsEmpty() || !rules->allowServices.IsEmpty()))
+    {
+        accepted = rules->allowAddresses.ContainsAddress(address) ||
+            std::any_of(services.begin(), services.end(),
+                [&rules](const Lumina::ServiceUuid& uuid) { return rules->allowServices.ContainsUuid(uuid); });
+    }
+
+    ++(accepted ? m_Accepted : m_Rejected);
+    return accepted;
+}
+
+bool LuminaIngestFilter::HasRules() const
+{
+    return m_Rules.load() != nullptr;
+}
+
+size_t LuminaIngestFilter::GetRuleCount() const
+{
+    std::shared_ptr<const Rules> rules = m_Rules.load();
+    if (!rules)
+    {
+        return 0;
+    }
+    return rules->allowAddresses.addresses.size() + rules->denyAddresses.addresses.size() +
+        rules->allowServices.uuids.size() + rules->denyServices.uuids.size();
+}
+
+size_t LuminaIngestFilter::GetMemoryBytes() const
+{
+    std::shared_ptr<const Rules> rules = m_Rules.load();
+    if (!rules)
+    {
+        return 0;
+    }
+
+    size_t bytes = sizeof(Rules);
+    for (const KeySet* set : { &rules->allowAddresses, &rules->denyAddresses, &rules->allowServices, &rules->denyServices })
+    {
+        bytes += set->bloom.GetMemoryBytes();
+        bytes += set->addresses.capacity() * sizeof(uint64_t);
+        bytes += set->uuids.capacity() * sizeof(Lumina::ServiceUuid);
+    }
+    return bytes;
+}
+
+void LuminaIngestFilter::ResetCounters()
+{
+    m_Accepted = 0;
+    m_Rejected = 0;
+}
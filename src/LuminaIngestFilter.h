@@ -0,0 +1,96 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <filesystem>
+#include <cstdint>
+#include "LuminaAdvertisement.h"
+
+namespace Lumina
+{
+    // Blocked Bloom filter: every key maps to one 512-bit block, so a lookup touches a single cache line.
+    class BlockedBloomFilter
+    {
+    public:
+        void Build(const std::vector<uint64_t>& keys, int bitsPerKey = 12);
+        bool MayContain(uint64_t key) const;
+        bool IsEmpty() const { return m_Blocks.empty(); }
+        size_t GetMemoryBytes() const { return m_Blocks.size() * sizeof(Block); }
+
+    private:
+        struct alignas(64) Block
+        {
+            uint64_t words[8];
+        };
+        std::vector<Block> m_Blocks;
+    };
+}
+
+// Allow/deny filtering of adverts by address and service UUID, applied before any parsing.
+// Bloom filters reject non-members cheaply; hits are confirmed against sorted exact lists.
+//
+// Rules file, one rule per line ('#' starts a comment):
+//   allow address AA:BB:CC:DD:EE:FF
+//   deny  address AA:BB:CC:DD:EE:FF
+//   allow service 0000180d-0000-1000-8000-00805f9b34fb
+//   deny  service 180d
+class LuminaIngestFilter
+{
+public:
+    enum class Verdict
+    {
+        Accept,
+        Reject,
+        CheckServices // Address alone is not conclusive; call CheckServices with the advert's UUIDs
+    };
+
+    // Loads the rules file if it changed since the last call. A missing file clears all rules.
+    // Returns false and leaves the current rules in place if the file cannot be read or parsed; that
+    // version of the file is then skipped, so each bad edit is reported once.
+    bool ReloadIfChanged(const std::filesystem::path& path, std::string& error);
+
+    Verdict CheckAddress(uint64_t address);
+    bool CheckServices(uint64_t address, const std::vector<Lumina::ServiceUuid>& services);
+
+    bool HasRules() const;
+    size_t GetRuleCount() const;
+    size_t GetMemoryBytes() const;
+    uint64_t GetAcceptedCount() const { return m_Accepted; }
+    uint64_t GetRejectedCount() const { return m_Rejected; }
+    void ResetCounters();
+
+private:
+    struct KeySet
+    {
+        Lumina::BlockedBloomFilter bloom;
+        std::vector<uint64_t> addresses;
+        std::vector<Lumina::ServiceUuid> uuids;
+
+        bool IsEmpty() const { return addresses.empty() && uuids.empty(); }
+        bool ContainsAddress(uint64_t address) const;
+        bool ContainsUuid(const Lumina::ServiceUuid& uuid) const;
+        void Finalize();
+    };
+
+    struct Rules
+    {
+        KeySet allowAddresses;
+        KeySet denyAddresses;
+        KeySet allowServices;
+        KeySet denyServices;
+    };
+
+    std::atomic<std::shared_ptr<const Rules>> m_Rules;
+    std::mutex m_ReloadMutex;
+    std::filesystem::file_time_type m_LastWriteTime{};
+    bool m_FileExisted = false;
+    std::filesystem::file_time_type m_FailedWriteTime{};
+    bool m_HasFailedWriteTime = false;
+
+    std::atomic<uint64_t> m_Accepted = 0;
+    std::atomic<uint64_t> m_Rejected = 0;
+
+    static bool ParseRules(std::istream& input, Rules& rules, std::string& error);
+};
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include "LuminaIntervalEstimator.h"
+
+namespace
+{
+    constexpr std::array<float, LuminaIntervalEstimator::MaxFold + 1> MakeReciprocals()
+    {
+        std::array<float, LuminaIntervalEstimator::MaxFold + 1> reciprocals{};
+        for (int i = 1; i <= LuminaIntervalEstimator::MaxFold; ++i)
+        {
+            reciprocals[i] = 1.0f / static_cast<float>(i);
+        }
+        return reciprocals;
+    }
+    constexpr std::array<float, LuminaIntervalEstimator::MaxFold + 1> Reciprocals = MakeReciprocals();
+
+    // Insertion sort beats nth_element at this size
+    float Median(float* values, int count)
+    {
+        for (int i = 1; i < count; ++i)
+        {
+            float value = values[i];
+            int j = i;
+            for (; j > 0 && values[j - 1] > value; --j)
+            {
+                values[j] = values[j - 1];
+            }
+            values[j] = value;
+        }
+        return values[count / 2];
+    }
+}
+
+void LuminaIntervalEstimator::Add(int64_t timeMicros)
+{
+    if (!m_HasArrival)
+    {
+        m_HasArrival = true;
+        m_LastArrival = timeMicros;
+        return;
+    }
+
+    const int64_t gap = timeMicros - m_LastArrival;
+    if (gap < MinGapMicros)
+    {
+        // Keeps the first copy's time, so duplicates add no bias
+        return;
+    }
+    m_LastArrival = timeMicros;
+
+    // A silence this long is the device out of range, not adverts missed
+    if (m_GapCount >= MinIntervals && static_cast<float>(gap) > m_Median * MaxFold)
+    {
+        return;
+    }
+    m_Gaps[m_NextGap] = static_cast<float>(gap);
+    m_NextGap = static_cast<uint8_t>((m_NextGap + 1) % WindowSize);
+    m_GapCount = static_cast<uint8_t>(std::min<int>(m_GapCount + 1, WindowSize));
+
+    // Once the window is full the interval moves slowly; refreshing it every few adverts keeps Add cheap
+    if (m_GapCount < WindowSize || ++m_SinceRefresh >= RefreshEvery)
+    {
+        m_SinceRefresh = 0;
+        Refresh();
+    }
+
+    const int count = FoldCount(static_cast<float>(gap), m_Median);
+    m_Intervals += static_cast<uint32_t>(count);
+    m_Missed += static_cast<uint32_t>(count - 1);
+}
+
+void LuminaIntervalEstimator::Refresh()
+{
+    // The window keeps raw gaps and is folded afresh each time, so an early guess that was a multiple of the
+    // interval does not stick. The shortest gap is almost always a single interval; when it is well under the
+    // last median, a first fold by it gives a median close enough that folding again counts every gap right.
+    const float shortest = *std::min_element(m_Gaps, m_Gaps + m_GapCount);
+    float base = m_Median;
+    if (!(shortest > base * 0.75f))
+    {
+        base = FoldedMedian(shortest);
+    }
+    m_Median = FoldedMedian(base);
+
+    float values[WindowSize];
+    for (int i = 0; i < m_GapCount; ++i)
+    {
+        values[i] = std::abs(Fold(m_Gaps[i], m_Median) - m_Median);
+    }
+    m_Deviation = Median(values, m_GapCount);
+}
+
+int LuminaIntervalEstimator::FoldCount(float gap, float interval)
+{
+    // Gaps are positive, so adding a half rounds
+    return interval > 0.0f ? std::clamp(static_cast<int>(gap / interval + 0.5f), 1, MaxFold) : 1;
+}
+
+float LuminaIntervalEstimator::Fold(float gap, float interval)
+{
+    return gap * Reciprocals[FoldCount(gap, interval)];
+}
+
+float LuminaIntervalEstimator::FoldedMedian(float interval) const
+{
+    float values[WindowSize];
+    for (int i = 0; i < m_GapCount; ++i)
+    {
+        values[i] = Fold(m_Gaps[i], interval);
+    }
+    return Median(values, m_GapCount);
+}
+
+LuminaIntervalEstimator::Estimate LuminaIntervalEstimator::GetEstimate() const
+{
+    Estimate estimate;
+    estimate.intervals = m_Intervals;
+    if (m_GapCount < MinIntervals)
+    {
+        return estimate;
+    }
+    estimate.isValid = true;
+    estimate.intervalMs = m_Median / 1000.0f;
+    estimate.jitterMs = m_Deviation / 1000.0f;
+    estimate.missedRatio = static_cast<float>(m_Missed) / static_cast<float>(m_Intervals);
+    return estimate;
+}
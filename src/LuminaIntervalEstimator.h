@@ -0,0 +1,58 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+// Estimates a device's advertising interval and jitter from the arrival times of its adverts. Keeps the last
+// WindowSize inter-arrival times and takes their median and median absolute deviation, which a burst of odd
+// gaps cannot drag around the way a mean would. A gap close to a whole number of intervals is counted as that
+// many intervals with the adverts between them missed, so lost packets neither stretch the interval nor
+// inflate the jitter. Fixed size, no allocation, and a bounded amount of work per Add.
+//
+// Arrivals include the controller's random advDelay of 0-10 ms per event, so a device configured for T
+// shows an interval of about T + 5 ms and a jitter of about 2.5 ms.
+//
+// Not thread-safe.
+class LuminaIntervalEstimator
+{
+public:
+    static constexpr int WindowSize = 15;
+    static constexpr int MinIntervals = 5;          // Before an estimate is reported
+    static constexpr int64_t MinGapMicros = 15000;  // Shorter than the smallest legal interval: the same advert seen twice
+    static constexpr int MaxFold = 64;              // Longer silences are out of range, not missed adverts
+    static constexpr int RefreshEvery = 8;          // Adverts between recomputing the median once the window is full
+
+    struct Estimate
+    {
+        bool isValid = false;
+        float intervalMs = 0.0f;    // Median inter-arrival time
+        float jitterMs = 0.0f;      // Median absolute deviation from it
+        float missedRatio = 0.0f;   // Share of the device's adverts that were not received
+        uint32_t intervals = 0;     // Inter-arrival times measured, missed adverts included
+    };
+
+    // Arrivals must be in order. Scan responses and fragments are not adverts of their own; leave them out.
+    void Add(int64_t timeMicros);
+    void Add(std::chrono::steady_clock::time_point time)
+    {
+        Add(std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count());
+    }
+
+    Estimate GetEstimate() const;
+
+private:
+    float m_Gaps[WindowSize] = {};  // Ring of raw inter-arrival times, microseconds
+    uint8_t m_GapCount = 0;
+    uint8_t m_NextGap = 0;
+    uint8_t m_SinceRefresh = 0;
+    bool m_HasArrival = false;
+    int64_t m_LastArrival = 0;
+    float m_Median = 0.0f;
+    float m_Deviation = 0.0f;
+    uint32_t m_Intervals = 0;
+    uint32_t m_Missed = 0;
+
+    void Refresh();
+    static int FoldCount(float gap, float interval);
+    static float Fold(float gap, float interval);
+    float FoldedMedian(float interval) const;
+};
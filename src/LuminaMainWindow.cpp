@@ -2,6 +2,11 @@
 #include "LuminaMainWindow.h"
 #include "LuminaHelper.h"
 
+LuminaMainWindow::LuminaMainWindow(LuminaStartupProfile& startupProfile)
+	: m_StartupProfile(startupProfile)
+	, m_DeviceManager(startupProfile)
+{
+}
 
 void LuminaMainWindow::ApplyImGuiStyle()
 {
@@ -85,12 +90,24 @@ void LuminaMainWindow::ApplyImGuiStyle()
 	config.SizePixels = 14.0f;
 	io.Fonts->AddFontDefault(&config);
 
-	// Load Ruda-Bold.ttf from the resources folder and set as default
-	ImFont* rudaFont = io.Fonts->AddFontFromFileTTF("../resources/Ruda-Bold.ttf", 18.0f, nullptr, io.Fonts->GetGlyphRangesDefault());
-	if (rudaFont)
+	// Ruda-Bold.ttf and its atlas cache are read in the background; the font becomes the default once they are
+	m_StartupProfile.Begin("Font baking");
+	m_FontLoader.Start(LuminaFontLoader::FindResource("Ruda-Bold.ttf"), 18.0f, 14.0f, LuminaConfig::FontCachePath, &m_StartupProfile);
+}
+
+bool LuminaMainWindow::ApplyPendingFonts()
+{
+	if (!m_FontLoader.IsLoading())
+	{
+		return false;
+	}
+
+	bool rebuilt = m_FontLoader.ApplyIfReady();
+	if (!m_FontLoader.IsLoading())
 	{
-		io.FontDefault = rudaFont;
+		m_StartupProfile.End("Font baking");
 	}
+	return rebuilt;
 }
 
 void LuminaMainWindow::Render()
@@ -105,9 +122,30 @@ void LuminaMainWindow::Render()
 	{
 		if (ImGui::BeginMenu("File"))
 		{
-			ImGui::MenuItem("New");
-			ImGui::MenuItem("Open...");
-			ImGui::MenuItem("Save");
+			// Known device registry: New clears it, Open reloads it from disk, Save syncs it now
+			if (ImGui::MenuItem("New"))
+			{
+				m_DeviceManager.NewRegistry();
+			}
+			if (ImGui::MenuItem("Open"))
+			{
+				m_DeviceManager.OpenRegistry();
+			}
+			if (ImGui::MenuItem("Save"))
+			{
+				m_DeviceManager.SaveRegistry();
+			}
+			ImGui::Separator();
+			bool isExportEnabled = m_DeviceManager.GetIsScanExportEnabled();
+			if (ImGui::MenuItem("Export Scan Sessions", nullptr, &isExportEnabled))
+			{
+				m_DeviceManager.SetScanExportEnabled(isExportEnabled);
+			}
+			bool isAddressLinkingEnabled = m_DeviceManager.GetIsAddressLinkingEnabled();
+			if (ImGui::MenuItem("Link Rotating Addresses", nullptr, &isAddressLinkingEnabled))
+			{
+				m_DeviceManager.SetAddressLinkingEnabled(isAddressLinkingEnabled);
+			}
 			ImGui::EndMenu();
 		}
 
@@ -138,10 +176,20 @@ void LuminaMainWindow::Render()
 			m_DeviceManager.Render();
 			ImGui::EndTabItem();
 		}
+		if (ImGui::BeginTabItem("Discovery Latency"))
+		{
+			m_DeviceManager.RenderLatency();
+			ImGui::EndTabItem();
+		}
+		if (ImGui::BeginTabItem("Waterfall"))
+		{
+			m_DeviceManager.RenderWaterfall();
+			ImGui::EndTabItem();
+		}
 		
 		ImGui::EndTabBar();
 	}
 	ImGui::End();
 
-	m_About.Render();
+	m_About.Render(m_StartupProfile);
 } 
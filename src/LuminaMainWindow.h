@@ -2,15 +2,23 @@
 
 #include "LuminaDeviceManagerViewModel.h"
 #include "LuminaAbout.h"
+#include "LuminaFontLoader.h"
+#include "LuminaStartupProfile.h"
 
 class LuminaMainWindow
 {
 public:
+    explicit LuminaMainWindow(LuminaStartupProfile& startupProfile);
+
     void Render();
     void ApplyImGuiStyle();
+    // Call between frames. Returns true when the renderer's font texture must be recreated.
+    bool ApplyPendingFonts();
 
 private:
 
+    LuminaStartupProfile& m_StartupProfile;
     LuminaDeviceManagerViewModel m_DeviceManager;
     LuminaAbout m_About;
+    LuminaFontLoader m_FontLoader;
 };
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "LuminaMappedFile.h"
+
+LuminaMappedFile::LuminaMappedFile(const std::filesystem::path& path)
+{
+#ifdef _WIN32
+    m_File = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_File == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_File, &size) || size.QuadPart == 0)
+    {
+        return;
+    }
+    m_Mapping = CreateFileMappingW(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_Mapping)
+    {
+        return;
+    }
+    m_Data = MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+    m_Size = m_Data ? static_cast<size_t>(size.QuadPart) : 0;
+#else
+    m_File = open(path.c_str(), O_RDONLY);
+    if (m_File < 0)
+    {
+        return;
+    }
+    struct stat info;
+    if (fstat(m_File, &info) != 0 || info.st_size == 0)
+    {
+        return;
+    }
+    void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, m_File, 0);
+    if (data != MAP_FAILED)
+    {
+        m_Data = data;
+        m_Size = static_cast<size_t>(info.st_size);
+    }
+#endif
+}
+
+LuminaMappedFile::~LuminaMappedFile()
+{
+#ifdef _WIN32
+    if (m_Data) UnmapViewOfFile(m_Data);
+    if (m_Mapping) CloseHandle(m_Mapping);
+    if (m_File != INVALID_HANDLE_VALUE) CloseHandle(m_File);
+#else
+    if (m_Data) munmap(m_Data, m_Size);
+    if (m_File >= 0) close(m_File);
+#endif
+}
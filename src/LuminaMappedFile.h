@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// Read-only view of a whole file, unmapped on destruction. Empty if the file is missing or empty.
+class LuminaMappedFile
+{
+public:
+    explicit LuminaMappedFile(const std::filesystem::path& path);
+    ~LuminaMappedFile();
+    LuminaMappedFile(const LuminaMappedFile&) = delete;
+    LuminaMappedFile& operator=(const LuminaMappedFile&) = delete;
+
+    const uint8_t* GetData() const { return static_cast<const uint8_t*>(m_Data); }
+    size_t GetSize() const { return m_Size; }
+
+private:
+#ifdef _WIN32
+    void* m_File;
+    void* m_Mapping = nullptr;
+#else
+    int m_File = -1;
+#endif
+    void* m_Data = nullptr;
+    size_t m_Size = 0;
+};
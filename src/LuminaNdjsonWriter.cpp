@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#endif
+#include "LuminaNdjsonWriter.h"
+#include "LuminaHelper.h"
+
+namespace
+{
+    // The GUI build links as a Windows-subsystem executable, so stdout is not bound to anything by default
+    FILE* OpenStdout()
+    {
+#ifdef _WIN32
+        HANDLE handle = GetStdHandle(STD_OUTPUT_HANDLE);
+        if (handle == nullptr || handle == INVALID_HANDLE_VALUE)
+        {
+            // Not redirected: write to the console we were started from, if any
+            if (AttachConsole(ATTACH_PARENT_PROCESS))
+            {
+                FILE* ignored = nullptr;
+                freopen_s(&ignored, "CONOUT$", "w", stdout);
+                freopen_s(&ignored, "CONOUT$", "w", stderr);
+            }
+            return stdout;
+        }
+        if (_fileno(stdout) < 0)
+        {
+            // Redirected to a pipe or file, but the CRT did not pick the handle up
+            int fd = _open_osfhandle(reinterpret_cast<intptr_t>(handle), _O_WRONLY | _O_BINARY);
+            if (fd >= 0)
+            {
+                FILE* stream = _fdopen(fd, "wb");
+                if (stream)
+                {
+                    return stream;
+                }
+            }
+        }
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        return stdout;
+    }
+}
+
+LuminaNdjsonWriter::LuminaNdjsonWriter()
+{
+}
+
+LuminaNdjsonWriter::~LuminaNdjsonWriter()
+{
+    Close();
+}
+
+bool LuminaNdjsonWriter::Open(const std::string& path, std::chrono::milliseconds flushInterval, std::string& error)
+{
+    Close();
+
+    if (path == "-")
+    {
+        m_Stream = OpenStdout();
+        m_OwnsStream = false;
+    }
+    else
+    {
+        m_Stream = std::fopen(path.c_str(), "ab");
+        m_OwnsStream = true;
+    }
+
+    if (!m_Stream)
+    {
+        error = "Failed to open output '" + path + "': " + std::strerror(errno);
+        return false;
+    }
+
+    // The flush thread batches writes, so the stream itself needs no buffering of its own
+    std::setvbuf(m_Stream, nullptr, _IONBF, 0);
+
+    m_FlushInterval = std::max(flushInterval, std::chrono::milliseconds(1));
+    m_LineCount = 0;
+    m_StopRequested = false;
+    m_IsOpen = true;
+    m_FlushThread = std::thread(&LuminaNdjsonWriter::FlushLoop, this);
+    return true;
+}
+
+void LuminaNdjsonWriter::Close()
+{
+    if (m_FlushThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_BufferMutex);
+            m_IsOpen = false;
+            m_StopRequested = true;
+        }
+        m_Wake.notify_one();
+        m_FlushThread.join();
+    }
+
+    if (m_Stream && m_OwnsStream)
+    {
+        std::fclose(m_Stream);
+    }
+    m_Stream = nullptr;
+    m_OwnsStream = false;
+}
+
+void LuminaNdjsonWriter::WriteLine(std::string_view line)
+{
+    bool flushEarly = false;
+    {
+        std::lock_guard<std::mutex> lock(m_BufferMutex);
+        if (!m_IsOpen)
+        {
+            return;
+        }
+        m_Buffer.append(line);
+        m_Buffer.push_back('\n');
+        flushEarly = m_Buffer.size() >= EarlyFlushBytes;
+    }
+    ++m_LineCount;
+
+    if (flushEarly)
+    {
+        m_Wake.notify_one();
+    }
+}
+
+void LuminaNdjsonWriter::AppendString(std::string& out, std::string_view value)
+{
+    static constexpr char Hex[] = "0123456789abcdef";
+
+    // JSON text must be UTF-8; bytes that are not become U+FFFD rather than breaking the reader
+    std::string repaired;
+    if (!LuminaHelper::IsValidUtf8(value))
+    {
+        repaired.assign(value);
+        LuminaHelper::ReplaceInvalidUtf8(repaired);
+        value = repaired;
+    }
+
+    out.push_back('"');
+    for (char c : value)
+    {
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                out += "\\u00";
+                out.push_back(Hex[(c >> 4) & 0xF]);
+                out.push_back(Hex[c & 0xF]);
+            }
+            else
+            {
+                out.push_back(c);
+            }
+            break;
+        }
+    }
+    out.push_back('"');
+}
+
+void LuminaNdjsonWriter::FlushLoop()
+{
+    while (true)
+    {
+        bool stopping = false;
+        {
+            std::unique_lock<std::mutex> lock(m_BufferMutex);
+            m_Wake.wait_for(lock, m_FlushInterval, [this] { return m_StopRequested.load() || m_Buffer.size() >= EarlyFlushBytes; });
+            stopping = m_StopRequested;
+        }
+        FlushBuffer();
+        if (stopping)
+        {
+            break;
+        }
+    }
+}
+
+void LuminaNdjsonWriter::FlushBuffer()
+{
+    std::string pending;
+    {
+        std::lock_guard<std::mutex> lock(m_BufferMutex);
+        pending.swap(m_Buffer);
+    }
+
+    // Written outside the lock so producers never wait on a slow pipe
+    if (!pending.empty() && m_Stream)
+    {
+        std::fwrite(pending.data(), 1, pending.size(), m_Stream);
+    }
+}
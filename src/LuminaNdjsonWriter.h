@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Buffered newline-delimited JSON output. Lines are appended to an in-memory buffer from any thread
+// and written out by a flush thread every flush interval, or sooner once the buffer grows large.
+class LuminaNdjsonWriter
+{
+public:
+    LuminaNdjsonWriter();
+    ~LuminaNdjsonWriter();
+    LuminaNdjsonWriter(const LuminaNdjsonWriter&) = delete;
+    LuminaNdjsonWriter& operator=(const LuminaNdjsonWriter&) = delete;
+
+    // "-" writes to stdout, anything else is appended to as a file
+    bool Open(const std::string& path, std::chrono::milliseconds flushInterval, std::string& error);
+    void Close();
+
+    // Thread-safe; the line must not contain a trailing newline
+    void WriteLine(std::string_view line);
+    uint64_t GetLineCount() const { return m_LineCount; }
+
+    // Appends value as a quoted JSON string; invalid UTF-8 is replaced with U+FFFD
+    static void AppendString(std::string& out, std::string_view value);
+
+private:
+    static constexpr size_t EarlyFlushBytes = 1 << 20;
+
+    FILE* m_Stream = nullptr;
+    bool m_OwnsStream = false;
+    std::chrono::milliseconds m_FlushInterval{ 250 };
+
+    std::string m_Buffer;
+    std::mutex m_BufferMutex;
+    std::condition_variable m_Wake;
+    std::thread m_FlushThread;
+    std::atomic<bool> m_StopRequested = false;
+    bool m_IsOpen = false; // Guarded by m_BufferMutex
+    std::atomic<uint64_t> m_LineCount = 0;
+
+    void FlushLoop();
+    void FlushBuffer();
+};
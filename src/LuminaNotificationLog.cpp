@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <ctime>
+#include <imgui.h>
+#include "LuminaNotificationLog.h"
+
+namespace
+{
+    ImVec4 SeverityColor(Lumina::Severity severity)
+    {
+        switch (severity)
+        {
+        case Lumina::Severity::Error: return ImVec4(1.0f, 0.4f, 0.4f, 1.0f);
+        case Lumina::Severity::Warning: return ImVec4(1.0f, 1.0f, 0.0f, 1.0f);
+        default: return ImVec4(0.7f, 0.7f, 0.7f, 1.0f);
+        }
+    }
+}
+
+LuminaNotificationLog::LuminaNotificationLog()
+    : m_Entries(Capacity)
+{
+}
+
+bool LuminaNotificationLog::Add(const Lumina::NotificationEvent& event)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto inserted = m_Sources.try_emplace(event.source);
+    SourceState& state = inserted.first->second;
+    if (inserted.second)
+    {
+        state.lastRefill = now;
+    }
+    double elapsed = std::chrono::duration<double>(now - state.lastRefill).count();
+    state.tokens = std::min(BurstSize, state.tokens + elapsed * RefillPerSecond);
+    state.lastRefill = now;
+
+    // A burst of like messages folds into the source's latest line without spending its budget
+    Entry* last = FindLive(state.lastSequence);
+    if (last && !state.isLastSuppression && !event.summary.empty() && last->summary == event.summary &&
+        last->severity == event.severity && now - last->lastUpdate <= CoalesceWindow)
+    {
+        ++last->count;
+        last->lastUpdate = now;
+        last->time = std::chrono::system_clock::now();
+        return false;
+    }
+
+    // Errors are never dropped
+    if (event.severity != Lumina::Severity::Error)
+    {
+        if (state.tokens < 1.0)
+        {
+            ++m_SuppressedCount;
+            if (last && state.isLastSuppression)
+            {
+                ++last->count;
+                last->lastUpdate = now;
+                return false;
+            }
+            Entry& entry = Append(now, Lumina::Severity::Info, event.source);
+            entry.summary = "message(s) suppressed";
+            state.lastSequence = entry.sequence;
+            state.isLastSuppression = true;
+            return false;
+        }
+        state.tokens -= 1.0;
+    }
+
+    Entry& entry = Append(now, event.severity, event.source);
+    entry.message = event.message;
+    entry.summary = event.summary;
+    state.lastSequence = entry.sequence;
+    state.isLastSuppression = false;
+    return true;
+}
+
+void LuminaNotificationLog::Clear()
+{
+    m_FirstSequence = m_NextSequence;
+    m_SuppressedCount = 0;
+}
+
+LuminaNotificationLog::Entry* LuminaNotificationLog::FindLive(uint64_t sequence)
+{
+    if (sequence < m_FirstSequence || sequence >= m_NextSequence)
+    {
+        return nullptr;
+    }
+    return &m_Entries[sequence % Capacity];
+}
+
+LuminaNotificationLog::Entry& LuminaNotificationLog::Append(std::chrono::steady_clock::time_point now, Lumina::Severity severity, const std::string& source)
+{
+    // Full: the oldest line gives up its slot
+    if (GetSize() == Capacity)
+    {
+        ++m_FirstSequence;
+    }
+    Entry& entry = m_Entries[m_NextSequence % Capacity];
+    entry.sequence = m_NextSequence++;
+    entry.time = std::chrono::system_clock::now();
+    entry.lastUpdate = now;
+    entry.severity = severity;
+    entry.source = source;
+    entry.message.clear();
+    entry.summary.clear();
+    entry.count = 1;
+    return entry;
+}
+
+void LuminaNotificationLog::Render(float height)
+{
+    ImGui::Text("Notifications");
+    if (m_SuppressedCount > 0)
+    {
+        ImGui::SameLine();
+        ImGui::TextDisabled("(%llu suppressed)", static_cast<unsigned long long>(m_SuppressedCount));
+    }
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Clear##Notifications"))
+    {
+        Clear();
+    }
+
+    ImGui::BeginChild("NotificationLog", ImVec2(0, height), true);
+    bool isAtBottom = ImGui::GetScrollY() >= ImGui::GetScrollMaxY();
+
+    // Only the visible lines are laid out, however long the log is
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(GetSize()));
+    while (clipper.Step())
+    {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+        {
+            const Entry& entry = GetEntry(static_cast<size_t>(i));
+            std::time_t time = std::chrono::system_clock::to_time_t(entry.time);
+            std::tm local{};
+#ifdef _WIN32
+            localtime_s(&local, &time);
+#else
+            localtime_r(&time, &local);
+#endif
+            ImGui::TextDisabled("%02d:%02d:%02d", local.tm_hour, local.tm_min, local.tm_sec);
+            ImGui::SameLine();
+            ImGui::TextColored(SeverityColor(entry.severity), "[%s]", entry.source.c_str());
+            ImGui::SameLine();
+            if (entry.count > 1 || entry.message.empty())
+            {
+                ImGui::Text("%u %s", entry.count, entry.summary.c_str());
+            }
+            else
+            {
+                ImGui::TextUnformatted(entry.message.c_str());
+            }
+        }
+    }
+
+    // Follow new lines unless the user scrolled up to read
+    if (isAtBottom && m_RenderedSequence != m_NextSequence)
+    {
+        ImGui::SetScrollHereY(1.0f);
+    }
+    m_RenderedSequence = m_NextSequence;
+    ImGui::EndChild();
+}
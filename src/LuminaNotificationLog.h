@@ -0,0 +1,64 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "LuminaEventBus.h"
+
+// Bounded history of user-facing notifications, shown as a scrollable panel. Each source gets a small
+// burst of messages and then a steady rate; anything over it is counted into one "N messages suppressed"
+// line. Messages with a summary fold into the previous one from the same source ("37 devices found").
+// Not thread-safe; feed it from the UI thread.
+class LuminaNotificationLog
+{
+public:
+    static constexpr size_t Capacity = 512;
+    static constexpr double BurstSize = 5.0;
+    static constexpr double RefillPerSecond = 1.0;
+    static constexpr std::chrono::seconds CoalesceWindow{ 2 };
+
+    struct Entry
+    {
+        uint64_t sequence = 0;
+        std::chrono::system_clock::time_point time;
+        std::chrono::steady_clock::time_point lastUpdate;
+        Lumina::Severity severity = Lumina::Severity::Info;
+        std::string source;
+        std::string message;
+        std::string summary;
+        uint32_t count = 0;         // Shown as "<count> <summary>" once above 1, or when there is no message
+    };
+
+    LuminaNotificationLog();
+
+    // Returns false if the message was coalesced or rate limited instead of getting its own line
+    bool Add(const Lumina::NotificationEvent& event);
+    void Clear();
+
+    size_t GetSize() const { return static_cast<size_t>(m_NextSequence - m_FirstSequence); }
+    // 0 is the oldest entry still held
+    const Entry& GetEntry(size_t index) const { return m_Entries[(m_FirstSequence + index) % Capacity]; }
+    uint64_t GetSuppressedCount() const { return m_SuppressedCount; }
+
+    void Render(float height);
+
+private:
+    struct SourceState
+    {
+        double tokens = BurstSize;
+        std::chrono::steady_clock::time_point lastRefill;
+        uint64_t lastSequence = 0;      // Latest entry from this source; 0 if none
+        bool isLastSuppression = false;
+    };
+
+    std::vector<Entry> m_Entries;
+    uint64_t m_FirstSequence = 1;
+    uint64_t m_NextSequence = 1;
+    std::unordered_map<std::string, SourceState> m_Sources;
+    uint64_t m_SuppressedCount = 0;
+    uint64_t m_RenderedSequence = 0;   // Newest entry at the last Render, to follow new lines
+
+    Entry* FindLive(uint64_t sequence);
+    Entry& Append(std::chrono::steady_clock::time_point now, Lumina::Severity severity, const std::string& source);
+};
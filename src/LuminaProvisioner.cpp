@@ -0,0 +1,341 @@
+#include <algorithm>
+#include <cctype>
+#include <ctime>
+#include <fstream>
+#include "LuminaProvisioner.h"
+#include "LuminaHelper.h"
+
+namespace
+{
+    double Seconds(std::chrono::steady_clock::duration duration)
+    {
+        return std::chrono::duration<double>(duration).count();
+    }
+}
+
+namespace Lumina
+{
+    bool ParseGattConfigWrite(const std::string& text, GattConfigWrite& write)
+    {
+        size_t first = text.find('/');
+        size_t second = first == std::string::npos ? std::string::npos : text.find('/', first + 1);
+        if (second == std::string::npos)
+        {
+            return false;
+        }
+        return LuminaHelper::ParseServiceUuid(text.substr(0, first), write.service) &&
+            LuminaHelper::ParseServiceUuid(text.substr(first + 1, second - first - 1), write.characteristic) &&
+            LuminaHelper::ParseHexBytes(text.substr(second + 1), write.value);
+    }
+}
+
+const char* LuminaProvisioner::GetUnitStateName(UnitState state)
+{
+    switch (state)
+    {
+    case UnitState::Waiting: return "waiting";
+    case UnitState::Queued: return "queued";
+    case UnitState::Pairing: return "pairing";
+    case UnitState::Configuring: return "configuring";
+    case UnitState::RetryWait: return "retry_wait";
+    case UnitState::Succeeded: return "succeeded";
+    case UnitState::Failed: return "failed";
+    }
+    return "";
+}
+
+bool LuminaProvisioner::LoadAddressList(const std::filesystem::path& path, std::vector<uint64_t>& addresses, std::string& error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "Cannot read " + path.string();
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        line.erase(std::remove_if(line.begin(), line.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); }), line.end());
+        if (line.empty())
+        {
+            continue;
+        }
+        uint64_t address = 0;
+        if (!LuminaHelper::ParseBluetoothAddress(line, address))
+        {
+            error = path.string() + ":" + std::to_string(lineNumber) + ": not a Bluetooth address";
+            return false;
+        }
+        addresses.push_back(address);
+    }
+    return true;
+}
+
+LuminaProvisioner::LuminaProvisioner(LuminaProvisioningTransport& transport, const Options& options)
+    : m_Transport(transport)
+    , m_Options(options)
+{
+    m_Options.maxInFlight = std::max(m_Options.maxInFlight, 1);
+    m_Options.maxAttempts = std::max(m_Options.maxAttempts, 1);
+    for (uint64_t address : m_Options.addresses)
+    {
+        if (m_UnitIndex.emplace(address, m_Units.size()).second)
+        {
+            Unit unit;
+            unit.address = address;
+            m_Units.push_back(unit);
+        }
+    }
+}
+
+void LuminaProvisioner::OnDeviceSeen(uint64_t address, const std::string& name, int16_t rssi)
+{
+    auto it = m_UnitIndex.find(address);
+    if (it == m_UnitIndex.end())
+    {
+        bool isFilterMode = m_Options.addresses.empty();
+        bool isFull = m_Options.unitLimit > 0 && m_Units.size() >= static_cast<size_t>(m_Options.unitLimit);
+        if (!isFilterMode || isFull || rssi < m_Options.minRssi || name.compare(0, m_Options.namePrefix.size(), m_Options.namePrefix) != 0)
+        {
+            return;
+        }
+        it = m_UnitIndex.emplace(address, m_Units.size()).first;
+        Unit unit;
+        unit.address = address;
+        m_Units.push_back(unit);
+    }
+
+    Unit& unit = m_Units[it->second];
+    if (!name.empty())
+    {
+        unit.name = name;
+    }
+    unit.rssi = rssi;
+    if (unit.state == UnitState::Waiting)
+    {
+        unit.state = UnitState::Queued;
+        m_Ready.push_back(it->second);
+    }
+}
+
+void LuminaProvisioner::Poll(std::vector<Unit>& finished)
+{
+    std::vector<Completed> completed;
+    {
+        std::lock_guard<std::mutex> lock(m_Inbox->mutex);
+        completed.swap(m_Inbox->completed);
+    }
+    for (const Completed& result : completed)
+    {
+        const Unit& unit = m_Units[result.unit];
+        bool isCurrent = unit.step == result.step && (unit.state == UnitState::Pairing || unit.state == UnitState::Configuring);
+        if (isCurrent)
+        {
+            CompleteStep(result.unit, result.error, finished);
+        }
+    }
+
+    // Timed-out steps fail their attempt; the transport's late completion will be ignored
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < m_Units.size(); ++i)
+    {
+        Unit& unit = m_Units[i];
+        if ((unit.state == UnitState::Pairing || unit.state == UnitState::Configuring) && now >= unit.deadline)
+        {
+            CompleteStep(i, std::string(GetUnitStateName(unit.state)) + " timed out", finished);
+        }
+        else if (unit.state == UnitState::RetryWait && now >= unit.deadline)
+        {
+            // Retries go ahead of fresh units so one flaky unit does not wait out the whole batch
+            unit.state = UnitState::Queued;
+            m_Ready.push_front(i);
+        }
+    }
+
+    while (m_InFlight < m_Options.maxInFlight && !m_Ready.empty())
+    {
+        size_t index = m_Ready.front();
+        m_Ready.pop_front();
+        Unit& unit = m_Units[index];
+        if (unit.attempts == 0)
+        {
+            unit.startTime = now;
+            if (m_StartTime == std::chrono::steady_clock::time_point())
+            {
+                m_StartTime = now;
+            }
+        }
+        ++unit.attempts;
+        // A unit that paired but failed its write only retries the write
+        StartStep(index, unit.isPaired && m_Options.configWrite ? UnitState::Configuring : UnitState::Pairing);
+    }
+}
+
+bool LuminaProvisioner::IsComplete() const
+{
+    if (m_Options.addresses.empty())
+    {
+        return m_Options.unitLimit > 0 && m_Finished >= static_cast<size_t>(m_Options.unitLimit);
+    }
+    return m_Finished == m_Units.size();
+}
+
+LuminaProvisioner::Report LuminaProvisioner::GetReport() const
+{
+    Report report;
+    report.unitCount = m_Units.size();
+    report.retries = m_Retries;
+    double unitSeconds = 0.0;
+    for (const Unit& unit : m_Units)
+    {
+        if (unit.state == UnitState::Succeeded)
+        {
+            ++report.succeeded;
+            unitSeconds += Seconds(unit.finishTime - unit.startTime);
+        }
+        else if (unit.state == UnitState::Failed)
+        {
+            ++report.failed;
+        }
+    }
+
+    if (m_StartTime != std::chrono::steady_clock::time_point())
+    {
+        auto end = IsComplete() ? m_LastFinishTime : std::chrono::steady_clock::now();
+        report.elapsedSeconds = Seconds(end - m_StartTime);
+    }
+    if (report.elapsedSeconds > 0.0)
+    {
+        report.unitsPerMinute = report.succeeded * 60.0 / report.elapsedSeconds;
+    }
+    if (report.succeeded > 0)
+    {
+        report.meanUnitSeconds = unitSeconds / report.succeeded;
+    }
+    return report;
+}
+
+bool LuminaProvisioner::ExportCsv(const std::filesystem::path& directory, std::filesystem::path& writtenPath, std::string& error) const
+{
+    std::time_t now = std::time(nullptr);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    char name[48];
+    std::strftime(name, sizeof(name), "provision-%Y%m%d-%H%M%S.csv", &local);
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    writtenPath = directory / name;
+    std::ofstream file(writtenPath);
+    if (!file)
+    {
+        error = "Cannot write " + writtenPath.string();
+        return false;
+    }
+
+    file << "address,name,rssi,result,attempts,seconds,error\n";
+    for (const Unit& unit : m_Units)
+    {
+        bool isFinished = unit.state == UnitState::Succeeded || unit.state == UnitState::Failed;
+        std::string unitName = unit.name;
+        std::replace(unitName.begin(), unitName.end(), ',', ' ');
+        std::string unitError = unit.state == UnitState::Succeeded ? std::string() : unit.lastError;
+        std::replace(unitError.begin(), unitError.end(), ',', ' ');
+        file << LuminaHelper::BluetoothAddressToString(unit.address) << "," << unitName << "," << unit.rssi << ","
+            << GetUnitStateName(unit.state) << "," << unit.attempts << ","
+            << (isFinished && unit.attempts > 0 ? Seconds(unit.finishTime - unit.startTime) : 0.0) << "," << unitError << "\n";
+    }
+
+    Report report = GetReport();
+    file << "# succeeded=" << report.succeeded << " failed=" << report.failed << " retries=" << report.retries
+        << " elapsed_s=" << report.elapsedSeconds << " units_per_minute=" << report.unitsPerMinute << "\n";
+    if (!file)
+    {
+        error = "Failed writing " + writtenPath.string();
+        return false;
+    }
+    return true;
+}
+
+void LuminaProvisioner::StartStep(size_t index, UnitState state)
+{
+    Unit& unit = m_Units[index];
+    unit.state = state;
+    unit.deadline = std::chrono::steady_clock::now() + m_Options.stepTimeout;
+    ++unit.step;
+    ++m_InFlight;
+
+    // The transport may complete inline; the completion only posts to the inbox
+    if (state == UnitState::Pairing)
+    {
+        m_Transport.Pair(unit.address, MakeCompletion(index));
+    }
+    else
+    {
+        m_Transport.WriteConfig(unit.address, *m_Options.configWrite, MakeCompletion(index));
+    }
+}
+
+void LuminaProvisioner::CompleteStep(size_t index, const std::string& error, std::vector<Unit>& finished)
+{
+    Unit& unit = m_Units[index];
+    --m_InFlight;
+    ++unit.step;
+
+    if (error.empty())
+    {
+        if (unit.state == UnitState::Pairing)
+        {
+            unit.isPaired = true;
+            if (m_Options.configWrite)
+            {
+                StartStep(index, UnitState::Configuring);
+                return;
+            }
+        }
+        Finish(index, UnitState::Succeeded, finished);
+        return;
+    }
+
+    unit.lastError = error;
+    if (unit.attempts >= m_Options.maxAttempts)
+    {
+        Finish(index, UnitState::Failed, finished);
+        return;
+    }
+    ++m_Retries;
+    unit.state = UnitState::RetryWait;
+    unit.deadline = std::chrono::steady_clock::now() + m_Options.retryDelay * (1 << std::min(unit.attempts - 1, 10));
+}
+
+void LuminaProvisioner::Finish(size_t index, UnitState state, std::vector<Unit>& finished)
+{
+    Unit& unit = m_Units[index];
+    unit.state = state;
+    unit.finishTime = std::chrono::steady_clock::now();
+    m_LastFinishTime = unit.finishTime;
+    ++m_Finished;
+    finished.push_back(unit);
+}
+
+LuminaProvisioningTransport::Completion LuminaProvisioner::MakeCompletion(size_t index)
+{
+    std::weak_ptr<Inbox> inbox = m_Inbox;
+    uint32_t step = m_Units[index].step;
+    return [inbox, index, step](const std::string& error)
+        {
+            if (auto target = inbox.lock())
+            {
+                std::lock_guard<std::mutex> lock(target->mutex);
+                target->completed.push_back({ index, step, error });
+            }
+        };
+}
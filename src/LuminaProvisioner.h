@@ -0,0 +1,151 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "LuminaAdvertisement.h"
+
+namespace Lumina
+{
+    // Value written to one GATT characteristic once a unit is paired
+    struct GattConfigWrite
+    {
+        ServiceUuid service;
+        ServiceUuid characteristic;
+        std::vector<uint8_t> value;
+    };
+
+    // "<service>/<characteristic>/<hex bytes>", UUIDs in full or as 16/32-bit aliases
+    bool ParseGattConfigWrite(const std::string& text, GattConfigWrite& write);
+}
+
+// The radio side of provisioning. Operations may complete on any thread, but must call their
+// completion exactly once; an empty error means success.
+class LuminaProvisioningTransport
+{
+public:
+    using Completion = std::function<void(const std::string& error)>;
+
+    virtual ~LuminaProvisioningTransport() = default;
+    virtual void Pair(uint64_t address, Completion completion) = 0;
+    virtual void WriteConfig(uint64_t address, const Lumina::GattConfigWrite& write, Completion completion) = 0;
+};
+
+// Pairs and configures a batch of units: discovered units queue up, at most maxInFlight are being
+// paired or written at once, and failed steps are retried with backoff. All methods are called from
+// one owner thread; only the transport's completions arrive elsewhere, and they are picked up by Poll.
+class LuminaProvisioner
+{
+public:
+    struct Options
+    {
+        std::vector<uint64_t> addresses;    // Units to provision; empty takes any device matching the filter
+        std::string namePrefix;             // Filter mode only
+        int minRssi = -127;                 // Filter mode only
+        int unitLimit = 0;                  // Filter mode: stop taking units after this many (0 = no limit)
+        std::optional<Lumina::GattConfigWrite> configWrite;
+        int maxInFlight = 4;
+        int maxAttempts = 3;
+        std::chrono::milliseconds retryDelay{ 1000 };   // Doubled after each failed attempt
+        std::chrono::milliseconds stepTimeout{ 30000 };
+    };
+
+    enum class UnitState : uint8_t
+    {
+        Waiting,        // Listed but not seen yet
+        Queued,
+        Pairing,
+        Configuring,
+        RetryWait,
+        Succeeded,
+        Failed,
+    };
+    static const char* GetUnitStateName(UnitState state);
+
+    struct Unit
+    {
+        uint64_t address = 0;
+        std::string name;
+        int16_t rssi = 0;
+        UnitState state = UnitState::Waiting;
+        int attempts = 0;
+        bool isPaired = false;
+        std::string lastError;
+        std::chrono::steady_clock::time_point startTime;    // First pairing attempt
+        std::chrono::steady_clock::time_point finishTime;
+        std::chrono::steady_clock::time_point deadline;     // Current step timeout, or next retry
+        uint32_t step = 0;                                  // Completions for older steps are ignored
+    };
+
+    struct Report
+    {
+        size_t unitCount = 0;
+        size_t succeeded = 0;
+        size_t failed = 0;
+        size_t retries = 0;
+        double elapsedSeconds = 0.0;
+        double unitsPerMinute = 0.0;        // Succeeded units over elapsed time
+        double meanUnitSeconds = 0.0;       // First attempt to success
+    };
+
+    // Addresses one per line, '#' starts a comment
+    static bool LoadAddressList(const std::filesystem::path& path, std::vector<uint64_t>& addresses, std::string& error);
+
+    LuminaProvisioner(LuminaProvisioningTransport& transport, const Options& options);
+    LuminaProvisioner(const LuminaProvisioner&) = delete;
+    LuminaProvisioner& operator=(const LuminaProvisioner&) = delete;
+
+    // Feed from discovery; unknown or filtered-out devices are ignored
+    void OnDeviceSeen(uint64_t address, const std::string& name, int16_t rssi);
+
+    // Handles completions, timeouts and retries, then starts queued units. Units that finished since
+    // the previous call are appended to finished.
+    void Poll(std::vector<Unit>& finished);
+
+    // Every unit finished, and in filter mode the unit limit reached
+    bool IsComplete() const;
+    Report GetReport() const;
+    const std::vector<Unit>& GetUnits() const { return m_Units; }
+
+    // One row per unit to <directory>/provision-<time>.csv
+    bool ExportCsv(const std::filesystem::path& directory, std::filesystem::path& writtenPath, std::string& error) const;
+
+private:
+    struct Completed
+    {
+        size_t unit;
+        uint32_t step;
+        std::string error;
+    };
+    // Shared with in-flight completions so a late one cannot outlive its target
+    struct Inbox
+    {
+        std::mutex mutex;
+        std::vector<Completed> completed;
+    };
+
+    LuminaProvisioningTransport& m_Transport;
+    Options m_Options;
+    std::shared_ptr<Inbox> m_Inbox = std::make_shared<Inbox>();
+
+    std::vector<Unit> m_Units;
+    std::unordered_map<uint64_t, size_t> m_UnitIndex;
+    std::deque<size_t> m_Ready;
+    int m_InFlight = 0;
+    size_t m_Finished = 0;
+    size_t m_Retries = 0;
+    std::chrono::steady_clock::time_point m_StartTime;
+    std::chrono::steady_clock::time_point m_LastFinishTime;
+
+    void StartStep(size_t index, UnitState state);
+    void CompleteStep(size_t index, const std::string& error, std::vector<Unit>& finished);
+    void Finish(size_t index, UnitState state, std::vector<Unit>& finished);
+    LuminaProvisioningTransport::Completion MakeCompletion(size_t index);
+};
@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <cstdio>
+#include "LuminaProvisioningSimulator.h"
+
+LuminaProvisioningSimulator::LuminaProvisioningSimulator(const Options& options)
+    : m_Options(options)
+    , m_StartTime(std::chrono::steady_clock::now())
+    , m_Random(options.seed)
+{
+    std::uniform_int_distribution<int> rssi(-90, -40);
+    for (int i = 0; i < m_Options.unitCount; ++i)
+    {
+        char name[16];
+        std::snprintf(name, sizeof(name), "SIM-%04d", i);
+        // Locally administered addresses so a dry run can never match a real device
+        m_Peripherals.push_back({ 0xC2AA00000000ull | static_cast<uint64_t>(i), name, static_cast<int16_t>(rssi(m_Random)) });
+    }
+    m_Thread = std::thread(&LuminaProvisioningSimulator::Run, this);
+}
+
+LuminaProvisioningSimulator::~LuminaProvisioningSimulator()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_IsStopping = true;
+    }
+    m_Wake.notify_one();
+    m_Thread.join();
+}
+
+std::vector<LuminaProvisioningSimulator::Peripheral> LuminaProvisioningSimulator::TakeArrivals()
+{
+    auto elapsed = std::chrono::steady_clock::now() - m_StartTime;
+    size_t due = m_Peripherals.size();
+    if (m_Options.arrivalInterval.count() > 0)
+    {
+        due = std::min<size_t>(due, static_cast<size_t>(elapsed / m_Options.arrivalInterval) + 1);
+    }
+
+    std::vector<Peripheral> arrivals(m_Peripherals.begin() + m_Arrived, m_Peripherals.begin() + std::max(due, m_Arrived));
+    m_Arrived = std::max(due, m_Arrived);
+    return arrivals;
+}
+
+void LuminaProvisioningSimulator::Pair(uint64_t, Completion completion)
+{
+    Schedule(m_Options.pairTime, "Simulated pairing failure", std::move(completion));
+}
+
+void LuminaProvisioningSimulator::WriteConfig(uint64_t, const Lumina::GattConfigWrite&, Completion completion)
+{
+    Schedule(m_Options.configTime, "Simulated config write failure", std::move(completion));
+}
+
+void LuminaProvisioningSimulator::Schedule(std::chrono::milliseconds meanTime, const char* failure, Completion completion)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        auto delay = std::chrono::duration_cast<std::chrono::steady_clock::duration>(meanTime * (0.5 + unit(m_Random)));
+        bool isFailure = unit(m_Random) < m_Options.failureRate;
+        m_Pending.push({ std::chrono::steady_clock::now() + delay, std::move(completion), isFailure ? failure : "" });
+    }
+    m_Wake.notify_one();
+}
+
+void LuminaProvisioningSimulator::Run()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (!m_IsStopping)
+    {
+        if (m_Pending.empty())
+        {
+            m_Wake.wait(lock);
+            continue;
+        }
+        // A copy: Schedule may grow the queue while the lock is released during the wait
+        const auto due = m_Pending.top().due;
+        if (m_Wake.wait_until(lock, due) != std::cv_status::timeout && std::chrono::steady_clock::now() < due)
+        {
+            continue;
+        }
+
+        Pending pending = m_Pending.top();
+        m_Pending.pop();
+        lock.unlock();
+        pending.completion(pending.error);
+        lock.lock();
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "LuminaProvisioner.h"
+
+// Simulated peripherals for dry-running provisioning without a radio (--provision-simulate).
+// Units "arrive" one at a time like off a production line, and each pair or write completes on a
+// background thread after a randomised delay, failing at the configured rate.
+class LuminaProvisioningSimulator : public LuminaProvisioningTransport
+{
+public:
+    struct Options
+    {
+        int unitCount = 100;
+        std::chrono::milliseconds arrivalInterval{ 200 };
+        std::chrono::milliseconds pairTime{ 1500 };     // Mean; each operation takes 0.5x-1.5x
+        std::chrono::milliseconds configTime{ 300 };
+        double failureRate = 0.05;                      // Per operation
+        uint32_t seed = 1;
+    };
+
+    struct Peripheral
+    {
+        uint64_t address = 0;
+        std::string name;
+        int16_t rssi = 0;
+    };
+
+    explicit LuminaProvisioningSimulator(const Options& options);
+    ~LuminaProvisioningSimulator() override;
+    LuminaProvisioningSimulator(const LuminaProvisioningSimulator&) = delete;
+    LuminaProvisioningSimulator& operator=(const LuminaProvisioningSimulator&) = delete;
+
+    // Peripherals whose arrival time has passed since the previous call
+    std::vector<Peripheral> TakeArrivals();
+
+    void Pair(uint64_t address, Completion completion) override;
+    void WriteConfig(uint64_t address, const Lumina::GattConfigWrite& write, Completion completion) override;
+
+private:
+    struct Pending
+    {
+        std::chrono::steady_clock::time_point due;
+        Completion completion;
+        std::string error;
+
+        bool operator>(const Pending& other) const { return due > other.due; }
+    };
+
+    Options m_Options;
+    std::vector<Peripheral> m_Peripherals;
+    size_t m_Arrived = 0;
+    std::chrono::steady_clock::time_point m_StartTime;
+
+    // Completions still to be delivered; dropped unrun on destruction
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> m_Pending;
+    std::mt19937 m_Random;
+    bool m_IsStopping = false;
+    std::thread m_Thread;
+
+    void Schedule(std::chrono::milliseconds meanTime, const char* failure, Completion completion);
+    void Run();
+};
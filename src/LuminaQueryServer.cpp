@@ -0,0 +1,732 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <afunix.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+#endif
+#include "LuminaQueryServer.h"
+#include "LuminaNdjsonWriter.h"
+#include "LuminaHelper.h"
+
+namespace
+{
+#ifdef _WIN32
+    constexpr LuminaQueryServer::SocketHandle InvalidSocket = INVALID_SOCKET;
+
+    void CloseSocket(LuminaQueryServer::SocketHandle socket) { closesocket(socket); }
+    bool SetNonBlocking(LuminaQueryServer::SocketHandle socket)
+    {
+        u_long enabled = 1;
+        return ioctlsocket(socket, FIONBIO, &enabled) == 0;
+    }
+    bool WouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+    bool IsConnectionRefused() { return WSAGetLastError() == WSAECONNREFUSED; }
+    std::string LastSocketError() { return "error " + std::to_string(WSAGetLastError()); }
+#else
+    constexpr LuminaQueryServer::SocketHandle InvalidSocket = -1;
+
+    void CloseSocket(LuminaQueryServer::SocketHandle socket) { close(socket); }
+    bool SetNonBlocking(LuminaQueryServer::SocketHandle socket)
+    {
+        int flags = fcntl(socket, F_GETFL, 0);
+        return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+    bool WouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+    bool IsConnectionRefused() { return errno == ECONNREFUSED; }
+    std::string LastSocketError() { return std::strerror(errno); }
+#endif
+
+    // A client hanging up mid-write must not raise SIGPIPE
+#ifdef MSG_NOSIGNAL
+    constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+    constexpr int SendFlags = 0;
+#endif
+
+    void AppendServiceUuid(std::string& out, const Lumina::ServiceUuid& uuid)
+    {
+        char text[40];
+        std::snprintf(text, sizeof(text), "\"%08x-%04x-%04x-%04x-%012llx\"",
+            static_cast<unsigned>(uuid.high >> 32), static_cast<unsigned>((uuid.high >> 16) & 0xFFFF),
+            static_cast<unsigned>(uuid.high & 0xFFFF), static_cast<unsigned>(uuid.low >> 48),
+            static_cast<unsigned long long>(uuid.low & 0xFFFFFFFFFFFFull));
+        out += text;
+    }
+
+    std::string ErrorLine(const std::string& message)
+    {
+        std::string line = "{\"type\":\"error\",\"message\":";
+        LuminaNdjsonWriter::AppendString(line, message);
+        line += "}";
+        return line;
+    }
+}
+
+// Readiness notification over the listen socket and all clients
+class LuminaQueryServer::Poller
+{
+public:
+    struct Event
+    {
+        SocketHandle socket;
+        bool isReadable;
+        bool isWritable;
+        bool isClosed;
+    };
+
+#ifdef __linux__
+    Poller() : m_Epoll(epoll_create1(EPOLL_CLOEXEC)) {}
+    ~Poller() { if (m_Epoll >= 0) close(m_Epoll); }
+
+    bool IsValid() const { return m_Epoll >= 0; }
+
+    void Add(SocketHandle socket)
+    {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = socket;
+        epoll_ctl(m_Epoll, EPOLL_CTL_ADD, socket, &event);
+    }
+
+    void SetWriteWatched(SocketHandle socket, bool isWatched)
+    {
+        epoll_event event{};
+        event.events = isWatched ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        event.data.fd = socket;
+        epoll_ctl(m_Epoll, EPOLL_CTL_MOD, socket, &event);
+    }
+
+    void Remove(SocketHandle socket)
+    {
+        epoll_ctl(m_Epoll, EPOLL_CTL_DEL, socket, nullptr);
+    }
+
+    void Wait(std::chrono::milliseconds timeout, std::vector<Event>& events)
+    {
+        epoll_event ready[64];
+        int count = epoll_wait(m_Epoll, ready, 64, static_cast<int>(timeout.count()));
+        events.clear();
+        for (int i = 0; i < count; ++i)
+        {
+            events.push_back({ ready[i].data.fd, (ready[i].events & EPOLLIN) != 0, (ready[i].events & EPOLLOUT) != 0,
+                (ready[i].events & (EPOLLERR | EPOLLHUP)) != 0 });
+        }
+    }
+
+private:
+    int m_Epoll;
+#else
+    bool IsValid() const { return true; }
+
+    void Add(SocketHandle socket) { m_Watched[socket] = false; }
+    void SetWriteWatched(SocketHandle socket, bool isWatched) { m_Watched[socket] = isWatched; }
+    void Remove(SocketHandle socket) { m_Watched.erase(socket); }
+
+    void Wait(std::chrono::milliseconds timeout, std::vector<Event>& events)
+    {
+        m_Fds.clear();
+        for (const auto& [socket, isWriteWatched] : m_Watched)
+        {
+#ifdef _WIN32
+            WSAPOLLFD fd{};
+#else
+            pollfd fd{};
+#endif
+            fd.fd = socket;
+            fd.events = POLLIN | (isWriteWatched ? POLLOUT : 0);
+            m_Fds.push_back(fd);
+        }
+#ifdef _WIN32
+        int count = WSAPoll(m_Fds.data(), static_cast<ULONG>(m_Fds.size()), static_cast<INT>(timeout.count()));
+#else
+        int count = poll(m_Fds.data(), m_Fds.size(), static_cast<int>(timeout.count()));
+#endif
+        events.clear();
+        for (size_t i = 0; count > 0 && i < m_Fds.size(); ++i)
+        {
+            if (m_Fds[i].revents != 0)
+            {
+                events.push_back({ static_cast<SocketHandle>(m_Fds[i].fd), (m_Fds[i].revents & POLLIN) != 0,
+                    (m_Fds[i].revents & POLLOUT) != 0, (m_Fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0 });
+            }
+        }
+    }
+
+private:
+    std::unordered_map<SocketHandle, bool> m_Watched;
+#ifdef _WIN32
+    std::vector<WSAPOLLFD> m_Fds;
+#else
+    std::vector<pollfd> m_Fds;
+#endif
+#endif
+};
+
+bool LuminaQueryServer::Filter::Matches(const Lumina::QueryDevice& device) const
+{
+    if (minRssi && device.rssi < *minRssi)
+    {
+        return false;
+    }
+    if (!nameContains.empty() && device.name.find(nameContains) == std::string::npos)
+    {
+        return false;
+    }
+    if (service && std::find(device.serviceUuids.begin(), device.serviceUuids.end(), *service) == device.serviceUuids.end())
+    {
+        return false;
+    }
+    return true;
+}
+
+LuminaQueryServer::LuminaQueryServer()
+    : m_ListenSocket(InvalidSocket)
+{
+}
+
+LuminaQueryServer::~LuminaQueryServer()
+{
+    Stop();
+}
+
+bool LuminaQueryServer::Start(const std::string& socketPath, std::string& error)
+{
+    Stop();
+
+#ifdef _WIN32
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+    {
+        error = "Failed to initialize Winsock for the query server";
+        return false;
+    }
+#endif
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path))
+    {
+        error = "Query socket path is too long: " + socketPath;
+        return false;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    m_ListenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_ListenSocket == InvalidSocket)
+    {
+        error = "Failed to create query socket: " + LastSocketError();
+        return false;
+    }
+
+    std::error_code ignored;
+    std::filesystem::path parent = std::filesystem::path(socketPath).parent_path();
+    if (!parent.empty())
+    {
+        std::filesystem::create_directories(parent, ignored);
+    }
+
+    // A socket file left by a previous run would make bind fail, but one a live server listens on must be left
+    // alone: unlinking it would take over that server's path from its clients. Only a refused connection means
+    // nobody is listening.
+    SocketHandle probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe != InvalidSocket)
+    {
+        bool isLive = connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        bool isStale = !isLive && IsConnectionRefused();
+        CloseSocket(probe);
+        if (isLive)
+        {
+            error = "Query socket " + socketPath + " is in use by another instance";
+            CloseSocket(m_ListenSocket);
+            m_ListenSocket = InvalidSocket;
+            return false;
+        }
+        if (isStale)
+        {
+            std::remove(socketPath.c_str());
+        }
+    }
+    if (bind(m_ListenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(m_ListenSocket, SOMAXCONN) != 0 || !SetNonBlocking(m_ListenSocket))
+    {
+        error = "Failed to listen on query socket " + socketPath + ": " + LastSocketError();
+        CloseSocket(m_ListenSocket);
+        m_ListenSocket = InvalidSocket;
+        return false;
+    }
+
+    m_SocketPath = socketPath;
+    m_StopRequested = false;
+    m_LoopThread = std::thread(&LuminaQueryServer::Loop, this);
+    return true;
+}
+
+void LuminaQueryServer::Stop()
+{
+    if (m_LoopThread.joinable())
+    {
+        m_StopRequested = true;
+        m_LoopThread.join();
+    }
+    if (m_ListenSocket != InvalidSocket)
+    {
+        CloseSocket(m_ListenSocket);
+        m_ListenSocket = InvalidSocket;
+        std::remove(m_SocketPath.c_str());
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+}
+
+void LuminaQueryServer::PublishDevice(const Lumina::QueryDevice& device)
+{
+    std::lock_guard<std::mutex> lock(m_PendingMutex);
+    m_PendingUpdates[device.address] = device;
+}
+
+void LuminaQueryServer::ClearDevices()
+{
+    std::lock_guard<std::mutex> lock(m_PendingMutex);
+    m_PendingUpdates.clear();
+    m_PendingClear = true;
+}
+
+LuminaQueryServer::Stats LuminaQueryServer::GetStats() const
+{
+    Stats stats;
+    stats.clients = m_ClientCount;
+    stats.queries = m_QueryCount;
+    stats.batches = m_BatchCount;
+    stats.updates = m_UpdateCount;
+    return stats;
+}
+
+void LuminaQueryServer::Loop()
+{
+    Poller poller;
+    if (!poller.IsValid())
+    {
+        return;
+    }
+    poller.Add(m_ListenSocket);
+
+    std::vector<Poller::Event> events;
+    std::vector<SocketHandle> closed;
+    while (!m_StopRequested)
+    {
+        // Short timeout so device updates and subscription batches go out without a separate wakeup channel
+        poller.Wait(TickInterval, events);
+
+        for (const auto& event : events)
+        {
+            if (event.socket == m_ListenSocket)
+            {
+                AcceptClients(poller);
+                continue;
+            }
+
+            auto it = m_Clients.find(event.socket);
+            if (it == m_Clients.end())
+            {
+                continue;
+            }
+            Client& client = *it->second;
+            bool isOpen = !event.isClosed || event.isReadable;
+            if (isOpen && event.isReadable)
+            {
+                isOpen = ReadClient(client);
+            }
+            if (isOpen && event.isWritable)
+            {
+                isOpen = WriteClient(client);
+            }
+            if (!isOpen)
+            {
+                closed.push_back(event.socket);
+            }
+        }
+
+        ApplyPendingUpdates();
+        FlushSubscriptions(std::chrono::steady_clock::now());
+
+        // Watch for writability only while output is queued
+        for (auto& [socket, client] : m_Clients)
+        {
+            if (client->output.size() > MaxOutputBytes)
+            {
+                closed.push_back(socket);
+                continue;
+            }
+            bool needsWrite = !client->output.empty();
+            if (needsWrite != client->isWriteWatched)
+            {
+                poller.SetWriteWatched(socket, needsWrite);
+                client->isWriteWatched = needsWrite;
+            }
+        }
+
+        for (SocketHandle socket : closed)
+        {
+            CloseClient(poller, socket);
+        }
+        closed.clear();
+    }
+
+    for (auto& [socket, client] : m_Clients)
+    {
+        poller.Remove(socket);
+        CloseSocket(socket);
+    }
+    m_Clients.clear();
+    m_ClientCount = 0;
+}
+
+void LuminaQueryServer::AcceptClients(Poller& poller)
+{
+    while (true)
+    {
+        SocketHandle socket = accept(m_ListenSocket, nullptr, nullptr);
+        if (socket == InvalidSocket)
+        {
+            return;
+        }
+        if (!SetNonBlocking(socket))
+        {
+            CloseSocket(socket);
+            continue;
+        }
+
+        auto client = std::make_unique<Client>();
+        client->socket = socket;
+        m_Clients[socket] = std::move(client);
+        poller.Add(socket);
+        ++m_ClientCount;
+    }
+}
+
+bool LuminaQueryServer::ReadClient(Client& client)
+{
+    char buffer[4096];
+    while (true)
+    {
+        int received = recv(client.socket, buffer, sizeof(buffer), 0);
+        if (received == 0)
+        {
+            return false;
+        }
+        if (received < 0)
+        {
+            if (!WouldBlock())
+            {
+                return false;
+            }
+            break;
+        }
+        client.input.append(buffer, static_cast<size_t>(received));
+    }
+
+    size_t start = 0;
+    size_t end = 0;
+    while ((end = client.input.find('\n', start)) != std::string::npos)
+    {
+        std::string line = client.input.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (!line.empty())
+        {
+            HandleCommand(client, line);
+        }
+        start = end + 1;
+    }
+    client.input.erase(0, start);
+
+    // A client that never sends a newline is not speaking the protocol
+    return client.input.size() <= MaxInputBytes && WriteClient(client);
+}
+
+bool LuminaQueryServer::WriteClient(Client& client)
+{
+    while (!client.output.empty())
+    {
+        int sent = send(client.socket, client.output.data(), static_cast<int>(std::min<size_t>(client.output.size(), 1 << 20)), SendFlags);
+        if (sent < 0)
+        {
+            return WouldBlock();
+        }
+        client.output.erase(0, static_cast<size_t>(sent));
+    }
+    return true;
+}
+
+void LuminaQueryServer::CloseClient(Poller& poller, SocketHandle socket)
+{
+    if (m_Clients.erase(socket) > 0)
+    {
+        poller.Remove(socket);
+        CloseSocket(socket);
+        --m_ClientCount;
+    }
+}
+
+void LuminaQueryServer::ApplyPendingUpdates()
+{
+    std::unordered_map<uint64_t, Lumina::QueryDevice> updates;
+    bool clear = false;
+    {
+        std::lock_guard<std::mutex> lock(m_PendingMutex);
+        updates.swap(m_PendingUpdates);
+        clear = m_PendingClear;
+        m_PendingClear = false;
+    }
+
+    if (clear)
+    {
+        m_Devices.clear();
+        for (auto& [socket, client] : m_Clients)
+        {
+            if (client->subscription)
+            {
+                Subscription& subscription = *client->subscription;
+                subscription.changed.insert(subscription.members.begin(), subscription.members.end());
+                subscription.members.clear();
+            }
+        }
+    }
+    for (auto& [address, device] : updates)
+    {
+        for (auto& [socket, client] : m_Clients)
+        {
+            if (!client->subscription)
+            {
+                continue;
+            }
+            // A device that stops matching is reported once as removed, then ignored until it matches again
+            Subscription& subscription = *client->subscription;
+            if (subscription.filter.Matches(device))
+            {
+                subscription.members.insert(address);
+                subscription.changed.insert(address);
+            }
+            else if (subscription.members.erase(address) > 0)
+            {
+                subscription.changed.insert(address);
+            }
+        }
+        m_Devices[address] = std::move(device);
+    }
+    m_UpdateCount += updates.size();
+}
+
+void LuminaQueryServer::FlushSubscriptions(std::chrono::steady_clock::time_point now)
+{
+    for (auto& [socket, client] : m_Clients)
+    {
+        if (!client->subscription || client->subscription->changed.empty() || now < client->subscription->nextBatch)
+        {
+            continue;
+        }
+
+        Subscription& subscription = *client->subscription;
+        std::string line = "{\"type\":\"batch\",\"devices\":[";
+        std::string removed;
+        bool isFirst = true;
+        for (uint64_t address : subscription.changed)
+        {
+            auto it = m_Devices.find(address);
+            if (it == m_Devices.end() || subscription.members.count(address) == 0)
+            {
+                removed += removed.empty() ? "" : ",";
+                LuminaNdjsonWriter::AppendString(removed, LuminaHelper::BluetoothAddressToString(address));
+                continue;
+            }
+            if (!isFirst)
+            {
+                line += ",";
+            }
+            AppendDevice(line, it->second);
+            isFirst = false;
+        }
+        line += "]";
+        if (!removed.empty())
+        {
+            line += ",\"removed\":[" + removed + "]";
+        }
+        line += "}";
+        subscription.changed.clear();
+        subscription.nextBatch = now + subscription.batchInterval;
+
+        Send(*client, line);
+        WriteClient(*client);
+        ++m_BatchCount;
+    }
+}
+
+void LuminaQueryServer::HandleCommand(Client& client, const std::string& line)
+{
+    std::istringstream stream(line);
+    std::string command;
+    stream >> command;
+    std::vector<std::string> args;
+    for (std::string arg; stream >> arg;)
+    {
+        args.push_back(arg);
+    }
+
+    std::string error;
+    if (command == "ping")
+    {
+        Send(client, "{\"type\":\"pong\"}");
+    }
+    else if (command == "query")
+    {
+        Filter filter;
+        if (!ParseFilter(args, filter, nullptr, error))
+        {
+            Send(client, ErrorLine(error));
+            return;
+        }
+
+        std::string response = "{\"type\":\"result\",\"devices\":[";
+        bool isFirst = true;
+        for (const auto& [address, device] : m_Devices)
+        {
+            if (!filter.Matches(device))
+            {
+                continue;
+            }
+            if (!isFirst)
+            {
+                response += ",";
+            }
+            AppendDevice(response, device);
+            isFirst = false;
+        }
+        response += "]}";
+        Send(client, response);
+        ++m_QueryCount;
+    }
+    else if (command == "subscribe")
+    {
+        Subscription subscription;
+        if (!ParseFilter(args, subscription.filter, &subscription.batchInterval, error))
+        {
+            Send(client, ErrorLine(error));
+            return;
+        }
+
+        // Start with everything that already matches, so a subscriber needs no separate query
+        for (const auto& [address, device] : m_Devices)
+        {
+            if (subscription.filter.Matches(device))
+            {
+                subscription.members.insert(address);
+            }
+        }
+        subscription.changed = subscription.members;
+        client.subscription = std::move(subscription);
+        Send(client, "{\"type\":\"subscribed\"}");
+    }
+    else if (command == "unsubscribe")
+    {
+        client.subscription.reset();
+        Send(client, "{\"type\":\"unsubscribed\"}");
+    }
+    else
+    {
+        Send(client, ErrorLine("Unknown command: " + command));
+    }
+}
+
+void LuminaQueryServer::Send(Client& client, const std::string& line)
+{
+    client.output += line;
+    client.output += '\n';
+}
+
+bool LuminaQueryServer::ParseFilter(const std::vector<std::string>& args, Filter& filter, std::chrono::milliseconds* batchInterval, std::string& error)
+{
+    for (const auto& arg : args)
+    {
+        size_t separator = arg.find('=');
+        std::string key = arg.substr(0, separator);
+        std::string value = separator == std::string::npos ? std::string() : arg.substr(separator + 1);
+
+        try
+        {
+            if (key == "service")
+            {
+                Lumina::ServiceUuid uuid;
+                if (!LuminaHelper::ParseServiceUuid(value, uuid))
+                {
+                    error = "Invalid service UUID: " + value;
+                    return false;
+                }
+                filter.service = uuid;
+            }
+            else if (key == "min_rssi")
+            {
+                filter.minRssi = std::stoi(value);
+            }
+            else if (key == "name")
+            {
+                filter.nameContains = value;
+            }
+            else if (key == "batch_ms" && batchInterval)
+            {
+                *batchInterval = std::chrono::milliseconds(std::clamp(std::stoi(value), 1, 60000));
+            }
+            else
+            {
+                error = "Unknown argument: " + arg;
+                return false;
+            }
+        }
+        catch (...)
+        {
+            error = "Invalid value: " + arg;
+            return false;
+        }
+    }
+    return true;
+}
+
+void LuminaQueryServer::AppendDevice(std::string& out, const Lumina::QueryDevice& device)
+{
+    out += "{\"address\":";
+    LuminaNdjsonWriter::AppendString(out, LuminaHelper::BluetoothAddressToString(device.address));
+    out += ",\"name\":";
+    LuminaNdjsonWriter::AppendString(out, device.name);
+    out += ",\"rssi\":" + std::to_string(device.rssi);
+    out += ",\"connectable\":";
+    out += device.isConnectable ? "true" : "false";
+    out += ",\"last_seen\":" + std::to_string(device.lastSeenUnixMs);
+    out += ",\"services\":[";
+    for (size_t i = 0; i < device.serviceUuids.size(); ++i)
+    {
+        if (i > 0)
+        {
+            out += ",";
+        }
+        AppendServiceUuid(out, device.serviceUuids[i]);
+    }
+    out += "]}";
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "LuminaAdvertisement.h"
+
+namespace Lumina
+{
+    // Device state as served to query clients
+    struct QueryDevice
+    {
+        uint64_t address = 0;
+        std::string name;
+        int16_t rssi = 0;
+        bool isConnectable = false;
+        int64_t lastSeenUnixMs = 0;
+        std::vector<ServiceUuid> serviceUuids;
+    };
+}
+
+// Local query and subscription API on a Unix domain socket, served from its own event loop thread
+// (epoll on Linux, WSAPoll on Windows where AF_UNIX is available since Windows 10 1803).
+//
+// One command per line, one JSON object per response line:
+//   query [service=<uuid>] [min_rssi=<dBm>] [name=<text>]   -> {"type":"result","devices":[...]}
+//   subscribe [same filters] [batch_ms=<n>]                  -> {"type":"batch","devices":[...],"removed":[...]} every batch_ms
+//                                                               with changed matches; "removed" lists the addresses that stopped
+//                                                               matching or were cleared, and is left out when empty
+//   unsubscribe | ping
+// <uuid> is a 16-bit alias ("180d") or a full UUID. Errors come back as {"type":"error","message":...}.
+// Start fails if another live server already listens on the path; a socket file left by a dead one is replaced.
+class LuminaQueryServer
+{
+public:
+    struct Stats
+    {
+        uint64_t clients = 0;   // Currently connected
+        uint64_t queries = 0;
+        uint64_t batches = 0;
+        uint64_t updates = 0;   // Device updates applied to the store
+    };
+
+    LuminaQueryServer();
+    ~LuminaQueryServer();
+    LuminaQueryServer(const LuminaQueryServer&) = delete;
+    LuminaQueryServer& operator=(const LuminaQueryServer&) = delete;
+
+    bool Start(const std::string& socketPath, std::string& error);
+    void Stop();
+    bool IsRunning() const { return m_LoopThread.joinable(); }
+
+    // Thread-safe. Updates are coalesced per address and applied on the next loop tick.
+    void PublishDevice(const Lumina::QueryDevice& device);
+    void ClearDevices();
+
+    Stats GetStats() const;
+
+#ifdef _WIN32
+    using SocketHandle = uintptr_t;
+#else
+    using SocketHandle = int;
+#endif
+
+private:
+    class Poller;
+
+    struct Filter
+    {
+        std::optional<Lumina::ServiceUuid> service;
+        std::optional<int> minRssi;
+        std::string nameContains;
+
+        bool Matches(const Lumina::QueryDevice& device) const;
+    };
+
+    struct Subscription
+    {
+        Filter filter;
+        std::chrono::milliseconds batchInterval{ 100 };
+        std::chrono::steady_clock::time_point nextBatch;
+        std::unordered_set<uint64_t> members;   // Matching devices the subscriber holds, counting the next batch
+        std::unordered_set<uint64_t> changed;   // Sent as devices if still members, otherwise as removed
+    };
+
+    struct Client
+    {
+        SocketHandle socket;
+        std::string input;
+        std::string output;
+        bool isWriteWatched = false;
+        std::optional<Subscription> subscription;
+    };
+
+    static constexpr auto TickInterval = std::chrono::milliseconds(10);
+    static constexpr size_t MaxInputBytes = 64 * 1024;
+    static constexpr size_t MaxOutputBytes = 8 * 1024 * 1024; // Slow subscribers past this are dropped
+
+    std::string m_SocketPath;
+    SocketHandle m_ListenSocket;
+    std::thread m_LoopThread;
+    std::atomic<bool> m_StopRequested = false;
+
+    // Producer side
+    std::mutex m_PendingMutex;
+    std::unordered_map<uint64_t, Lumina::QueryDevice> m_PendingUpdates;
+    bool m_PendingClear = false;
+
+    // Loop thread only
+    std::unordered_map<uint64_t, Lumina::QueryDevice> m_Devices;
+    std::unordered_map<SocketHandle, std::unique_ptr<Client>> m_Clients;
+
+    std::atomic<uint64_t> m_ClientCount = 0;
+    std::atomic<uint64_t> m_QueryCount = 0;
+    std::atomic<uint64_t> m_BatchCount = 0;
+    std::atomic<uint64_t> m_UpdateCount = 0;
+
+    void Loop();
+    void AcceptClients(Poller& poller);
+    bool ReadClient(Client& client);
+    bool WriteClient(Client& client);
+    void CloseClient(Poller& poller, SocketHandle socket);
+    void ApplyPendingUpdates();
+    void FlushSubscriptions(std::chrono::steady_clock::time_point now);
+    void HandleCommand(Client& client, const std::string& line);
+    void Send(Client& client, const std::string& line);
+
+    static bool ParseFilter(const std::vector<std::string>& args, Filter& filter, std::chrono::milliseconds* batchInterval, std::string& error);
+    static void AppendDevice(std::string& out, const Lumina::QueryDevice& device);
+};
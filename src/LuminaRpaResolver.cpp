@@ -0,0 +1,430 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include "LuminaRpaResolver.h"
+#include "LuminaHelper.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define LUMINA_AESNI 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define LUMINA_TARGET_AESNI
+#else
+#include <cpuid.h>
+#define LUMINA_TARGET_AESNI __attribute__((target("aes")))
+#endif
+#endif
+
+namespace
+{
+    constexpr uint8_t SBox[256] = {
+        0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+        0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+        0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+        0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+        0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+        0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+        0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+        0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+        0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+        0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+        0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+        0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+        0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+        0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+        0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+        0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+    };
+
+    constexpr uint8_t XTime(uint8_t value)
+    {
+        return static_cast<uint8_t>((value << 1) ^ ((value & 0x80) ? 0x1b : 0x00));
+    }
+
+    // SubBytes and MixColumns for one byte as a column word (2s, s, s, 3s); the other rows are rotations of it
+    constexpr std::array<uint32_t, 256> MakeRoundTable()
+    {
+        std::array<uint32_t, 256> table{};
+        for (int i = 0; i < 256; ++i)
+        {
+            uint8_t s = SBox[i];
+            uint8_t doubled = XTime(s);
+            table[i] = (static_cast<uint32_t>(doubled) << 24) | (static_cast<uint32_t>(s) << 16) |
+                (static_cast<uint32_t>(s) << 8) | static_cast<uint8_t>(doubled ^ s);
+        }
+        return table;
+    }
+    constexpr std::array<uint32_t, 256> RoundTable = MakeRoundTable();
+
+    uint32_t RotateRight(uint32_t value, int bits)
+    {
+        return (value >> bits) | (value << (32 - bits));
+    }
+
+    uint32_t LoadBigEndian(const uint8_t* data)
+    {
+        return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) | (static_cast<uint32_t>(data[2]) << 8) | data[3];
+    }
+
+    void StoreBigEndian(uint32_t value, uint8_t* data)
+    {
+        data[0] = static_cast<uint8_t>(value >> 24);
+        data[1] = static_cast<uint8_t>(value >> 16);
+        data[2] = static_cast<uint8_t>(value >> 8);
+        data[3] = static_cast<uint8_t>(value);
+    }
+
+    // Portable AES-128 encryption of one block over an expanded key, byte order as in FIPS-197.
+    // Table driven: one lookup per byte per round covers SubBytes, ShiftRows and MixColumns.
+    void EncryptBlock(const uint8_t roundKeys[11][16], const uint8_t input[16], uint8_t output[16])
+    {
+        uint32_t s0 = LoadBigEndian(input) ^ LoadBigEndian(roundKeys[0]);
+        uint32_t s1 = LoadBigEndian(input + 4) ^ LoadBigEndian(roundKeys[0] + 4);
+        uint32_t s2 = LoadBigEndian(input + 8) ^ LoadBigEndian(roundKeys[0] + 8);
+        uint32_t s3 = LoadBigEndian(input + 12) ^ LoadBigEndian(roundKeys[0] + 12);
+        auto column = [](uint32_t a, uint32_t b, uint32_t c, uint32_t d, const uint8_t* key)
+            {
+                return RoundTable[a >> 24] ^ RotateRight(RoundTable[(b >> 16) & 0xFF], 8) ^
+                    RotateRight(RoundTable[(c >> 8) & 0xFF], 16) ^ RotateRight(RoundTable[d & 0xFF], 24) ^ LoadBigEndian(key);
+            };
+        for (int round = 1; round < 10; ++round)
+        {
+            const uint8_t* key = roundKeys[round];
+            uint32_t t0 = column(s0, s1, s2, s3, key);
+            uint32_t t1 = column(s1, s2, s3, s0, key + 4);
+            uint32_t t2 = column(s2, s3, s0, s1, key + 8);
+            uint32_t t3 = column(s3, s0, s1, s2, key + 12);
+            s0 = t0;
+            s1 = t1;
+            s2 = t2;
+            s3 = t3;
+        }
+
+        // Last round has no MixColumns
+        auto lastColumn = [](uint32_t a, uint32_t b, uint32_t c, uint32_t d, const uint8_t* key)
+            {
+                return ((static_cast<uint32_t>(SBox[a >> 24]) << 24) | (static_cast<uint32_t>(SBox[(b >> 16) & 0xFF]) << 16) |
+                    (static_cast<uint32_t>(SBox[(c >> 8) & 0xFF]) << 8) | SBox[d & 0xFF]) ^ LoadBigEndian(key);
+            };
+        StoreBigEndian(lastColumn(s0, s1, s2, s3, roundKeys[10]), output);
+        StoreBigEndian(lastColumn(s1, s2, s3, s0, roundKeys[10] + 4), output + 4);
+        StoreBigEndian(lastColumn(s2, s3, s0, s1, roundKeys[10] + 8), output + 8);
+        StoreBigEndian(lastColumn(s3, s0, s1, s2, roundKeys[10] + 12), output + 12);
+    }
+
+    // ah() puts the 24-bit random part in the last three bytes of an otherwise zero block
+    void MakeAhBlock(uint32_t prand, uint8_t block[16])
+    {
+        std::memset(block, 0, 16);
+        block[13] = static_cast<uint8_t>(prand >> 16);
+        block[14] = static_cast<uint8_t>(prand >> 8);
+        block[15] = static_cast<uint8_t>(prand);
+    }
+
+    uint32_t AhFromBlock(const uint8_t block[16])
+    {
+        return (static_cast<uint32_t>(block[13]) << 16) | (static_cast<uint32_t>(block[14]) << 8) | block[15];
+    }
+
+    bool DetectAesNi()
+    {
+#if defined(LUMINA_AESNI) && defined(_MSC_VER)
+        int info[4] = {};
+        __cpuid(info, 1);
+        return (info[2] & (1 << 25)) != 0;
+#elif defined(LUMINA_AESNI)
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_AES) != 0;
+#else
+        return false;
+#endif
+    }
+
+#ifdef LUMINA_AESNI
+    // Eight keys per pass: aesenc has several cycles of latency but issues every cycle, so independent
+    // blocks hide it. The hash is the top three bytes of the last 32-bit lane.
+    LUMINA_TARGET_AESNI int FindIrkAesNi(const uint8_t (*roundKeys)[11][16], size_t count, const uint8_t plain[16], uint32_t hash)
+    {
+        constexpr size_t Lanes = 8;
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plain));
+        const uint32_t target = ((hash >> 16) & 0xFF) << 8 | ((hash >> 8) & 0xFF) << 16 | (hash & 0xFF) << 24;
+        auto key = [roundKeys](size_t index, int round) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(roundKeys[index][round])); };
+        auto matches = [target](__m128i state) { return (static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(state, 12))) & 0xFFFFFF00u) == target; };
+
+        size_t index = 0;
+        for (; index + Lanes <= count; index += Lanes)
+        {
+            __m128i s0 = _mm_xor_si128(block, key(index + 0, 0));
+            __m128i s1 = _mm_xor_si128(block, key(index + 1, 0));
+            __m128i s2 = _mm_xor_si128(block, key(index + 2, 0));
+            __m128i s3 = _mm_xor_si128(block, key(index + 3, 0));
+            __m128i s4 = _mm_xor_si128(block, key(index + 4, 0));
+            __m128i s5 = _mm_xor_si128(block, key(index + 5, 0));
+            __m128i s6 = _mm_xor_si128(block, key(index + 6, 0));
+            __m128i s7 = _mm_xor_si128(block, key(index + 7, 0));
+            for (int round = 1; round < 10; ++round)
+            {
+                s0 = _mm_aesenc_si128(s0, key(index + 0, round));
+                s1 = _mm_aesenc_si128(s1, key(index + 1, round));
+                s2 = _mm_aesenc_si128(s2, key(index + 2, round));
+                s3 = _mm_aesenc_si128(s3, key(index + 3, round));
+                s4 = _mm_aesenc_si128(s4, key(index + 4, round));
+                s5 = _mm_aesenc_si128(s5, key(index + 5, round));
+                s6 = _mm_aesenc_si128(s6, key(index + 6, round));
+                s7 = _mm_aesenc_si128(s7, key(index + 7, round));
+            }
+            const __m128i results[Lanes] = {
+                _mm_aesenclast_si128(s0, key(index + 0, 10)), _mm_aesenclast_si128(s1, key(index + 1, 10)),
+                _mm_aesenclast_si128(s2, key(index + 2, 10)), _mm_aesenclast_si128(s3, key(index + 3, 10)),
+                _mm_aesenclast_si128(s4, key(index + 4, 10)), _mm_aesenclast_si128(s5, key(index + 5, 10)),
+                _mm_aesenclast_si128(s6, key(index + 6, 10)), _mm_aesenclast_si128(s7, key(index + 7, 10)),
+            };
+            for (size_t lane = 0; lane < Lanes; ++lane)
+            {
+                if (matches(results[lane]))
+                {
+                    return static_cast<int>(index + lane);
+                }
+            }
+        }
+        for (; index < count; ++index)
+        {
+            __m128i state = _mm_xor_si128(block, key(index, 0));
+            for (int round = 1; round < 10; ++round)
+            {
+                state = _mm_aesenc_si128(state, key(index, round));
+            }
+            if (matches(_mm_aesenclast_si128(state, key(index, 10))))
+            {
+                return static_cast<int>(index);
+            }
+        }
+        return -1;
+    }
+#endif
+
+    bool ParseKey(const std::string& text, uint8_t key[16])
+    {
+        std::vector<uint8_t> bytes;
+        if (!LuminaHelper::ParseHexBytes(text, bytes) || bytes.size() != 16)
+        {
+            return false;
+        }
+        std::copy(bytes.begin(), bytes.end(), key);
+        return true;
+    }
+}
+
+LuminaRpaResolver::LuminaRpaResolver()
+    : m_IsUsingAesNi(DetectAesNi())
+{
+}
+
+bool LuminaRpaResolver::ReloadIfChanged(const std::filesystem::path& path, std::string& error)
+{
+    std::lock_guard<std::mutex> lock(m_ReloadMutex);
+
+    std::error_code ec;
+    bool exists = std::filesystem::exists(path, ec);
+    if (!exists)
+    {
+        if (m_FileExisted)
+        {
+            m_Keys.store(nullptr);
+            m_FileExisted = false;
+            std::lock_guard<std::mutex> cacheLock(m_CacheMutex);
+            m_Cache.clear();
+        }
+        m_HasFailedWriteTime = false;
+        return true;
+    }
+
+    auto writeTime = std::filesystem::last_write_time(path, ec);
+    if (ec)
+    {
+        error = "Failed to read IRK file time: " + ec.message();
+        return false;
+    }
+    if (m_FileExisted && writeTime == m_LastWriteTime)
+    {
+        return true;
+    }
+    // This version already failed and was reported; keep the current IRKs until the file is written again
+    if (m_HasFailedWriteTime && writeTime == m_FailedWriteTime)
+    {
+        return true;
+    }
+
+    std::ifstream file(path);
+    auto keys = std::make_shared<Keys>();
+    if (!file)
+    {
+        error = "Failed to open IRK file: " + path.string();
+    }
+    if (!file || !ParseKeys(file, *keys, error))
+    {
+        m_FailedWriteTime = writeTime;
+        m_HasFailedWriteTime = true;
+        return false;
+    }
+
+    m_Keys.store(std::move(keys));
+    m_LastWriteTime = writeTime;
+    m_FileExisted = true;
+    m_HasFailedWriteTime = false;
+    // Addresses that matched nothing before may match a new key
+    std::lock_guard<std::mutex> cacheLock(m_CacheMutex);
+    m_Cache.clear();
+    return true;
+}
+
+bool LuminaRpaResolver::ParseKeys(std::istream& input, Keys& keys, std::string& error)
+{
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(input, line))
+    {
+        ++lineNumber;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.resize(comment);
+        }
+
+        std::istringstream tokens(line);
+        std::string addressText, keyText;
+        if (!(tokens >> addressText))
+        {
+            continue;
+        }
+        uint64_t identity = 0;
+        uint8_t key[16];
+        if (!(tokens >> keyText) || !LuminaHelper::ParseBluetoothAddress(addressText, identity) || !ParseKey(keyText, key))
+        {
+            error = "IRK file line " + std::to_string(lineNumber) + ": expected '<identity address> <32 hex digit IRK> [name]'";
+            return false;
+        }
+        // Anything after the key is a name for people reading the file
+
+        keys.schedules.emplace_back();
+        ExpandKey(key, keys.schedules.back());
+        keys.identities.push_back(identity);
+    }
+    return true;
+}
+
+void LuminaRpaResolver::ExpandKey(const uint8_t key[16], RoundKeys& roundKeys)
+{
+    static constexpr uint8_t RoundConstants[10] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36 };
+    std::memcpy(roundKeys.bytes[0], key, 16);
+    for (int round = 1; round <= 10; ++round)
+    {
+        const uint8_t* previous = roundKeys.bytes[round - 1];
+        uint8_t* next = roundKeys.bytes[round];
+        // RotWord, SubWord and the round constant on the previous key's last word
+        uint8_t word[4] = { SBox[previous[13]], SBox[previous[14]], SBox[previous[15]], SBox[previous[12]] };
+        word[0] ^= RoundConstants[round - 1];
+        for (int i = 0; i < 16; ++i)
+        {
+            next[i] = previous[i] ^ (i < 4 ? word[i] : next[i - 4]);
+        }
+    }
+}
+
+uint32_t LuminaRpaResolver::Ah(const uint8_t irk[16], uint32_t prand)
+{
+    RoundKeys roundKeys;
+    ExpandKey(irk, roundKeys);
+    uint8_t block[16];
+    MakeAhBlock(prand, block);
+    EncryptBlock(roundKeys.bytes, block, block);
+    return AhFromBlock(block);
+}
+
+int LuminaRpaResolver::FindIrk(uint32_t prand, uint32_t hash, bool allowAesNi) const
+{
+    std::shared_ptr<const Keys> keys = m_Keys.load();
+    return keys ? FindIrk(*keys, prand, hash, allowAesNi) : -1;
+}
+
+int LuminaRpaResolver::FindIrk(const Keys& keys, uint32_t prand, uint32_t hash, bool allowAesNi) const
+{
+    uint8_t block[16];
+    MakeAhBlock(prand, block);
+#ifdef LUMINA_AESNI
+    if (allowAesNi && m_IsUsingAesNi)
+    {
+        return FindIrkAesNi(&keys.schedules.data()->bytes, keys.schedules.size(), block, hash);
+    }
+#endif
+    for (size_t i = 0; i < keys.schedules.size(); ++i)
+    {
+        uint8_t output[16];
+        EncryptBlock(keys.schedules[i].bytes, block, output);
+        if (AhFromBlock(output) == hash)
+        {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+uint64_t LuminaRpaResolver::Resolve(uint64_t address)
+{
+    if (!IsResolvable(address))
+    {
+        return address;
+    }
+    std::shared_ptr<const Keys> keys = m_Keys.load();
+    if (!keys || keys->schedules.empty())
+    {
+        return address;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_CacheMutex);
+        auto it = m_Cache.find(address);
+        if (it != m_Cache.end())
+        {
+            return it->second;
+        }
+    }
+
+    // Most significant 24 bits are the random part, least significant 24 its hash
+    int index = FindIrk(*keys, static_cast<uint32_t>(address >> 24) & 0xFFFFFF, static_cast<uint32_t>(address) & 0xFFFFFF, true);
+    uint64_t identity = index >= 0 ? keys->identities[index] : address;
+    ++m_Checked;
+    if (index >= 0)
+    {
+        ++m_Resolved;
+    }
+
+    std::lock_guard<std::mutex> lock(m_CacheMutex);
+    // A reload swaps the keys before clearing the cache under this lock. If they were swapped while we
+    // searched, our result belongs to the old keys and must not outlive that clear.
+    if (m_Keys.load() != keys)
+    {
+        return identity;
+    }
+    if (m_Cache.size() >= MaxCachedAddresses)
+    {
+        m_Cache.clear();
+    }
+    m_Cache.emplace(address, identity);
+    return identity;
+}
+
+size_t LuminaRpaResolver::GetIrkCount() const
+{
+    std::shared_ptr<const Keys> keys = m_Keys.load();
+    return keys ? keys->schedules.size() : 0;
+}
+
+void LuminaRpaResolver::ResetCounters()
+{
+    m_Checked = 0;
+    m_Resolved = 0;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Resolves the rotating private addresses of bonded devices back to their identity addresses, so each one
+// stays a single device however often it changes address. A resolvable private address carries a 24-bit
+// random part and a 24-bit hash of it under the device's IRK; resolving means finding the IRK whose hash
+// matches. Every IRK is checked for each new address, with AES-NI running eight keys side by side where the
+// CPU has it. Results are cached per address, so an address is only checked once.
+//
+// IRK file, one bonded device per line ('#' starts a comment):
+//   <identity address> <IRK as 32 hex digits, most significant byte first> [name]
+//   AA:BB:CC:DD:EE:FF ec0234a357c8ad05341010a60a397d9b Phone
+class LuminaRpaResolver
+{
+public:
+    struct Stats
+    {
+        uint64_t checked = 0;   // Addresses run against the IRKs
+        uint64_t resolved = 0;  // ...that matched one
+    };
+
+    LuminaRpaResolver();
+
+    // Loads the IRK file if it changed since the last call. A missing file removes all IRKs.
+    // Returns false and keeps the current IRKs if the file cannot be read or parsed; that version
+    // of the file is then skipped, so each bad edit is reported once.
+    bool ReloadIfChanged(const std::filesystem::path& path, std::string& error);
+
+    // Thread-safe. The identity address for a resolvable private address of a known device, otherwise the address itself.
+    uint64_t Resolve(uint64_t address);
+
+    size_t GetIrkCount() const;
+    bool GetIsUsingAesNi() const { return m_IsUsingAesNi; }
+    Stats GetStats() const { return { m_Checked, m_Resolved }; }
+    void ResetCounters();
+
+    // Top two bits 0b01 mark a resolvable private address
+    static bool IsResolvable(uint64_t address) { return (address >> 46) == 0x1; }
+
+    // The Core Specification's ah(k, r) = e(k, 0^104 || r) mod 2^24, with the IRK most significant byte first
+    static uint32_t Ah(const uint8_t irk[16], uint32_t prand);
+
+    // Index of the first key whose ah(prand) equals hash, or -1. Public for benchmarking the two paths.
+    int FindIrk(uint32_t prand, uint32_t hash, bool allowAesNi = true) const;
+
+private:
+    struct RoundKeys
+    {
+        uint8_t bytes[11][16];
+    };
+
+    struct Keys
+    {
+        std::vector<RoundKeys> schedules;   // Expanded once at load
+        std::vector<uint64_t> identities;
+    };
+
+    static constexpr size_t MaxCachedAddresses = 65536;
+
+    std::atomic<std::shared_ptr<const Keys>> m_Keys;
+    std::mutex m_ReloadMutex;
+    std::filesystem::file_time_type m_LastWriteTime{};
+    bool m_FileExisted = false;
+    std::filesystem::file_time_type m_FailedWriteTime{};
+    bool m_HasFailedWriteTime = false;
+    const bool m_IsUsingAesNi;
+
+    std::mutex m_CacheMutex;
+    std::unordered_map<uint64_t, uint64_t> m_Cache;    // Only holds results of the keys currently in m_Keys
+
+    std::atomic<uint64_t> m_Checked = 0;
+    std::atomic<uint64_t> m_Resolved = 0;
+
+    int FindIrk(const Keys& keys, uint32_t prand, uint32_t hash, bool allowAesNi) const;
+    static bool ParseKeys(std::istream& input, Keys& keys, std::string& error);
+    static void ExpandKey(const uint8_t key[16], RoundKeys& roundKeys);
+};
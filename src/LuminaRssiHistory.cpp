@@ -0,0 +1,571 @@
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include "LuminaRssiHistory.h"
+
+namespace
+{
+    // Bits are packed MSB first
+    void WriteBits(std::vector<uint8_t>& bytes, size_t& bitCount, uint64_t value, int width)
+    {
+        while (width > 0)
+        {
+            int offset = static_cast<int>(bitCount % 8);
+            if (offset == 0)
+            {
+                bytes.push_back(0);
+            }
+            int take = std::min(8 - offset, width);
+            uint8_t bits = static_cast<uint8_t>((value >> (width - take)) & ((1u << take) - 1));
+            bytes.back() |= static_cast<uint8_t>(bits << (8 - offset - take));
+            bitCount += take;
+            width -= take;
+        }
+    }
+
+    // Reads MSB-first bits through a 64-bit window refilled a byte at a time
+    class BitReader
+    {
+    public:
+        BitReader(const uint8_t* data, size_t size) : m_Data(data), m_Size(size) {}
+
+        bool IsValid() const { return m_IsValid; }
+
+        uint64_t Read(int width)
+        {
+            if (width == 0)
+            {
+                return 0;
+            }
+            if (!Fill(width))
+            {
+                return 0;
+            }
+            uint64_t value = m_Window >> (64 - width);
+            Consume(width);
+            return value;
+        }
+
+        int64_t ReadSigned(int width)
+        {
+            uint64_t raw = Read(width);
+            return (raw >> (width - 1)) & 1 ? static_cast<int64_t>(raw) - (int64_t(1) << width) : static_cast<int64_t>(raw);
+        }
+
+        // Number of leading 1 bits before a 0, up to limit (the 0 is not read at the limit)
+        int ReadPrefix(int limit)
+        {
+            Fill(1);
+            int ones = std::min(std::countl_one(m_Window), std::min(limit, m_WindowBits));
+            int width = ones < limit ? ones + 1 : ones;
+            if (!Fill(width))
+            {
+                return 0;
+            }
+            Consume(width);
+            return ones;
+        }
+
+    private:
+        const uint8_t* m_Data;
+        size_t m_Size;
+        size_t m_Offset = 0;
+        uint64_t m_Window = 0;
+        int m_WindowBits = 0;
+        bool m_IsValid = true;
+
+        bool Fill(int width)
+        {
+            while (m_WindowBits <= 56 && m_Offset < m_Size)
+            {
+                m_Window |= static_cast<uint64_t>(m_Data[m_Offset++]) << (56 - m_WindowBits);
+                m_WindowBits += 8;
+            }
+            if (m_WindowBits < width)
+            {
+                m_IsValid = false;
+            }
+            return m_IsValid;
+        }
+
+        void Consume(int width)
+        {
+            m_Window = width < 64 ? m_Window << width : 0;
+            m_WindowBits -= width;
+        }
+    };
+
+    // Delta-of-delta timestamp codes (in ticks): 0 | 10+5 | 110+9 | 1110+13 | 1111+32
+    constexpr int TimestampWidths[] = { 0, 5, 9, 13, 32 };
+    constexpr uint64_t TimestampPrefixes[] = { 0b0, 0b10, 0b110, 0b1110, 0b1111 };
+    // Zigzag RSSI delta codes: 0 | 10+3 | 110+6 | 111+8 (absolute value)
+    constexpr int RssiWidths[] = { 0, 3, 6 };
+
+    bool Seek(FILE* file, uint64_t offset)
+    {
+#ifdef _WIN32
+        return _fseeki64(file, static_cast<int64_t>(offset), SEEK_SET) == 0;
+#else
+        return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+    }
+
+    int64_t NowMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+}
+
+LuminaRssiHistory::LuminaRssiHistory()
+{
+}
+
+LuminaRssiHistory::~LuminaRssiHistory()
+{
+    Close();
+}
+
+bool LuminaRssiHistory::Open(const std::filesystem::path& directory, const std::string& name, std::string& error)
+{
+    Close();
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    std::filesystem::path dataPath = directory / (name + ".dat");
+    std::filesystem::path indexPath = directory / (name + ".idx");
+
+    uint64_t dataSize = std::filesystem::exists(dataPath, ec) ? std::filesystem::file_size(dataPath, ec) : 0;
+
+    // Load the index, keeping only entries whose chunk made it to disk; a torn tail is cut off
+    std::unordered_map<uint64_t, std::vector<IndexEntry>> index;
+    uint64_t sampleCount = 0;
+    size_t validEntries = 0;
+    if (FILE* file = std::fopen(indexPath.string().c_str(), "rb"))
+    {
+        IndexEntry entry;
+        while (std::fread(&entry, sizeof(entry), 1, file) == 1 && entry.offset + entry.length <= dataSize)
+        {
+            index[entry.address].push_back(entry);
+            sampleCount += entry.count;
+            ++validEntries;
+        }
+        std::fclose(file);
+        std::filesystem::resize_file(indexPath, validEntries * sizeof(IndexEntry), ec);
+    }
+    for (auto& [address, entries] : index)
+    {
+        std::stable_sort(entries.begin(), entries.end(), [](const IndexEntry& a, const IndexEntry& b) { return a.startMs < b.startMs; });
+    }
+
+    FILE* dataFile = std::fopen(dataPath.string().c_str(), "ab");
+    FILE* indexFile = std::fopen(indexPath.string().c_str(), "ab");
+    FILE* readFile = dataFile ? std::fopen(dataPath.string().c_str(), "rb") : nullptr;
+    if (!dataFile || !indexFile || !readFile)
+    {
+        error = "Failed to open RSSI history in " + directory.string() + ": " + std::strerror(errno);
+        if (dataFile) std::fclose(dataFile);
+        if (indexFile) std::fclose(indexFile);
+        if (readFile) std::fclose(readFile);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Index = std::move(index);
+    m_OpenChunks.clear();
+    m_PendingChunks.clear();
+    m_WritingChunks.clear();
+    m_DataFile = dataFile;
+    m_IndexFile = indexFile;
+    m_ReadFile = readFile;
+    m_DataSize = dataSize;
+    m_SampleCount = sampleCount;
+    m_StoredBytes = dataSize;
+    m_StopRequested = false;
+    m_IsOpen = true;
+    m_WriterThread = std::thread(&LuminaRssiHistory::WriterLoop, this);
+    return true;
+}
+
+void LuminaRssiHistory::Close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!m_IsOpen)
+        {
+            return;
+        }
+        for (auto& [address, chunk] : m_OpenChunks)
+        {
+            if (chunk.count > 0)
+            {
+                CloseChunk(address, chunk);
+            }
+        }
+        m_StopRequested = true;
+        m_IsOpen = false;
+    }
+    m_Wake.notify_one();
+    m_WriterThread.join();
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::fclose(m_DataFile);
+    std::fclose(m_IndexFile);
+    std::lock_guard<std::mutex> readLock(m_ReadMutex);
+    std::fclose(m_ReadFile);
+    m_DataFile = nullptr;
+    m_IndexFile = nullptr;
+    m_ReadFile = nullptr;
+    m_OpenChunks.clear();
+    m_Index.clear();
+}
+
+bool LuminaRssiHistory::IsOpen() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_IsOpen;
+}
+
+void LuminaRssiHistory::Record(uint64_t address, int64_t timeMs, int rssi)
+{
+    rssi = std::clamp(rssi, -127, 127);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!m_IsOpen)
+    {
+        return;
+    }
+
+    OpenChunk& chunk = m_OpenChunks[address];
+    if (chunk.lastMs != 0 && timeMs < chunk.lastMs + MinSampleIntervalMs)
+    {
+        return; // Throttled, or the clock went backwards
+    }
+    // Chunks never cross a ChunkAlignMs boundary, so aligned buckets never need decoding
+    if (chunk.count >= MaxChunkSamples || (chunk.count > 0 && timeMs / ChunkAlignMs != chunk.startMs / ChunkAlignMs))
+    {
+        CloseChunk(address, chunk);
+    }
+
+    Append(chunk, timeMs, rssi);
+    ++m_SampleCount;
+}
+
+void LuminaRssiHistory::Query(uint64_t address, int64_t fromMs, int64_t toMs, size_t bucketCount, std::vector<Lumina::RssiHistoryPoint>& points) const
+{
+    points.assign(bucketCount, Lumina::RssiHistoryPoint());
+    if (bucketCount == 0 || toMs <= fromMs)
+    {
+        return;
+    }
+    int64_t bucketMs = std::max<int64_t>(1, (toMs - fromMs + static_cast<int64_t>(bucketCount) - 1) / static_cast<int64_t>(bucketCount));
+    std::vector<Bucket> buckets(bucketCount);
+
+    // Chunks that need decoding from disk are read after the lock is released, so ingest never waits on I/O
+    std::vector<IndexEntry> toRead;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!m_IsOpen)
+        {
+            points.clear();
+            return;
+        }
+
+        auto indexed = m_Index.find(address);
+        if (indexed != m_Index.end())
+        {
+            // A chunk spans at most ChunkAlignMs, so nothing earlier than this can overlap the range
+            const auto& entries = indexed->second;
+            auto it = std::lower_bound(entries.begin(), entries.end(), fromMs - ChunkAlignMs,
+                [](const IndexEntry& entry, int64_t value) { return entry.startMs < value; });
+            for (; it != entries.end() && it->startMs < toMs; ++it)
+            {
+                if (it->endMs < fromMs)
+                {
+                    continue;
+                }
+                if (it->startMs >= fromMs && it->endMs < toMs && (it->startMs - fromMs) / bucketMs == (it->endMs - fromMs) / bucketMs)
+                {
+                    AddToBucket(buckets[static_cast<size_t>((it->startMs - fromMs) / bucketMs)], it->count, it->minRssi, it->maxRssi,
+                        static_cast<double>(it->meanRssi) * it->count);
+                }
+                else
+                {
+                    toRead.push_back(*it);
+                }
+            }
+        }
+
+        for (const auto* chunks : { &m_WritingChunks, &m_PendingChunks })
+        {
+            for (const auto& chunk : *chunks)
+            {
+                if (chunk.entry.address == address && chunk.entry.endMs >= fromMs && chunk.entry.startMs < toMs)
+                {
+                    Decode(chunk.bits.data(), chunk.bits.size(), chunk.entry.startMs, chunk.entry.count, fromMs, toMs, bucketMs, buckets);
+                }
+            }
+        }
+
+        auto open = m_OpenChunks.find(address);
+        if (open != m_OpenChunks.end() && open->second.count > 0)
+        {
+            const OpenChunk& chunk = open->second;
+            Decode(chunk.bits.data(), chunk.bits.size(), chunk.startMs, chunk.count, fromMs, toMs, bucketMs, buckets);
+        }
+    }
+
+    {
+        std::vector<uint8_t> buffer;
+        std::lock_guard<std::mutex> readLock(m_ReadMutex);
+        for (const auto& entry : toRead)
+        {
+            buffer.resize(entry.length);
+            if (m_ReadFile && Seek(m_ReadFile, entry.offset) &&
+                std::fread(buffer.data(), 1, buffer.size(), m_ReadFile) == buffer.size())
+            {
+                Decode(buffer.data(), buffer.size(), entry.startMs, entry.count, fromMs, toMs, bucketMs, buckets);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < bucketCount; ++i)
+    {
+        Lumina::RssiHistoryPoint& point = points[i];
+        point.startMs = fromMs + static_cast<int64_t>(i) * bucketMs;
+        point.count = buckets[i].count;
+        if (point.count > 0)
+        {
+            point.minRssi = static_cast<float>(buckets[i].minRssi);
+            point.maxRssi = static_cast<float>(buckets[i].maxRssi);
+            point.meanRssi = static_cast<float>(buckets[i].rssiSum / point.count);
+        }
+    }
+}
+
+void LuminaRssiHistory::WriterLoop()
+{
+    while (true)
+    {
+        bool isStopping = false;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Wake.wait_for(lock, std::chrono::seconds(1), [this] { return m_StopRequested || m_PendingChunks.size() >= PendingWakeupChunks; });
+            isStopping = m_StopRequested;
+            if (!isStopping)
+            {
+                CloseIdleChunks(NowMs());
+            }
+            m_WritingChunks.swap(m_PendingChunks);
+        }
+
+        if (!m_WritingChunks.empty())
+        {
+            WritePending();
+        }
+        if (isStopping)
+        {
+            break;
+        }
+    }
+}
+
+void LuminaRssiHistory::WritePending()
+{
+    // Data first, then the index that points at it, so a crash can only lose index entries
+    std::vector<IndexEntry> written;
+    for (auto& chunk : m_WritingChunks)
+    {
+        chunk.entry.offset = m_DataSize;
+        if (std::fwrite(chunk.bits.data(), 1, chunk.bits.size(), m_DataFile) != chunk.bits.size())
+        {
+            break;
+        }
+        m_DataSize += chunk.bits.size();
+        written.push_back(chunk.entry);
+    }
+    std::fflush(m_DataFile);
+    std::fwrite(written.data(), sizeof(IndexEntry), written.size(), m_IndexFile);
+    std::fflush(m_IndexFile);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (const auto& entry : written)
+    {
+        auto& entries = m_Index[entry.address];
+        auto position = std::upper_bound(entries.begin(), entries.end(), entry.startMs,
+            [](int64_t value, const IndexEntry& other) { return value < other.startMs; });
+        entries.insert(position, entry);
+    }
+    m_WritingChunks.clear();
+    m_StoredBytes = m_DataSize;
+}
+
+void LuminaRssiHistory::CloseChunk(uint64_t address, OpenChunk& chunk)
+{
+    ClosedChunk closed;
+    closed.entry = {};
+    closed.entry.address = address;
+    closed.entry.startMs = chunk.startMs;
+    closed.entry.endMs = chunk.lastMs;
+    closed.entry.length = static_cast<uint32_t>(chunk.bits.size());
+    closed.entry.count = chunk.count;
+    closed.entry.minRssi = static_cast<int8_t>(chunk.minRssi);
+    closed.entry.maxRssi = static_cast<int8_t>(chunk.maxRssi);
+    closed.entry.meanRssi = static_cast<float>(chunk.rssiSum) / chunk.count;
+    closed.bits = std::move(chunk.bits);
+    m_PendingChunks.push_back(std::move(closed));
+
+    // Keep lastMs so throttling carries across the chunk boundary
+    int64_t lastMs = chunk.lastMs;
+    chunk = OpenChunk();
+    chunk.lastMs = lastMs;
+
+    if (m_PendingChunks.size() >= PendingWakeupChunks)
+    {
+        m_Wake.notify_one();
+    }
+}
+
+void LuminaRssiHistory::CloseIdleChunks(int64_t nowMs)
+{
+    for (auto it = m_OpenChunks.begin(); it != m_OpenChunks.end();)
+    {
+        if (nowMs - it->second.lastMs >= IdleChunkCloseMs)
+        {
+            if (it->second.count > 0)
+            {
+                CloseChunk(it->first, it->second);
+            }
+            it = m_OpenChunks.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void LuminaRssiHistory::Append(OpenChunk& chunk, int64_t timeMs, int rssi)
+{
+    int64_t tick = timeMs / TickMs;
+    if (chunk.count == 0)
+    {
+        // First sample: time comes from the index, RSSI is stored as is
+        chunk.startMs = tick * TickMs;
+        chunk.lastTick = tick;
+        chunk.lastDelta = 0;
+        chunk.minRssi = rssi;
+        chunk.maxRssi = rssi;
+        WriteBits(chunk.bits, chunk.bitCount, static_cast<uint8_t>(static_cast<int8_t>(rssi)), 8);
+    }
+    else
+    {
+        int64_t delta = tick - chunk.lastTick;
+        int64_t deltaOfDelta = delta - chunk.lastDelta;
+        int code = 0;
+        if (deltaOfDelta != 0)
+        {
+            code = 1;
+            while (code < 4 && (deltaOfDelta < -(int64_t(1) << (TimestampWidths[code] - 1)) || deltaOfDelta >= (int64_t(1) << (TimestampWidths[code] - 1))))
+            {
+                ++code;
+            }
+        }
+        WriteBits(chunk.bits, chunk.bitCount, TimestampPrefixes[code], code == 4 ? 4 : code + 1);
+        WriteBits(chunk.bits, chunk.bitCount, static_cast<uint64_t>(deltaOfDelta), TimestampWidths[code]);
+        chunk.lastDelta = delta;
+        chunk.lastTick = tick;
+
+        int rssiDelta = rssi - chunk.lastRssi;
+        uint32_t zigzag = static_cast<uint32_t>((rssiDelta << 1) ^ (rssiDelta >> 31));
+        if (zigzag == 0)
+        {
+            WriteBits(chunk.bits, chunk.bitCount, 0, 1);
+        }
+        else if (zigzag < (1u << RssiWidths[1]))
+        {
+            WriteBits(chunk.bits, chunk.bitCount, 0b10, 2);
+            WriteBits(chunk.bits, chunk.bitCount, zigzag, RssiWidths[1]);
+        }
+        else if (zigzag < (1u << RssiWidths[2]))
+        {
+            WriteBits(chunk.bits, chunk.bitCount, 0b110, 3);
+            WriteBits(chunk.bits, chunk.bitCount, zigzag, RssiWidths[2]);
+        }
+        else
+        {
+            WriteBits(chunk.bits, chunk.bitCount, 0b111, 3);
+            WriteBits(chunk.bits, chunk.bitCount, static_cast<uint8_t>(static_cast<int8_t>(rssi)), 8);
+        }
+    }
+
+    chunk.lastRssi = rssi;
+    chunk.lastMs = timeMs;
+    chunk.minRssi = std::min(chunk.minRssi, rssi);
+    chunk.maxRssi = std::max(chunk.maxRssi, rssi);
+    chunk.rssiSum += rssi;
+    ++chunk.count;
+}
+
+void LuminaRssiHistory::Decode(const uint8_t* bits, size_t byteCount, int64_t startMs, uint32_t count,
+    int64_t fromMs, int64_t toMs, int64_t bucketMs, std::vector<Bucket>& buckets)
+{
+    BitReader reader(bits, byteCount);
+    int64_t tick = startMs / TickMs;
+    int64_t delta = 0;
+    int rssi = static_cast<int8_t>(reader.Read(8));
+
+    // Samples are in time order, so the bucket only ever moves forward
+    size_t bucket = 0;
+    int64_t bucketEndMs = fromMs + bucketMs;
+
+    for (uint32_t i = 0; i < count && reader.IsValid(); ++i)
+    {
+        if (i > 0)
+        {
+            int code = reader.ReadPrefix(4);
+            delta += code == 0 ? 0 : reader.ReadSigned(TimestampWidths[code]);
+            tick += delta;
+
+            int rssiCode = reader.ReadPrefix(3);
+            if (rssiCode == 3)
+            {
+                rssi = static_cast<int8_t>(reader.Read(8));
+            }
+            else if (rssiCode > 0)
+            {
+                uint32_t zigzag = static_cast<uint32_t>(reader.Read(RssiWidths[rssiCode]));
+                rssi += static_cast<int>(zigzag >> 1) ^ -static_cast<int>(zigzag & 1);
+            }
+        }
+
+        int64_t timeMs = tick * TickMs;
+        if (timeMs >= toMs)
+        {
+            break;
+        }
+        if (timeMs >= fromMs)
+        {
+            if (timeMs >= bucketEndMs)
+            {
+                bucket = static_cast<size_t>((timeMs - fromMs) / bucketMs);
+                bucketEndMs = fromMs + static_cast<int64_t>(bucket + 1) * bucketMs;
+            }
+            AddToBucket(buckets[bucket], 1, rssi, rssi, rssi);
+        }
+    }
+}
+
+void LuminaRssiHistory::AddToBucket(Bucket& bucket, uint32_t count, int minRssi, int maxRssi, double rssiSum)
+{
+    if (bucket.count == 0)
+    {
+        bucket.minRssi = minRssi;
+        bucket.maxRssi = maxRssi;
+    }
+    bucket.minRssi = std::min(bucket.minRssi, minRssi);
+    bucket.maxRssi = std::max(bucket.maxRssi, maxRssi);
+    bucket.rssiSum += rssiSum;
+    bucket.count += count;
+}
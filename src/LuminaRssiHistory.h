@@ -0,0 +1,138 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Lumina
+{
+    // One bucket of a history query
+    struct RssiHistoryPoint
+    {
+        int64_t startMs = 0;
+        uint32_t count = 0;     // 0 for buckets with no samples
+        float minRssi = 0.0f;
+        float maxRssi = 0.0f;
+        float meanRssi = 0.0f;
+    };
+}
+
+// Long-term per-device RSSI history on disk. Samples go into an open chunk per device, encoded as they
+// arrive: timestamps as delta-of-delta in 10 ms ticks and RSSI as zigzag deltas, both in variable-width
+// bit codes. Closed chunks are appended to <name>.dat by a writer thread, and indexed in <name>.idx by
+// device and time range together with their min/max/mean, so wide queries are answered from the index.
+class LuminaRssiHistory
+{
+public:
+    // Chunks are cut at multiples of this, so buckets aligned to it are answered from the index alone
+    static constexpr int64_t ChunkAlignMs = 15 * 60 * 1000;
+
+    LuminaRssiHistory();
+    ~LuminaRssiHistory();
+    LuminaRssiHistory(const LuminaRssiHistory&) = delete;
+    LuminaRssiHistory& operator=(const LuminaRssiHistory&) = delete;
+
+    bool Open(const std::filesystem::path& directory, const std::string& name, std::string& error);
+    // Closes every open chunk and writes it out
+    void Close();
+    bool IsOpen() const;
+
+    // Thread-safe. Keeps at most one sample per device per MinSampleIntervalMs.
+    void Record(uint64_t address, int64_t timeMs, int rssi);
+
+    // Summarizes [fromMs, toMs) into bucketCount equal buckets. Chunks that fit inside one bucket are taken
+    // from the index without touching the data file; the rest are read back and decoded.
+    void Query(uint64_t address, int64_t fromMs, int64_t toMs, size_t bucketCount, std::vector<Lumina::RssiHistoryPoint>& points) const;
+
+    uint64_t GetSampleCount() const { return m_SampleCount; }
+    uint64_t GetStoredBytes() const { return m_StoredBytes; }
+
+private:
+    static constexpr int64_t TickMs = 10;
+    static constexpr int64_t MinSampleIntervalMs = 1000;
+    static constexpr uint32_t MaxChunkSamples = 1024;
+    static constexpr int64_t IdleChunkCloseMs = 10 * 60 * 1000;
+    static constexpr size_t PendingWakeupChunks = 64;
+
+    // On-disk index record; chunks of one device are appended in time order
+    struct IndexEntry
+    {
+        uint64_t address;
+        int64_t startMs;
+        int64_t endMs;
+        uint64_t offset;
+        uint32_t length;
+        uint32_t count;
+        int8_t minRssi;
+        int8_t maxRssi;
+        int16_t reserved;
+        float meanRssi;
+    };
+
+    struct OpenChunk
+    {
+        std::vector<uint8_t> bits;
+        size_t bitCount = 0;
+        int64_t startMs = 0;
+        int64_t lastTick = 0;
+        int64_t lastDelta = 0;
+        int64_t lastMs = 0;
+        int lastRssi = 0;
+        uint32_t count = 0;
+        int minRssi = 0;
+        int maxRssi = 0;
+        int64_t rssiSum = 0;
+    };
+
+    // Query accumulator for one bucket
+    struct Bucket
+    {
+        uint32_t count = 0;
+        int minRssi = 0;
+        int maxRssi = 0;
+        double rssiSum = 0.0;
+    };
+
+    struct ClosedChunk
+    {
+        IndexEntry entry;
+        std::vector<uint8_t> bits;
+    };
+
+    mutable std::mutex m_Mutex;                                     // Guards everything below
+    std::unordered_map<uint64_t, OpenChunk> m_OpenChunks;
+    std::unordered_map<uint64_t, std::vector<IndexEntry>> m_Index;  // Only chunks already on disk
+    std::vector<ClosedChunk> m_PendingChunks;                       // Closed, not yet written
+    std::vector<ClosedChunk> m_WritingChunks;                       // Being written, not yet indexed
+    bool m_IsOpen = false;
+
+    mutable std::mutex m_ReadMutex;
+    FILE* m_ReadFile = nullptr;
+
+    // Writer thread; the files are only touched by it once open
+    std::thread m_WriterThread;
+    std::condition_variable m_Wake;
+    bool m_StopRequested = false;
+    FILE* m_DataFile = nullptr;
+    FILE* m_IndexFile = nullptr;
+    uint64_t m_DataSize = 0;
+
+    std::atomic<uint64_t> m_SampleCount = 0;
+    std::atomic<uint64_t> m_StoredBytes = 0;
+
+    void WriterLoop();
+    void WritePending();
+    void CloseChunk(uint64_t address, OpenChunk& chunk);
+    void CloseIdleChunks(int64_t nowMs);
+
+    static void Append(OpenChunk& chunk, int64_t timeMs, int rssi);
+    static void Decode(const uint8_t* bits, size_t byteCount, int64_t startMs, uint32_t count,
+        int64_t fromMs, int64_t toMs, int64_t bucketMs, std::vector<Bucket>& buckets);
+    static void AddToBucket(Bucket& bucket, uint32_t count, int minRssi, int maxRssi, double rssiSum);
+};
@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <ctime>
+#include "LuminaScanExporter.h"
+#include "LuminaHelper.h"
+
+namespace
+{
+    using ColumnType = LuminaArrowWriter::ColumnType;
+
+    enum AdvertColumn : size_t { AdvertTime, AdvertAddress, AdvertName, AdvertRssi, AdvertType, AdvertPayload };
+    const std::vector<LuminaArrowWriter::Column> AdvertColumns = {
+        { "time", ColumnType::TimestampMicros },
+        { "address", ColumnType::DictionaryUtf8 },
+        { "name", ColumnType::DictionaryUtf8 },
+        { "rssi", ColumnType::Int16 },
+        { "advertisement_type", ColumnType::UInt8 },
+        { "payload", ColumnType::Binary },
+    };
+
+    enum DeviceColumn : size_t { DeviceAddress, DeviceName, DeviceFirstSeen, DeviceLastSeen, DeviceAdverts, DeviceMinRssi, DeviceMaxRssi, DeviceMeanRssi,
+        DeviceInterval, DeviceJitter, DeviceMissed };
+    const std::vector<LuminaArrowWriter::Column> DeviceColumns = {
+        { "address", ColumnType::DictionaryUtf8 },
+        { "name", ColumnType::DictionaryUtf8 },
+        { "first_seen", ColumnType::TimestampMicros },
+        { "last_seen", ColumnType::TimestampMicros },
+        { "adverts", ColumnType::UInt32 },
+        { "min_rssi", ColumnType::Int16 },
+        { "max_rssi", ColumnType::Int16 },
+        { "mean_rssi", ColumnType::Float32 },
+        { "interval_ms", ColumnType::Float32, true },
+        { "jitter_ms", ColumnType::Float32, true },
+        { "missed_ratio", ColumnType::Float32, true },
+    };
+
+    std::string SessionName()
+    {
+        std::time_t now = std::time(nullptr);
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &now);
+#else
+        localtime_r(&now, &local);
+#endif
+        char text[32];
+        std::strftime(text, sizeof(text), "scan-%Y%m%d-%H%M%S", &local);
+        return text;
+    }
+}
+
+void LuminaScanExporter::Pending::Clear()
+{
+    adverts.clear();
+    payloads.clear();
+    names.clear();
+}
+
+LuminaScanExporter::LuminaScanExporter()
+{
+}
+
+LuminaScanExporter::~LuminaScanExporter()
+{
+    Stop();
+}
+
+bool LuminaScanExporter::Start(const std::filesystem::path& directory, std::string& error)
+{
+    std::lock_guard<std::mutex> control(m_ControlMutex);
+    StopLocked();
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    std::string session = SessionName();
+    m_AdvertsPath = directory / (session + "-adverts.arrows");
+    m_DevicesPath = directory / (session + "-devices.arrows");
+    if (!m_AdvertWriter.Open(m_AdvertsPath, AdvertColumns, error))
+    {
+        return false;
+    }
+    m_AdvertBatch = m_AdvertWriter.CreateBatch();
+    m_Devices.clear();
+
+    // Samples carry steady_clock time; the files carry wall-clock time
+    m_SteadyToUnix = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()) -
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch());
+
+    m_AdvertCount = 0;
+    m_DroppedCount = 0;
+    m_RowGroupCount = 0;
+    m_ByteCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_PendingMutex);
+        m_Pending.Clear();
+        m_StopRequested = false;
+    }
+    m_ExportThread = std::thread(&LuminaScanExporter::ExportLoop, this);
+    return true;
+}
+
+void LuminaScanExporter::Stop()
+{
+    std::lock_guard<std::mutex> control(m_ControlMutex);
+    StopLocked();
+}
+
+bool LuminaScanExporter::IsRunning() const
+{
+    std::lock_guard<std::mutex> control(m_ControlMutex);
+    return m_ExportThread.joinable();
+}
+
+void LuminaScanExporter::StopLocked()
+{
+    if (!m_ExportThread.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_PendingMutex);
+        m_StopRequested = true;
+    }
+    m_Wake.notify_one();
+    m_ExportThread.join();
+}
+
+void LuminaScanExporter::RecordAdvert(const Lumina::AdvertisementSample& sample, const std::string* name)
+{
+    int64_t timestampMicros = (std::chrono::duration_cast<std::chrono::microseconds>(sample.timestamp.time_since_epoch()) + m_SteadyToUnix).count();
+
+    bool isRowGroupReady = false;
+    {
+        std::lock_guard<std::mutex> lock(m_PendingMutex);
+        if (m_StopRequested)
+        {
+            return;
+        }
+        if (m_Pending.adverts.size() >= MaxPendingAdverts)
+        {
+            ++m_DroppedCount;
+            return;
+        }
+
+        if (name)
+        {
+            m_Pending.names.push_back({ m_Pending.adverts.size(), *name });
+        }
+        m_Pending.adverts.push_back({ sample.address, timestampMicros, sample.rssi, sample.advertisementType, sample.payloadLength, m_Pending.payloads.size() });
+        m_Pending.payloads.insert(m_Pending.payloads.end(), sample.payload, sample.payload + sample.payloadLength);
+        isRowGroupReady = m_Pending.adverts.size() == RowGroupSize;
+    }
+
+    if (isRowGroupReady)
+    {
+        m_Wake.notify_one();
+    }
+}
+
+LuminaScanExporter::Stats LuminaScanExporter::GetStats() const
+{
+    Stats stats;
+    stats.adverts = m_AdvertCount;
+    stats.dropped = m_DroppedCount;
+    stats.rowGroups = m_RowGroupCount;
+    stats.bytes = m_ByteCount;
+    return stats;
+}
+
+void LuminaScanExporter::ExportLoop()
+{
+    // Double buffering: the producer fills one Pending while this thread encodes the other
+    Pending working;
+    auto lastRowGroup = std::chrono::steady_clock::now();
+    bool isStopping = false;
+    while (!isStopping)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_PendingMutex);
+            m_Wake.wait_for(lock, std::chrono::seconds(1), [this] { return m_StopRequested || m_Pending.adverts.size() >= RowGroupSize; });
+            isStopping = m_StopRequested;
+            std::swap(working, m_Pending);
+        }
+
+        ExportPending(working);
+        working.Clear();
+
+        // Keep row groups large for readers, but don't let a quiet session sit in memory indefinitely
+        auto now = std::chrono::steady_clock::now();
+        if (m_AdvertBatch.GetRowCount() >= RowGroupSize || (m_AdvertBatch.GetRowCount() > 0 && now - lastRowGroup >= MaxRowGroupAge))
+        {
+            WriteRowGroup();
+            lastRowGroup = now;
+        }
+    }
+
+    if (m_AdvertBatch.GetRowCount() > 0)
+    {
+        WriteRowGroup();
+    }
+    m_AdvertWriter.Close();
+    WriteDeviceSummary();
+}
+
+void LuminaScanExporter::ExportPending(const Pending& pending)
+{
+    size_t nextName = 0;
+    for (size_t i = 0; i < pending.adverts.size(); ++i)
+    {
+        const PendingAdvert& advert = pending.adverts[i];
+        DeviceSummary& device = m_Devices[advert.address];
+        while (nextName < pending.names.size() && pending.names[nextName].advertIndex == i)
+        {
+            device.name = pending.names[nextName++].name;
+        }
+
+        if (device.advertCount == 0)
+        {
+            device.addressText = LuminaHelper::BluetoothAddressToString(advert.address);
+            device.firstSeenMicros = advert.timestampMicros;
+            device.minRssi = advert.rssi;
+            device.maxRssi = advert.rssi;
+        }
+        device.lastSeenMicros = advert.timestampMicros;
+        device.minRssi = std::min(device.minRssi, advert.rssi);
+        device.maxRssi = std::max(device.maxRssi, advert.rssi);
+        device.rssiSum += advert.rssi;
+        ++device.advertCount;
+        if (advert.advertisementType != Lumina::AdvertisementSample::ScanResponseType)
+        {
+            device.advertisingInterval.Add(advert.timestampMicros);
+        }
+
+        m_AdvertBatch.AppendInteger(AdvertTime, advert.timestampMicros);
+        m_AdvertBatch.AppendBytes(AdvertAddress, device.addressText);
+        m_AdvertBatch.AppendBytes(AdvertName, device.name);
+        m_AdvertBatch.AppendInteger(AdvertRssi, advert.rssi);
+        m_AdvertBatch.AppendInteger(AdvertType, advert.advertisementType);
+        m_AdvertBatch.AppendBytes(AdvertPayload, std::string_view(reinterpret_cast<const char*>(pending.payloads.data()) + advert.payloadOffset, advert.payloadLength));
+
+        if (m_AdvertBatch.GetRowCount() >= RowGroupSize)
+        {
+            WriteRowGroup();
+        }
+    }
+}
+
+void LuminaScanExporter::WriteRowGroup()
+{
+    std::string error;
+    if (m_AdvertWriter.WriteBatch(m_AdvertBatch, error))
+    {
+        m_AdvertCount += m_AdvertBatch.GetRowCount();
+        ++m_RowGroupCount;
+    }
+    else
+    {
+        m_DroppedCount += m_AdvertBatch.GetRowCount();
+    }
+    m_ByteCount = m_AdvertWriter.GetBytesWritten();
+    m_AdvertBatch.Clear();
+}
+
+void LuminaScanExporter::WriteDeviceSummary()
+{
+    LuminaArrowWriter writer;
+    std::string error;
+    if (!writer.Open(m_DevicesPath, DeviceColumns, error))
+    {
+        return;
+    }
+
+    LuminaArrowWriter::Batch batch = writer.CreateBatch();
+    for (const auto& [address, device] : m_Devices)
+    {
+        batch.AppendBytes(DeviceAddress, device.addressText);
+        batch.AppendBytes(DeviceName, device.name);
+        batch.AppendInteger(DeviceFirstSeen, device.firstSeenMicros);
+        batch.AppendInteger(DeviceLastSeen, device.lastSeenMicros);
+        batch.AppendInteger(DeviceAdverts, device.advertCount);
+        batch.AppendInteger(DeviceMinRssi, device.minRssi);
+        batch.AppendInteger(DeviceMaxRssi, device.maxRssi);
+        batch.AppendFloat(DeviceMeanRssi, static_cast<float>(device.rssiSum) / std::max<uint32_t>(device.advertCount, 1));
+        // Null until enough adverts were seen; devices heard only through scan responses never have an estimate
+        LuminaIntervalEstimator::Estimate interval = device.advertisingInterval.GetEstimate();
+        if (interval.isValid)
+        {
+            batch.AppendFloat(DeviceInterval, interval.intervalMs);
+            batch.AppendFloat(DeviceJitter, interval.jitterMs);
+            batch.AppendFloat(DeviceMissed, interval.missedRatio);
+        }
+        else
+        {
+            batch.AppendNull(DeviceInterval);
+            batch.AppendNull(DeviceJitter);
+            batch.AppendNull(DeviceMissed);
+        }
+    }
+    writer.WriteBatch(batch, error);
+    writer.Close();
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "LuminaAdvertisement.h"
+#include "LuminaArrowWriter.h"
+#include "LuminaIntervalEstimator.h"
+
+// Persists a scan session for offline analysis as two Arrow IPC streams in the export directory:
+//   scan-<time>-adverts.arrows   one row per advert (row groups of RowGroupSize)
+//   scan-<time>-devices.arrows   one summary row per device, written when the session stops
+// The ingest path only appends to an in-memory buffer; encoding and disk I/O happen on the export thread.
+class LuminaScanExporter
+{
+public:
+    struct Stats
+    {
+        uint64_t adverts = 0;   // Written to the adverts stream
+        uint64_t dropped = 0;   // Discarded because the export thread fell behind
+        uint64_t rowGroups = 0;
+        uint64_t bytes = 0;
+    };
+
+    LuminaScanExporter();
+    ~LuminaScanExporter();
+    LuminaScanExporter(const LuminaScanExporter&) = delete;
+    LuminaScanExporter& operator=(const LuminaScanExporter&) = delete;
+
+    // Start/Stop may be called from different threads (UI toggle, scan timeout)
+    bool Start(const std::filesystem::path& directory, std::string& error);
+    // Flushes what is buffered, writes the device summary and closes both files
+    void Stop();
+    bool IsRunning() const;
+
+    // Thread-safe, never waits on disk. Pass the device name when it may have changed, else nullptr; it goes to
+    // a UTF-8 column, so it must be valid UTF-8 (see LuminaHelper::ReplaceInvalidUtf8).
+    void RecordAdvert(const Lumina::AdvertisementSample& sample, const std::string* name);
+
+    Stats GetStats() const;
+    std::filesystem::path GetAdvertsPath() const { return m_AdvertsPath; }
+
+private:
+    static constexpr size_t RowGroupSize = 64 * 1024;
+    static constexpr size_t MaxPendingAdverts = 1024 * 1024;
+    static constexpr auto MaxRowGroupAge = std::chrono::seconds(5);
+
+    struct PendingAdvert
+    {
+        uint64_t address;
+        int64_t timestampMicros;
+        int16_t rssi;
+        uint8_t advertisementType;
+        uint16_t payloadLength;
+        size_t payloadOffset;
+    };
+
+    struct PendingName
+    {
+        size_t advertIndex; // Applies from this advert on
+        std::string name;
+    };
+
+    struct Pending
+    {
+        std::vector<PendingAdvert> adverts;
+        std::vector<uint8_t> payloads;
+        std::vector<PendingName> names;
+
+        void Clear();
+    };
+
+    struct DeviceSummary
+    {
+        std::string addressText;
+        std::string name;
+        int64_t firstSeenMicros = 0;
+        int64_t lastSeenMicros = 0;
+        uint32_t advertCount = 0;
+        int16_t minRssi = 0;
+        int16_t maxRssi = 0;
+        int64_t rssiSum = 0;
+        LuminaIntervalEstimator advertisingInterval;
+    };
+
+    std::filesystem::path m_AdvertsPath;
+    std::filesystem::path m_DevicesPath;
+    std::chrono::microseconds m_SteadyToUnix{ 0 };
+
+    // Producer side, swapped out whole by the export thread
+    std::mutex m_PendingMutex;
+    std::condition_variable m_Wake;
+    Pending m_Pending;
+    bool m_StopRequested = true; // Also set while no session is running, so adverts are ignored
+
+    mutable std::mutex m_ControlMutex;
+    std::thread m_ExportThread;
+
+    // Export thread only
+    LuminaArrowWriter m_AdvertWriter;
+    LuminaArrowWriter::Batch m_AdvertBatch;
+    std::unordered_map<uint64_t, DeviceSummary> m_Devices;
+
+    std::atomic<uint64_t> m_AdvertCount = 0;
+    std::atomic<uint64_t> m_DroppedCount = 0;
+    std::atomic<uint64_t> m_RowGroupCount = 0;
+    std::atomic<uint64_t> m_ByteCount = 0;
+
+    void StopLocked();
+    void ExportLoop();
+    void ExportPending(const Pending& pending);
+    void WriteRowGroup();
+    void WriteDeviceSummary();
+};
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include "LuminaScanMerger.h"
+
+LuminaScanMerger::LuminaScanMerger()
+{
+}
+
+LuminaScanMerger::~LuminaScanMerger()
+{
+    Stop();
+}
+
+void LuminaScanMerger::Start(int laneCount, std::chrono::milliseconds reorderWindow)
+{
+    Stop();
+
+    m_Lanes.clear();
+    for (int i = 0; i < std::max(laneCount, 1); ++i)
+    {
+        m_Lanes.push_back(std::make_unique<Lane>());
+    }
+    m_ReorderWindow = reorderWindow;
+    m_Received = 0;
+    m_Merged = 0;
+    m_Emitted = 0;
+    m_StopRequested = false;
+
+    if (m_Lanes.size() > 1)
+    {
+        m_MergeThread = std::thread(&LuminaScanMerger::MergeLoop, this);
+    }
+}
+
+void LuminaScanMerger::Stop()
+{
+    if (m_MergeThread.joinable())
+    {
+        m_StopRequested = true;
+        m_Wake.notify_one();
+        m_MergeThread.join();
+    }
+    m_Pending.clear();
+    m_PendingByKey.clear();
+}
+
+void LuminaScanMerger::Push(int lane, const Lumina::AdvertisementSample& sample)
+{
+    ++m_Received;
+    if (m_Lanes.size() <= 1)
+    {
+        Lumina::AdvertisementSample single = sample;
+        single.adapterIndex = 0;
+        single.adapterRssi[0] = static_cast<int8_t>(std::clamp<int>(sample.rssi, -126, 126));
+        ++m_Emitted;
+        if (m_OnSample)
+        {
+            m_OnSample(single);
+        }
+        return;
+    }
+
+    if (lane < 0 || lane >= static_cast<int>(m_Lanes.size()))
+    {
+        return;
+    }
+    Lane& target = *m_Lanes[lane];
+    std::lock_guard<std::mutex> lock(target.mutex);
+    target.queue.push_back(sample);
+    target.queue.back().adapterIndex = static_cast<uint8_t>(lane);
+}
+
+LuminaScanMerger::Stats LuminaScanMerger::GetStats() const
+{
+    Stats stats;
+    stats.received = m_Received;
+    stats.merged = m_Merged;
+    stats.emitted = m_Emitted;
+    return stats;
+}
+
+void LuminaScanMerger::MergeLoop()
+{
+    // Tick at a fraction of the window so samples leave close to their deadline
+    auto tick = std::max(std::chrono::milliseconds(1), m_ReorderWindow / 4);
+    while (!m_StopRequested)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_WakeMutex);
+            m_Wake.wait_for(lock, tick, [this] { return m_StopRequested.load(); });
+        }
+        Collect();
+        EmitUntil(std::chrono::steady_clock::now() - m_ReorderWindow);
+    }
+
+    // Drain whatever is left
+    Collect();
+    EmitUntil(std::chrono::steady_clock::time_point::max());
+}
+
+void LuminaScanMerger::Collect()
+{
+    std::vector<Lumina::AdvertisementSample> batch;
+    for (auto& lane : m_Lanes)
+    {
+        {
+            std::lock_guard<std::mutex> lock(lane->mutex);
+            batch.swap(lane->queue);
+        }
+        for (auto& sample : batch)
+        {
+            Insert(sample);
+        }
+        batch.clear();
+    }
+}
+
+void LuminaScanMerger::Insert(Lumina::AdvertisementSample& sample)
+{
+    size_t lane = sample.adapterIndex;
+    if (lane < Lumina::AdvertisementSample::MaxAdapters)
+    {
+        sample.adapterRssi[lane] = static_cast<int8_t>(std::clamp<int>(sample.rssi, -126, 126));
+    }
+
+    // Same advert already pending from another adapter: fold it in
+    auto existing = m_PendingByKey.find(PendingKey(sample));
+    if (existing != m_PendingByKey.end())
+    {
+        Lumina::AdvertisementSample& pending = existing->second->second;
+        if (pending.HasSamePayload(sample) && lane < Lumina::AdvertisementSample::MaxAdapters &&
+            pending.adapterRssi[lane] == Lumina::AdvertisementSample::NoRssi)
+        {
+            pending.adapterRssi[lane] = sample.adapterRssi[lane];
+            pending.rssi = std::max(pending.rssi, sample.rssi);
+            ++m_Merged;
+            return;
+        }
+    }
+
+    auto it = m_Pending.emplace(sample.timestamp, sample);
+    m_PendingByKey[PendingKey(sample)] = it;
+}
+
+uint64_t LuminaScanMerger::PendingKey(const Lumina::AdvertisementSample& sample)
+{
+    // Bluetooth addresses are 48 bits, leaving the top byte for the advert type
+    return (sample.address & 0x00FFFFFFFFFFFFFFull) | (static_cast<uint64_t>(sample.advertisementType) << 56);
+}
+
+void LuminaScanMerger::EmitUntil(std::chrono::steady_clock::time_point watermark)
+{
+    while (!m_Pending.empty() && m_Pending.begin()->first <= watermark)
+    {
+        auto it = m_Pending.begin();
+        auto indexed = m_PendingByKey.find(PendingKey(it->second));
+        if (indexed != m_PendingByKey.end() && indexed->second == it)
+        {
+            m_PendingByKey.erase(indexed);
+        }
+
+        ++m_Emitted;
+        if (m_OnSample)
+        {
+            m_OnSample(it->second);
+        }
+        m_Pending.erase(it);
+    }
+}
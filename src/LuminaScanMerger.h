@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "LuminaAdvertisement.h"
+
+// Merges advert streams from several adapters into one stream ordered by timestamp.
+// Each adapter pushes into its own lane from its own thread. A merge thread holds samples
+// for a short reorder window, folds the same advert seen by several adapters into one sample
+// with per-adapter RSSI, and hands the result to the ingest callback in timestamp order.
+class LuminaScanMerger
+{
+public:
+    struct Stats
+    {
+        uint64_t received = 0;
+        uint64_t merged = 0;  // Duplicate sightings folded into an earlier sample
+        uint64_t emitted = 0;
+    };
+
+    LuminaScanMerger();
+    ~LuminaScanMerger();
+    LuminaScanMerger(const LuminaScanMerger&) = delete;
+    LuminaScanMerger& operator=(const LuminaScanMerger&) = delete;
+
+    // With a single lane there is nothing to reorder, so samples pass straight through.
+    void Start(int laneCount, std::chrono::milliseconds reorderWindow = std::chrono::milliseconds(20));
+    void Stop();
+
+    // Thread-safe; one producer per lane
+    void Push(int lane, const Lumina::AdvertisementSample& sample);
+
+    Stats GetStats() const;
+    int GetLaneCount() const { return static_cast<int>(m_Lanes.size()); }
+
+    // Called on the merge thread (or the producer thread with a single lane)
+    void HandleOnSample(const std::function<void(const Lumina::AdvertisementSample&)>& callback) { m_OnSample = callback; }
+
+private:
+    struct Lane
+    {
+        std::mutex mutex;
+        std::vector<Lumina::AdvertisementSample> queue;
+    };
+
+    std::vector<std::unique_ptr<Lane>> m_Lanes;
+    std::chrono::milliseconds m_ReorderWindow{ 0 };
+
+    // Merge thread state: samples ordered by time, plus the newest pending sample per address and advert type.
+    // Keyed by type too, so an advert and its scan response pending together both still fold.
+    std::multimap<std::chrono::steady_clock::time_point, Lumina::AdvertisementSample> m_Pending;
+    std::unordered_map<uint64_t, std::multimap<std::chrono::steady_clock::time_point, Lumina::AdvertisementSample>::iterator> m_PendingByKey;
+
+    std::thread m_MergeThread;
+    std::mutex m_WakeMutex;
+    std::condition_variable m_Wake;
+    std::atomic<bool> m_StopRequested = false;
+
+    std::atomic<uint64_t> m_Received = 0;
+    std::atomic<uint64_t> m_Merged = 0;
+    std::atomic<uint64_t> m_Emitted = 0;
+
+    std::function<void(const Lumina::AdvertisementSample&)> m_OnSample;
+
+    void MergeLoop();
+    void Collect();
+    void Insert(Lumina::AdvertisementSample& sample);
+    static uint64_t PendingKey(const Lumina::AdvertisementSample& sample);
+    void EmitUntil(std::chrono::steady_clock::time_point watermark);
+};
@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <cmath>
+#include "LuminaScanProfile.h"
+
+namespace
+{
+    using namespace std::chrono_literals;
+
+    constexpr std::array<Lumina::ScanProfile, Lumina::ScanProfileCount> Profiles = { {
+        { Lumina::ScanProfileId::LowLatency, "low-latency", "Low latency",
+            "Active scan, no signal threshold. Devices show up on their first advert.",
+            true, Lumina::ScanProfile::NoThreshold, Lumina::ScanProfile::NoThreshold, 0ms, false },
+        { Lumina::ScanProfileId::HighDensity, "high-density", "High density",
+            "Passive scan for crowded spaces: no scan requests, weak devices dropped, slow to time out.",
+            false, -85, -95, 10000ms, false },
+        { Lumina::ScanProfileId::LowPower, "low-power", "Low power",
+            "Passive scan of nearby devices only.",
+            false, -70, -80, 5000ms, false },
+        { Lumina::ScanProfileId::ExtendedAdverts, "extended", "Extended adverts",
+            "Active scan with no threshold that also reports Bluetooth 5 extended adverts, on whichever PHY the adapter scans.",
+            true, Lumina::ScanProfile::NoThreshold, Lumina::ScanProfile::NoThreshold, 0ms, true },
+    } };
+}
+
+namespace Lumina
+{
+    const ScanProfile& GetScanProfile(ScanProfileId id)
+    {
+        return Profiles[static_cast<size_t>(id)];
+    }
+
+    const ScanProfile* FindScanProfile(std::string_view name)
+    {
+        auto it = std::find_if(Profiles.begin(), Profiles.end(),
+            [name](const ScanProfile& profile) { return name == profile.name; });
+        return it != Profiles.end() ? &*it : nullptr;
+    }
+
+    void DiscoveryHistogram::Record(std::chrono::steady_clock::duration latency)
+    {
+        double ms = std::max(0.0, std::chrono::duration<double, std::milli>(latency).count());
+        size_t bucket = std::upper_bound(BucketEdgesMs.begin(), BucketEdgesMs.end(), ms,
+            [](double value, int edge) { return value < edge; }) - BucketEdgesMs.begin();
+        ++m_Buckets[bucket];
+        ++m_Count;
+        m_SumMs += ms;
+        m_MaxMs = std::max(m_MaxMs, ms);
+    }
+
+    void DiscoveryHistogram::Clear()
+    {
+        *this = DiscoveryHistogram();
+    }
+
+    double DiscoveryHistogram::GetPercentileMs(double fraction) const
+    {
+        if (m_Count == 0)
+        {
+            return 0.0;
+        }
+        uint64_t rank = static_cast<uint64_t>(std::ceil(std::clamp(fraction, 0.0, 1.0) * m_Count));
+        uint64_t seen = 0;
+        for (size_t i = 0; i + 1 < BucketCount; ++i)
+        {
+            seen += m_Buckets[i];
+            if (seen >= std::max<uint64_t>(rank, 1))
+            {
+                return std::min<double>(BucketEdgesMs[i], m_MaxMs);
+            }
+        }
+        return m_MaxMs;
+    }
+}
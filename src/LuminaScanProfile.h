@@ -0,0 +1,61 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+namespace Lumina
+{
+    enum class ScanProfileId : uint8_t
+    {
+        LowLatency,
+        HighDensity,
+        LowPower,
+        ExtendedAdverts,
+    };
+    constexpr size_t ScanProfileCount = 4;
+
+    // Watcher settings for one kind of scan
+    struct ScanProfile
+    {
+        static constexpr int16_t NoThreshold = -127;
+
+        ScanProfileId id;
+        const char* name;               // Short key, e.g. for --profile
+        const char* label;
+        const char* description;
+        bool isActive;                  // Active scans request scan responses, which often carry the name
+        int16_t inRangeDbm;             // Devices are reported once they reach this; NoThreshold reports everything
+        int16_t outOfRangeDbm;          // Dropped after staying below this for outOfRangeTimeout
+        std::chrono::milliseconds outOfRangeTimeout;
+        bool allowExtendedAdvertisements; // Bluetooth 5 extended adverts; the radio still picks the PHY
+    };
+
+    const ScanProfile& GetScanProfile(ScanProfileId id);
+    const ScanProfile* FindScanProfile(std::string_view name);
+
+    // Time from a device's first advert to it appearing in the device table, in fixed log-spaced buckets
+    class DiscoveryHistogram
+    {
+    public:
+        static constexpr size_t BucketCount = 11;
+        // Upper bound of each bucket in ms; the last bucket is open-ended
+        static constexpr std::array<int, BucketCount - 1> BucketEdgesMs = { 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000 };
+
+        void Record(std::chrono::steady_clock::duration latency);
+        void Clear();
+
+        uint64_t GetCount() const { return m_Count; }
+        uint64_t GetBucket(size_t index) const { return m_Buckets[index]; }
+        double GetMeanMs() const { return m_Count > 0 ? m_SumMs / m_Count : 0.0; }
+        double GetMaxMs() const { return m_MaxMs; }
+        // Upper edge of the bucket holding the given fraction (0-1) of samples; the max for the open bucket
+        double GetPercentileMs(double fraction) const;
+
+    private:
+        std::array<uint64_t, BucketCount> m_Buckets = {};
+        uint64_t m_Count = 0;
+        double m_SumMs = 0.0;
+        double m_MaxMs = 0.0;
+    };
+}
@@ -0,0 +1,127 @@
+#include <chrono>
+#include <cstring>
+#include "LuminaSharedTable.h"
+
+using namespace Lumina::SharedTable;
+
+LuminaSharedTableWriter::LuminaSharedTableWriter()
+{
+}
+
+LuminaSharedTableWriter::~LuminaSharedTableWriter()
+{
+    Close();
+}
+
+bool LuminaSharedTableWriter::Open(const std::string& name, std::string& error)
+{
+    Close();
+    if (!m_Mapping.Create(name, error))
+    {
+        return false;
+    }
+
+    // The segment starts zeroed; fill in the header and publish the magic last
+    m_Table = m_Mapping.GetLayout();
+    m_Table->header.version = Version;
+    m_Table->header.capacity = Capacity;
+    m_Table->header.nameSize = static_cast<uint32_t>(NameSize);
+    m_Table->header.rowCount.store(0, std::memory_order_relaxed);
+    m_Table->header.generation.store(1, std::memory_order_relaxed);
+    m_Table->header.magic.store(Magic, std::memory_order_release);
+    return true;
+}
+
+void LuminaSharedTableWriter::Close()
+{
+    if (m_Table)
+    {
+        // Readers still holding a mapping see an empty table rather than stale rows
+        m_Table->header.rowCount.store(0, std::memory_order_release);
+        m_Table->header.magic.store(0, std::memory_order_release);
+    }
+    m_Mapping.Close();
+    m_Table = nullptr;
+    m_RowByAddress.clear();
+}
+
+void LuminaSharedTableWriter::Publish(const Row& row)
+{
+    if (!m_Table)
+    {
+        return;
+    }
+
+    auto it = m_RowByAddress.find(row.address);
+    if (it != m_RowByAddress.end())
+    {
+        WriteRow(it->second, row);
+    }
+    else
+    {
+        uint32_t rowCount = m_Table->header.rowCount.load(std::memory_order_relaxed);
+        if (rowCount < Capacity)
+        {
+            WriteRow(rowCount, row);
+            m_Table->header.rowCount.store(rowCount + 1, std::memory_order_release);
+            m_RowByAddress.emplace(row.address, rowCount);
+        }
+        else
+        {
+            uint32_t index = FindOldestRow();
+            m_RowByAddress.erase(m_Table->address[index]);
+            WriteRow(index, row);
+            m_RowByAddress.emplace(row.address, index);
+        }
+    }
+
+    m_Table->header.updatedUnixMs.store(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+}
+
+void LuminaSharedTableWriter::Clear()
+{
+    if (!m_Table)
+    {
+        return;
+    }
+    m_Table->header.rowCount.store(0, std::memory_order_release);
+    m_Table->header.generation.fetch_add(1, std::memory_order_release);
+    m_RowByAddress.clear();
+}
+
+uint32_t LuminaSharedTableWriter::GetRowCount() const
+{
+    return m_Table ? m_Table->header.rowCount.load(std::memory_order_relaxed) : 0;
+}
+
+uint32_t LuminaSharedTableWriter::FindOldestRow() const
+{
+    // Only reached with a full table; the timestamp column is contiguous so this is one linear pass
+    uint32_t oldest = 0;
+    for (uint32_t i = 1; i < Capacity; ++i)
+    {
+        if (m_Table->lastSeenUnixMs[i] < m_Table->lastSeenUnixMs[oldest])
+        {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+void LuminaSharedTableWriter::WriteRow(uint32_t index, const Row& row)
+{
+    // Seqlock: odd while writing, readers retry if the sequence moved under them
+    std::atomic<uint32_t>& sequence = m_Table->sequence[index];
+    uint32_t start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    m_Table->address[index] = row.address;
+    m_Table->lastSeenUnixMs[index] = row.lastSeenUnixMs;
+    m_Table->rssi[index] = row.rssi;
+    m_Table->flags[index] = row.flags;
+    std::memcpy(m_Table->name[index], row.name, NameSize);
+
+    sequence.store(start + 2, std::memory_order_release);
+}
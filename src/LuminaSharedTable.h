@@ -0,0 +1,32 @@
+#pragma once
+#include <unordered_map>
+#include "LuminaSharedTableLayout.h"
+
+// Publishes the live device table into shared memory for other processes (see LuminaSharedTableReader).
+// Single writer: all calls must come from one thread at a time.
+class LuminaSharedTableWriter
+{
+public:
+    LuminaSharedTableWriter();
+    ~LuminaSharedTableWriter();
+    LuminaSharedTableWriter(const LuminaSharedTableWriter&) = delete;
+    LuminaSharedTableWriter& operator=(const LuminaSharedTableWriter&) = delete;
+
+    bool Open(const std::string& name, std::string& error);
+    void Close();
+    bool IsOpen() const { return m_Table != nullptr; }
+
+    // Inserts or updates the row for row.address. When the table is full the least recently seen row is reused.
+    void Publish(const Lumina::SharedTable::Row& row);
+    void Clear();
+
+    uint32_t GetRowCount() const;
+
+private:
+    Lumina::SharedTable::Mapping m_Mapping;
+    Lumina::SharedTable::Layout* m_Table = nullptr;
+    std::unordered_map<uint64_t, uint32_t> m_RowByAddress;
+
+    uint32_t FindOldestRow() const;
+    void WriteRow(uint32_t index, const Lumina::SharedTable::Row& row);
+};
@@ -0,0 +1,152 @@
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include "LuminaSharedTableLayout.h"
+
+namespace Lumina::SharedTable
+{
+    Mapping::~Mapping()
+    {
+        Close();
+    }
+
+#ifdef _WIN32
+    bool Mapping::Create(const std::string& name, std::string& error)
+    {
+        Close();
+        // Object names are plain ASCII, so a widening copy is enough
+        std::wstring objectName = L"Local\\" + std::wstring(name.begin(), name.end());
+        HANDLE handle = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(Layout), objectName.c_str());
+        if (!handle)
+        {
+            error = "Failed to create shared device table '" + name + "' (error " + std::to_string(GetLastError()) + ")";
+            return false;
+        }
+        if (GetLastError() == ERROR_ALREADY_EXISTS)
+        {
+            CloseHandle(handle);
+            error = "Shared device table '" + name + "' is already published by another process";
+            return false;
+        }
+        m_Data = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Layout));
+        if (!m_Data)
+        {
+            CloseHandle(handle);
+            error = "Failed to map shared device table '" + name + "'";
+            return false;
+        }
+        m_Handle = handle;
+        m_IsOwner = true;
+        m_Name = name;
+        return true;
+    }
+
+    bool Mapping::OpenReadOnly(const std::string& name, std::string& error)
+    {
+        Close();
+        std::wstring objectName = L"Local\\" + std::wstring(name.begin(), name.end());
+        HANDLE handle = OpenFileMappingW(FILE_MAP_READ, FALSE, objectName.c_str());
+        if (!handle)
+        {
+            error = "Shared device table '" + name + "' is not published";
+            return false;
+        }
+        m_Data = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, sizeof(Layout));
+        if (!m_Data)
+        {
+            CloseHandle(handle);
+            error = "Failed to map shared device table '" + name + "'";
+            return false;
+        }
+        m_Handle = handle;
+        m_Name = name;
+        return true;
+    }
+
+    void Mapping::Close()
+    {
+        if (m_Data) UnmapViewOfFile(m_Data);
+        if (m_Handle) CloseHandle(m_Handle);
+        m_Data = nullptr;
+        m_Handle = nullptr;
+        m_IsOwner = false;
+        m_Name.clear();
+    }
+#else
+    bool Mapping::Create(const std::string& name, std::string& error)
+    {
+        Close();
+        std::string objectName = "/" + name;
+
+        // O_TRUNC drops whatever a crashed writer left behind; the fresh segment reads as zeros
+        int fd = shm_open(objectName.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            error = "Failed to create shared device table '" + name + "': " + std::strerror(errno);
+            return false;
+        }
+        if (ftruncate(fd, sizeof(Layout)) != 0)
+        {
+            error = "Failed to size shared device table '" + name + "': " + std::strerror(errno);
+            close(fd);
+            return false;
+        }
+        void* data = mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+        {
+            error = "Failed to map shared device table '" + name + "': " + std::strerror(errno);
+            return false;
+        }
+        m_Data = data;
+        m_IsOwner = true;
+        m_Name = objectName;
+        return true;
+    }
+
+    bool Mapping::OpenReadOnly(const std::string& name, std::string& error)
+    {
+        Close();
+        std::string objectName = "/" + name;
+        int fd = shm_open(objectName.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+        {
+            error = "Shared device table '" + name + "' is not published";
+            return false;
+        }
+        void* data = mmap(nullptr, sizeof(Layout), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+        {
+            error = "Failed to map shared device table '" + name + "': " + std::strerror(errno);
+            return false;
+        }
+        m_Data = data;
+        m_Name = objectName;
+        return true;
+    }
+
+    void Mapping::Close()
+    {
+        if (m_Data)
+        {
+            munmap(m_Data, sizeof(Layout));
+        }
+        if (m_IsOwner)
+        {
+            shm_unlink(m_Name.c_str());
+        }
+        m_Data = nullptr;
+        m_IsOwner = false;
+        m_Name.clear();
+    }
+#endif
+}
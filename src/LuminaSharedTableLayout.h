@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Fixed layout of the live device table exported through shared memory. Any process can map it
+// read-only and read rows directly; each row is guarded by its own seqlock so a reader either sees
+// a complete row or retries, without syscalls, locks or copies beyond the row itself.
+namespace Lumina::SharedTable
+{
+    constexpr uint32_t Magic = 0x544D554C; // "LUMT"
+    constexpr uint32_t Version = 1;
+    constexpr uint32_t Capacity = 1024;
+    constexpr size_t NameSize = 32;
+
+    enum RowFlags : uint8_t
+    {
+        FlagConnectable = 1 << 0,
+    };
+
+    // One device as seen by readers
+    struct Row
+    {
+        uint64_t address = 0;
+        int64_t lastSeenUnixMs = 0;
+        int16_t rssi = 0;
+        uint8_t flags = 0;
+        char name[NameSize] = {};
+    };
+
+    struct alignas(64) Header
+    {
+        std::atomic<uint32_t> magic;        // Written last by the creator; readers refuse the table until it matches
+        uint32_t version;
+        uint32_t capacity;
+        uint32_t nameSize;
+        std::atomic<uint32_t> rowCount;     // Rows [0, rowCount) are in use
+        std::atomic<uint64_t> generation;   // Bumped whenever the table is cleared, e.g. on a new scan
+        std::atomic<int64_t> updatedUnixMs; // Last publish by the writer
+    };
+
+    // Structure of arrays so a reader scanning one column (e.g. RSSI) touches only that column's cache lines.
+    // sequence[i] is odd while row i is being written.
+    struct Layout
+    {
+        Header header;
+        alignas(64) std::atomic<uint32_t> sequence[Capacity];
+        alignas(64) uint64_t address[Capacity];
+        alignas(64) int64_t lastSeenUnixMs[Capacity];
+        alignas(64) int16_t rssi[Capacity];
+        alignas(64) uint8_t flags[Capacity];
+        alignas(64) char name[Capacity][NameSize];
+    };
+
+    static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+        "Shared table atomics must be address-free to work across processes");
+
+    // Shared memory segment holding one Layout. The creator owns (and on POSIX unlinks) the name.
+    class Mapping
+    {
+    public:
+        Mapping() = default;
+        ~Mapping();
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+
+        bool Create(const std::string& name, std::string& error);
+        bool OpenReadOnly(const std::string& name, std::string& error);
+        void Close();
+
+        Layout* GetLayout() const { return static_cast<Layout*>(m_Data); }
+
+    private:
+        void* m_Data = nullptr;
+        bool m_IsOwner = false;
+        std::string m_Name;
+#ifdef _WIN32
+        void* m_Handle = nullptr;
+#endif
+    };
+}
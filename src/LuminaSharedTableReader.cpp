@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <cstring>
+#include "LuminaSharedTableReader.h"
+
+using namespace Lumina::SharedTable;
+
+LuminaSharedTableReader::LuminaSharedTableReader()
+{
+}
+
+LuminaSharedTableReader::~LuminaSharedTableReader()
+{
+    Close();
+}
+
+bool LuminaSharedTableReader::Open(const std::string& name, std::string& error)
+{
+    Close();
+    if (!m_Mapping.OpenReadOnly(name, error))
+    {
+        return false;
+    }
+
+    const Layout* table = m_Mapping.GetLayout();
+    if (table->header.magic.load(std::memory_order_acquire) != Magic || table->header.version != Version ||
+        table->header.capacity != Capacity || table->header.nameSize != NameSize)
+    {
+        m_Mapping.Close();
+        error = "Shared device table '" + name + "' is not ready or has an incompatible layout";
+        return false;
+    }
+    m_Table = table;
+    return true;
+}
+
+void LuminaSharedTableReader::Close()
+{
+    m_Mapping.Close();
+    m_Table = nullptr;
+}
+
+bool LuminaSharedTableReader::IsOpen() const
+{
+    return m_Table && m_Table->header.magic.load(std::memory_order_acquire) == Magic;
+}
+
+uint32_t LuminaSharedTableReader::GetRowCount() const
+{
+    return m_Table ? std::min(m_Table->header.rowCount.load(std::memory_order_acquire), Capacity) : 0;
+}
+
+uint64_t LuminaSharedTableReader::GetGeneration() const
+{
+    return m_Table ? m_Table->header.generation.load(std::memory_order_acquire) : 0;
+}
+
+int64_t LuminaSharedTableReader::GetUpdatedUnixMs() const
+{
+    return m_Table ? m_Table->header.updatedUnixMs.load(std::memory_order_relaxed) : 0;
+}
+
+bool LuminaSharedTableReader::ReadRow(uint32_t index, Row& row) const
+{
+    if (index >= GetRowCount())
+    {
+        return false;
+    }
+
+    const std::atomic<uint32_t>& sequence = m_Table->sequence[index];
+    for (int attempt = 0; attempt < MaxReadAttempts; ++attempt)
+    {
+        uint32_t start = sequence.load(std::memory_order_acquire);
+        if (start & 1)
+        {
+            continue;
+        }
+
+        row.address = m_Table->address[index];
+        row.lastSeenUnixMs = m_Table->lastSeenUnixMs[index];
+        row.rssi = m_Table->rssi[index];
+        row.flags = m_Table->flags[index];
+        std::memcpy(row.name, m_Table->name[index], NameSize);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == start)
+        {
+            row.name[NameSize - 1] = '\0';
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t LuminaSharedTableReader::ReadAll(std::vector<Row>& rows) const
+{
+    uint32_t rowCount = GetRowCount();
+    rows.resize(rowCount);
+
+    size_t count = 0;
+    for (uint32_t i = 0; i < rowCount; ++i)
+    {
+        if (ReadRow(i, rows[count]))
+        {
+            ++count;
+        }
+    }
+    rows.resize(count);
+    return count;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include "LuminaSharedTableLayout.h"
+
+// Reads the device table published by LuminaSharedTableWriter from another process.
+// Only depends on LuminaSharedTableLayout.h/.cpp, so those three files can be dropped into a dashboard or logger.
+// After Open, reads touch the mapped memory only: no syscalls, no locks.
+class LuminaSharedTableReader
+{
+public:
+    LuminaSharedTableReader();
+    ~LuminaSharedTableReader();
+    LuminaSharedTableReader(const LuminaSharedTableReader&) = delete;
+    LuminaSharedTableReader& operator=(const LuminaSharedTableReader&) = delete;
+
+    bool Open(const std::string& name, std::string& error);
+    void Close();
+
+    // False once the writer has closed the table; reopen to pick up a new writer
+    bool IsOpen() const;
+
+    uint32_t GetRowCount() const;
+    uint64_t GetGeneration() const;
+    int64_t GetUpdatedUnixMs() const;
+
+    // Copies a consistent snapshot of one row. Returns false if the row is out of range,
+    // or the writer kept rewriting it for every attempt.
+    bool ReadRow(uint32_t index, Lumina::SharedTable::Row& row) const;
+
+    // Replaces rows with every row that could be read consistently; returns the count
+    size_t ReadAll(std::vector<Lumina::SharedTable::Row>& rows) const;
+
+private:
+    static constexpr int MaxReadAttempts = 64;
+
+    Lumina::SharedTable::Mapping m_Mapping;
+    const Lumina::SharedTable::Layout* m_Table = nullptr;
+};
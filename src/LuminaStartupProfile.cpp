@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <fstream>
+#include "LuminaStartupProfile.h"
+
+LuminaStartupProfile::LuminaStartupProfile()
+    : m_Start(std::chrono::steady_clock::now())
+{
+}
+
+double LuminaStartupProfile::Now() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_Start).count();
+}
+
+void LuminaStartupProfile::Begin(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Phase phase;
+    phase.name = name;
+    phase.startMs = Now();
+    m_Phases.push_back(phase);
+}
+
+void LuminaStartupProfile::End(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = std::find_if(m_Phases.begin(), m_Phases.end(),
+        [&name](const Phase& phase) { return phase.name == name && !phase.done; });
+    if (it != m_Phases.end())
+    {
+        it->endMs = Now();
+        it->done = true;
+    }
+}
+
+void LuminaStartupProfile::MarkFirstFrame()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!m_FirstFrameMs)
+    {
+        m_FirstFrameMs = Now();
+    }
+}
+
+std::vector<LuminaStartupProfile::Phase> LuminaStartupProfile::GetPhases() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Phases;
+}
+
+std::optional<double> LuminaStartupProfile::GetFirstFrameMs() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_FirstFrameMs;
+}
+
+std::optional<double> LuminaStartupProfile::GetInteractiveMs() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return GetInteractiveMs_Internal();
+}
+
+std::optional<double> LuminaStartupProfile::GetInteractiveMs_Internal() const
+{
+    if (!m_FirstFrameMs)
+    {
+        return std::nullopt;
+    }
+
+    double interactiveMs = *m_FirstFrameMs;
+    for (const auto& phase : m_Phases)
+    {
+        if (!phase.done)
+        {
+            return std::nullopt;
+        }
+        interactiveMs = std::max(interactiveMs, phase.endMs);
+    }
+    return interactiveMs;
+}
+
+bool LuminaStartupProfile::AppendToLog(const std::filesystem::path& path)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::optional<double> interactiveMs = GetInteractiveMs_Internal();
+    if (m_Logged || !interactiveMs)
+    {
+        return false;
+    }
+    m_Logged = true;
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    bool writeHeader = !std::filesystem::exists(path, ec);
+
+    std::ofstream log(path, std::ios::app);
+    if (!log)
+    {
+        return false;
+    }
+    if (writeHeader)
+    {
+        log << "unix_time,first_frame_ms,interactive_ms,phases\n";
+    }
+
+    log << std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()
+        << "," << *m_FirstFrameMs << "," << *interactiveMs << ",";
+    for (size_t i = 0; i < m_Phases.size(); ++i)
+    {
+        // name=start+duration, separated by ';' so the row stays one CSV field
+        log << (i > 0 ? ";" : "") << m_Phases[i].name << "=" << m_Phases[i].startMs << "+" << (m_Phases[i].endMs - m_Phases[i].startMs);
+    }
+    log << "\n";
+    return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <optional>
+#include <mutex>
+#include <chrono>
+#include <filesystem>
+
+// Per-phase startup timings, measured from process start.
+// Background phases run in parallel with the first frames; the app is interactive once
+// the first frame is presented and every phase has ended.
+class LuminaStartupProfile
+{
+public:
+    struct Phase
+    {
+        std::string name;
+        double startMs = 0.0;
+        double endMs = 0.0;
+        bool done = false;
+    };
+
+    LuminaStartupProfile();
+
+    // Thread-safe; phases may begin and end on any thread
+    void Begin(const std::string& name);
+    void End(const std::string& name);
+    void MarkFirstFrame();
+
+    std::vector<Phase> GetPhases() const;
+    std::optional<double> GetFirstFrameMs() const;
+    std::optional<double> GetInteractiveMs() const;
+
+    // Appends one CSV row per run so cold-start time can be tracked across builds.
+    // Returns false if the run is not interactive yet or was already recorded.
+    bool AppendToLog(const std::filesystem::path& path);
+
+private:
+    std::chrono::steady_clock::time_point m_Start;
+    std::vector<Phase> m_Phases;
+    std::optional<double> m_FirstFrameMs;
+    bool m_Logged = false;
+    mutable std::mutex m_Mutex;
+
+    double Now() const;
+    std::optional<double> GetInteractiveMs_Internal() const;
+};
@@ -0,0 +1,63 @@
+#include <mutex>
+#include "LuminaStringPool.h"
+
+LuminaStringPool& LuminaStringPool::Get()
+{
+    static LuminaStringPool pool;
+    return pool;
+}
+
+LuminaStringPool::LuminaStringPool()
+{
+    m_Strings.emplace_back();
+    m_Ids.emplace(std::string_view(m_Strings.front()), EmptyId);
+}
+
+LuminaStringPool::Id LuminaStringPool::Intern(std::string_view value)
+{
+    if (value.empty())
+    {
+        return EmptyId;
+    }
+
+    {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        auto it = m_Ids.find(value);
+        if (it != m_Ids.end())
+        {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+    auto it = m_Ids.find(value);
+    if (it != m_Ids.end())
+    {
+        return it->second;
+    }
+    Id id = static_cast<Id>(m_Strings.size());
+    const std::string& stored = m_Strings.emplace_back(value);
+    m_Ids.emplace(std::string_view(stored), id);
+
+    // String object, its heap buffer once past the small-string capacity, and the hash node
+    m_Bytes += sizeof(std::string) + (stored.capacity() > 15 ? stored.capacity() + 1 : 0) + sizeof(std::pair<std::string_view, Id>) + 2 * sizeof(void*);
+    return id;
+}
+
+const std::string& LuminaStringPool::Lookup(Id id) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_Mutex);
+    return id < m_Strings.size() ? m_Strings[id] : m_Strings.front();
+}
+
+size_t LuminaStringPool::GetCount() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_Mutex);
+    return m_Strings.size() - 1;
+}
+
+size_t LuminaStringPool::GetBytes() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_Mutex);
+    return m_Bytes;
+}
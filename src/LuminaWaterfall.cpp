@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#endif
+#include <GL/gl.h>
+#include <imgui.h>
+#include "LuminaWaterfall.h"
+#include "LuminaHelper.h"
+
+// Not in the GL 1.1 headers that ship with Windows
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+namespace
+{
+    constexpr int8_t EmptyRssi = INT8_MIN;
+
+    uint32_t PackColor(float r, float g, float b)
+    {
+        auto channel = [](float value) { return static_cast<uint32_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f); };
+        return channel(r) | (channel(g) << 8) | (channel(b) << 16) | 0xFF000000u;
+    }
+}
+
+LuminaWaterfall::LuminaWaterfall()
+    : m_Start(std::chrono::steady_clock::now())
+{
+}
+
+int64_t LuminaWaterfall::GetBin(std::chrono::steady_clock::time_point time) const
+{
+    return std::max<int64_t>(0, (time - m_Start) / BinDuration);
+}
+
+void LuminaWaterfall::Record(uint64_t address, int16_t rssi, std::chrono::steady_clock::time_point time)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    int64_t bin = GetBin(time);
+    if (bin <= m_CurrentBin - ColumnCount)
+    {
+        return; // Older than the history
+    }
+    AdvanceTo_Internal(bin);
+
+    auto it = m_Rows.find(address);
+    if (it == m_Rows.end())
+    {
+        if (m_RowAddresses.size() >= MaxRows)
+        {
+            ++m_DroppedDevices;
+            return;
+        }
+        it = m_Rows.emplace(address, static_cast<int>(m_RowAddresses.size())).first;
+        m_RowAddresses.push_back(address);
+    }
+    if (m_Cells.empty())
+    {
+        m_Cells.assign(static_cast<size_t>(ColumnCount) * MaxRows, Cell{ 0, EmptyRssi });
+    }
+
+    Cell& cell = m_Cells[static_cast<size_t>(bin % ColumnCount) * MaxRows + it->second];
+    cell.count = static_cast<uint8_t>(std::min(cell.count + 1, 255));
+    cell.maxRssi = static_cast<int8_t>(std::max<int>(cell.maxRssi, std::clamp<int>(rssi, -127, 127)));
+    // A late advert may land in a column that is already uploaded
+    m_NextUploadBin = std::min(m_NextUploadBin, bin);
+}
+
+void LuminaWaterfall::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::fill(m_Cells.begin(), m_Cells.end(), Cell{ 0, EmptyRssi });
+    m_Rows.clear();
+    m_RowAddresses.clear();
+    m_DroppedDevices = 0;
+    m_IsClearPending = true;
+}
+
+void LuminaWaterfall::AdvanceTo_Internal(int64_t bin)
+{
+    if (bin <= m_CurrentBin)
+    {
+        return;
+    }
+    // Columns reused by the ring start out empty; only rows in use can be dirty
+    if (!m_Cells.empty())
+    {
+        for (int64_t next = std::max(m_CurrentBin + 1, bin - ColumnCount + 1); next <= bin; ++next)
+        {
+            Cell* column = &m_Cells[static_cast<size_t>(next % ColumnCount) * MaxRows];
+            std::fill(column, column + m_RowAddresses.size(), Cell{ 0, EmptyRssi });
+        }
+    }
+    m_CurrentBin = bin;
+}
+
+uint32_t LuminaWaterfall::CellColor(const Cell& cell)
+{
+    if (cell.count == 0)
+    {
+        return PackColor(0.06f, 0.06f, 0.08f);
+    }
+    // Hue from signal strength (blue at -100 dBm to red at -40 dBm), brightness from advert count
+    float strength = std::clamp((cell.maxRssi + 100) / 60.0f, 0.0f, 1.0f);
+    float activity = 0.35f + 0.65f * std::min(1.0f, std::log2(1.0f + cell.count) / 5.0f);
+    float r = std::clamp(2.0f * strength - 0.5f, 0.0f, 1.0f);
+    float g = 1.0f - std::abs(2.0f * strength - 1.0f);
+    float b = std::clamp(1.5f - 2.0f * strength, 0.0f, 1.0f);
+    return PackColor(r * activity, g * activity, b * activity);
+}
+
+void LuminaWaterfall::UploadColumns()
+{
+    if (m_Texture == 0)
+    {
+        std::vector<uint32_t> blank(static_cast<size_t>(ColumnCount) * MaxRows, CellColor(Cell{ 0, EmptyRssi }));
+        glGenTextures(1, &m_Texture);
+        glBindTexture(GL_TEXTURE_2D, m_Texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // The ring wraps horizontally
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, ColumnCount, MaxRows, 0, GL_RGBA, GL_UNSIGNED_BYTE, blank.data());
+    }
+
+    int64_t firstBin = 0;
+    int64_t lastBin = 0;
+    int rowCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        AdvanceTo_Internal(GetBin(std::chrono::steady_clock::now()));
+        firstBin = std::max(m_NextUploadBin, m_CurrentBin - ColumnCount + 1);
+        lastBin = m_CurrentBin;
+        rowCount = static_cast<int>(m_RowAddresses.size());
+        if (m_IsClearPending)
+        {
+            // Blank every column over the rows the previous devices used
+            firstBin = m_CurrentBin - ColumnCount + 1;
+            rowCount = std::max(rowCount, m_TextureRows);
+            m_TextureRows = 0;
+            m_IsClearPending = false;
+        }
+        m_TextureRows = std::max(m_TextureRows, static_cast<int>(m_RowAddresses.size()));
+        if (rowCount == 0)
+        {
+            m_NextUploadBin = lastBin;
+            return;
+        }
+
+        m_UploadBuffer.resize(static_cast<size_t>(lastBin - firstBin + 1) * rowCount);
+        uint32_t* out = m_UploadBuffer.data();
+        for (int64_t bin = firstBin; bin <= lastBin; ++bin)
+        {
+            if (m_Cells.empty())
+            {
+                std::fill(out, out + rowCount, CellColor(Cell{ 0, EmptyRssi }));
+            }
+            else
+            {
+                const Cell* column = &m_Cells[static_cast<size_t>(bin % ColumnCount) * MaxRows];
+                std::transform(column, column + rowCount, out, CellColor);
+            }
+            out += rowCount;
+        }
+        // The newest column is still filling, so it goes up again next frame
+        m_NextUploadBin = lastBin;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, m_Texture);
+    const uint32_t* column = m_UploadBuffer.data();
+    for (int64_t bin = firstBin; bin <= lastBin; ++bin)
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(bin % ColumnCount), 0, 1, rowCount, GL_RGBA, GL_UNSIGNED_BYTE, column);
+        column += rowCount;
+    }
+}
+
+void LuminaWaterfall::Render()
+{
+    UploadColumns();
+
+    int rowCount = 0;
+    uint64_t dropped = 0;
+    int64_t currentBin = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        rowCount = static_cast<int>(m_RowAddresses.size());
+        dropped = m_DroppedDevices;
+        currentBin = m_CurrentBin;
+    }
+
+    const float binSeconds = std::chrono::duration<float>(BinDuration).count();
+    const float historySeconds = ColumnCount * binSeconds;
+    if (ImGui::Button("Clear"))
+    {
+        Clear();
+        m_FirstRow = 0;
+        m_VisibleRows = 0;
+    }
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(160.0f);
+    ImGui::SliderFloat("Zoom", &m_Zoom, 1.0f, 64.0f, "%.0fx", ImGuiSliderFlags_Logarithmic);
+    float visibleSeconds = historySeconds / m_Zoom;
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(160.0f);
+    ImGui::SliderFloat("Back", &m_PanSeconds, 0.0f, historySeconds - visibleSeconds, "%.0f s");
+    m_PanSeconds = std::clamp(m_PanSeconds, 0.0f, historySeconds - visibleSeconds);
+    ImGui::SameLine();
+    ImGui::TextDisabled("%d devices%s, %.0f s shown, wheel scrolls rows, Ctrl+wheel zooms rows", rowCount,
+        dropped > 0 ? " (more not shown)" : "", visibleSeconds);
+
+    // Rows: all of them by default; wheel scrolls and Ctrl+wheel zooms once set
+    int visibleRows = m_VisibleRows > 0 ? m_VisibleRows : std::max(rowCount, 1);
+    m_FirstRow = std::clamp(m_FirstRow, 0, std::max(0, MaxRows - visibleRows));
+
+    // Bins map to texture columns modulo ColumnCount, so with GL_REPEAT the visible window is just a UV range
+    float visibleColumns = ColumnCount / m_Zoom;
+    double rightBin = static_cast<double>(currentBin + 1) - m_PanSeconds / binSeconds;
+    float u1 = static_cast<float>(std::fmod(rightBin, static_cast<double>(ColumnCount)) / ColumnCount);
+    float u0 = u1 - visibleColumns / ColumnCount;
+    float v0 = static_cast<float>(m_FirstRow) / MaxRows;
+    float v1 = static_cast<float>(m_FirstRow + visibleRows) / MaxRows;
+
+    ImVec2 size = ImGui::GetContentRegionAvail();
+    size.x = std::max(size.x, 64.0f);
+    size.y = std::max(size.y, 64.0f);
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<intptr_t>(m_Texture)), size, ImVec2(u0, v0), ImVec2(u1, v1));
+    if (!ImGui::IsItemHovered())
+    {
+        return;
+    }
+
+    ImGuiIO& io = ImGui::GetIO();
+    if (io.MouseWheel != 0.0f)
+    {
+        if (io.KeyCtrl)
+        {
+            m_VisibleRows = std::clamp(static_cast<int>(visibleRows * (io.MouseWheel > 0.0f ? 0.8f : 1.25f)), 16, MaxRows);
+        }
+        else
+        {
+            m_FirstRow -= static_cast<int>(io.MouseWheel * std::max(1, visibleRows / 10));
+            m_VisibleRows = visibleRows;
+        }
+    }
+
+    float x = (io.MousePos.x - origin.x) / size.x;
+    float y = (io.MousePos.y - origin.y) / size.y;
+    int row = m_FirstRow + static_cast<int>(y * visibleRows);
+    int64_t bin = static_cast<int64_t>(std::floor(rightBin - (1.0f - x) * visibleColumns));
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (row < 0 || row >= static_cast<int>(m_RowAddresses.size()) || bin < 0 || bin <= m_CurrentBin - ColumnCount || bin > m_CurrentBin)
+    {
+        return;
+    }
+    const Cell& cell = m_Cells[static_cast<size_t>(bin % ColumnCount) * MaxRows + row];
+    ImGui::BeginTooltip();
+    ImGui::Text("%s", LuminaHelper::BluetoothAddressToString(m_RowAddresses[row]).c_str());
+    ImGui::Text("%.1f s ago", (m_CurrentBin - bin) * binSeconds);
+    if (cell.count > 0)
+    {
+        ImGui::Text("%d advert%s, strongest %d dBm", cell.count, cell.count == 1 ? "" : "s", cell.maxRssi);
+    }
+    else
+    {
+        ImGui::TextDisabled("No adverts");
+    }
+    ImGui::EndTooltip();
+}
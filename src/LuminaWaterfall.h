@@ -0,0 +1,61 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Time-by-device heatmap of advert activity. Each device gets a row the first time it is seen and keeps it;
+// each column is one time bin. Cells live in a CPU ring and are mirrored into a GPU texture that is never
+// redrawn: a frame uploads only the columns that changed since the last one (normally just the newest), and
+// scrolling, zoom and pan are done through texture coordinates. Frame cost does not depend on history length.
+class LuminaWaterfall
+{
+public:
+    static constexpr int ColumnCount = 1024;                        // Texture width; history = ColumnCount * BinDuration
+    static constexpr int MaxRows = 4096;                            // Texture height; later devices are counted but not shown
+    static constexpr std::chrono::milliseconds BinDuration{ 250 };
+
+    LuminaWaterfall();
+    LuminaWaterfall(const LuminaWaterfall&) = delete;
+    LuminaWaterfall& operator=(const LuminaWaterfall&) = delete;
+
+    // Any thread; called once per received advert
+    void Record(uint64_t address, int16_t rssi, std::chrono::steady_clock::time_point time);
+    void Clear();
+
+    // UI thread with the GL context current. The texture is released with the context.
+    void Render();
+
+private:
+    struct Cell
+    {
+        uint8_t count;      // Adverts in the bin, saturating
+        int8_t maxRssi;
+    };
+
+    std::chrono::steady_clock::time_point m_Start;
+
+    mutable std::mutex m_Mutex;
+    std::vector<Cell> m_Cells;                          // Column-major ring, ColumnCount x MaxRows, allocated on first use
+    std::unordered_map<uint64_t, int> m_Rows;
+    std::vector<uint64_t> m_RowAddresses;
+    int64_t m_CurrentBin = 0;
+    int64_t m_NextUploadBin = 0;                        // Oldest bin whose column may differ from the texture
+    uint64_t m_DroppedDevices = 0;
+    bool m_IsClearPending = false;
+
+    // UI thread only
+    unsigned int m_Texture = 0;
+    int m_TextureRows = 0;                              // Rows that may hold non-empty texels
+    std::vector<uint32_t> m_UploadBuffer;
+    float m_Zoom = 1.0f;                                // Horizontal: 1 shows the whole history
+    float m_PanSeconds = 0.0f;                          // How far back the right edge is
+    int m_FirstRow = 0;
+    int m_VisibleRows = 0;                              // 0 fits every row
+
+    int64_t GetBin(std::chrono::steady_clock::time_point time) const;
+    void AdvanceTo_Internal(int64_t bin);
+    void UploadColumns();
+    static uint32_t CellColor(const Cell& cell);
+};
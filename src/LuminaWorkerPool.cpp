@@ -0,0 +1,182 @@
+#include <algorithm>
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "LuminaWorkerPool.h"
+
+namespace
+{
+    // Lets Submit keep a worker's own tasks on its own deque
+    thread_local const LuminaWorkerPool* t_Pool = nullptr;
+    thread_local size_t t_WorkerIndex = 0;
+}
+
+LuminaWorkerPool::LuminaWorkerPool()
+    : LuminaWorkerPool(Options())
+{
+}
+
+LuminaWorkerPool::LuminaWorkerPool(const Options& options)
+{
+    int threadCount = options.threadCount > 0 ? options.threadCount : static_cast<int>(std::thread::hardware_concurrency());
+    threadCount = std::max(threadCount, 1);
+
+    for (int i = 0; i < threadCount; ++i)
+    {
+        m_Workers.push_back(std::make_unique<Worker>());
+    }
+    // Started only once every deque exists, since any worker may steal from any other
+    for (size_t i = 0; i < m_Workers.size(); ++i)
+    {
+        m_Workers[i]->thread = std::thread(&LuminaWorkerPool::WorkerLoop, this, i);
+        if (options.isPinned)
+        {
+            PinToCore(m_Workers[i]->thread, i);
+        }
+    }
+}
+
+LuminaWorkerPool::~LuminaWorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_WakeMutex);
+        m_StopRequested = true;
+    }
+    m_Wake.notify_all();
+    for (auto& worker : m_Workers)
+    {
+        worker->thread.join();
+    }
+}
+
+LuminaWorkerPool& LuminaWorkerPool::Get()
+{
+    static LuminaWorkerPool pool;
+    return pool;
+}
+
+void LuminaWorkerPool::Submit(Task task, Priority priority)
+{
+    size_t index = t_Pool == this
+        ? t_WorkerIndex
+        : m_NextWorker.fetch_add(1, std::memory_order_relaxed) % m_Workers.size();
+
+    // Counted before it is visible, so a worker that finds it never sees the count go negative
+    m_Active.fetch_add(1);
+    m_Queued.fetch_add(1);
+    {
+        Worker& worker = *m_Workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.queues[static_cast<size_t>(priority)].push_back(std::move(task));
+    }
+
+    // Pairs with the sleeper raising m_Sleeping before it re-checks m_Queued
+    if (m_Sleeping.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_WakeMutex);
+        m_Wake.notify_one();
+    }
+}
+
+void LuminaWorkerPool::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock(m_WakeMutex);
+    m_Idle.wait(lock, [this] { return m_Active.load() == 0; });
+}
+
+LuminaWorkerPool::Stats LuminaWorkerPool::GetStats() const
+{
+    Stats stats;
+    stats.executed = m_Executed;
+    stats.stolen = m_Stolen;
+    return stats;
+}
+
+void LuminaWorkerPool::WorkerLoop(size_t index)
+{
+    t_Pool = this;
+    t_WorkerIndex = index;
+
+    Task task;
+    while (true)
+    {
+        if (TryTake(index, task))
+        {
+            m_Queued.fetch_sub(1);
+            task();
+            task = nullptr;
+            ++m_Executed;
+            if (m_Active.fetch_sub(1) == 1)
+            {
+                std::lock_guard<std::mutex> lock(m_WakeMutex);
+                m_Idle.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_WakeMutex);
+        // Finish queued tasks before stopping
+        if (m_StopRequested && m_Queued.load() == 0)
+        {
+            return;
+        }
+        m_Sleeping.fetch_add(1);
+        m_Wake.wait(lock, [this] { return m_Queued.load() > 0 || m_StopRequested; });
+        m_Sleeping.fetch_sub(1);
+    }
+}
+
+bool LuminaWorkerPool::TryTake(size_t index, Task& task)
+{
+    for (size_t priority = 0; priority < PriorityCount; ++priority)
+    {
+        // Own deque from the back: the newest task is the most likely to still be in cache
+        {
+            Worker& own = *m_Workers[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            auto& queue = own.queues[priority];
+            if (!queue.empty())
+            {
+                task = std::move(queue.back());
+                queue.pop_back();
+                return true;
+            }
+        }
+
+        // Steal from the front of the others, starting with the next worker along
+        for (size_t offset = 1; offset < m_Workers.size(); ++offset)
+        {
+            Worker& victim = *m_Workers[(index + offset) % m_Workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            auto& queue = victim.queues[priority];
+            if (!queue.empty())
+            {
+                task = std::move(queue.front());
+                queue.pop_front();
+                ++m_Stolen;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void LuminaWorkerPool::PinToCore(std::thread& thread, size_t core)
+{
+#ifdef _WIN32
+    SetThreadAffinityMask(thread.native_handle(), static_cast<DWORD_PTR>(1) << (core % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % CPU_SETSIZE, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+    (void)core;
+#endif
+}
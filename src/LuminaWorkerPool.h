@@ -0,0 +1,85 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool for CPU-bound pipeline stages. Each worker owns one deque per priority: it runs its
+// own newest task first, and when it runs dry it steals the oldest task from another worker. Tasks submitted
+// from a worker stay on that worker; tasks from other threads are dealt out round-robin.
+// Higher priorities are drained pool-wide before any lower one is started. Portable; no platform threads.
+class LuminaWorkerPool
+{
+public:
+    enum class Priority : uint8_t
+    {
+        High,       // Latency-sensitive, e.g. advert ingest
+        Normal,
+        Background, // Runs only when nothing else is queued
+    };
+    static constexpr size_t PriorityCount = 3;
+
+    using Task = std::function<void()>;
+
+    struct Options
+    {
+        int threadCount = 0;    // 0: one per hardware thread
+        bool isPinned = false;  // Pin worker i to core i
+    };
+
+    struct Stats
+    {
+        uint64_t executed = 0;
+        uint64_t stolen = 0;    // Tasks run by a worker other than the one they were queued on
+    };
+
+    LuminaWorkerPool();
+    explicit LuminaWorkerPool(const Options& options);
+    // Runs everything still queued, then joins the workers
+    ~LuminaWorkerPool();
+    LuminaWorkerPool(const LuminaWorkerPool&) = delete;
+    LuminaWorkerPool& operator=(const LuminaWorkerPool&) = delete;
+
+    // Process-wide pool sized to the machine
+    static LuminaWorkerPool& Get();
+
+    void Submit(Task task, Priority priority = Priority::Normal);
+    // Blocks until every submitted task has finished. Must not be called from a worker.
+    void WaitIdle();
+
+    int GetThreadCount() const { return static_cast<int>(m_Workers.size()); }
+    Stats GetStats() const;
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::array<std::deque<Task>, PriorityCount> queues;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_Workers;
+    std::atomic<size_t> m_NextWorker = 0;
+
+    // m_Queued counts tasks sitting in deques, m_Active those queued or running
+    std::atomic<int64_t> m_Queued = 0;
+    std::atomic<int64_t> m_Active = 0;
+    std::atomic<int> m_Sleeping = 0;
+    std::mutex m_WakeMutex;
+    std::condition_variable m_Wake;
+    std::condition_variable m_Idle;
+    bool m_StopRequested = false;
+
+    std::atomic<uint64_t> m_Executed = 0;
+    std::atomic<uint64_t> m_Stolen = 0;
+
+    void WorkerLoop(size_t index);
+    bool TryTake(size_t index, Task& task);
+    static void PinToCore(std::thread& thread, size_t core);
+};
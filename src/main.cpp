@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <filesystem>
 #include <iostream>
+#ifdef _WIN32
 #include <windows.h>
 
 #include <GL/gl.h>
@@ -8,9 +9,16 @@
 #include <backends/imgui_impl_glfw.h>
 #include <backends/imgui_impl_opengl3.h>
 #include <imgui.h>
+#include <winrt/base.h>
 
 #include "LuminaMainWindow.h"
+#endif
+
+#include "LuminaHeadless.h"
+#include "LuminaStartupProfile.h"
+#include "LuminaHelper.h"
 
+#ifdef _WIN32
 // OpenGL function declarations for Windows
 extern "C"
 {
@@ -19,8 +27,6 @@ extern "C"
 	void glClear(GLbitfield mask);
 }
 
-#ifdef _WIN32
-#include <windows.h>
 extern int main(int argc, char** argv);
 int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow)
 {
@@ -30,6 +36,41 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 
 int main(int argc, char** argv)
 {
+	LuminaStartupProfile startupProfile;
+
+#ifdef _WIN32
+	// One multi-threaded apartment for the whole process, before any WinRT object is created
+	try
+	{
+		winrt::init_apartment();
+	}
+	catch (...)
+	{
+		fprintf(stderr, "Failed to initialize WinRT apartment!\n");
+	}
+#endif
+
+	// --headless skips the window and UI entirely
+	LuminaHeadless::Options headlessOptions;
+	std::string argumentError;
+	if (LuminaHeadless::ParseArguments(argc, argv, headlessOptions, argumentError))
+	{
+		if (!argumentError.empty())
+		{
+			fprintf(stderr, "%s\n", argumentError.c_str());
+			return 2;
+		}
+		LuminaHeadless headless(headlessOptions);
+		return headless.Run();
+	}
+
+#ifndef _WIN32
+	// The window needs the WinRT device manager; elsewhere only the daemon is built
+	fprintf(stderr, "This build has no window; run with --headless\n");
+	return 2;
+#else
+
+	startupProfile.Begin("Window");
 	if (!glfwInit())
 	{
 		fprintf(stderr, "Failed to initialize GLFW!\n");
@@ -50,7 +91,9 @@ int main(int argc, char** argv)
 
 	glfwMakeContextCurrent(window);
 	glfwSwapInterval(1);
+	startupProfile.End("Window");
 
+	startupProfile.Begin("ImGui init");
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
 	ImGuiIO& io = ImGui::GetIO(); (void)io;
@@ -59,15 +102,27 @@ int main(int argc, char** argv)
 	ImGui_ImplGlfw_InitForOpenGL(window, true);
 	ImGui_ImplOpenGL3_Init("#version 330");
 
-	LuminaMainWindow mainWindow;
+	LuminaMainWindow mainWindow(startupProfile);
 	mainWindow.ApplyImGuiStyle();
+	startupProfile.End("ImGui init");
+	bool isStartupLogged = false;
+	bool hasDeviceObjects = false;
 
 	// Main loop
 	while (!glfwWindowShouldClose(window))
 	{
 		glfwPollEvents();
 
+		// Swap in the background-baked font atlas. The 1.90 backend only builds the font texture along with its
+		// other device objects on the first NewFrame, so after that the texture has to be rebuilt here.
+		if (mainWindow.ApplyPendingFonts() && hasDeviceObjects)
+		{
+			ImGui_ImplOpenGL3_DestroyFontsTexture();
+			ImGui_ImplOpenGL3_CreateFontsTexture();
+		}
+
 		ImGui_ImplOpenGL3_NewFrame();
+		hasDeviceObjects = true;
 		ImGui_ImplGlfw_NewFrame();
 		ImGui::NewFrame();
 
@@ -82,6 +137,12 @@ int main(int argc, char** argv)
 		glClear(GL_COLOR_BUFFER_BIT);
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 		glfwSwapBuffers(window);
+
+		if (!isStartupLogged)
+		{
+			startupProfile.MarkFirstFrame();
+			isStartupLogged = startupProfile.AppendToLog(LuminaConfig::StartupLogPath);
+		}
 	}
 
 	// Cleanup - ensure proper order
@@ -103,5 +164,6 @@ int main(int argc, char** argv)
 	}
 	
 	return 0;
+#endif
 }
 
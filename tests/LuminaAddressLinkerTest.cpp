@@ -0,0 +1,167 @@
+#include <chrono>
+#include <cstdio>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "LuminaAddressLinker.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr uint8_t CompanyIds[] = { 0x4C, 0x06, 0x75, 0xE0, 0x59 };
+
+    struct Device
+    {
+        int model = 0;
+        uint64_t address = 0;
+        Clock::time_point nextRotation;
+        std::chrono::milliseconds interval{ 0 };
+        float rssi = 0.0f;
+    };
+
+    struct Run
+    {
+        uint64_t adverts = 0;
+        uint64_t rotations = 0;
+        uint64_t links = 0;
+        uint64_t correctLinks = 0;
+        double nsPerAdvert = 0.0;
+    };
+
+    uint64_t RandomPrivateAddress(std::mt19937_64& random)
+    {
+        return (uint64_t(1) << 46) | (random() & ((uint64_t(1) << 46) - 1));
+    }
+
+    // Devices of one model share everything but their interval jitter and signal strength
+    void FillPayload(Lumina::AdvertisementSample& sample, int model)
+    {
+        const uint8_t flags = 0x06;
+        sample.AppendSection(0x01, &flags, 1);
+        const uint8_t manufacturer[] = { CompanyIds[model % 5], 0x00, static_cast<uint8_t>(0x10 + model % 7), 0x05, 0x01, 0x02, 0x03 };
+        sample.AppendSection(0xFF, manufacturer, 3 + static_cast<size_t>(model % 4));
+        const uint8_t service[] = { static_cast<uint8_t>(0x0D + model), 0x18 };
+        sample.AppendSection(0x03, service, sizeof(service));
+        if (model % 2 == 0)
+        {
+            const int8_t txPower = static_cast<int8_t>(-4 - model % 9);
+            sample.AppendSection(0x0A, reinterpret_cast<const uint8_t*>(&txPower), 1);
+        }
+        if (model % 3 == 0)
+        {
+            const std::string name = "Model-" + std::to_string(model);
+            sample.AppendSection(0x09, reinterpret_cast<const uint8_t*>(name.data()), name.size());
+        }
+    }
+
+    // Replays deviceCount devices for duration, each rotating its address every rotationMin-rotationMax
+    Run Simulate(int deviceCount, int modelCount, std::chrono::minutes duration,
+        std::chrono::seconds rotationMin, std::chrono::seconds rotationMax)
+    {
+        std::mt19937_64 random(1234);
+        const Clock::time_point start{};
+        const Clock::time_point end = start + duration;
+        auto rotationDelay = [&]()
+        {
+            return std::chrono::milliseconds(std::uniform_int_distribution<int64_t>(
+                std::chrono::milliseconds(rotationMin).count(), std::chrono::milliseconds(rotationMax).count())(random));
+        };
+
+        std::vector<Device> devices(deviceCount);
+        std::unordered_map<uint64_t, int> owner;
+        using Due = std::pair<Clock::time_point, int>;
+        std::priority_queue<Due, std::vector<Due>, std::greater<Due>> schedule;
+        for (int i = 0; i < deviceCount; ++i)
+        {
+            Device& device = devices[i];
+            device.model = i % modelCount;
+            device.address = RandomPrivateAddress(random);
+            device.nextRotation = start + rotationDelay();
+            device.interval = std::chrono::milliseconds(100 + 100 * (device.model % 10));
+            device.rssi = static_cast<float>(-90 + static_cast<int>(random() % 50));
+            owner[device.address] = i;
+            schedule.push({ start + std::chrono::milliseconds(random() % 1000), i });
+        }
+
+        Run run;
+        LuminaAddressLinker linker;
+        std::unordered_map<uint64_t, uint64_t> linkOf; // Latest link per address
+        Lumina::AdvertisementSample sample;
+        sample.addressType = Lumina::AdvertisementSample::AddressRandom;
+        std::uniform_int_distribution<int> advDelay(0, 10);
+        std::normal_distribution<float> rssiNoise(0.0f, 2.0f);
+
+        const auto wallStart = Clock::now();
+        while (!schedule.empty() && schedule.top().first < end)
+        {
+            const auto [time, index] = schedule.top();
+            schedule.pop();
+            Device& device = devices[index];
+            if (time >= device.nextRotation)
+            {
+                device.address = RandomPrivateAddress(random);
+                device.nextRotation = time + rotationDelay();
+                owner[device.address] = index;
+                ++run.rotations;
+            }
+
+            sample.address = device.address;
+            sample.timestamp = time;
+            sample.rssi = static_cast<int16_t>(device.rssi + rssiNoise(random));
+            sample.payloadLength = 0;
+            FillPayload(sample, device.model);
+            if (auto link = linker.Observe(sample))
+            {
+                linkOf[link->address] = link->linkedAddress;
+            }
+            ++run.adverts;
+            schedule.push({ time + device.interval + std::chrono::milliseconds(advDelay(random)), index });
+        }
+        run.nsPerAdvert = std::chrono::duration<double, std::nano>(Clock::now() - wallStart).count() / static_cast<double>(run.adverts);
+
+        for (const auto& [address, linkedAddress] : linkOf)
+        {
+            ++run.links;
+            run.correctLinks += owner[address] == owner[linkedAddress] ? 1 : 0;
+        }
+        return run;
+    }
+
+    void Report(const char* label, const Run& run, double minPrecision, double minRecall)
+    {
+        const double precision = run.links ? static_cast<double>(run.correctLinks) / static_cast<double>(run.links) : 0.0;
+        const double recall = run.rotations ? static_cast<double>(run.correctLinks) / static_cast<double>(run.rotations) : 0.0;
+        std::printf("address linker, %s: %llu adverts at %.0f ns each, %llu rotations, precision %.3f, recall %.3f\n", label,
+            static_cast<unsigned long long>(run.adverts), run.nsPerAdvert, static_cast<unsigned long long>(run.rotations), precision, recall);
+        LUMINA_CHECK(run.rotations > 0);
+        LUMINA_CHECK(precision >= minPrecision);
+        LUMINA_CHECK(recall >= minRecall);
+    }
+
+    void TestAddressKinds()
+    {
+        Lumina::AdvertisementSample sample;
+        sample.addressType = Lumina::AdvertisementSample::AddressPublic;
+        sample.address = uint64_t(1) << 46;
+        LUMINA_CHECK(!LuminaAddressLinker::IsRotatingAddress(sample));
+        sample.addressType = Lumina::AdvertisementSample::AddressRandom;
+        LUMINA_CHECK(LuminaAddressLinker::IsRotatingAddress(sample));
+        sample.address = uint64_t(3) << 46;    // Static random
+        LUMINA_CHECK(!LuminaAddressLinker::IsRotatingAddress(sample));
+        sample.addressType = Lumina::AdvertisementSample::AddressResolved;
+        sample.address = uint64_t(1) << 46;
+        LUMINA_CHECK(!LuminaAddressLinker::IsRotatingAddress(sample));
+    }
+}
+
+int main()
+{
+    TestAddressKinds();
+    Report("rotation every 8-15 min", Simulate(1000, 60, std::chrono::minutes(30), std::chrono::minutes(8), std::chrono::minutes(15)), 0.95, 0.8);
+    Report("rotation every 30-90 s", Simulate(500, 60, std::chrono::minutes(15), std::chrono::seconds(30), std::chrono::seconds(90)), 0.8, 0.3);
+    return LuminaTest::Finish();
+}
@@ -0,0 +1,369 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "LuminaAdvertCoalescer.h"
+#include "LuminaHelper.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    using Sample = Lumina::AdvertisementSample;
+    using Clock = std::chrono::steady_clock;
+
+    // Raw AD structures, to be split into samples
+    struct Payload
+    {
+        std::vector<uint8_t> bytes;
+
+        Payload& Add(uint8_t type, const void* data, size_t size)
+        {
+            bytes.reserve(bytes.size() + size + 2);
+            bytes.push_back(static_cast<uint8_t>(size + 1));
+            bytes.push_back(type);
+            bytes.insert(bytes.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+            return *this;
+        }
+        Payload& Flags(uint8_t flags) { return Add(0x01, &flags, 1); }
+        Payload& Name(const std::string& name, bool isComplete = true) { return Add(isComplete ? 0x09 : 0x08, name.data(), name.size()); }
+        Payload& Service16(uint16_t uuid) { return Add(0x03, &uuid, 2); }
+        Payload& Filler(size_t size) { return Add(0xFF, std::vector<uint8_t>(size, 0x5A).data(), size); }
+    };
+
+    Sample MakeSample(uint64_t address, const uint8_t* data, size_t size, Clock::time_point time,
+        uint8_t dataStatus = Sample::DataComplete, bool isScanResponse = false)
+    {
+        Sample sample;
+        sample.address = address;
+        sample.timestamp = time;
+        sample.dataStatus = dataStatus;
+        sample.advertisementType = isScanResponse ? Sample::ScanResponseType : 0;
+        sample.payloadLength = static_cast<uint16_t>(size);
+        std::memcpy(sample.payload, data, size);
+        return sample;
+    }
+
+    // An extended advert split into fragments of at most fragmentSize bytes, all but the last "more to come"
+    std::vector<Sample> Fragment(uint64_t address, const Payload& payload, size_t fragmentSize, Clock::time_point time)
+    {
+        std::vector<Sample> samples;
+        for (size_t offset = 0; offset < payload.bytes.size(); offset += fragmentSize)
+        {
+            size_t size = std::min(fragmentSize, payload.bytes.size() - offset);
+            bool isLast = offset + size == payload.bytes.size();
+            samples.push_back(MakeSample(address, payload.bytes.data() + offset, size, time,
+                isLast ? Sample::DataComplete : Sample::DataMoreToCome));
+        }
+        return samples;
+    }
+
+    Sample Whole(uint64_t address, const Payload& payload, Clock::time_point time, bool isScanResponse = false)
+    {
+        return MakeSample(address, payload.bytes.data(), payload.bytes.size(), time, Sample::DataComplete, isScanResponse);
+    }
+
+    void TestScanResponseMerge()
+    {
+        LuminaAdvertCoalescer coalescer;
+        const Clock::time_point time{};
+        auto result = coalescer.Merge(Whole(1, Payload().Flags(0x06).Service16(0x180D).Name("Sen", false), time));
+        LUMINA_CHECK(result.record && result.isNew && result.changed == LuminaAdvertCoalescer::ChangeAll);
+        LUMINA_CHECK(result.record->name == "Sen");
+
+        // The scan response's complete name wins; its UUIDs join the advert's
+        result = coalescer.Merge(Whole(1, Payload().Name("Sensor 42").Service16(0x180F), time, true));
+        LUMINA_CHECK(result.record && !result.isNew);
+        LUMINA_CHECK(result.changed == (LuminaAdvertCoalescer::ChangeName | LuminaAdvertCoalescer::ChangeServices));
+        LUMINA_CHECK(result.record->name == "Sensor 42" && result.record->serviceUuids.size() == 2);
+
+        // Repeats change nothing, whichever slot they hit
+        LUMINA_CHECK(coalescer.Merge(Whole(1, Payload().Flags(0x06).Service16(0x180D).Name("Sen", false), time)).changed == 0);
+        LUMINA_CHECK(coalescer.Merge(Whole(1, Payload().Name("Sensor 42").Service16(0x180F), time, true)).changed == 0);
+        LUMINA_CHECK(coalescer.GetStats().unchanged == 2);
+    }
+
+    void TestReassembly()
+    {
+        LuminaAdvertCoalescer coalescer;
+        const Clock::time_point time{};
+        Payload payload;
+        payload.Flags(0x06).Filler(200).Filler(200).Name("Long Advert").Service16(0x1812);
+        std::vector<Sample> fragments = Fragment(2, payload, 100, time);
+        LUMINA_CHECK(fragments.size() > 3);
+        for (size_t i = 0; i + 1 < fragments.size(); ++i)
+        {
+            LUMINA_CHECK(!coalescer.Merge(fragments[i]).record);
+        }
+        auto result = coalescer.Merge(fragments.back());
+        LUMINA_CHECK(result.record && result.isNew);
+        LUMINA_CHECK(result.record->name == "Long Advert" && result.record->serviceUuids.size() == 1);
+        LUMINA_CHECK(coalescer.GetStats().reassembled == 1);
+
+        // The watcher's split of a 254-byte structure, too long for any one sample: its first 255 bytes close one
+        // fragment and its last byte opens the next
+        std::vector<uint16_t> uuids(127);
+        for (size_t i = 0; i < uuids.size(); ++i)
+        {
+            uuids[i] = static_cast<uint16_t>(0x1800 + i);
+        }
+        Payload straddled;
+        straddled.Name("Straddle").Add(0x03, uuids.data(), uuids.size() * 2);
+        const size_t nameLength = 10;
+        const uint8_t* bytes = straddled.bytes.data();
+        LUMINA_CHECK(!coalescer.Merge(MakeSample(3, bytes, nameLength, time, Sample::DataMoreToCome)).record);
+        LUMINA_CHECK(!coalescer.Merge(MakeSample(3, bytes + nameLength, Sample::MaxPayloadSize, time, Sample::DataMoreToCome)).record);
+        result = coalescer.Merge(MakeSample(3, bytes + nameLength + Sample::MaxPayloadSize, 1, time));
+        LUMINA_CHECK(result.record && result.record->name == "Straddle" && result.record->serviceUuids.size() == uuids.size());
+
+        // A chain longer than the largest extended advert is dropped, and so is the rest of it
+        Payload huge;
+        for (int i = 0; i < 8; ++i)
+        {
+            huge.Filler(240);
+        }
+        huge.Name("Other");
+        std::vector<Sample> chain = Fragment(2, huge, 240, time);
+        size_t merged = 0;
+        for (const Sample& sample : chain)
+        {
+            merged += coalescer.Merge(sample).record ? 1 : 0;
+        }
+        LUMINA_CHECK(merged == 0);
+        LUMINA_CHECK(coalescer.GetStats().droppedFragments == 1);
+        LUMINA_CHECK(coalescer.GetStats().orphanFragments > 0);
+
+        // The device's next whole advert merges as usual
+        auto next = coalescer.Merge(Whole(2, Payload().Flags(0x06).Name("Short"), time + std::chrono::milliseconds(5)));
+        LUMINA_CHECK(next.record && next.record->name == "Short");
+    }
+
+    // The tail of a chain whose assembly was evicted must not be merged as a whole advert
+    void TestOrphanTail()
+    {
+        LuminaAdvertCoalescer coalescer;
+        Clock::time_point time{};
+        const Payload full = Payload().Flags(0x06).Service16(0x180A).Name("Victim");
+        LUMINA_CHECK(coalescer.Merge(Whole(100, full, time)).record);
+
+        // Start a chain for the victim, then more chains than the pool holds so the victim's is evicted
+        Payload chained;
+        chained.Flags(0x06).Filler(150).Name("Victim Extended");
+        std::vector<Sample> victimChain = Fragment(100, chained, 100, time);
+        LUMINA_CHECK(!coalescer.Merge(victimChain[0]).record);
+        for (uint64_t address = 200; address < 200 + LuminaAdvertCoalescer::AssemblyCount; ++address)
+        {
+            time += std::chrono::milliseconds(1);
+            LUMINA_CHECK(!coalescer.Merge(Fragment(address, chained, 100, time)[0]).record);
+        }
+        LUMINA_CHECK(coalescer.GetStats().droppedFragments == 1);
+
+        // The victim's final fragment arrives: dropped and counted, the record keeps its name and UUIDs
+        victimChain.back().timestamp = time;
+        LUMINA_CHECK(!coalescer.Merge(victimChain.back()).record);
+        LUMINA_CHECK(coalescer.GetStats().orphanFragments == 1);
+        auto result = coalescer.Merge(Whole(100, full, time));
+        LUMINA_CHECK(result.record && result.changed == 0);
+        LUMINA_CHECK(result.record->name == "Victim" && result.record->serviceUuids.size() == 1);
+
+        // Long after a chain was abandoned, a sample is a new advert again
+        LuminaAdvertCoalescer later;
+        LUMINA_CHECK(!later.Merge(Fragment(101, chained, 100, time)[0]).record);
+        for (uint64_t address = 300; address < 300 + LuminaAdvertCoalescer::AssemblyCount; ++address)
+        {
+            time += std::chrono::milliseconds(1);
+            LUMINA_CHECK(!later.Merge(Fragment(address, chained, 100, time)[0]).record);
+        }
+        LUMINA_CHECK(later.GetStats().droppedFragments == 1);
+        time += LuminaAdvertCoalescer::LostTailWindow + std::chrono::milliseconds(1);
+        result = later.Merge(Whole(101, Payload().Flags(0x06).Name("Later"), time));
+        LUMINA_CHECK(result.record && result.record->name == "Later");
+        LUMINA_CHECK(later.GetStats().orphanFragments == 0);
+    }
+
+    void TestTruncated()
+    {
+        LuminaAdvertCoalescer coalescer;
+        const Clock::time_point time{};
+        const Payload full = Payload().Flags(0x06).Service16(0x180D).Name("Whole Name");
+        const Payload cut = Payload().Flags(0x06);
+
+        // With nothing better, a truncated advert is used
+        auto result = coalescer.Merge(MakeSample(5, cut.bytes.data(), cut.bytes.size(), time, Sample::DataTruncated));
+        LUMINA_CHECK(result.record && result.isNew);
+
+        LUMINA_CHECK(coalescer.Merge(Whole(5, full, time)).record->name == "Whole Name");
+
+        // ...but never replaces a whole one
+        result = coalescer.Merge(MakeSample(5, cut.bytes.data(), cut.bytes.size(), time, Sample::DataTruncated));
+        LUMINA_CHECK(result.record && result.changed == 0);
+        LUMINA_CHECK(result.record->name == "Whole Name" && result.record->serviceUuids.size() == 1);
+
+        // Nor does a chain the controller truncated
+        std::vector<Sample> chain = Fragment(5, Payload().Flags(0x06).Filler(150), 100, time);
+        chain.back().dataStatus = Sample::DataTruncated;
+        LUMINA_CHECK(!coalescer.Merge(chain[0]).record);
+        result = coalescer.Merge(chain[1]);
+        LUMINA_CHECK(result.record && result.changed == 0 && result.record->name == "Whole Name");
+        LUMINA_CHECK(coalescer.GetStats().truncatedIgnored == 2);
+    }
+
+    // High-density replay: each device sends an advert and a scan response, some as 2-fragment extended adverts.
+    // Compared with hashing each sample and re-parsing it into the device whenever the hash moves.
+    // Removing a device frees its chain; the record moved into its place keeps its own chain and fields
+    void TestRemove()
+    {
+        LuminaAdvertCoalescer coalescer;
+        const Clock::time_point time{};
+        Payload payload;
+        payload.Flags(0x06).Filler(200).Name("Chained").Service16(0x1812);
+        std::vector<Sample> removedChain = Fragment(1, payload, 100, time);
+        std::vector<Sample> movedChain = Fragment(3, payload, 100, time);
+
+        coalescer.Merge(Whole(2, Payload().Name("Middle"), time));
+        LUMINA_CHECK(!coalescer.Merge(removedChain[0]).record);
+        LUMINA_CHECK(!coalescer.Merge(movedChain[0]).record);
+        coalescer.Remove(1);
+        coalescer.Remove(0xDEAD); // Unknown; ignored
+
+        for (size_t i = 1; i + 1 < movedChain.size(); ++i)
+        {
+            LUMINA_CHECK(!coalescer.Merge(movedChain[i]).record);
+        }
+        auto moved = coalescer.Merge(movedChain.back());
+        LUMINA_CHECK(moved.record && moved.isNew && moved.record->address == 3 && moved.record->name == "Chained");
+
+        auto middle = coalescer.Merge(Whole(2, Payload().Name("Middle"), time));
+        LUMINA_CHECK(middle.record && !middle.isNew && middle.changed == 0);
+
+        // The removed device starts over
+        auto fresh = coalescer.Merge(Whole(1, Payload().Name("Back"), time));
+        LUMINA_CHECK(fresh.record && fresh.isNew && fresh.record->name == "Back");
+        LUMINA_CHECK(coalescer.GetStats().droppedFragments == 0);
+
+        // Every assembly is free again: a full pool of new chains starts without evicting any
+        for (uint64_t address = 10; address < 10 + LuminaAdvertCoalescer::AssemblyCount; ++address)
+        {
+            coalescer.Merge(Fragment(address, payload, 100, time)[0]);
+        }
+        LUMINA_CHECK(coalescer.GetStats().droppedFragments == 0);
+    }
+
+    // The old hash kept per PDU type instead, so an advert and its scan response no longer evict each other's
+    size_t CountTypedHashMisses(const std::vector<Sample>& replay)
+    {
+        std::unordered_map<uint64_t, uint64_t> hashes;
+        size_t misses = 0;
+        for (const Sample& sample : replay)
+        {
+            uint64_t& previous = hashes[sample.address << 8 | sample.advertisementType];
+            uint64_t hash = LuminaHelper::HashBytes(sample.payload, sample.payloadLength);
+            misses += hash != previous ? 1 : 0;
+            previous = hash;
+        }
+        return misses;
+    }
+
+    void BenchmarkReplay()
+    {
+        constexpr int DeviceCount = 4000;
+        constexpr int Rounds = 100;
+        std::mt19937 random(17);
+
+        std::vector<std::vector<Sample>> perDevice(DeviceCount);
+        for (int device = 0; device < DeviceCount; ++device)
+        {
+            const uint64_t address = 0xE00000000000ull + static_cast<uint64_t>(device);
+            Payload advert = Payload().Flags(0x06).Service16(static_cast<uint16_t>(0x1800 + device % 32)).Name("Dev", false);
+            Payload response = Payload().Name("Device " + std::to_string(device));
+            if (device % 10 == 0)
+            {
+                advert.Filler(180);
+                perDevice[device] = Fragment(address, advert, 128, Clock::time_point{});
+            }
+            else
+            {
+                perDevice[device].push_back(Whole(address, advert, Clock::time_point{}));
+            }
+            perDevice[device].push_back(Whole(address, response, Clock::time_point{}, true));
+        }
+        std::vector<Sample> replay;
+        for (int round = 0; round < Rounds; ++round)
+        {
+            for (int i = 0; i < DeviceCount; ++i)
+            {
+                for (Sample sample : perDevice[(static_cast<size_t>(i) * 7919 + static_cast<size_t>(round)) % DeviceCount])
+                {
+                    sample.timestamp = Clock::time_point{} + std::chrono::milliseconds(round * 100);
+                    replay.push_back(sample);
+                }
+            }
+        }
+
+        // Old path: re-parse whenever the sample's hash differs from the device's previous one
+        struct Parsed
+        {
+            uint64_t hash = 0;
+            std::string name;
+            std::vector<Lumina::ServiceUuid> uuids;
+        };
+        std::unordered_map<uint64_t, Parsed> devices;
+        size_t reparsed = 0;
+        size_t nameFlips = 0;
+        auto start = Clock::now();
+        for (const Sample& sample : replay)
+        {
+            Parsed& device = devices[sample.address];
+            uint64_t hash = LuminaHelper::HashBytes(sample.payload, sample.payloadLength);
+            if (hash == device.hash)
+            {
+                continue;
+            }
+            device.hash = hash;
+            ++reparsed;
+            auto name = Lumina::AdvertisementParser::GetLocalName(sample.payload, sample.payloadLength);
+            std::string newName = name ? *name : std::string();
+            nameFlips += newName != device.name ? 1 : 0;
+            device.name = newName;
+            device.uuids.clear();
+            Lumina::AdvertisementParser::GetServiceUuids(sample.payload, sample.payloadLength, device.uuids);
+        }
+        const double oldNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(replay.size());
+        const size_t typedReparsed = CountTypedHashMisses(replay);
+
+        LuminaAdvertCoalescer coalescer;
+        size_t changed = 0;
+        size_t nameChanges = 0;
+        start = Clock::now();
+        for (const Sample& sample : replay)
+        {
+            auto result = coalescer.Merge(sample);
+            changed += result.record && result.changed ? 1 : 0;
+            nameChanges += result.changed & LuminaAdvertCoalescer::ChangeName ? 1 : 0;
+        }
+        const double newNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(replay.size());
+
+        std::printf("advert coalescer: %zu samples; hash-and-reparse %.0f ns/sample, %.0f%% re-parsed, %zu name flips; "
+            "per-type hash %.1f%% re-parsed; coalescer %.0f ns/sample, %.1f%% changed, %zu name changes\n",
+            replay.size(), oldNs, 100.0 * static_cast<double>(reparsed) / static_cast<double>(replay.size()), nameFlips,
+            100.0 * static_cast<double>(typedReparsed) / static_cast<double>(replay.size()),
+            newNs, 100.0 * static_cast<double>(changed) / static_cast<double>(replay.size()), nameChanges);
+        // Each device names itself once from its advert and once more from its scan response, then never again
+        LUMINA_CHECK(nameChanges == 2 * DeviceCount);
+        LUMINA_CHECK(changed <= typedReparsed && typedReparsed < reparsed);
+        LUMINA_CHECK(coalescer.GetStats().orphanFragments == 0 && coalescer.GetStats().droppedFragments == 0);
+    }
+}
+
+int main()
+{
+    TestScanResponseMerge();
+    TestReassembly();
+    TestOrphanTail();
+    TestTruncated();
+    TestRemove();
+    BenchmarkReplay();
+    return LuminaTest::Finish();
+}
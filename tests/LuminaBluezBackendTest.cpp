@@ -0,0 +1,1000 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <dbus/dbus.h>
+#include "LuminaAdvertCoalescer.h"
+#include "LuminaBluezBackend.h"
+#include "LuminaHelper.h"
+#include "LuminaNdjsonWriter.h"
+#include "LuminaScanMerger.h"
+#include "LuminaTest.h"
+
+// Drives LuminaBluezBackend against a mock org.bluez on a private bus. Run under dbus-run-session.
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int AdapterCount = 2;
+    constexpr int DeviceCount = 64;         // On hci0; the first SharedCount are also seen by hci1
+    constexpr int SharedCount = 8;
+    constexpr uint64_t AdapterAddress = 0x001A7DDA7113ull;
+    constexpr uint64_t FirstDeviceAddress = 0xC00000000000ull;
+    constexpr int RefusingDevice = 12;      // Its Connect fails as a real stack's might
+
+    std::string DevicePath(int adapter, int device)
+    {
+        char path[64];
+        std::snprintf(path, sizeof(path), "/org/bluez/hci%d/dev_C0_00_00_00_%02X_%02X", adapter, (device >> 8) & 0xFF, device & 0xFF);
+        return path;
+    }
+
+    std::string DeviceAddressText(int device)
+    {
+        char text[32];
+        std::snprintf(text, sizeof(text), "C0:00:00:00:%02X:%02X", (device >> 8) & 0xFF, device & 0xFF);
+        return text;
+    }
+
+    // libdbus container helpers for a{sv} property dictionaries
+    void OpenEntry(DBusMessageIter* dict, const char* key, const char* signature, DBusMessageIter* entry, DBusMessageIter* variant)
+    {
+        dbus_message_iter_open_container(dict, DBUS_TYPE_DICT_ENTRY, nullptr, entry);
+        dbus_message_iter_append_basic(entry, DBUS_TYPE_STRING, &key);
+        dbus_message_iter_open_container(entry, DBUS_TYPE_VARIANT, signature, variant);
+    }
+
+    void CloseEntry(DBusMessageIter* dict, DBusMessageIter* entry, DBusMessageIter* variant)
+    {
+        dbus_message_iter_close_container(entry, variant);
+        dbus_message_iter_close_container(dict, entry);
+    }
+
+    void AppendProperty(DBusMessageIter* dict, const char* key, int type, const void* value)
+    {
+        const char signature[2] = { static_cast<char>(type), 0 };
+        DBusMessageIter entry, variant;
+        OpenEntry(dict, key, signature, &entry, &variant);
+        dbus_message_iter_append_basic(&variant, type, value);
+        CloseEntry(dict, &entry, &variant);
+    }
+
+    void AppendBytes(DBusMessageIter* iter, const uint8_t* data, int size)
+    {
+        DBusMessageIter array;
+        dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, "y", &array);
+        dbus_message_iter_append_fixed_array(&array, DBUS_TYPE_BYTE, &data, size);
+        dbus_message_iter_close_container(iter, &array);
+    }
+
+    // ManufacturerData (a{qv}) or ServiceData (a{sv}) with a single entry
+    template <typename Key>
+    void AppendKeyedBytes(DBusMessageIter* dict, const char* name, int keyType, Key key, const uint8_t* data, int size)
+    {
+        const bool isShort = keyType == DBUS_TYPE_UINT16;
+        DBusMessageIter entry, variant, array, item, inner;
+        OpenEntry(dict, name, isShort ? "a{qv}" : "a{sv}", &entry, &variant);
+        dbus_message_iter_open_container(&variant, DBUS_TYPE_ARRAY, isShort ? "{qv}" : "{sv}", &array);
+        dbus_message_iter_open_container(&array, DBUS_TYPE_DICT_ENTRY, nullptr, &item);
+        dbus_message_iter_append_basic(&item, keyType, &key);
+        dbus_message_iter_open_container(&item, DBUS_TYPE_VARIANT, "ay", &inner);
+        AppendBytes(&inner, data, size);
+        dbus_message_iter_close_container(&item, &inner);
+        dbus_message_iter_close_container(&array, &item);
+        dbus_message_iter_close_container(&variant, &array);
+        CloseEntry(dict, &entry, &variant);
+    }
+
+    void AppendUuids(DBusMessageIter* dict, const std::vector<const char*>& uuids)
+    {
+        DBusMessageIter entry, variant, array;
+        OpenEntry(dict, "UUIDs", "as", &entry, &variant);
+        dbus_message_iter_open_container(&variant, DBUS_TYPE_ARRAY, "s", &array);
+        for (const char* uuid : uuids)
+        {
+            dbus_message_iter_append_basic(&array, DBUS_TYPE_STRING, &uuid);
+        }
+        dbus_message_iter_close_container(&variant, &array);
+        CloseEntry(dict, &entry, &variant);
+    }
+
+    // Opens the a{sa{sv}} entry for one interface of an object and fills its properties
+    void AppendInterface(DBusMessageIter* interfaces, const char* name, const std::function<void(DBusMessageIter*)>& fill)
+    {
+        DBusMessageIter entry, properties;
+        dbus_message_iter_open_container(interfaces, DBUS_TYPE_DICT_ENTRY, nullptr, &entry);
+        dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &name);
+        dbus_message_iter_open_container(&entry, DBUS_TYPE_ARRAY, "{sv}", &properties);
+        fill(&properties);
+        dbus_message_iter_close_container(&entry, &properties);
+        dbus_message_iter_close_container(interfaces, &entry);
+    }
+
+    // Enough of bluetoothd for the backend: the object tree, the adapter and device methods, the agent
+    // round trip on Pair and the signals that follow each call. Counts the method calls it sees.
+    class MockBluez
+    {
+    public:
+        std::atomic<int> methodCalls = 0;
+        std::atomic<int> propertyGets = 0;  // The backend should never fetch a property on its own
+        std::atomic<int> filterRssi = 0;    // RSSI of the last SetDiscoveryFilter, 0 if it had none
+        std::atomic<bool> isFilterLeOnly = false;
+
+        bool Start(const char* address)
+        {
+            DBusError error;
+            dbus_error_init(&error);
+            m_Connection = dbus_connection_open_private(address, &error);
+            if (m_Connection && dbus_bus_register(m_Connection, &error))
+            {
+                dbus_bus_request_name(m_Connection, "org.bluez", DBUS_NAME_FLAG_DO_NOT_QUEUE, &error);
+            }
+            if (dbus_error_is_set(&error))
+            {
+                std::fprintf(stderr, "mock org.bluez: %s\n", error.message);
+                dbus_error_free(&error);
+                return false;
+            }
+            m_Thread = std::thread([this] { Run(); });
+            return true;
+        }
+
+        void Stop()
+        {
+            m_IsStopping = true;
+            if (m_Thread.joinable())
+            {
+                m_Thread.join();
+            }
+            if (m_Connection)
+            {
+                dbus_connection_close(m_Connection);
+                dbus_connection_unref(m_Connection);
+                m_Connection = nullptr;
+            }
+        }
+
+        // Runs on the mock's thread, which owns the connection
+        void Post(std::function<void()> task)
+        {
+            std::lock_guard<std::mutex> lock(m_TaskMutex);
+            m_Tasks.push_back(std::move(task));
+        }
+
+        // One advert: the RSSI and manufacturer data carrying a sequence number and the send time, now unless given
+        void SendAdvert(int adapter, int device, uint64_t sequence, int16_t rssi, int64_t sent = 0)
+        {
+            SendPropertiesChanged(DevicePath(adapter, device), "org.bluez.Device1", [&](DBusMessageIter* dict)
+                {
+                    dbus_int16_t value = rssi;
+                    AppendProperty(dict, "RSSI", DBUS_TYPE_INT16, &value);
+                    uint8_t data[16];
+                    if (sent == 0)
+                    {
+                        sent = Clock::now().time_since_epoch().count();
+                    }
+                    std::memcpy(data, &sequence, 8);
+                    std::memcpy(data + 8, &sent, 8);
+                    AppendKeyedBytes(dict, "ManufacturerData", DBUS_TYPE_UINT16, static_cast<dbus_uint16_t>(0x0059), data, 16);
+                });
+        }
+
+        // The object at path losing interfaceName, as when a device is removed or an adapter unplugged
+        void SendInterfacesRemoved(const std::string& path, const char* interfaceName)
+        {
+            DBusMessage* signal = dbus_message_new_signal("/", "org.freedesktop.DBus.ObjectManager", "InterfacesRemoved");
+            DBusMessageIter iter, interfaces;
+            const char* pathText = path.c_str();
+            const char* propertiesInterface = "org.freedesktop.DBus.Properties";
+            dbus_message_iter_init_append(signal, &iter);
+            dbus_message_iter_append_basic(&iter, DBUS_TYPE_OBJECT_PATH, &pathText);
+            dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "s", &interfaces);
+            dbus_message_iter_append_basic(&interfaces, DBUS_TYPE_STRING, &interfaceName);
+            dbus_message_iter_append_basic(&interfaces, DBUS_TYPE_STRING, &propertiesInterface);
+            dbus_message_iter_close_container(&iter, &interfaces);
+            dbus_connection_send(m_Connection, signal, nullptr);
+            dbus_message_unref(signal);
+        }
+
+        void Flush()
+        {
+            dbus_connection_flush(m_Connection);
+        }
+
+    private:
+        DBusConnection* m_Connection = nullptr;
+        std::thread m_Thread;
+        std::atomic<bool> m_IsStopping = false;
+        std::mutex m_TaskMutex;
+        std::vector<std::function<void()>> m_Tasks;
+
+        void Run()
+        {
+            while (!m_IsStopping)
+            {
+                std::vector<std::function<void()>> tasks;
+                {
+                    std::lock_guard<std::mutex> lock(m_TaskMutex);
+                    tasks.swap(m_Tasks);
+                }
+                for (auto& task : tasks)
+                {
+                    task();
+                }
+                dbus_connection_read_write(m_Connection, tasks.empty() ? 1 : 0);
+                while (DBusMessage* message = dbus_connection_pop_message(m_Connection))
+                {
+                    Handle(message);
+                    dbus_message_unref(message);
+                }
+            }
+        }
+
+        void SendPropertiesChanged(const std::string& path, const char* interfaceName, const std::function<void(DBusMessageIter*)>& fill)
+        {
+            DBusMessage* signal = dbus_message_new_signal(path.c_str(), "org.freedesktop.DBus.Properties", "PropertiesChanged");
+            DBusMessageIter iter, dict, invalidated;
+            dbus_message_iter_init_append(signal, &iter);
+            dbus_message_iter_append_basic(&iter, DBUS_TYPE_STRING, &interfaceName);
+            dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "{sv}", &dict);
+            fill(&dict);
+            dbus_message_iter_close_container(&iter, &dict);
+            dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "s", &invalidated);
+            dbus_message_iter_close_container(&iter, &invalidated);
+            dbus_connection_send(m_Connection, signal, nullptr);
+            dbus_message_unref(signal);
+        }
+
+        static void AppendAdapter(DBusMessageIter* interfaces, int adapter)
+        {
+            AppendInterface(interfaces, "org.bluez.Adapter1", [adapter](DBusMessageIter* properties)
+                {
+                    const char* address = adapter == 0 ? "00:1A:7D:DA:71:13" : "00:1A:7D:DA:71:14";
+                    const char* alias = adapter == 0 ? "mock-hci0" : "mock-hci1";
+                    dbus_bool_t isPowered = TRUE;
+                    dbus_bool_t isDiscovering = FALSE;
+                    AppendProperty(properties, "Address", DBUS_TYPE_STRING, &address);
+                    AppendProperty(properties, "Alias", DBUS_TYPE_STRING, &alias);
+                    AppendProperty(properties, "Powered", DBUS_TYPE_BOOLEAN, &isPowered);
+                    AppendProperty(properties, "Discovering", DBUS_TYPE_BOOLEAN, &isDiscovering);
+                });
+        }
+
+        static void AppendDevice(DBusMessageIter* interfaces, int device)
+        {
+            AppendInterface(interfaces, "org.bluez.Device1", [device](DBusMessageIter* properties)
+                {
+                    std::string addressText = DeviceAddressText(device);
+                    std::string nameText = "Dev" + std::to_string(device);
+                    const char* address = addressText.c_str();
+                    const char* addressType = "random";
+                    const char* name = nameText.c_str();
+                    dbus_bool_t isPaired = device == 0;
+                    dbus_bool_t isConnected = FALSE;
+                    dbus_int16_t rssi = -60;
+                    dbus_int16_t txPower = 4;
+                    dbus_uint16_t appearance = 0x03C1;
+                    AppendProperty(properties, "Address", DBUS_TYPE_STRING, &address);
+                    AppendProperty(properties, "AddressType", DBUS_TYPE_STRING, &addressType);
+                    AppendProperty(properties, "Name", DBUS_TYPE_STRING, &name);
+                    AppendProperty(properties, "RSSI", DBUS_TYPE_INT16, &rssi);
+                    AppendProperty(properties, "TxPower", DBUS_TYPE_INT16, &txPower);
+                    AppendProperty(properties, "Appearance", DBUS_TYPE_UINT16, &appearance);
+                    AppendProperty(properties, "Paired", DBUS_TYPE_BOOLEAN, &isPaired);
+                    AppendProperty(properties, "Connected", DBUS_TYPE_BOOLEAN, &isConnected);
+                    AppendUuids(properties, { "0000180f-0000-1000-8000-00805f9b34fb", "6e400001-b5a3-f393-e0a9-e50e24dcca9e" });
+                    const uint8_t serviceData[2] = { 0x55, 0x66 };
+                    AppendKeyedBytes(properties, "ServiceData", DBUS_TYPE_STRING, "0000feaa-0000-1000-8000-00805f9b34fb", serviceData, 2);
+                    const uint8_t manufacturerData[3] = { 1, 2, 3 };
+                    AppendKeyedBytes(properties, "ManufacturerData", DBUS_TYPE_UINT16, static_cast<dbus_uint16_t>(0x004C), manufacturerData, 3);
+                });
+        }
+
+        DBusMessage* ReplyManagedObjects(DBusMessage* message)
+        {
+            DBusMessage* reply = dbus_message_new_method_return(message);
+            DBusMessageIter iter, objects;
+            dbus_message_iter_init_append(reply, &iter);
+            dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "{oa{sa{sv}}}", &objects);
+            auto appendObject = [&objects](const std::string& path, const std::function<void(DBusMessageIter*)>& fill)
+                {
+                    DBusMessageIter entry, interfaces;
+                    const char* pathText = path.c_str();
+                    dbus_message_iter_open_container(&objects, DBUS_TYPE_DICT_ENTRY, nullptr, &entry);
+                    dbus_message_iter_append_basic(&entry, DBUS_TYPE_OBJECT_PATH, &pathText);
+                    dbus_message_iter_open_container(&entry, DBUS_TYPE_ARRAY, "{sa{sv}}", &interfaces);
+                    fill(&interfaces);
+                    dbus_message_iter_close_container(&entry, &interfaces);
+                    dbus_message_iter_close_container(&objects, &entry);
+                };
+            for (int adapter = 0; adapter < AdapterCount; ++adapter)
+            {
+                appendObject("/org/bluez/hci" + std::to_string(adapter), [adapter](DBusMessageIter* interfaces) { AppendAdapter(interfaces, adapter); });
+            }
+            for (int device = 0; device < DeviceCount; ++device)
+            {
+                appendObject(DevicePath(0, device), [device](DBusMessageIter* interfaces) { AppendDevice(interfaces, device); });
+                if (device < SharedCount)
+                {
+                    appendObject(DevicePath(1, device), [device](DBusMessageIter* interfaces) { AppendDevice(interfaces, device); });
+                }
+            }
+            dbus_message_iter_close_container(&iter, &objects);
+            return reply;
+        }
+
+        // Asks the client's agent to confirm, as bluetoothd does for Just Works, then reports the device paired
+        DBusMessage* ReplyPair(DBusMessage* message, const char* path)
+        {
+            DBusMessage* request = dbus_message_new_method_call(dbus_message_get_sender(message), "/org/lumina/agent", "org.bluez.Agent1", "RequestConfirmation");
+            dbus_uint32_t passkey = 123456;
+            dbus_message_append_args(request, DBUS_TYPE_OBJECT_PATH, &path, DBUS_TYPE_UINT32, &passkey, DBUS_TYPE_INVALID);
+            DBusError error;
+            dbus_error_init(&error);
+            DBusMessage* answer = dbus_connection_send_with_reply_and_block(m_Connection, request, 2000, &error);
+            dbus_message_unref(request);
+            if (!answer)
+            {
+                DBusMessage* reply = dbus_message_new_error(message, "org.bluez.Error.AuthenticationRejected", error.message);
+                dbus_error_free(&error);
+                return reply;
+            }
+            dbus_message_unref(answer);
+            dbus_bool_t isPaired = TRUE;
+            SendPropertiesChanged(path, "org.bluez.Device1", [&](DBusMessageIter* dict) { AppendProperty(dict, "Paired", DBUS_TYPE_BOOLEAN, &isPaired); });
+            return dbus_message_new_method_return(message);
+        }
+
+        DBusMessage* ReplyRemoveDevice(DBusMessage* message)
+        {
+            const char* device = nullptr;
+            dbus_message_get_args(message, nullptr, DBUS_TYPE_OBJECT_PATH, &device, DBUS_TYPE_INVALID);
+            SendInterfacesRemoved(device, "org.bluez.Device1");
+            return dbus_message_new_method_return(message);
+        }
+
+        void ReadDiscoveryFilter(DBusMessage* message)
+        {
+            filterRssi = 0;
+            isFilterLeOnly = false;
+            DBusMessageIter args;
+            DBusMessageIter dictionary;
+            if (!dbus_message_iter_init(message, &args) || dbus_message_iter_get_arg_type(&args) != DBUS_TYPE_ARRAY)
+            {
+                return;
+            }
+            for (dbus_message_iter_recurse(&args, &dictionary); dbus_message_iter_get_arg_type(&dictionary) == DBUS_TYPE_DICT_ENTRY;
+                dbus_message_iter_next(&dictionary))
+            {
+                DBusMessageIter entry;
+                DBusMessageIter variant;
+                const char* key = nullptr;
+                dbus_message_iter_recurse(&dictionary, &entry);
+                dbus_message_iter_get_basic(&entry, &key);
+                dbus_message_iter_next(&entry);
+                dbus_message_iter_recurse(&entry, &variant);
+                if (std::strcmp(key, "RSSI") == 0 && dbus_message_iter_get_arg_type(&variant) == DBUS_TYPE_INT16)
+                {
+                    dbus_int16_t rssi = 0;
+                    dbus_message_iter_get_basic(&variant, &rssi);
+                    filterRssi = rssi;
+                }
+                else if (std::strcmp(key, "Transport") == 0 && dbus_message_iter_get_arg_type(&variant) == DBUS_TYPE_STRING)
+                {
+                    const char* transport = nullptr;
+                    dbus_message_iter_get_basic(&variant, &transport);
+                    isFilterLeOnly = std::strcmp(transport, "le") == 0;
+                }
+            }
+        }
+
+        void Handle(DBusMessage* message)
+        {
+            if (dbus_message_get_type(message) != DBUS_MESSAGE_TYPE_METHOD_CALL)
+            {
+                return;
+            }
+            ++methodCalls;
+            const char* interfaceName = dbus_message_get_interface(message);
+            const char* member = dbus_message_get_member(message);
+            const char* path = dbus_message_get_path(message);
+            DBusMessage* reply = nullptr;
+            if (interfaceName && std::strcmp(interfaceName, "org.freedesktop.DBus.Properties") == 0)
+            {
+                ++propertyGets;
+                reply = dbus_message_new_error(message, DBUS_ERROR_NOT_SUPPORTED, "Properties are only sent as signals");
+            }
+            else if (std::strcmp(member, "GetManagedObjects") == 0)
+            {
+                reply = ReplyManagedObjects(message);
+            }
+            else if (std::strcmp(member, "SetDiscoveryFilter") == 0)
+            {
+                ReadDiscoveryFilter(message);
+                reply = dbus_message_new_method_return(message);
+            }
+            else if (std::strcmp(member, "RegisterAgent") == 0 || std::strcmp(member, "RequestDefaultAgent") == 0 ||
+                std::strcmp(member, "UnregisterAgent") == 0)
+            {
+                reply = dbus_message_new_method_return(message);
+            }
+            else if (std::strcmp(member, "StartDiscovery") == 0 || std::strcmp(member, "StopDiscovery") == 0)
+            {
+                dbus_bool_t isDiscovering = std::strcmp(member, "StartDiscovery") == 0;
+                SendPropertiesChanged(path, "org.bluez.Adapter1", [&](DBusMessageIter* dict) { AppendProperty(dict, "Discovering", DBUS_TYPE_BOOLEAN, &isDiscovering); });
+                reply = dbus_message_new_method_return(message);
+            }
+            else if (std::strcmp(member, "Pair") == 0)
+            {
+                reply = ReplyPair(message, path);
+            }
+            else if (std::strcmp(member, "Connect") == 0 && DevicePath(0, RefusingDevice) == path)
+            {
+                reply = dbus_message_new_error(message, "org.bluez.Error.Failed", "le-connection-abort-by-local");
+            }
+            else if (std::strcmp(member, "Connect") == 0 || std::strcmp(member, "Disconnect") == 0)
+            {
+                dbus_bool_t isConnected = std::strcmp(member, "Connect") == 0;
+                SendPropertiesChanged(path, "org.bluez.Device1", [&](DBusMessageIter* dict) { AppendProperty(dict, "Connected", DBUS_TYPE_BOOLEAN, &isConnected); });
+                reply = dbus_message_new_method_return(message);
+            }
+            else if (std::strcmp(member, "RemoveDevice") == 0)
+            {
+                reply = ReplyRemoveDevice(message);
+            }
+            else
+            {
+                reply = dbus_message_new_error(message, DBUS_ERROR_UNKNOWN_METHOD, member);
+            }
+            dbus_connection_send(m_Connection, reply, nullptr);
+            dbus_message_unref(reply);
+        }
+    };
+
+    // What the backend's handlers saw
+    struct Sink
+    {
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::vector<Lumina::AdvertisementSample> samples;
+        std::vector<LuminaBluezBackend::DeviceState> states;
+        std::vector<double> latencies;  // Signal sent to sample handled, ms
+
+        void Attach(LuminaBluezBackend& backend)
+        {
+            backend.HandleOnSample([this](const Lumina::AdvertisementSample& sample) { Add(sample); });
+            backend.HandleOnDeviceState([this](const LuminaBluezBackend::DeviceState& state)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    states.push_back(state);
+                    changed.notify_all();
+                });
+        }
+
+        void Add(const Lumina::AdvertisementSample& sample)
+        {
+            const int64_t now = Clock::now().time_since_epoch().count();
+            std::lock_guard<std::mutex> lock(mutex);
+            samples.push_back(sample);
+            Lumina::AdvertisementParser::ForEachSection(sample.payload, sample.payloadLength, [&](uint8_t type, const uint8_t* data, size_t size)
+                {
+                    if (type == 0xFF && size == 18 && data[0] == 0x59)
+                    {
+                        int64_t sent = 0;
+                        std::memcpy(&sent, data + 10, 8);
+                        latencies.push_back(std::chrono::duration<double, std::milli>(Clock::duration(now - sent)).count());
+                    }
+                    return true;
+                });
+            changed.notify_all();
+        }
+
+        bool WaitForSamples(size_t count, std::chrono::milliseconds timeout = std::chrono::milliseconds(5000))
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            return changed.wait_for(lock, timeout, [&] { return samples.size() >= count; });
+        }
+
+        bool WaitForStates(size_t count)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            return changed.wait_for(lock, std::chrono::seconds(5), [&] { return states.size() >= count; });
+        }
+    };
+
+    // Blocks on one asynchronous call's completion
+    struct Waiter
+    {
+        std::mutex mutex;
+        std::condition_variable done;
+        bool isDone = false;
+        bool isSucceeded = false;
+        std::string error;
+
+        LuminaBluezBackend::Completion Get()
+        {
+            return [this](bool succeeded, const std::string& message)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    isDone = true;
+                    isSucceeded = succeeded;
+                    error = message;
+                    done.notify_all();
+                };
+        }
+
+        bool Wait()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            LUMINA_CHECK(done.wait_for(lock, std::chrono::seconds(10), [this] { return isDone; }));
+            return isSucceeded;
+        }
+    };
+
+    LuminaBluezBackend::Options MakeOptions(const char* busAddress)
+    {
+        LuminaBluezBackend::Options options;
+        options.busAddress = busAddress;
+        options.callTimeout = std::chrono::milliseconds(500);
+        return options;
+    }
+
+    // The snapshot at start, the advert rebuilt from properties, and the pairing and connection calls
+    void TestSnapshotAndControl(MockBluez& mock, const char* busAddress)
+    {
+        Sink sink;
+        LuminaBluezBackend backend;
+        sink.Attach(backend);
+        std::string error;
+        const int callsBefore = mock.methodCalls;
+        LUMINA_CHECK(backend.Start(MakeOptions(busAddress), error));
+
+        std::vector<LuminaBluezBackend::Adapter> adapters = backend.GetAdapters();
+        LUMINA_CHECK(adapters.size() == AdapterCount);
+        LUMINA_CHECK(adapters[0].index == 0 && adapters[0].isPowered && adapters[0].address == AdapterAddress && adapters[0].name == "mock-hci0");
+        LUMINA_CHECK(adapters[1].index == 1);
+        {
+            // The paired device is reported once per adapter that knows it; nothing has advertised yet
+            std::lock_guard<std::mutex> lock(sink.mutex);
+            LUMINA_CHECK(sink.samples.empty());
+            LUMINA_CHECK(!sink.states.empty() && sink.states[0].isPaired && sink.states[0].address == FirstDeviceAddress);
+            sink.states.clear();
+        }
+
+        Waiter discovery;
+        LuminaBluezBackend::DiscoveryFilter filter;
+        filter.minRssi = -85;
+        backend.StartDiscovery(filter, discovery.Get());
+        LUMINA_CHECK(discovery.Wait());
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        LUMINA_CHECK(backend.GetAdapters()[0].isDiscovering && backend.GetAdapters()[1].isDiscovering);
+        LUMINA_CHECK(mock.filterRssi == -85 && mock.isFilterLeOnly);
+
+        mock.Post([&mock] { mock.SendAdvert(0, 5, 1, -42); });
+        LUMINA_CHECK(sink.WaitForSamples(1));
+        {
+            std::lock_guard<std::mutex> lock(sink.mutex);
+            LUMINA_CHECK(sink.samples.size() == 1);
+            const Lumina::AdvertisementSample& sample = sink.samples[0];
+            LUMINA_CHECK(sample.address == FirstDeviceAddress + 5 && sample.rssi == -42 && sample.adapterIndex == 0);
+            LUMINA_CHECK(sample.addressType == Lumina::AdvertisementSample::AddressRandom && sample.adapterRssi[0] == -42);
+            std::vector<uint8_t> types;
+            Lumina::AdvertisementParser::ForEachSection(sample.payload, sample.payloadLength, [&](uint8_t type, const uint8_t* data, size_t size)
+                {
+                    types.push_back(type);
+                    if (type == 0x03)
+                    {
+                        LUMINA_CHECK(size == 2 && data[0] == 0x0F && data[1] == 0x18);
+                    }
+                    else if (type == 0x07)
+                    {
+                        LUMINA_CHECK(size == 16 && data[0] == 0x9E && data[15] == 0x6E);
+                    }
+                    else if (type == 0x09)
+                    {
+                        LUMINA_CHECK(std::string(reinterpret_cast<const char*>(data), size) == "Dev5");
+                    }
+                    else if (type == 0x0A)
+                    {
+                        LUMINA_CHECK(size == 1 && static_cast<int8_t>(data[0]) == 4);
+                    }
+                    else if (type == 0x16)
+                    {
+                        LUMINA_CHECK(size == 4 && data[0] == 0xAA && data[1] == 0xFE && data[2] == 0x55);
+                    }
+                    else if (type == 0x19)
+                    {
+                        LUMINA_CHECK(size == 2 && data[0] == 0xC1 && data[1] == 0x03);
+                    }
+                    return true;
+                });
+            // The new manufacturer data replaces the old rather than being added next to it
+            LUMINA_CHECK(std::count(types.begin(), types.end(), 0xFF) == 1);
+        }
+
+        Waiter pair;
+        backend.Pair(FirstDeviceAddress + 9, pair.Get());
+        LUMINA_CHECK(pair.Wait());
+        Waiter connect;
+        backend.Connect(FirstDeviceAddress + 9, connect.Get());
+        LUMINA_CHECK(connect.Wait());
+        Waiter refused;
+        backend.Connect(FirstDeviceAddress + RefusingDevice, refused.Get());
+        LUMINA_CHECK(!refused.Wait() && refused.error.find("le-connection-abort-by-local") != std::string::npos);
+        Waiter unknown;
+        backend.Connect(0xD00000000007ull, unknown.Get());
+        LUMINA_CHECK(!unknown.Wait() && unknown.error == "Unknown device");
+        Waiter remove;
+        backend.RemoveDevice(FirstDeviceAddress + 9, remove.Get());
+        LUMINA_CHECK(remove.Wait());
+        LUMINA_CHECK(sink.WaitForStates(3));
+        {
+            std::lock_guard<std::mutex> lock(sink.mutex);
+            LUMINA_CHECK(sink.states.size() == 3);
+            LUMINA_CHECK(sink.states[0].isPaired && !sink.states[0].isConnected);
+            LUMINA_CHECK(sink.states[1].isPaired && sink.states[1].isConnected);
+            LUMINA_CHECK(sink.states[2].isRemoved);
+        }
+        Waiter removed;
+        backend.Pair(FirstDeviceAddress + 9, removed.Get());
+        LUMINA_CHECK(!removed.Wait());
+
+        backend.Stop();
+        Waiter stopped;
+        backend.Pair(FirstDeviceAddress + 1, stopped.Get());
+        LUMINA_CHECK(!stopped.Wait());
+        LUMINA_CHECK(mock.propertyGets == 0);
+        std::printf("bluez backend: %d method calls from start to stop\n", mock.methodCalls - callsBefore);
+    }
+
+    // Samples feed the merger through one lane per adapter, as discovery wires them: a device heard by
+    // both adapters comes out once, with both adapters' RSSI
+    void TestAdapterLanes(MockBluez& mock, const char* busAddress)
+    {
+        Sink sink;
+        LuminaScanMerger merger;
+        merger.HandleOnSample([&sink](const Lumina::AdvertisementSample& sample) { sink.Add(sample); });
+        LuminaBluezBackend backend;
+        backend.HandleOnSample([&merger](const Lumina::AdvertisementSample& sample) { merger.Push(sample.adapterIndex, sample); });
+        std::string error;
+        LUMINA_CHECK(backend.Start(MakeOptions(busAddress), error));
+        int laneCount = 1;
+        for (const auto& adapter : backend.GetAdapters())
+        {
+            laneCount = std::max(laneCount, adapter.index + 1);
+        }
+        LUMINA_CHECK(laneCount == AdapterCount);
+        merger.Start(laneCount);
+        Waiter discovery;
+        backend.StartDiscovery({}, discovery.Get());
+        LUMINA_CHECK(discovery.Wait());
+        LUMINA_CHECK(mock.filterRssi == 0);
+
+        // The same advert on both adapters for the shared devices, on hci0 alone for the others
+        mock.Post([&mock]
+            {
+                const int64_t sent = Clock::now().time_since_epoch().count();
+                for (int device = 0; device < SharedCount * 2; ++device)
+                {
+                    mock.SendAdvert(0, device, 100 + static_cast<uint64_t>(device), -50, sent);
+                    if (device < SharedCount)
+                    {
+                        mock.SendAdvert(1, device, 100 + static_cast<uint64_t>(device), -70, sent);
+                    }
+                }
+                mock.Flush();
+            });
+        LUMINA_CHECK(sink.WaitForSamples(SharedCount * 2));
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        backend.Stop();
+        merger.Stop();
+
+        std::lock_guard<std::mutex> lock(sink.mutex);
+        LUMINA_CHECK(sink.samples.size() == SharedCount * 2);
+        size_t heardByBoth = 0;
+        for (const auto& sample : sink.samples)
+        {
+            const bool isShared = sample.address < FirstDeviceAddress + SharedCount;
+            LUMINA_CHECK(sample.adapterRssi[0] == -50);
+            LUMINA_CHECK(sample.adapterRssi[1] == (isShared ? -70 : Lumina::AdvertisementSample::NoRssi));
+            heardByBoth += sample.adapterRssi[1] == -70 ? 1 : 0;
+        }
+        LUMINA_CHECK(heardByBoth == SharedCount);
+        LuminaScanMerger::Stats stats = merger.GetStats();
+        LUMINA_CHECK(stats.received == SharedCount * 3 && stats.merged == SharedCount && stats.emitted == SharedCount * 2);
+        std::printf("bluez lanes: %d adapters, %llu sightings merged into %llu samples\n", laneCount,
+            static_cast<unsigned long long>(stats.received), static_cast<unsigned long long>(stats.emitted));
+    }
+
+    // A device known on both adapters stays reachable through the other when one copy goes, and an unplugged
+    // adapter takes its devices with it
+    void TestRemovedObjects(MockBluez& mock, const char* busAddress)
+    {
+        constexpr int Shared = 3;           // On both adapters
+        constexpr int Witness = 20;         // On hci0 only; its advert shows the signals before it were handled
+        Sink sink;
+        LuminaBluezBackend backend;
+        sink.Attach(backend);
+        std::string error;
+        LUMINA_CHECK(backend.Start(MakeOptions(busAddress), error));
+        Waiter discovery;
+        backend.StartDiscovery({}, discovery.Get());
+        LUMINA_CHECK(discovery.Wait());
+        {
+            std::lock_guard<std::mutex> lock(sink.mutex);
+            sink.states.clear();
+        }
+
+        mock.Post([&mock]
+            {
+                mock.SendInterfacesRemoved(DevicePath(0, Shared), "org.bluez.Device1");
+                mock.SendAdvert(0, Witness, 1, -40);
+                mock.Flush();
+            });
+        LUMINA_CHECK(sink.WaitForSamples(1));
+        Waiter viaOther;
+        backend.Connect(FirstDeviceAddress + Shared, viaOther.Get());
+        LUMINA_CHECK(viaOther.Wait());
+        {
+            std::lock_guard<std::mutex> lock(sink.mutex);
+            LUMINA_CHECK(std::none_of(sink.states.begin(), sink.states.end(), [](const auto& state) { return state.isRemoved; }));
+        }
+
+        mock.Post([&mock]
+            {
+                mock.SendInterfacesRemoved("/org/bluez/hci1", "org.bluez.Adapter1");
+                mock.SendAdvert(0, Witness, 2, -40);
+                mock.Flush();
+            });
+        LUMINA_CHECK(sink.WaitForSamples(2));
+        LUMINA_CHECK(backend.GetAdapters().size() == AdapterCount - 1);
+        Waiter gone;
+        backend.Connect(FirstDeviceAddress + Shared, gone.Get());
+        LUMINA_CHECK(!gone.Wait() && gone.error == "Unknown device");
+        Waiter stillThere;
+        backend.Connect(FirstDeviceAddress + Shared + 1, stillThere.Get());
+        LUMINA_CHECK(stillThere.Wait());
+        backend.Stop();
+
+        // Only the device whose last copy went with the adapter is reported removed
+        std::lock_guard<std::mutex> lock(sink.mutex);
+        size_t removed = 0;
+        for (const auto& state : sink.states)
+        {
+            if (state.isRemoved)
+            {
+                ++removed;
+                LUMINA_CHECK(state.address == FirstDeviceAddress + Shared);
+            }
+        }
+        LUMINA_CHECK(removed == 1);
+    }
+
+    // Paced and flooded adverts: signal-to-sample latency, and no method calls once running
+    void BenchmarkSignals(MockBluez& mock, const char* busAddress)
+    {
+        constexpr int PacedCount = 1000;
+        constexpr int FloodCount = 20000;
+        constexpr int SenderCount = 48;     // Devices 16..63, on hci0 only
+
+        Sink sink;
+        LuminaBluezBackend backend;
+        sink.Attach(backend);
+        std::string error;
+        LUMINA_CHECK(backend.Start(MakeOptions(busAddress), error));
+        Waiter discovery;
+        backend.StartDiscovery({}, discovery.Get());
+        LUMINA_CHECK(discovery.Wait());
+        const LuminaBluezBackend::Stats before = backend.GetStats();
+        const int mockCallsBefore = mock.methodCalls;
+
+        for (int i = 0; i < PacedCount; ++i)
+        {
+            mock.Post([&mock, i]
+                {
+                    mock.SendAdvert(0, 16 + i % SenderCount, static_cast<uint64_t>(i), static_cast<int16_t>(-50 - i % 30));
+                    mock.Flush();
+                });
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+        LUMINA_CHECK(sink.WaitForSamples(PacedCount));
+        std::vector<double> paced;
+        {
+            std::lock_guard<std::mutex> lock(sink.mutex);
+            paced.swap(sink.latencies);
+            sink.samples.clear();
+        }
+
+        const LuminaBluezBackend::Stats floodStart = backend.GetStats();
+        const auto start = Clock::now();
+        mock.Post([&mock]
+            {
+                for (int i = 0; i < FloodCount; ++i)
+                {
+                    mock.SendAdvert(0, 16 + i % SenderCount, static_cast<uint64_t>(PacedCount + i), -60);
+                    if (i % 256 == 255)
+                    {
+                        mock.Flush();
+                    }
+                }
+                mock.Flush();
+            });
+        // Signals for one device in the same batch fold into one sample, so wait for the stream to go quiet
+        while (true)
+        {
+            const uint64_t messages = backend.GetStats().messages;
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            if (backend.GetStats().messages == messages && messages - floodStart.messages >= FloodCount)
+            {
+                break;
+            }
+            if (LuminaTest::SecondsSince(start) > 30.0)
+            {
+                LUMINA_CHECK(!"flood did not drain");
+                break;
+            }
+        }
+        const double seconds = LuminaTest::SecondsSince(start) - 0.3;
+        const LuminaBluezBackend::Stats after = backend.GetStats();
+        backend.Stop();
+
+        std::lock_guard<std::mutex> lock(sink.mutex);
+        const uint64_t messages = after.messages - floodStart.messages;
+        const uint64_t batches = after.batches - floodStart.batches;
+        std::printf("bluez paced: %zu adverts, latency p50 %.3f ms p99 %.3f ms\n", paced.size(),
+            LuminaTest::Percentile(paced, 0.5), LuminaTest::Percentile(paced, 0.99));
+        std::printf("bluez flood: %llu signals in %.2f s (%.0f/s), %.1f signals per batch, %.2f samples per signal, latency p50 %.2f ms\n",
+            static_cast<unsigned long long>(messages), seconds, static_cast<double>(messages) / seconds,
+            static_cast<double>(messages) / static_cast<double>(std::max<uint64_t>(batches, 1)),
+            static_cast<double>(sink.samples.size()) / static_cast<double>(std::max<uint64_t>(messages, 1)), LuminaTest::Percentile(sink.latencies, 0.5));
+        LUMINA_CHECK(paced.size() == PacedCount);
+        LUMINA_CHECK(messages >= FloodCount && !sink.samples.empty() && sink.samples.size() <= FloodCount);
+        LUMINA_CHECK(after.methodCalls == before.methodCalls && mock.methodCalls == mockCallsBefore);
+    }
+
+    // CPU seconds used so far, by the process or by the calling thread
+    double CpuSeconds(int who)
+    {
+        rusage usage{};
+        getrusage(who, &usage);
+        return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    }
+
+    // A field of /proc/self/status in kB, e.g. "VmRSS"
+    long StatusKb(const std::string& field)
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+        {
+            if (line.compare(0, field.size() + 1, field + ":") == 0)
+            {
+                return std::strtol(line.c_str() + field.size() + 1, nullptr, 10);
+            }
+        }
+        return 0;
+    }
+
+    // The headless daemon's path under a steady synthetic load: BlueZ signals through the backend and the
+    // coalescer to one NDJSON device line per new or changed record, as the daemon writes them. The mock and
+    // this thread run in the same process; their CPU is taken off.
+    void BenchmarkHeadlessLoad(MockBluez& mock, const char* busAddress)
+    {
+        constexpr int Rate = 2000;              // Adverts per second
+        constexpr int Seconds = 5;
+        constexpr int TickMs = 10;
+        constexpr int SenderCount = 48;         // Devices 16..63, on hci0 only
+
+        const std::filesystem::path output = std::filesystem::temp_directory_path() /
+            ("lumina-headless-" + std::to_string(Clock::now().time_since_epoch().count()) + ".ndjson");
+        LuminaNdjsonWriter writer;
+        std::string error;
+        LUMINA_CHECK(writer.Open(output.string(), std::chrono::milliseconds(250), error));
+
+        LuminaAdvertCoalescer coalescer;
+        LuminaBluezBackend backend;
+        backend.HandleOnSample([&](const Lumina::AdvertisementSample& sample)
+            {
+                LuminaAdvertCoalescer::MergeResult merge = coalescer.Merge(sample);
+                if (!merge.record || (!merge.isNew && merge.changed == 0))
+                {
+                    return;
+                }
+                std::string line = "{\"event\":\"device\",\"address\":";
+                LuminaNdjsonWriter::AppendString(line, LuminaHelper::BluetoothAddressToString(sample.address));
+                line += ",\"name\":";
+                LuminaNdjsonWriter::AppendString(line, merge.record->name);
+                line += ",\"rssi\":" + std::to_string(sample.rssi) + "}";
+                writer.WriteLine(line);
+            });
+        LUMINA_CHECK(backend.Start(MakeOptions(busAddress), error));
+        Waiter discovery;
+        backend.StartDiscovery({}, discovery.Get());
+        LUMINA_CHECK(discovery.Wait());
+
+        std::atomic<double> mockCpuStart = 0.0;
+        std::atomic<double> mockCpuEnd = 0.0;
+        mock.Post([&mockCpuStart] { mockCpuStart = CpuSeconds(RUSAGE_THREAD); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        const long rssBefore = StatusKb("VmRSS");
+        const uint64_t messagesBefore = backend.GetStats().messages;
+        const double processCpuStart = CpuSeconds(RUSAGE_SELF);
+        const double mainCpuStart = CpuSeconds(RUSAGE_THREAD);
+        const auto start = Clock::now();
+
+        constexpr int PerTick = Rate * TickMs / 1000;
+        uint64_t sequence = 0;
+        for (int tick = 0; tick < Seconds * 1000 / TickMs; ++tick)
+        {
+            mock.Post([&mock, first = sequence]
+                {
+                    for (int i = 0; i < PerTick; ++i)
+                    {
+                        const uint64_t value = first + static_cast<uint64_t>(i);
+                        mock.SendAdvert(0, 16 + static_cast<int>(value % SenderCount), value, static_cast<int16_t>(-50 - value % 30));
+                    }
+                    mock.Flush();
+                });
+            sequence += PerTick;
+            std::this_thread::sleep_until(start + std::chrono::milliseconds((tick + 1) * TickMs));
+        }
+        mock.Post([&mockCpuEnd] { mockCpuEnd = CpuSeconds(RUSAGE_THREAD); });
+        while ((mockCpuEnd == 0.0 || backend.GetStats().messages - messagesBefore < sequence) && LuminaTest::SecondsSince(start) < Seconds + 10.0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        const double wall = LuminaTest::SecondsSince(start);
+        const double mainCpu = CpuSeconds(RUSAGE_THREAD) - mainCpuStart;
+        const double pipelineCpu = CpuSeconds(RUSAGE_SELF) - processCpuStart - (mockCpuEnd - mockCpuStart) - mainCpu;
+        const long rssAfter = StatusKb("VmRSS");
+        const uint64_t messages = backend.GetStats().messages - messagesBefore;
+        backend.Stop();
+        writer.Close();
+
+        std::printf("headless load: %llu adverts at %d/s over %.1f s -> %llu NDJSON lines (%.1f MB)\n",
+            static_cast<unsigned long long>(messages), Rate, wall, static_cast<unsigned long long>(writer.GetLineCount()),
+            static_cast<double>(std::filesystem::file_size(output)) / 1e6);
+        std::printf("headless load: backend + coalescer + writer %.1f%% of one core (%.1f us per advert); RSS %ld -> %ld kB (%+ld kB), peak %ld kB\n",
+            100.0 * pipelineCpu / wall, 1e6 * pipelineCpu / static_cast<double>(std::max<uint64_t>(messages, 1)),
+            rssBefore, rssAfter, rssAfter - rssBefore, StatusKb("VmHWM"));
+        LUMINA_CHECK(messages >= sequence);
+        LUMINA_CHECK(writer.GetLineCount() > 0 && writer.GetLineCount() <= messages);
+        std::filesystem::remove(output);
+    }
+}
+
+int main()
+{
+    const char* busAddress = std::getenv("DBUS_SESSION_BUS_ADDRESS");
+    if (!busAddress)
+    {
+        std::fprintf(stderr, "No session bus; run under dbus-run-session\n");
+        return 1;
+    }
+    dbus_threads_init_default();
+    MockBluez mock;
+    if (!mock.Start(busAddress))
+    {
+        return 1;
+    }
+
+    TestSnapshotAndControl(mock, busAddress);
+    TestAdapterLanes(mock, busAddress);
+    TestRemovedObjects(mock, busAddress);
+    BenchmarkSignals(mock, busAddress);
+    BenchmarkHeadlessLoad(mock, busAddress);
+
+    mock.Stop();
+    return LuminaTest::Finish();
+}
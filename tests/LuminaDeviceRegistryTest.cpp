@@ -0,0 +1,281 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "LuminaDeviceRegistry.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    Lumina::RegistryRecord MakeRecord(uint64_t address, const std::string& name)
+    {
+        Lumina::RegistryRecord record;
+        record.address = address;
+        record.lastRssi = -60;
+        record.SetName(name);
+        record.SetId("BluetoothLE#BluetoothLE" + std::to_string(address));
+        return record;
+    }
+
+    bool HasName(const LuminaDeviceRegistry& registry, uint64_t address, const std::string& name)
+    {
+        auto record = registry.Find(address);
+        return record && name == record->name;
+    }
+
+    uintmax_t FileSize(const std::filesystem::path& path)
+    {
+        std::error_code ec;
+        uintmax_t size = std::filesystem::file_size(path, ec);
+        return ec ? 0 : size;
+    }
+
+    void Open(LuminaDeviceRegistry& registry, const std::filesystem::path& directory, int& errors)
+    {
+        registry.HandleOnErrorMessage([&errors](const std::string& message)
+        {
+            std::fprintf(stderr, "registry error: %s\n", message.c_str());
+            ++errors;
+        });
+        std::string error;
+        bool isOpen = registry.Open(directory, "devices", error);
+        LUMINA_CHECK(isOpen && error.empty());
+    }
+
+    // Changes survive a reopen through the log alone; a torn or corrupt tail loses only itself
+    void TestLogReplay(const std::filesystem::path& directory)
+    {
+        const std::filesystem::path logPath = directory / "devices.wal";
+        int errors = 0;
+        {
+            LuminaDeviceRegistry registry;
+            Open(registry, directory, errors);
+            for (uint64_t i = 0; i < 10; ++i)
+            {
+                registry.Upsert(MakeRecord(0xA0 + i, "Device " + std::to_string(i)));
+            }
+            registry.Remove(0xA3);
+            registry.Remove(0xFFFF); // Unknown; still logged
+            LUMINA_CHECK(registry.GetRecordCount() == 9);
+        }
+        LUMINA_CHECK(!std::filesystem::exists(directory / "devices.dat"));
+        const uintmax_t entrySize = FileSize(logPath) / 12;
+        LUMINA_CHECK(entrySize > sizeof(Lumina::RegistryRecord) && FileSize(logPath) == 12 * entrySize);
+
+        {
+            LuminaDeviceRegistry registry;
+            Open(registry, directory, errors);
+            LUMINA_CHECK(registry.GetRecordCount() == 9 && registry.GetRecords().size() == 9);
+            LUMINA_CHECK(!registry.Find(0xA3) && HasName(registry, 0xA5, "Device 5"));
+        }
+
+        // Half an entry, as a crash mid-write leaves it
+        {
+            std::ofstream log(logPath, std::ios::binary | std::ios::app);
+            std::vector<char> half(static_cast<size_t>(entrySize / 2), 'x');
+            log.write(half.data(), static_cast<std::streamsize>(half.size()));
+        }
+        {
+            LuminaDeviceRegistry registry;
+            Open(registry, directory, errors);
+            LUMINA_CHECK(registry.GetRecordCount() == 9);
+            LUMINA_CHECK(FileSize(logPath) == 12 * entrySize);
+        }
+
+        // A flipped byte in the first Remove fails its checksum; replay stops there
+        {
+            std::fstream log(logPath, std::ios::binary | std::ios::in | std::ios::out);
+            log.seekp(static_cast<std::streamoff>(10 * entrySize + entrySize / 2));
+            log.put('\x5A');
+        }
+        {
+            LuminaDeviceRegistry registry;
+            Open(registry, directory, errors);
+            LUMINA_CHECK(registry.GetRecordCount() == 10 && HasName(registry, 0xA3, "Device 3"));
+            LUMINA_CHECK(FileSize(logPath) == 10 * entrySize);
+
+            // Appends after the truncation replay normally
+            registry.Upsert(MakeRecord(0xB0, "After repair"));
+        }
+        {
+            LuminaDeviceRegistry registry;
+            Open(registry, directory, errors);
+            LUMINA_CHECK(registry.GetRecordCount() == 11 && HasName(registry, 0xB0, "After repair"));
+        }
+        LUMINA_CHECK(errors == 0);
+    }
+
+    // Flush folds the log into a sorted snapshot; later changes layer over it until the next compaction
+    void TestCompaction(const std::filesystem::path& directory)
+    {
+        constexpr uint64_t Count = 100;
+        int errors = 0;
+        std::mt19937_64 random(5);
+        std::vector<uint64_t> addresses;
+        {
+            LuminaDeviceRegistry registry;
+            Open(registry, directory, errors);
+            for (uint64_t i = 0; i < Count; ++i)
+            {
+                addresses.push_back(random() & 0xFFFFFFFFFFFFull);
+                registry.Upsert(MakeRecord(addresses.back(), "Device " + std::to_string(i)));
+            }
+            registry.Flush();
+        }
+        LUMINA_CHECK(FileSize(directory / "devices.wal") == 0);
+        LUMINA_CHECK(FileSize(directory / "devices.dat") > Count * sizeof(Lumina::RegistryRecord));
+
+        LuminaDeviceRegistry registry;
+        Open(registry, directory, errors);
+        LUMINA_CHECK(registry.GetRecordCount() == Count && registry.GetRecords().size() == Count);
+        bool isEveryFound = true;
+        for (uint64_t i = 0; i < Count; ++i)
+        {
+            isEveryFound = isEveryFound && HasName(registry, addresses[i], "Device " + std::to_string(i));
+        }
+        LUMINA_CHECK(isEveryFound);
+        LUMINA_CHECK(!registry.Find(0x123));
+
+        registry.Upsert(MakeRecord(addresses[0], "Renamed"));
+        registry.Remove(addresses[1]);
+        registry.Upsert(MakeRecord(0x42, "New"));
+        LUMINA_CHECK(registry.GetRecordCount() == Count);
+        LUMINA_CHECK(HasName(registry, addresses[0], "Renamed") && !registry.Find(addresses[1]) && HasName(registry, 0x42, "New"));
+        LUMINA_CHECK(registry.GetRecords().size() == Count);
+
+        registry.Clear();
+        LUMINA_CHECK(registry.GetRecordCount() == 0 && registry.GetRecords().empty() && !registry.Find(addresses[2]));
+        registry.Upsert(MakeRecord(addresses[2], "Kept"));
+        registry.Flush();
+        registry.Close();
+
+        Open(registry, directory, errors);
+        LUMINA_CHECK(registry.GetRecordCount() == 1 && HasName(registry, addresses[2], "Kept"));
+        registry.Close();
+        LUMINA_CHECK(errors == 0);
+    }
+
+    // Lookups keep finding every record while the writer thread swaps in new snapshots underneath them
+    void TestLookupsDuringCompaction(const std::filesystem::path& directory)
+    {
+        constexpr uint64_t Base = 1000;
+        constexpr int Rounds = 20;
+        constexpr uint64_t PerRound = 200;
+        int errors = 0;
+        LuminaDeviceRegistry registry;
+        Open(registry, directory, errors);
+        for (uint64_t i = 0; i < Base; ++i)
+        {
+            registry.Upsert(MakeRecord(i, "Base"));
+        }
+        registry.Flush();
+
+        std::atomic<bool> isDone = false;
+        std::atomic<uint64_t> misses = 0;
+        std::atomic<uint64_t> lookups = 0;
+        std::thread reader([&]()
+        {
+            while (!isDone)
+            {
+                for (uint64_t i = 0; i < Base; i += 7)
+                {
+                    misses += HasName(registry, i, "Base") ? 0 : 1;
+                    ++lookups;
+                }
+            }
+        });
+        for (int round = 0; round < Rounds; ++round)
+        {
+            for (uint64_t i = 0; i < PerRound; ++i)
+            {
+                registry.Upsert(MakeRecord(Base + static_cast<uint64_t>(round) * PerRound + i, "Added"));
+            }
+            registry.Flush();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        isDone = true;
+        reader.join();
+        registry.Close();
+
+        LUMINA_CHECK(misses == 0 && lookups > 0);
+        LUMINA_CHECK(registry.GetRecordCount() == Base + Rounds * PerRound);
+        LUMINA_CHECK(errors == 0);
+    }
+
+    void BenchmarkLoad(const std::filesystem::path& directory)
+    {
+        constexpr uint64_t Count = 100000;
+        int errors = 0;
+        std::mt19937_64 random(11);
+        std::vector<uint64_t> addresses;
+        {
+            LuminaDeviceRegistry registry;
+            Open(registry, directory, errors);
+            for (uint64_t i = 0; i < Count; ++i)
+            {
+                addresses.push_back(random() & 0xFFFFFFFFFFFFull);
+                registry.Upsert(MakeRecord(addresses.back(), "Device " + std::to_string(i)));
+            }
+            registry.Flush();
+        }
+
+        // Best of a few opens, with the snapshot in the page cache as on a relaunch
+        double loadMs = 1e9;
+        LuminaDeviceRegistry registry;
+        for (int i = 0; i < 5; ++i)
+        {
+            Open(registry, directory, errors);
+            loadMs = std::min(loadMs, registry.GetLoadMilliseconds());
+            registry.Close();
+        }
+        Open(registry, directory, errors);
+        LUMINA_CHECK(registry.GetRecordCount() == Count);
+
+        auto start = Clock::now();
+        size_t found = 0;
+        for (uint64_t address : addresses)
+        {
+            found += registry.Find(address) ? 1 : 0;
+        }
+        double findNs = LuminaTest::SecondsSince(start) * 1e9 / static_cast<double>(Count);
+        LUMINA_CHECK(found == Count);
+
+        // What copying every record into a hash map on open, as the registry used to, would add
+        start = Clock::now();
+        std::vector<Lumina::RegistryRecord> records = registry.GetRecords();
+        std::unordered_map<uint64_t, Lumina::RegistryRecord> copied;
+        copied.reserve(records.size());
+        for (const Lumina::RegistryRecord& record : records)
+        {
+            copied.emplace(record.address, record);
+        }
+        double copyMs = LuminaTest::SecondsSince(start) * 1e3;
+        LUMINA_CHECK(copied.size() == Count);
+        registry.Close();
+
+        std::printf("device registry: %llu records, %.1f MB snapshot; open %.2f ms, find %.0f ns; copying into a hash map would add %.1f ms\n",
+            static_cast<unsigned long long>(Count), static_cast<double>(FileSize(directory / "devices.dat")) / 1e6, loadMs, findNs, copyMs);
+        LUMINA_CHECK(loadMs < 10.0);
+        LUMINA_CHECK(errors == 0);
+    }
+}
+
+int main()
+{
+    const std::filesystem::path root = std::filesystem::temp_directory_path() /
+        ("lumina-registry-test-" + std::to_string(Clock::now().time_since_epoch().count()));
+    TestLogReplay(root / "replay");
+    TestCompaction(root / "compaction");
+    TestLookupsDuringCompaction(root / "concurrent");
+    BenchmarkLoad(root / "load");
+    std::filesystem::remove_all(root);
+    return LuminaTest::Finish();
+}
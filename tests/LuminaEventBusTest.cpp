@@ -0,0 +1,193 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "LuminaEventBus.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    struct TestEvent
+    {
+        uint32_t producer = 0;
+        uint32_t sequence = 0;
+    };
+
+    // Checks each producer's events arrive in the order they were published
+    struct OrderCheck
+    {
+        std::vector<uint32_t> next;
+        std::atomic<uint64_t> delivered = 0;
+        uint64_t outOfOrder = 0;
+
+        explicit OrderCheck(size_t producerCount) : next(producerCount, 0) {}
+
+        void Handle(const std::vector<TestEvent>& batch)
+        {
+            for (const TestEvent& event : batch)
+            {
+                outOfOrder += event.sequence == next[event.producer] ? 0 : 1;
+                next[event.producer] = event.sequence + 1;
+            }
+            delivered.fetch_add(batch.size(), std::memory_order_release);
+        }
+    };
+
+    bool WaitFor(const std::function<bool()>& isDone)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        while (!isDone())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    // Several producers to a worker subscriber and a queued subscriber, with queues large enough for no drops
+    void TestMultiProducerOrder()
+    {
+        constexpr uint32_t ProducerCount = 4;
+        constexpr uint32_t EventsPerProducer = 500000;
+        constexpr uint64_t Total = uint64_t(ProducerCount) * EventsPerProducer;
+
+        LuminaEventChannel<TestEvent> channel;
+        LuminaWorkerExecutor workerExecutor;
+        LuminaQueuedExecutor queuedExecutor;
+        OrderCheck workerCheck(ProducerCount);
+        OrderCheck queuedCheck(ProducerCount);
+        channel.Subscribe(workerExecutor, [&](const std::vector<TestEvent>& batch) { workerCheck.Handle(batch); }, Total);
+        channel.Subscribe(queuedExecutor, [&](const std::vector<TestEvent>& batch) { queuedCheck.Handle(batch); }, Total);
+
+        std::atomic<bool> isPublishing = true;
+        std::thread consumer([&]()
+        {
+            while (isPublishing.load() || queuedCheck.delivered.load(std::memory_order_acquire) < Total)
+            {
+                queuedExecutor.RunPending();
+                std::this_thread::yield();
+            }
+        });
+
+        std::vector<std::thread> producers;
+        for (uint32_t p = 0; p < ProducerCount; ++p)
+        {
+            producers.emplace_back([&channel, p]()
+            {
+                for (uint32_t i = 0; i < EventsPerProducer; ++i)
+                {
+                    channel.Publish(TestEvent{ p, i });
+                }
+            });
+        }
+        for (std::thread& producer : producers)
+        {
+            producer.join();
+        }
+        isPublishing = false;
+
+        LUMINA_CHECK(WaitFor([&] { return workerCheck.delivered.load(std::memory_order_acquire) == Total; }));
+        consumer.join();
+
+        LUMINA_CHECK(channel.GetDroppedCount() == 0);
+        LUMINA_CHECK(workerCheck.outOfOrder == 0);
+        LUMINA_CHECK(queuedCheck.outOfOrder == 0);
+        LUMINA_CHECK(queuedCheck.delivered.load() == Total);
+        std::printf("event bus: %u x %u events to 2 subscribers, %llu dropped\n", ProducerCount, EventsPerProducer,
+            static_cast<unsigned long long>(channel.GetDroppedCount()));
+    }
+
+    // A stalled subscriber loses events instead of blocking the publisher; every event is delivered or counted
+    void TestFullQueueDrops()
+    {
+        LuminaEventChannel<TestEvent> channel;
+        LuminaQueuedExecutor executor;
+        OrderCheck check(1);
+        channel.Subscribe(executor, [&](const std::vector<TestEvent>& batch) { check.Handle(batch); }, 64);
+
+        for (uint32_t i = 0; i < 1000; ++i)
+        {
+            channel.Publish(TestEvent{ 0, i });
+        }
+        executor.RunPending();
+        LUMINA_CHECK(check.delivered.load() == 64);
+        LUMINA_CHECK(channel.GetDroppedCount() == 1000 - 64);
+
+        // Delivery resumes once the queue has drained
+        check.next[0] = 5000;
+        channel.Publish(TestEvent{ 0, 5000 });
+        executor.RunPending();
+        LUMINA_CHECK(check.delivered.load() == 65);
+        LUMINA_CHECK(check.outOfOrder == 0);
+    }
+
+    void TestUnsubscribe()
+    {
+        LuminaEventChannel<TestEvent> channel;
+        LuminaInlineExecutor executor;
+        int first = 0;
+        int second = 0;
+        auto id = channel.Subscribe(executor, [&](const std::vector<TestEvent>& batch) { first += static_cast<int>(batch.size()); });
+        channel.Subscribe(executor, [&](const std::vector<TestEvent>& batch) { second += static_cast<int>(batch.size()); });
+
+        channel.Publish(TestEvent{});
+        channel.Unsubscribe(id);
+        channel.Publish(TestEvent{});
+        LUMINA_CHECK(first == 1);
+        LUMINA_CHECK(second == 2);
+    }
+
+    // Cost per event on the publishing thread, against calling a std::function directly
+    void BenchmarkPublish()
+    {
+        constexpr int Iterations = 2000000;
+        uint64_t sink = 0;
+
+        std::function<void(const Lumina::DeviceUpdatedEvent&)> direct = [&](const Lumina::DeviceUpdatedEvent& event) { sink += event.name.size(); };
+        Lumina::DeviceUpdatedEvent update;
+        update.name = "Lumina Test Device";
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < Iterations; ++i)
+        {
+            update.rssi = static_cast<int16_t>(i);
+            direct(update);
+        }
+        const double directNs = LuminaTest::SecondsSince(start) * 1e9 / Iterations;
+
+        LuminaEventBus bus;
+        LuminaQueuedExecutor executor;
+        bus.GetChannel<Lumina::DeviceUpdatedEvent>().Subscribe(executor,
+            [&](const std::vector<Lumina::DeviceUpdatedEvent>& batch) { sink += batch.size(); }, 1 << 16);
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < Iterations; ++i)
+        {
+            update.rssi = static_cast<int16_t>(i);
+            bus.Publish(update);
+            if ((i & 0x3FFF) == 0x3FFF)
+            {
+                executor.RunPending();
+            }
+        }
+        executor.RunPending();
+        const double queuedNs = LuminaTest::SecondsSince(start) * 1e9 / Iterations;
+
+        std::printf("event bus: DeviceUpdated %.1f ns through std::function, %.1f ns through a queued subscriber (%llu)\n",
+            directNs, queuedNs, static_cast<unsigned long long>(sink));
+        LUMINA_CHECK(bus.GetChannel<Lumina::DeviceUpdatedEvent>().GetDroppedCount() == 0);
+    }
+}
+
+int main()
+{
+    TestUnsubscribe();
+    TestFullQueueDrops();
+    TestMultiProducerOrder();
+    BenchmarkPublish();
+    return LuminaTest::Finish();
+}
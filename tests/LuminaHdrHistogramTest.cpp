@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+#include "LuminaHdrHistogram.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    // Exact value at a percentile with the same ceil rank the histogram uses
+    int64_t ExactPercentile(const std::vector<int64_t>& sorted, double percentile)
+    {
+        size_t rank = std::max<size_t>(static_cast<size_t>(std::ceil(percentile / 100.0 * static_cast<double>(sorted.size()))), 1);
+        return sorted[rank - 1];
+    }
+
+    // 2 significant digits: every percentile within 1% of the exact one
+    void TestLognormalAccuracy()
+    {
+        constexpr size_t SampleCount = 1000000;
+        std::mt19937_64 random(7);
+        std::lognormal_distribution<double> latency(std::log(2000.0), 1.0);
+        std::vector<int64_t> values(SampleCount);
+        for (int64_t& value : values)
+        {
+            value = std::max<int64_t>(1, static_cast<int64_t>(latency(random)));
+        }
+
+        LuminaHdrHistogram histogram;
+        const auto start = std::chrono::steady_clock::now();
+        for (int64_t value : values)
+        {
+            histogram.Record(value);
+        }
+        const double recordNs = LuminaTest::SecondsSince(start) * 1e9 / SampleCount;
+
+        std::vector<int64_t> sorted = values;
+        std::sort(sorted.begin(), sorted.end());
+        LUMINA_CHECK(histogram.GetCount() == SampleCount);
+        LUMINA_CHECK(histogram.GetMin() <= sorted.front() && histogram.GetMin() >= sorted.front() * 99 / 100);
+        LUMINA_CHECK(histogram.GetMax() == sorted.back());
+
+        double worstError = 0.0;
+        for (double percentile : { 1.0, 10.0, 50.0, 90.0, 99.0, 99.9, 99.99, 100.0 })
+        {
+            const double exact = static_cast<double>(ExactPercentile(sorted, percentile));
+            const double error = std::fabs(static_cast<double>(histogram.GetValueAtPercentile(percentile)) - exact) / exact;
+            worstError = std::max(worstError, error);
+        }
+        LUMINA_CHECK(worstError <= 0.01);
+
+        const auto queryStart = std::chrono::steady_clock::now();
+        int64_t sink = 0;
+        for (int i = 0; i < 1000; ++i)
+        {
+            sink += histogram.GetValueAtPercentile(99.0);
+        }
+        const double queryUs = LuminaTest::SecondsSince(queryStart) * 1e6 / 1000;
+
+        std::printf("hdr histogram: %.2f%% worst relative error over 1M lognormal samples, %zu KB, %.1f ns per Record, %.2f us per percentile (%lld)\n",
+            worstError * 100.0, histogram.GetMemoryBytes() / 1024, recordNs, queryUs, static_cast<long long>(sink % 10));
+    }
+
+    void TestEdges()
+    {
+        LuminaHdrHistogram histogram(1000000, 2);
+        LUMINA_CHECK(histogram.GetValueAtPercentile(50.0) == 0);
+
+        histogram.Record(-5);       // Clamped to 0
+        histogram.Record(5000000);  // Clamped to the highest trackable value
+        LUMINA_CHECK(histogram.GetCount() == 2);
+        LUMINA_CHECK(histogram.GetMin() == 0);
+        LUMINA_CHECK(histogram.GetMax() == 1000000);
+
+        histogram.Reset();
+        LUMINA_CHECK(histogram.GetCount() == 0);
+        histogram.Record(100);
+        histogram.Record(300);
+        LUMINA_CHECK(histogram.GetMin() == 100);
+        LUMINA_CHECK(std::fabs(histogram.GetMean() - 200.0) < 2.0);
+        LUMINA_CHECK(histogram.GetValueAtPercentile(50.0) == 100);
+        LUMINA_CHECK(histogram.GetValueAtPercentile(100.0) == 300);
+    }
+
+    // Record is lock-free; concurrent recorders must not lose counts
+    void TestConcurrentRecord()
+    {
+        constexpr int ThreadCount = 4;
+        constexpr int PerThread = 250000;
+        LuminaHdrHistogram histogram;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < ThreadCount; ++t)
+        {
+            threads.emplace_back([&histogram, t]()
+            {
+                for (int i = 0; i < PerThread; ++i)
+                {
+                    histogram.Record(1 + (i % 1000) + t);
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        LUMINA_CHECK(histogram.GetCount() == uint64_t(ThreadCount) * PerThread);
+        LUMINA_CHECK(histogram.GetMin() == 1);
+        LUMINA_CHECK(histogram.GetMax() == 1000 + ThreadCount - 1);
+    }
+}
+
+int main()
+{
+    TestEdges();
+    TestConcurrentRecord();
+    TestLognormalAccuracy();
+    return LuminaTest::Finish();
+}
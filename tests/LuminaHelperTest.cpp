@@ -0,0 +1,69 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include "LuminaHelper.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    const std::string Replacement = "\xEF\xBF\xBD";
+
+    std::string Repaired(std::string text)
+    {
+        LuminaHelper::ReplaceInvalidUtf8(text);
+        return text;
+    }
+
+    void TestValidUtf8IsUntouched()
+    {
+        for (std::string text : { std::string(), std::string("Lumina"), std::string("Caf\xC3\xA9"),
+            std::string("\xE2\x82\xAC 5"), std::string("\xF0\x9F\x98\x80"), std::string("\xF4\x8F\xBF\xBF"), std::string("a\0b", 3) })
+        {
+            const std::string original = text;
+            LUMINA_CHECK(!LuminaHelper::ReplaceInvalidUtf8(text));
+            LUMINA_CHECK(text == original);
+        }
+    }
+
+    // One U+FFFD per maximal invalid subpart, as Unicode recommends and pyarrow/Python decode with errors="replace"
+    void TestInvalidSequencesAreReplaced()
+    {
+        std::string text = "\xFF";
+        LUMINA_CHECK(LuminaHelper::ReplaceInvalidUtf8(text));
+        LUMINA_CHECK(text == Replacement);
+
+        LUMINA_CHECK(Repaired("A\xC3") == "A" + Replacement);                                // Truncated at the end
+        LUMINA_CHECK(Repaired("\xE2\x82x") == Replacement + "x");                             // Truncated, one replacement
+        LUMINA_CHECK(Repaired("\x80\x80") == Replacement + Replacement);                      // Stray continuation bytes
+        LUMINA_CHECK(Repaired("\xC0\xAF") == Replacement + Replacement);                      // Overlong
+        LUMINA_CHECK(Repaired("\xE0\x80\xAF") == Replacement + Replacement + Replacement);    // Overlong three-byte form
+        LUMINA_CHECK(Repaired("\xED\xA0\x80") == Replacement + Replacement + Replacement);    // UTF-16 surrogate
+        LUMINA_CHECK(Repaired("\xF4\x90\x80\x80") == Replacement + Replacement + Replacement + Replacement); // Past U+10FFFF
+        LUMINA_CHECK(Repaired("ok\xF0\x9F\x98") == "ok" + Replacement);
+        LUMINA_CHECK(Repaired("Sensor\xFE-\xC3\xA9") == "Sensor" + Replacement + "-\xC3\xA9");
+    }
+
+    void BenchmarkValidNames()
+    {
+        constexpr int Iterations = 2000000;
+        std::string name = "Lumina Sensor \xC3\xA9 0042";
+        size_t changed = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < Iterations; ++i)
+        {
+            name[name.size() - 1] = static_cast<char>('0' + i % 10);
+            changed += LuminaHelper::ReplaceInvalidUtf8(name) ? 1 : 0;
+        }
+        std::printf("helper: %.1f ns to check a valid %zu-byte name (%zu changed)\n",
+            LuminaTest::SecondsSince(start) * 1e9 / Iterations, name.size(), changed);
+        LUMINA_CHECK(changed == 0);
+    }
+}
+
+int main()
+{
+    TestValidUtf8IsUntouched();
+    TestInvalidSequencesAreReplaced();
+    BenchmarkValidNames();
+    return LuminaTest::Finish();
+}
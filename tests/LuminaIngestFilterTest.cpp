@@ -0,0 +1,161 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "LuminaHelper.h"
+#include "LuminaIngestFilter.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    using Verdict = LuminaIngestFilter::Verdict;
+
+    // Writes the file and gives it a write time of its own, so back-to-back edits are seen as changes
+    void WriteFile(const std::filesystem::path& path, const std::string& text, int version)
+    {
+        {
+            std::ofstream file(path, std::ios::trunc);
+            file << text;
+        }
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now() + std::chrono::seconds(version));
+    }
+
+    Lumina::ServiceUuid Uuid(const char* text)
+    {
+        Lumina::ServiceUuid uuid{};
+        LuminaHelper::ParseServiceUuid(text, uuid);
+        return uuid;
+    }
+
+    void TestRules(const std::filesystem::path& path)
+    {
+        WriteFile(path,
+            "# comment\n"
+            "deny address AA:BB:CC:DD:EE:01\n"
+            "allow address AA:BB:CC:DD:EE:02   # trailing comment\n"
+            "allow service 180d\n"
+            "deny service 0000fe2c-0000-1000-8000-00805f9b34fb\n", 1);
+        LuminaIngestFilter filter;
+        std::string error;
+        LUMINA_CHECK(filter.ReloadIfChanged(path, error));
+        LUMINA_CHECK(filter.GetRuleCount() == 4);
+
+        LUMINA_CHECK(filter.CheckAddress(0xAABBCCDDEE01ull) == Verdict::Reject);
+        // Deny services exist, so every other address still needs its services looked at
+        LUMINA_CHECK(filter.CheckAddress(0xAABBCCDDEE02ull) == Verdict::CheckServices);
+        LUMINA_CHECK(filter.CheckServices(0xAABBCCDDEE02ull, {}));
+        LUMINA_CHECK(!filter.CheckServices(0xAABBCCDDEE02ull, { Uuid("fe2c") }));
+        LUMINA_CHECK(filter.CheckServices(0x112233445566ull, { Uuid("180D") }));
+        LUMINA_CHECK(!filter.CheckServices(0x112233445566ull, { Uuid("180F") }));
+    }
+
+    // A bad edit is reported once, keeps the last good rules, and a later good edit is picked up
+    void TestReloadAfterError(const std::filesystem::path& path)
+    {
+        LuminaIngestFilter filter;
+        std::string error;
+        WriteFile(path, "deny address AA:BB:CC:DD:EE:01\n", 1);
+        LUMINA_CHECK(filter.ReloadIfChanged(path, error));
+        LUMINA_CHECK(filter.CheckAddress(0xAABBCCDDEE01ull) == Verdict::Reject);
+
+        WriteFile(path, "deny address AA:BB:CC:DD:EE:01\ndeny adress AA:BB:CC:DD:EE:02\n", 2);
+        error.clear();
+        LUMINA_CHECK(!filter.ReloadIfChanged(path, error));
+        LUMINA_CHECK(error.find("line 2") != std::string::npos);
+        for (int i = 0; i < 3; ++i)
+        {
+            error.clear();
+            LUMINA_CHECK(filter.ReloadIfChanged(path, error));
+            LUMINA_CHECK(error.empty());
+        }
+        LUMINA_CHECK(filter.GetRuleCount() == 1);
+        LUMINA_CHECK(filter.CheckAddress(0xAABBCCDDEE01ull) == Verdict::Reject);
+
+        WriteFile(path, "deny address AA:BB:CC:DD:EE:02\n", 3);
+        LUMINA_CHECK(filter.ReloadIfChanged(path, error));
+        LUMINA_CHECK(filter.CheckAddress(0xAABBCCDDEE01ull) == Verdict::Accept);
+        LUMINA_CHECK(filter.CheckAddress(0xAABBCCDDEE02ull) == Verdict::Reject);
+
+        // Going back to an earlier bad version is a new change, and is reported again
+        WriteFile(path, "allow nothing\n", 4);
+        LUMINA_CHECK(!filter.ReloadIfChanged(path, error));
+
+        std::filesystem::remove(path);
+        LUMINA_CHECK(filter.ReloadIfChanged(path, error));
+        LUMINA_CHECK(!filter.HasRules());
+        WriteFile(path, "allow nothing\n", 5);
+        LUMINA_CHECK(!filter.ReloadIfChanged(path, error));
+    }
+
+    double CheckNanos(LuminaIngestFilter& filter, const std::vector<uint64_t>& addresses, Verdict expected, size_t& mismatches)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (uint64_t address : addresses)
+        {
+            mismatches += filter.CheckAddress(address) == expected ? 0 : 1;
+        }
+        return LuminaTest::SecondsSince(start) * 1e9 / static_cast<double>(addresses.size());
+    }
+
+    // 200k-address lists: how fast adverts are turned away before any parsing, and what the rules cost in memory
+    void BenchmarkRejection(const std::filesystem::path& path)
+    {
+        constexpr size_t ListSize = 200000;
+        constexpr size_t ProbeCount = 2000000;
+        std::mt19937_64 random(11);
+        auto randomAddress = [&random]() { return random() & 0xFFFFFFFFFFFFull; };
+
+        std::vector<uint64_t> listed(ListSize);
+        for (uint64_t& address : listed)
+        {
+            address = randomAddress();
+        }
+        std::vector<uint64_t> members(ProbeCount);
+        std::vector<uint64_t> strangers(ProbeCount);
+        for (size_t i = 0; i < ProbeCount; ++i)
+        {
+            members[i] = listed[random() % ListSize];
+            strangers[i] = randomAddress();
+        }
+
+        for (const char* action : { "deny", "allow" })
+        {
+            std::string text;
+            for (uint64_t address : listed)
+            {
+                text += std::string(action) + " address " + LuminaHelper::BluetoothAddressToString(address) + "\n";
+            }
+            WriteFile(path, text, 10);
+
+            LuminaIngestFilter filter;
+            std::string error;
+            const auto loadStart = std::chrono::steady_clock::now();
+            LUMINA_CHECK(filter.ReloadIfChanged(path, error));
+            const double loadMs = LuminaTest::SecondsSince(loadStart) * 1000.0;
+
+            const bool isDeny = action[0] == 'd';
+            size_t mismatches = 0;
+            const double listedNs = CheckNanos(filter, members, isDeny ? Verdict::Reject : Verdict::Accept, mismatches);
+            const double strangerNs = CheckNanos(filter, strangers, isDeny ? Verdict::Accept : Verdict::Reject, mismatches);
+            std::printf("ingest filter, %zu %s rules: loaded in %.0f ms, %.2f MB; %.1f ns per listed address, %.1f ns per other address\n",
+                ListSize, action, loadMs, static_cast<double>(filter.GetMemoryBytes()) / (1024.0 * 1024.0), listedNs, strangerNs);
+            // A random stranger could collide with a listed address, but not in this seed
+            LUMINA_CHECK(mismatches == 0);
+            LUMINA_CHECK(filter.GetMemoryBytes() < 4 * 1024 * 1024);
+        }
+    }
+}
+
+int main()
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() /
+        ("lumina-filter-test-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".txt");
+    TestRules(path);
+    TestReloadAfterError(path);
+    BenchmarkRejection(path);
+    std::filesystem::remove(path);
+    return LuminaTest::Finish();
+}
@@ -0,0 +1,138 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "LuminaIntervalEstimator.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    struct Population
+    {
+        std::vector<double> errorsMs;   // Against T + 5 ms, the mean interval with advDelay
+        std::vector<double> jittersMs;
+        std::vector<double> missedRatios;
+        size_t invalid = 0;
+    };
+
+    // deviceCount devices with intervals from 20 ms to 10.24 s, each received advertsPerDevice times through
+    // a channel that loses the given share of adverts
+    Population Simulate(int deviceCount, int advertsPerDevice, double loss, uint64_t seed)
+    {
+        std::mt19937_64 random(seed);
+        std::uniform_real_distribution<double> logInterval(std::log(20.0), std::log(10240.0));
+        std::uniform_int_distribution<int64_t> advDelay(0, 10000);
+        std::bernoulli_distribution isLost(loss);
+
+        Population population;
+        for (int device = 0; device < deviceCount; ++device)
+        {
+            // Legal intervals are multiples of 0.625 ms
+            const int64_t intervalMicros = static_cast<int64_t>(std::exp(logInterval(random)) / 0.625) * 625;
+            LuminaIntervalEstimator estimator;
+            int64_t eventTime = static_cast<int64_t>(random() % 1000000);
+            // advDelay postpones each event and the next one is scheduled from it, so it accumulates
+            for (int received = 0; received < advertsPerDevice; eventTime += intervalMicros + advDelay(random))
+            {
+                if (!isLost(random))
+                {
+                    estimator.Add(eventTime);
+                    ++received;
+                }
+            }
+
+            const LuminaIntervalEstimator::Estimate estimate = estimator.GetEstimate();
+            if (!estimate.isValid)
+            {
+                ++population.invalid;
+                continue;
+            }
+            population.errorsMs.push_back(std::fabs(estimate.intervalMs - (static_cast<double>(intervalMicros) / 1000.0 + 5.0)));
+            population.jittersMs.push_back(estimate.jitterMs);
+            population.missedRatios.push_back(estimate.missedRatio);
+        }
+        return population;
+    }
+
+    void CheckPopulation(double loss, double maxP50, double maxP95)
+    {
+        Population population = Simulate(2000, 30, loss, static_cast<uint64_t>(loss * 100) + 1);
+        const double p50 = LuminaTest::Percentile(population.errorsMs, 0.5);
+        const double p95 = LuminaTest::Percentile(population.errorsMs, 0.95);
+        const double jitter = LuminaTest::Percentile(population.jittersMs, 0.5);
+        const double missed = LuminaTest::Percentile(population.missedRatios, 0.5);
+        std::printf("interval estimator, loss %.0f%%: error p50 %.2f ms, p95 %.2f ms; jitter %.2f ms; missed %.3f\n",
+            loss * 100.0, p50, p95, jitter, missed);
+
+        LUMINA_CHECK(population.invalid == 0);
+        LUMINA_CHECK(p50 <= maxP50);
+        LUMINA_CHECK(p95 <= maxP95);
+        LUMINA_CHECK(jitter > 1.0 && jitter < 3.5);     // 2.5 ms for a uniform 0-10 ms advDelay, less once lost adverts are folded
+        LUMINA_CHECK(std::fabs(missed - loss) < 0.1);
+    }
+
+    void TestEdges()
+    {
+        LuminaIntervalEstimator estimator;
+        LUMINA_CHECK(!estimator.GetEstimate().isValid);
+
+        // Too few intervals, then duplicates that must not count as intervals
+        int64_t time = 0;
+        for (int i = 0; i < LuminaIntervalEstimator::MinIntervals; ++i, time += 100000)
+        {
+            estimator.Add(time);
+            estimator.Add(time + 2000);
+        }
+        LUMINA_CHECK(!estimator.GetEstimate().isValid);
+        estimator.Add(time);
+        LuminaIntervalEstimator::Estimate estimate = estimator.GetEstimate();
+        LUMINA_CHECK(estimate.isValid);
+        LUMINA_CHECK(std::fabs(estimate.intervalMs - 100.0f) < 0.5f);
+        LUMINA_CHECK(estimate.intervals == LuminaIntervalEstimator::MinIntervals);
+
+        // A gap of three intervals is two missed adverts, not a longer interval
+        time += 300000;
+        estimator.Add(time);
+        estimate = estimator.GetEstimate();
+        LUMINA_CHECK(std::fabs(estimate.intervalMs - 100.0f) < 0.5f);
+        LUMINA_CHECK(estimate.intervals == LuminaIntervalEstimator::MinIntervals + 3);
+        LUMINA_CHECK(estimate.missedRatio > 0.0f);
+
+        // A silence far beyond MaxFold intervals is left out
+        time += 100000 * (LuminaIntervalEstimator::MaxFold + 10);
+        estimator.Add(time);
+        LUMINA_CHECK(std::fabs(estimator.GetEstimate().intervalMs - 100.0f) < 0.5f);
+    }
+
+    void BenchmarkAdd()
+    {
+        constexpr int Iterations = 4000000;
+        LuminaIntervalEstimator estimator;
+        std::mt19937 random(3);
+        std::vector<int64_t> times(Iterations);
+        int64_t time = 0;
+        for (int64_t& value : times)
+        {
+            time += 100000 + static_cast<int64_t>(random() % 10000);
+            value = time;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        for (int64_t value : times)
+        {
+            estimator.Add(value);
+        }
+        const double ns = LuminaTest::SecondsSince(start) * 1e9 / Iterations;
+        std::printf("interval estimator: %.1f ns per Add, %zu bytes (%.1f ms)\n", ns, sizeof(LuminaIntervalEstimator), estimator.GetEstimate().intervalMs);
+    }
+}
+
+int main()
+{
+    TestEdges();
+    CheckPopulation(0.0, 2.0, 4.0);
+    CheckPopulation(0.3, 2.0, 4.0);
+    CheckPopulation(0.5, 2.0, 5.0);
+    BenchmarkAdd();
+    return LuminaTest::Finish();
+}
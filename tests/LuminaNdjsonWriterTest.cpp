@@ -0,0 +1,91 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "LuminaHelper.h"
+#include "LuminaNdjsonWriter.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    std::string Quoted(std::string_view value)
+    {
+        std::string out;
+        LuminaNdjsonWriter::AppendString(out, value);
+        return out;
+    }
+
+    void TestAppendString()
+    {
+        LUMINA_CHECK(Quoted("Lumina") == "\"Lumina\"");
+        LUMINA_CHECK(Quoted("a\"b\\c") == "\"a\\\"b\\\\c\"");
+        LUMINA_CHECK(Quoted("1\n2\t3\r") == "\"1\\n2\\t3\\r\"");
+        LUMINA_CHECK(Quoted(std::string_view("\x01\0", 2)) == "\"\\u0001\\u0000\"");
+        LUMINA_CHECK(Quoted("Caf\xC3\xA9") == "\"Caf\xC3\xA9\"");
+
+        // Raw bytes from an advert name come out as U+FFFD, and the result is valid UTF-8
+        const std::string repaired = Quoted("Tag\xFF\xC3\"");
+        LUMINA_CHECK(repaired == "\"Tag\xEF\xBF\xBD\xEF\xBF\xBD\\\"\"");
+        LUMINA_CHECK(LuminaHelper::IsValidUtf8(repaired));
+    }
+
+    // Lines written from several threads all reach the file whole
+    void TestConcurrentLines()
+    {
+        constexpr int ThreadCount = 4;
+        constexpr int LinesPerThread = 20000;
+        const std::filesystem::path path = std::filesystem::temp_directory_path() /
+            ("lumina-ndjson-test-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".ndjson");
+
+        LuminaNdjsonWriter writer;
+        std::string error;
+        LUMINA_CHECK(writer.Open(path.string(), std::chrono::milliseconds(5), error));
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < ThreadCount; ++t)
+        {
+            threads.emplace_back([&writer, t]()
+            {
+                std::string line;
+                for (int i = 0; i < LinesPerThread; ++i)
+                {
+                    line = "{\"thread\":" + std::to_string(t) + ",\"name\":";
+                    LuminaNdjsonWriter::AppendString(line, i % 100 == 0 ? "bad\xFE" : "device");
+                    line += "}";
+                    writer.WriteLine(line);
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        const double seconds = LuminaTest::SecondsSince(start);
+        writer.Close();
+        LUMINA_CHECK(writer.GetLineCount() == uint64_t(ThreadCount) * LinesPerThread);
+
+        std::ifstream file(path);
+        size_t lines = 0;
+        size_t malformed = 0;
+        for (std::string line; std::getline(file, line); ++lines)
+        {
+            malformed += line.front() == '{' && line.back() == '}' && LuminaHelper::IsValidUtf8(line) ? 0 : 1;
+        }
+        file.close();
+        std::filesystem::remove(path);
+
+        std::printf("ndjson writer: %d lines from %d threads in %.1f ms\n", ThreadCount * LinesPerThread, ThreadCount, seconds * 1000.0);
+        LUMINA_CHECK(lines == size_t(ThreadCount) * LinesPerThread);
+        LUMINA_CHECK(malformed == 0);
+    }
+}
+
+int main()
+{
+    TestAppendString();
+    TestConcurrentLines();
+    return LuminaTest::Finish();
+}
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include "LuminaProvisioner.h"
+#include "LuminaProvisioningSimulator.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    // Passes operations through to the simulator and tracks how many are outstanding at once
+    class CountingTransport : public LuminaProvisioningTransport
+    {
+    public:
+        explicit CountingTransport(LuminaProvisioningTransport& inner) : m_Inner(inner) {}
+
+        void Pair(uint64_t address, Completion completion) override
+        {
+            Begin();
+            m_Inner.Pair(address, Wrap(std::move(completion)));
+        }
+
+        void WriteConfig(uint64_t address, const Lumina::GattConfigWrite& write, Completion completion) override
+        {
+            Begin();
+            m_Inner.WriteConfig(address, write, Wrap(std::move(completion)));
+        }
+
+        int GetMaxOutstanding() const { return m_MaxOutstanding.load(); }
+        int GetOperations() const { return m_Operations.load(); }
+
+    private:
+        LuminaProvisioningTransport& m_Inner;
+        std::atomic<int> m_Outstanding = 0;
+        std::atomic<int> m_MaxOutstanding = 0;
+        std::atomic<int> m_Operations = 0;
+
+        void Begin()
+        {
+            ++m_Operations;
+            int outstanding = ++m_Outstanding;
+            int max = m_MaxOutstanding.load();
+            while (outstanding > max && !m_MaxOutstanding.compare_exchange_weak(max, outstanding))
+            {
+            }
+        }
+
+        Completion Wrap(Completion completion)
+        {
+            return [this, completion = std::move(completion)](const std::string& error)
+            {
+                --m_Outstanding;
+                completion(error);
+            };
+        }
+    };
+
+    int CountInFlight(const LuminaProvisioner& provisioner)
+    {
+        return static_cast<int>(std::count_if(provisioner.GetUnits().begin(), provisioner.GetUnits().end(), [](const LuminaProvisioner::Unit& unit)
+        {
+            return unit.state == LuminaProvisioner::UnitState::Pairing || unit.state == LuminaProvisioner::UnitState::Configuring;
+        }));
+    }
+
+    // 60 simulated units, 4 in flight, 30% of operations failing
+    void TestSimulatedBatch()
+    {
+        constexpr int UnitCount = 60;
+        constexpr int MaxInFlight = 4;
+
+        LuminaProvisioningSimulator::Options simulation;
+        simulation.unitCount = UnitCount;
+        simulation.arrivalInterval = std::chrono::milliseconds(5);
+        simulation.pairTime = std::chrono::milliseconds(30);
+        simulation.configTime = std::chrono::milliseconds(10);
+        simulation.failureRate = 0.3;
+        simulation.seed = 7;
+        LuminaProvisioningSimulator simulator(simulation);
+        CountingTransport transport(simulator);
+
+        LuminaProvisioner::Options options;
+        for (int i = 0; i < UnitCount; ++i)
+        {
+            options.addresses.push_back(0xC2AA00000000ull | static_cast<uint64_t>(i));
+        }
+        options.maxInFlight = MaxInFlight;
+        options.retryDelay = std::chrono::milliseconds(10);
+        options.configWrite.emplace();
+        LUMINA_CHECK(Lumina::ParseGattConfigWrite("180A/2A29/4C756D", *options.configWrite));
+        LuminaProvisioner provisioner(transport, options);
+
+        std::vector<LuminaProvisioner::Unit> finished;
+        size_t finishedCount = 0;
+        int maxInFlight = 0;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+        while (!provisioner.IsComplete() && std::chrono::steady_clock::now() < deadline)
+        {
+            for (const auto& peripheral : simulator.TakeArrivals())
+            {
+                provisioner.OnDeviceSeen(peripheral.address, peripheral.name, peripheral.rssi);
+            }
+            finished.clear();
+            provisioner.Poll(finished);
+            finishedCount += finished.size();
+            maxInFlight = std::max(maxInFlight, CountInFlight(provisioner));
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        const LuminaProvisioner::Report report = provisioner.GetReport();
+        std::printf("provisioner: %zu of %zu succeeded, %zu retries, %d operations, %.0f units/min, at most %d in flight\n",
+            report.succeeded, report.unitCount, report.retries, transport.GetOperations(), report.unitsPerMinute, transport.GetMaxOutstanding());
+
+        LUMINA_CHECK(provisioner.IsComplete());
+        LUMINA_CHECK(finishedCount == UnitCount);
+        LUMINA_CHECK(report.unitCount == UnitCount);
+        LUMINA_CHECK(report.succeeded + report.failed == UnitCount);
+        LUMINA_CHECK(report.succeeded > UnitCount / 2);
+        LUMINA_CHECK(report.retries > 0);
+        LUMINA_CHECK(maxInFlight <= MaxInFlight);
+        LUMINA_CHECK(transport.GetMaxOutstanding() <= MaxInFlight);
+        for (const LuminaProvisioner::Unit& unit : provisioner.GetUnits())
+        {
+            if (unit.state == LuminaProvisioner::UnitState::Succeeded)
+            {
+                LUMINA_CHECK(unit.isPaired && unit.attempts <= options.maxAttempts);
+            }
+            else
+            {
+                LUMINA_CHECK(unit.state == LuminaProvisioner::UnitState::Failed);
+                LUMINA_CHECK(unit.attempts == options.maxAttempts && !unit.lastError.empty());
+            }
+        }
+
+        const std::filesystem::path directory = std::filesystem::temp_directory_path() / "lumina-provisioner-test";
+        std::filesystem::path written;
+        std::string error;
+        LUMINA_CHECK(provisioner.ExportCsv(directory, written, error));
+        std::ifstream csv(written);
+        size_t lines = 0;
+        for (std::string line; std::getline(csv, line);)
+        {
+            ++lines;
+        }
+        LUMINA_CHECK(lines == UnitCount + 2); // Header, one row per unit, summary
+        std::filesystem::remove_all(directory);
+    }
+
+    // Filter mode takes matching devices up to the unit limit
+    void TestFilterMode()
+    {
+        LuminaProvisioningSimulator::Options simulation;
+        simulation.unitCount = 0;
+        LuminaProvisioningSimulator simulator(simulation);
+
+        LuminaProvisioner::Options options;
+        options.namePrefix = "SIM-";
+        options.minRssi = -70;
+        options.unitLimit = 2;
+        LuminaProvisioner provisioner(simulator, options);
+        provisioner.OnDeviceSeen(1, "Other", -40);
+        provisioner.OnDeviceSeen(2, "SIM-0002", -80);
+        provisioner.OnDeviceSeen(3, "SIM-0003", -50);
+        provisioner.OnDeviceSeen(3, "SIM-0003", -45);
+        provisioner.OnDeviceSeen(4, "SIM-0004", -60);
+        provisioner.OnDeviceSeen(5, "SIM-0005", -60);
+        LUMINA_CHECK(provisioner.GetUnits().size() == 2);
+        LUMINA_CHECK(provisioner.GetUnits()[0].address == 3 && provisioner.GetUnits()[0].rssi == -45);
+        LUMINA_CHECK(!provisioner.IsComplete());
+    }
+
+    void TestParsing()
+    {
+        Lumina::GattConfigWrite write;
+        LUMINA_CHECK(Lumina::ParseGattConfigWrite("0000180a-0000-1000-8000-00805f9b34fb/2A29/00ff", write));
+        LUMINA_CHECK(write.service.high == 0x0000180a00001000ull && write.value.size() == 2 && write.value[1] == 0xFF);
+        LUMINA_CHECK(!Lumina::ParseGattConfigWrite("180A/2A29", write));
+        LUMINA_CHECK(!Lumina::ParseGattConfigWrite("180A/2A29/0", write));
+        LUMINA_CHECK(!Lumina::ParseGattConfigWrite("18ZA/2A29/00", write));
+
+        const std::filesystem::path path = std::filesystem::temp_directory_path() / "lumina-provisioner-addresses.txt";
+        {
+            std::ofstream file(path);
+            file << "# line\nAA:BB:CC:DD:EE:01\n\n  aabbccddee02  # second\n";
+        }
+        std::vector<uint64_t> addresses;
+        std::string error;
+        LUMINA_CHECK(LuminaProvisioner::LoadAddressList(path, addresses, error));
+        LUMINA_CHECK(addresses.size() == 2 && addresses[0] == 0xAABBCCDDEE01ull && addresses[1] == 0xAABBCCDDEE02ull);
+        {
+            std::ofstream file(path);
+            file << "not an address\n";
+        }
+        LUMINA_CHECK(!LuminaProvisioner::LoadAddressList(path, addresses, error) && !error.empty());
+        std::filesystem::remove(path);
+    }
+}
+
+int main()
+{
+    TestParsing();
+    TestFilterMode();
+    TestSimulatedBatch();
+    return LuminaTest::Finish();
+}
@@ -0,0 +1,507 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+#else
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#include "LuminaQueryServer.h"
+#include "LuminaHelper.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using SocketHandle = LuminaQueryServer::SocketHandle;
+
+#ifdef _WIN32
+    constexpr SocketHandle InvalidSocket = INVALID_SOCKET;
+    void CloseSocket(SocketHandle socket) { closesocket(socket); }
+    int PollOne(SocketHandle socket, int timeoutMs)
+    {
+        WSAPOLLFD entry{ socket, POLLIN, 0 };
+        return WSAPoll(&entry, 1, timeoutMs);
+    }
+#else
+    constexpr SocketHandle InvalidSocket = -1;
+    void CloseSocket(SocketHandle socket) { close(socket); }
+    int PollOne(SocketHandle socket, int timeoutMs)
+    {
+        pollfd entry{ socket, POLLIN, 0 };
+        return poll(&entry, 1, timeoutMs);
+    }
+#endif
+
+    sockaddr_un SocketAddress(const std::string& path)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), std::min(path.size() + 1, sizeof(address.sun_path)));
+        return address;
+    }
+
+    // Blocking line-oriented client
+    class TestClient
+    {
+    public:
+        ~TestClient() { Close(); }
+
+        bool Connect(const std::string& path)
+        {
+            sockaddr_un address = SocketAddress(path);
+            m_Socket = socket(AF_UNIX, SOCK_STREAM, 0);
+            return m_Socket != InvalidSocket && connect(m_Socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        }
+
+        void Close()
+        {
+            if (m_Socket != InvalidSocket)
+            {
+                CloseSocket(m_Socket);
+                m_Socket = InvalidSocket;
+            }
+        }
+
+        bool Send(const std::string& line)
+        {
+            std::string data = line + "\n";
+            return send(m_Socket, data.data(), static_cast<int>(data.size()), 0) == static_cast<int>(data.size());
+        }
+
+        // Next line, or nothing once the timeout passes or the server hangs up
+        std::optional<std::string> ReadLine(int timeoutMs = 2000)
+        {
+            auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+            size_t end;
+            while ((end = m_Input.find('\n')) == std::string::npos)
+            {
+                int remaining = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count());
+                if (remaining <= 0 || PollOne(m_Socket, remaining) <= 0)
+                {
+                    return std::nullopt;
+                }
+                char buffer[65536];
+                int received = recv(m_Socket, buffer, sizeof(buffer), 0);
+                if (received <= 0)
+                {
+                    m_IsClosed = true;
+                    return std::nullopt;
+                }
+                m_Input.append(buffer, static_cast<size_t>(received));
+            }
+            std::string line = m_Input.substr(0, end);
+            m_Input.erase(0, end + 1);
+            return line;
+        }
+
+        std::string Request(const std::string& line)
+        {
+            Send(line);
+            return ReadLine().value_or("");
+        }
+
+        bool IsClosed() const { return m_IsClosed; }
+
+    private:
+        SocketHandle m_Socket = InvalidSocket;
+        std::string m_Input;
+        bool m_IsClosed = false;
+    };
+
+    bool Contains(const std::string& text, const std::string& part)
+    {
+        return text.find(part) != std::string::npos;
+    }
+
+    size_t CountDevices(const std::string& line)
+    {
+        size_t count = 0;
+        for (size_t at = line.find("\"address\":"); at != std::string::npos; at = line.find("\"address\":", at + 1))
+        {
+            ++count;
+        }
+        return count;
+    }
+
+    // The "removed" array of a batch line, or empty
+    std::string Removed(const std::string& line)
+    {
+        size_t start = line.find("\"removed\":[");
+        return start == std::string::npos ? std::string() : line.substr(start + 11, line.find(']', start) - start - 11);
+    }
+
+    std::string Quoted(uint64_t address)
+    {
+        return "\"" + LuminaHelper::BluetoothAddressToString(address) + "\"";
+    }
+
+    const Lumina::ServiceUuid HeartRate = { 0x0000180D00001000ull, 0x800000805F9B34FBull };
+
+    Lumina::QueryDevice MakeDevice(uint64_t address, const std::string& name, int16_t rssi, bool hasHeartRate)
+    {
+        Lumina::QueryDevice device;
+        device.address = address;
+        device.name = name;
+        device.rssi = rssi;
+        device.lastSeenUnixMs = 1700000000000;
+        if (hasHeartRate)
+        {
+            device.serviceUuids.push_back(HeartRate);
+        }
+        return device;
+    }
+
+    // Updates land on the loop's next tick; waits until the store has taken this many in total
+    void WaitForUpdates(const LuminaQueryServer& server, uint64_t count)
+    {
+        auto deadline = Clock::now() + std::chrono::seconds(5);
+        while (server.GetStats().updates < count && Clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        LUMINA_CHECK(server.GetStats().updates >= count);
+    }
+
+    bool Start(LuminaQueryServer& server, const std::string& path)
+    {
+        std::string error;
+        bool isStarted = server.Start(path, error);
+        if (!isStarted)
+        {
+            std::fprintf(stderr, "query server: %s\n", error.c_str());
+        }
+        return isStarted;
+    }
+
+    constexpr uint64_t SensorA = 0x00000000A1A1A1A1ull;
+    constexpr uint64_t BandB = 0x00000000B2B2B2B2ull;
+    constexpr uint64_t ThermoC = 0x00000000C3C3C3C3ull;
+    constexpr uint64_t NamelessD = 0x00000000D4D4D4D4ull;
+
+    void PublishFour(LuminaQueryServer& server)
+    {
+        server.PublishDevice(MakeDevice(SensorA, "Heart Sensor", -50, true));
+        server.PublishDevice(MakeDevice(BandB, "Heart Band", -80, true));
+        server.PublishDevice(MakeDevice(ThermoC, "Thermo", -40, false));
+        server.PublishDevice(MakeDevice(NamelessD, "", -90, false));
+        WaitForUpdates(server, 4);
+    }
+
+    // Each filter alone and combined; arguments AND together, names match case-sensitive substrings
+    void TestQueryAndFilters(const std::string& path)
+    {
+        LuminaQueryServer server;
+        LUMINA_CHECK(Start(server, path));
+        PublishFour(server);
+
+        TestClient client;
+        LUMINA_CHECK(client.Connect(path));
+        LUMINA_CHECK(client.Request("ping") == "{\"type\":\"pong\"}");
+
+        std::string all = client.Request("query");
+        LUMINA_CHECK(Contains(all, "\"type\":\"result\"") && CountDevices(all) == 4);
+
+        std::string strong = client.Request("query min_rssi=-50");
+        LUMINA_CHECK(CountDevices(strong) == 2 && Contains(strong, Quoted(SensorA)) && Contains(strong, Quoted(ThermoC)));
+
+        std::string heart = client.Request("query name=Heart");
+        LUMINA_CHECK(CountDevices(heart) == 2 && Contains(heart, Quoted(SensorA)) && Contains(heart, Quoted(BandB)));
+        LUMINA_CHECK(CountDevices(client.Request("query name=heart")) == 0);
+
+        std::string alias = client.Request("query service=180d");
+        std::string full = client.Request("query service=0000180d-0000-1000-8000-00805f9b34fb");
+        LUMINA_CHECK(CountDevices(alias) == 2 && alias == full);
+        LUMINA_CHECK(Contains(alias, "\"services\":[\"0000180d-0000-1000-8000-00805f9b34fb\"]"));
+
+        std::string combined = client.Request("query service=180d min_rssi=-60 name=Sensor");
+        LUMINA_CHECK(CountDevices(combined) == 1 && Contains(combined, Quoted(SensorA)));
+        LUMINA_CHECK(CountDevices(client.Request("query service=180d name=Thermo")) == 0);
+
+        // Bad arguments get an error line and leave the connection usable
+        const char* badRequests[][2] = {
+            { "query colour=red", "Unknown argument: colour=red" },
+            { "query min_rssi=loud", "Invalid value: min_rssi=loud" },
+            { "query min_rssi", "Invalid value: min_rssi" },
+            { "query service=zz", "Invalid service UUID: zz" },
+            { "query batch_ms=10", "Unknown argument: batch_ms=10" },
+            { "subscribe batch_ms=soon", "Invalid value: batch_ms=soon" },
+            { "frobnicate", "Unknown command: frobnicate" },
+        };
+        for (const auto& [request, message] : badRequests)
+        {
+            std::string response = client.Request(request);
+            LUMINA_CHECK(response == std::string("{\"type\":\"error\",\"message\":\"") + message + "\"}");
+        }
+        LUMINA_CHECK(client.Request("ping") == "{\"type\":\"pong\"}");
+        LUMINA_CHECK(server.GetStats().clients == 1);
+    }
+
+    // A subscriber is told about each device that enters its filter, and once about each that leaves it
+    void TestSubscribe(const std::string& path)
+    {
+        LuminaQueryServer server;
+        LUMINA_CHECK(Start(server, path));
+        PublishFour(server);
+        uint64_t updates = 4;
+
+        TestClient client;
+        LUMINA_CHECK(client.Connect(path));
+        LUMINA_CHECK(client.Request("subscribe min_rssi=-60 batch_ms=5") == "{\"type\":\"subscribed\"}");
+
+        std::string initial = client.ReadLine().value_or("");
+        LUMINA_CHECK(Contains(initial, "\"type\":\"batch\"") && CountDevices(initial) == 2);
+        LUMINA_CHECK(Contains(initial, Quoted(SensorA)) && Contains(initial, Quoted(ThermoC)) && !Contains(initial, "removed"));
+
+        // Enters the filter
+        server.PublishDevice(MakeDevice(BandB, "Heart Band", -55, true));
+        WaitForUpdates(server, ++updates);
+        std::string entered = client.ReadLine().value_or("");
+        LUMINA_CHECK(CountDevices(entered) == 1 && Contains(entered, Quoted(BandB)) && Removed(entered).empty());
+
+        // Leaves it: reported once, further non-matching updates stay silent
+        server.PublishDevice(MakeDevice(SensorA, "Heart Sensor", -70, true));
+        WaitForUpdates(server, ++updates);
+        std::string left = client.ReadLine().value_or("");
+        LUMINA_CHECK(CountDevices(left) == 0 && Removed(left) == Quoted(SensorA));
+        server.PublishDevice(MakeDevice(SensorA, "Heart Sensor", -75, true));
+        server.PublishDevice(MakeDevice(NamelessD, "", -95, false));
+        updates += 2;
+        WaitForUpdates(server, updates);
+        LUMINA_CHECK(!client.ReadLine(100));
+
+        // Comes back
+        server.PublishDevice(MakeDevice(SensorA, "Heart Sensor", -45, true));
+        WaitForUpdates(server, ++updates);
+        std::string back = client.ReadLine().value_or("");
+        LUMINA_CHECK(CountDevices(back) == 1 && Contains(back, Quoted(SensorA)) && Removed(back).empty());
+
+        // A clear removes every member; non-members are not mentioned
+        server.ClearDevices();
+        std::string cleared = client.ReadLine().value_or("");
+        std::string removed = Removed(cleared);
+        LUMINA_CHECK(CountDevices(cleared) == 0 && Contains(removed, Quoted(SensorA)) && Contains(removed, Quoted(BandB)));
+        LUMINA_CHECK(Contains(removed, Quoted(ThermoC)) && !Contains(removed, Quoted(NamelessD)));
+
+        // Published again after the clear, it arrives as a plain update
+        server.PublishDevice(MakeDevice(ThermoC, "Thermo", -40, false));
+        WaitForUpdates(server, ++updates);
+        std::string republished = client.ReadLine().value_or("");
+        LUMINA_CHECK(CountDevices(republished) == 1 && Contains(republished, Quoted(ThermoC)) && Removed(republished).empty());
+
+        LUMINA_CHECK(client.Request("unsubscribe") == "{\"type\":\"unsubscribed\"}");
+        server.PublishDevice(MakeDevice(ThermoC, "Thermo", -30, false));
+        WaitForUpdates(server, ++updates);
+        LUMINA_CHECK(!client.ReadLine(100));
+        LUMINA_CHECK(server.GetStats().batches == 6);
+    }
+
+    // A second server must not take over a live one's path; a file left by a dead one is reclaimed
+    void TestSocketOwnership(const std::string& path)
+    {
+        {
+            LuminaQueryServer first;
+            LUMINA_CHECK(Start(first, path));
+
+            LuminaQueryServer second;
+            std::string error;
+            LUMINA_CHECK(!second.Start(path, error) && !second.IsRunning());
+            LUMINA_CHECK(Contains(error, "in use by another instance"));
+            second.Stop();
+
+            TestClient client;
+            LUMINA_CHECK(client.Connect(path) && client.Request("ping") == "{\"type\":\"pong\"}");
+        }
+        LUMINA_CHECK(!std::filesystem::exists(path));
+
+        // Bound and closed without unlinking, as a crashed server leaves it
+        SocketHandle stale = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address = SocketAddress(path);
+        LUMINA_CHECK(bind(stale, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+        CloseSocket(stale);
+        LUMINA_CHECK(std::filesystem::exists(path));
+
+        LuminaQueryServer server;
+        LUMINA_CHECK(Start(server, path));
+        TestClient client;
+        LUMINA_CHECK(client.Connect(path) && client.Request("ping") == "{\"type\":\"pong\"}");
+    }
+
+    // A subscriber that stops reading is dropped once MaxOutputBytes is queued for it; others are unaffected
+    void TestSlowClientDrop(const std::string& path)
+    {
+        constexpr uint64_t DeviceCount = 2000;
+        LuminaQueryServer server;
+        LUMINA_CHECK(Start(server, path));
+
+        TestClient slow;
+        TestClient healthy;
+        LUMINA_CHECK(slow.Connect(path) && healthy.Connect(path));
+        slow.Send("subscribe batch_ms=1");
+        LUMINA_CHECK(healthy.Request("ping") == "{\"type\":\"pong\"}");
+
+        const std::string padding(400, 'x');
+        uint64_t updates = 0;
+        int rounds = 0;
+        auto deadline = Clock::now() + std::chrono::seconds(20);
+        while (server.GetStats().clients == 2 && Clock::now() < deadline)
+        {
+            for (uint64_t i = 0; i < DeviceCount; ++i)
+            {
+                server.PublishDevice(MakeDevice(0x100000 + i, padding, static_cast<int16_t>(-40 - rounds % 50), false));
+            }
+            updates += DeviceCount;
+            WaitForUpdates(server, updates);
+            ++rounds;
+        }
+        LUMINA_CHECK(server.GetStats().clients == 1);
+
+        // What reached the kernel buffers is still readable, then the server's hangup
+        size_t lines = 0;
+        while (slow.ReadLine(2000))
+        {
+            ++lines;
+        }
+        LUMINA_CHECK(slow.IsClosed());
+        LUMINA_CHECK(healthy.Request("ping") == "{\"type\":\"pong\"}");
+        std::printf("slow client: dropped after %d rounds of %llu devices (~%.1f MB published), %zu lines had reached it\n",
+            rounds, static_cast<unsigned long long>(DeviceCount), rounds * DeviceCount * (padding.size() + 120) / 1e6, lines);
+    }
+
+    // Many subscribers at once: publish-to-receive latency of the fan-out, then query throughput
+    void BenchmarkManyClients(const std::string& path)
+    {
+        constexpr int ClientCount = 100;
+        constexpr int Rounds = 50;
+        constexpr int QueryThreads = 16;
+        constexpr int QueriesPerThread = 500;
+        LuminaQueryServer server;
+        LUMINA_CHECK(Start(server, path));
+        size_t expectedMatches = 0;
+        for (uint64_t i = 0; i < 1000; ++i)
+        {
+            Lumina::QueryDevice device = MakeDevice(0x200000 + i, "Device " + std::to_string(i), static_cast<int16_t>(-30 - i % 70), i % 10 == 0);
+            expectedMatches += device.rssi >= -60 && !device.serviceUuids.empty() ? 1 : 0;
+            server.PublishDevice(device);
+        }
+        WaitForUpdates(server, 1000);
+        uint64_t updates = 1000;
+
+        std::vector<std::unique_ptr<TestClient>> clients;
+        for (int i = 0; i < ClientCount; ++i)
+        {
+            clients.push_back(std::make_unique<TestClient>());
+            LUMINA_CHECK(clients.back()->Connect(path));
+            LUMINA_CHECK(clients.back()->Request("subscribe name=Round batch_ms=1") == "{\"type\":\"subscribed\"}");
+        }
+        LUMINA_CHECK(server.GetStats().clients == ClientCount);
+
+        std::vector<std::atomic<int64_t>> publishedNs(Rounds);
+        std::vector<std::vector<double>> latencies(ClientCount);
+        std::vector<std::thread> readers;
+        for (int i = 0; i < ClientCount; ++i)
+        {
+            readers.emplace_back([&, i]()
+            {
+                for (int round = 0; round < Rounds;)
+                {
+                    std::optional<std::string> line = clients[i]->ReadLine(5000);
+                    if (!line)
+                    {
+                        return;
+                    }
+                    int64_t now = Clock::now().time_since_epoch().count();
+                    if (Contains(*line, "\"name\":\"Round " + std::to_string(round) + "\""))
+                    {
+                        latencies[i].push_back(static_cast<double>(now - publishedNs[round]) / 1e6);
+                        ++round;
+                    }
+                }
+            });
+        }
+        for (int round = 0; round < Rounds; ++round)
+        {
+            publishedNs[round] = Clock::now().time_since_epoch().count();
+            server.PublishDevice(MakeDevice(0x300000, "Round " + std::to_string(round), -40, false));
+            WaitForUpdates(server, ++updates);
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        for (std::thread& reader : readers)
+        {
+            reader.join();
+        }
+
+        std::vector<double> all;
+        for (const std::vector<double>& values : latencies)
+        {
+            all.insert(all.end(), values.begin(), values.end());
+        }
+        LUMINA_CHECK(all.size() == static_cast<size_t>(ClientCount) * Rounds);
+        double p50 = LuminaTest::Percentile(all, 0.5);
+        double p99 = LuminaTest::Percentile(all, 0.99);
+        std::printf("fan-out: %d subscribers x %d rounds, publish to receive p50 %.2f ms, p99 %.2f ms (10 ms tick)\n",
+            ClientCount, Rounds, p50, p99);
+
+        std::atomic<int> answered = 0;
+        std::vector<std::thread> queriers;
+        auto start = Clock::now();
+        for (int i = 0; i < QueryThreads; ++i)
+        {
+            queriers.emplace_back([&, i]()
+            {
+                TestClient& client = *clients[i];
+                client.Send("unsubscribe");
+                client.ReadLine();
+                for (int q = 0; q < QueriesPerThread; ++q)
+                {
+                    std::string response = client.Request("query service=180d min_rssi=-60");
+                    answered += Contains(response, "\"type\":\"result\"") && CountDevices(response) == expectedMatches ? 1 : 0;
+                }
+            });
+        }
+        for (std::thread& querier : queriers)
+        {
+            querier.join();
+        }
+        double seconds = LuminaTest::SecondsSince(start);
+        LUMINA_CHECK(answered == QueryThreads * QueriesPerThread);
+        std::printf("queries: %d clients x %d over 1000 devices, %.0f queries/s\n", QueryThreads, QueriesPerThread,
+            QueryThreads * QueriesPerThread / seconds);
+    }
+}
+
+int main()
+{
+    const std::filesystem::path root = std::filesystem::temp_directory_path() /
+        ("lumina-query-test-" + std::to_string(Clock::now().time_since_epoch().count()));
+    std::filesystem::create_directories(root);
+#ifdef _WIN32
+    // The servers start and stop Winsock with themselves; the test's own sockets need it in between
+    WSADATA data;
+    WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+    const std::string path = (root / "query.sock").string();
+
+    TestQueryAndFilters(path);
+    TestSubscribe(path);
+    TestSocketOwnership(path);
+    TestSlowClientDrop(path);
+    BenchmarkManyClients(path);
+    std::filesystem::remove_all(root);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return LuminaTest::Finish();
+}
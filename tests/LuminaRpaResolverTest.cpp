@@ -0,0 +1,247 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "LuminaHelper.h"
+#include "LuminaRpaResolver.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    using Irk = std::array<uint8_t, 16>;
+
+    struct Bond
+    {
+        uint64_t identity;
+        Irk irk;
+    };
+
+    std::string IrkToHex(const Irk& irk)
+    {
+        std::string text;
+        char digits[3];
+        for (uint8_t byte : irk)
+        {
+            std::snprintf(digits, sizeof(digits), "%02x", byte);
+            text += digits;
+        }
+        return text;
+    }
+
+    void WriteBonds(const std::filesystem::path& path, const std::vector<Bond>& bonds, int version)
+    {
+        {
+            std::ofstream file(path, std::ios::trunc);
+            file << "# identity irk name\n";
+            for (const Bond& bond : bonds)
+            {
+                file << LuminaHelper::BluetoothAddressToString(bond.identity) << " " << IrkToHex(bond.irk) << " Device\n";
+            }
+        }
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now() + std::chrono::seconds(version));
+    }
+
+    // A resolvable private address the owner of irk could advertise
+    uint64_t MakeRpa(const Irk& irk, std::mt19937_64& random)
+    {
+        const uint32_t prand = 0x400000 | static_cast<uint32_t>(random() & 0x3FFFFF);
+        return (static_cast<uint64_t>(prand) << 24) | LuminaRpaResolver::Ah(irk.data(), prand);
+    }
+
+    Irk RandomIrk(std::mt19937_64& random)
+    {
+        Irk irk;
+        for (uint8_t& byte : irk)
+        {
+            byte = static_cast<uint8_t>(random());
+        }
+        return irk;
+    }
+
+    void TestSpecificationSample()
+    {
+        std::vector<uint8_t> irk;
+        LUMINA_CHECK(LuminaHelper::ParseHexBytes("ec0234a357c8ad05341010a60a397d9b", irk) && irk.size() == 16);
+        LUMINA_CHECK(LuminaRpaResolver::Ah(irk.data(), 0x708194) == 0x0dfbaa);
+    }
+
+    void TestResolve(const std::filesystem::path& path)
+    {
+        std::mt19937_64 random(5);
+        std::vector<Bond> bonds;
+        for (int i = 0; i < 20; ++i)
+        {
+            bonds.push_back({ 0xD00000000000ull + static_cast<uint64_t>(i), RandomIrk(random) });
+        }
+        WriteBonds(path, bonds, 1);
+
+        LuminaRpaResolver resolver;
+        std::string error;
+        LUMINA_CHECK(resolver.ReloadIfChanged(path, error));
+        LUMINA_CHECK(resolver.GetIrkCount() == bonds.size());
+
+        for (const Bond& bond : bonds)
+        {
+            const uint64_t rpa = MakeRpa(bond.irk, random);
+            LUMINA_CHECK(resolver.Resolve(rpa) == bond.identity);
+            LUMINA_CHECK(resolver.Resolve(rpa) == bond.identity);   // Cached
+        }
+        const uint64_t stranger = MakeRpa(RandomIrk(random), random);
+        LUMINA_CHECK(resolver.Resolve(stranger) == stranger);
+        LUMINA_CHECK(resolver.Resolve(0xC12345678901ull) == 0xC12345678901ull);    // Static random, never resolved
+        LUMINA_CHECK(resolver.GetStats().checked == bonds.size() + 1);
+        LUMINA_CHECK(resolver.GetStats().resolved == bonds.size());
+    }
+
+    // The AES-NI and portable paths must agree, including on which key matched first
+    void TestPathsAgree()
+    {
+        std::mt19937_64 random(9);
+        std::vector<Bond> bonds;
+        for (int i = 0; i < 1000; ++i)
+        {
+            bonds.push_back({ 0xD10000000000ull + static_cast<uint64_t>(i), RandomIrk(random) });
+        }
+        const std::filesystem::path path = std::filesystem::temp_directory_path() / "lumina-irk-agree.txt";
+        WriteBonds(path, bonds, 1);
+        LuminaRpaResolver resolver;
+        std::string error;
+        LUMINA_CHECK(resolver.ReloadIfChanged(path, error));
+
+        size_t disagreements = 0;
+        for (int i = 0; i < 2000; ++i)
+        {
+            const uint64_t rpa = i % 2 ? MakeRpa(bonds[random() % bonds.size()].irk, random) : MakeRpa(RandomIrk(random), random);
+            const uint32_t prand = static_cast<uint32_t>(rpa >> 24) & 0xFFFFFF;
+            const uint32_t hash = static_cast<uint32_t>(rpa) & 0xFFFFFF;
+            disagreements += resolver.FindIrk(prand, hash, true) == resolver.FindIrk(prand, hash, false) ? 0 : 1;
+        }
+        LUMINA_CHECK(disagreements == 0);
+
+        // Worst case: no key matches, so every key is tried
+        for (bool allowAesNi : { true, false })
+        {
+            if (allowAesNi && !resolver.GetIsUsingAesNi())
+            {
+                continue;
+            }
+            constexpr int Iterations = 2000;
+            int found = 0;
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < Iterations; ++i)
+            {
+                found += resolver.FindIrk(static_cast<uint32_t>(0x400000 + i), 0xFFFFFF - static_cast<uint32_t>(i), allowAesNi) >= 0 ? 1 : 0;
+            }
+            const double seconds = LuminaTest::SecondsSince(start);
+            std::printf("rpa resolver, %s: %.0f resolutions/s over %zu IRKs, %.1f ns per key (%d hits)\n", allowAesNi ? "AES-NI" : "portable",
+                Iterations / seconds, bonds.size(), seconds * 1e9 / Iterations / static_cast<double>(bonds.size()), found);
+        }
+        std::filesystem::remove(path);
+    }
+
+    void TestReloadAfterError(const std::filesystem::path& path)
+    {
+        std::mt19937_64 random(3);
+        const Bond bond{ 0xD20000000001ull, RandomIrk(random) };
+        WriteBonds(path, { bond }, 1);
+        LuminaRpaResolver resolver;
+        std::string error;
+        LUMINA_CHECK(resolver.ReloadIfChanged(path, error));
+
+        {
+            std::ofstream file(path, std::ios::app);
+            file << "AA:BB:CC:DD:EE:FF not-a-key\n";
+        }
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now() + std::chrono::seconds(2));
+        LUMINA_CHECK(!resolver.ReloadIfChanged(path, error));
+        for (int i = 0; i < 3; ++i)
+        {
+            error.clear();
+            LUMINA_CHECK(resolver.ReloadIfChanged(path, error));
+            LUMINA_CHECK(error.empty());
+        }
+        LUMINA_CHECK(resolver.GetIrkCount() == 1);
+        LUMINA_CHECK(resolver.Resolve(MakeRpa(bond.irk, random)) == bond.identity);
+
+        WriteBonds(path, {}, 3);
+        LUMINA_CHECK(resolver.ReloadIfChanged(path, error));
+        LUMINA_CHECK(resolver.GetIrkCount() == 0);
+    }
+
+    // Resolvers racing reloads that move one IRK between two identities. After each reload has settled,
+    // no address may still resolve to the identity of the keys it replaced.
+    void TestReloadDuringResolve(const std::filesystem::path& path)
+    {
+        std::mt19937_64 random(21);
+        const Irk irk = RandomIrk(random);
+        const uint64_t identities[2] = { 0xD30000000001ull, 0xD30000000002ull };
+        std::vector<uint64_t> addresses;
+        for (int i = 0; i < 64; ++i)
+        {
+            addresses.push_back(MakeRpa(irk, random));
+        }
+        // Other keys first, so each search is long enough for reloads to land inside it
+        std::vector<Bond> bonds;
+        for (int i = 0; i < 500; ++i)
+        {
+            bonds.push_back({ 0xD40000000000ull + static_cast<uint64_t>(i), RandomIrk(random) });
+        }
+        bonds.push_back({ 0, irk });
+
+        LuminaRpaResolver resolver;
+        std::atomic<bool> isDone = false;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 3; ++t)
+        {
+            threads.emplace_back([&, t]()
+            {
+                for (size_t i = static_cast<size_t>(t); !isDone.load(); ++i)
+                {
+                    resolver.Resolve(addresses[i % addresses.size()]);
+                }
+            });
+        }
+
+        std::string error;
+        size_t stale = 0;
+        for (int version = 1; version <= 100; ++version)
+        {
+            const uint64_t expected = identities[version % 2];
+            bonds.back().identity = expected;
+            WriteBonds(path, bonds, version);
+            LUMINA_CHECK(resolver.ReloadIfChanged(path, error));
+
+            // Searches that started before the reload are long finished by now
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            for (uint64_t address : addresses)
+            {
+                stale += resolver.Resolve(address) == expected ? 0 : 1;
+            }
+        }
+        isDone = true;
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        LUMINA_CHECK(stale == 0);
+    }
+}
+
+int main()
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() /
+        ("lumina-irk-test-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".txt");
+    TestSpecificationSample();
+    TestResolve(path);
+    TestReloadAfterError(path);
+    TestReloadDuringResolve(path);
+    TestPathsAgree();
+    std::filesystem::remove(path);
+    return LuminaTest::Finish();
+}
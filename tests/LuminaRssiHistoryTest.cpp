@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+#include "LuminaRssiHistory.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    struct Sample
+    {
+        uint64_t address;
+        int64_t timeMs;
+        int rssi;
+    };
+
+    constexpr int64_t HourMs = 60 * 60 * 1000;
+    constexpr int64_t DayMs = 24 * HourMs;
+
+    // Same bucketing as LuminaRssiHistory::Query, computed straight from the samples
+    std::vector<Lumina::RssiHistoryPoint> ExpectedPoints(const std::vector<Sample>& samples, uint64_t address,
+        int64_t fromMs, int64_t toMs, size_t bucketCount)
+    {
+        const int64_t bucketMs = (toMs - fromMs + static_cast<int64_t>(bucketCount) - 1) / static_cast<int64_t>(bucketCount);
+        std::vector<Lumina::RssiHistoryPoint> points(bucketCount);
+        std::vector<double> sums(bucketCount, 0.0);
+        for (const Sample& sample : samples)
+        {
+            if (sample.address != address || sample.timeMs < fromMs || sample.timeMs >= toMs)
+            {
+                continue;
+            }
+            const size_t index = static_cast<size_t>((sample.timeMs - fromMs) / bucketMs);
+            Lumina::RssiHistoryPoint& point = points[index];
+            const float rssi = static_cast<float>(sample.rssi);
+            point.minRssi = point.count == 0 ? rssi : std::min(point.minRssi, rssi);
+            point.maxRssi = point.count == 0 ? rssi : std::max(point.maxRssi, rssi);
+            ++point.count;
+            sums[index] += sample.rssi;
+        }
+        for (size_t i = 0; i < bucketCount; ++i)
+        {
+            points[i].meanRssi = points[i].count ? static_cast<float>(sums[i] / points[i].count) : 0.0f;
+        }
+        return points;
+    }
+
+    bool SamePoints(const std::vector<Lumina::RssiHistoryPoint>& actual, const std::vector<Lumina::RssiHistoryPoint>& expected)
+    {
+        if (actual.size() != expected.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < actual.size(); ++i)
+        {
+            if (actual[i].count != expected[i].count)
+            {
+                return false;
+            }
+            if (expected[i].count != 0 && (actual[i].minRssi != expected[i].minRssi || actual[i].maxRssi != expected[i].maxRssi ||
+                std::fabs(actual[i].meanRssi - expected[i].meanRssi) > 0.01f))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Each query shape the device properties window uses, ending at endMs
+    void CheckQueries(const LuminaRssiHistory& history, const std::vector<Sample>& samples, uint64_t address, int64_t endMs, const char* label)
+    {
+        struct Range
+        {
+            const char* name;
+            int64_t spanMs;
+            size_t bucketCount;
+        };
+        const Range ranges[] = { { "hour", HourMs, 360 }, { "day", DayMs, 96 }, { "unaligned", 5 * HourMs + 7 * 1000, 37 } };
+
+        std::vector<Lumina::RssiHistoryPoint> points;
+        for (const Range& range : ranges)
+        {
+            const int64_t fromMs = endMs - range.spanMs;
+            history.Query(address, fromMs, endMs, range.bucketCount, points);
+            const bool isSame = SamePoints(points, ExpectedPoints(samples, address, fromMs, endMs, range.bucketCount));
+            if (!isSame)
+            {
+                std::fprintf(stderr, "%s: %s query differs from the recorded samples\n", label, range.name);
+            }
+            LUMINA_CHECK(isSame);
+        }
+    }
+
+    double QueryMillis(const LuminaRssiHistory& history, uint64_t address, int64_t fromMs, int64_t toMs, size_t bucketCount)
+    {
+        std::vector<double> times;
+        std::vector<Lumina::RssiHistoryPoint> points;
+        for (int i = 0; i < 50; ++i)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            history.Query(address, fromMs, toMs, bucketCount, points);
+            times.push_back(LuminaTest::SecondsSince(start) * 1000.0);
+        }
+        return LuminaTest::Percentile(times, 0.5);
+    }
+}
+
+int main()
+{
+    constexpr int DeviceCount = 10;
+    constexpr int64_t DurationMs = 3 * DayMs;
+    const int64_t startMs = 1700000000000 - 1700000000000 % LuminaRssiHistory::ChunkAlignMs;
+    const int64_t endMs = startMs + DurationMs;
+
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() /
+        ("lumina-rssi-test-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    std::filesystem::create_directories(directory);
+
+    // One sample every 1.0-1.3 s per device on the 10 ms tick grid, RSSI drifting within -100..-30
+    std::mt19937 random(42);
+    std::vector<Sample> samples;
+    for (int device = 0; device < DeviceCount; ++device)
+    {
+        const uint64_t address = 0xC00000000000ull + static_cast<uint64_t>(device);
+        int rssi = -60;
+        for (int64_t timeMs = startMs + device * 10; timeMs < endMs; timeMs += 1000 + 10 * static_cast<int64_t>(random() % 31))
+        {
+            rssi = std::clamp(rssi + static_cast<int>(random() % 7) - 3, -100, -30);
+            samples.push_back({ address, timeMs, rssi });
+        }
+    }
+    std::sort(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) { return a.timeMs < b.timeMs; });
+
+    std::string error;
+    {
+        LuminaRssiHistory history;
+        LUMINA_CHECK(history.Open(directory, "rssi", error));
+        const auto start = std::chrono::steady_clock::now();
+        for (const Sample& sample : samples)
+        {
+            history.Record(sample.address, sample.timeMs, sample.rssi);
+        }
+        const double seconds = LuminaTest::SecondsSince(start);
+        LUMINA_CHECK(history.GetSampleCount() == samples.size());
+        std::printf("rssi history: %zu samples recorded at %.0f ns each\n", samples.size(), seconds * 1e9 / static_cast<double>(samples.size()));
+
+        // Answered from open, pending and written chunks alike
+        CheckQueries(history, samples, samples.front().address, endMs, "live");
+        history.Close();
+    }
+
+    const uintmax_t dataBytes = std::filesystem::file_size(directory / "rssi.dat");
+    const uintmax_t indexBytes = std::filesystem::file_size(directory / "rssi.idx");
+    std::printf("rssi history: %.2f bytes/sample of data, %.2f including the index\n",
+        static_cast<double>(dataBytes) / static_cast<double>(samples.size()),
+        static_cast<double>(dataBytes + indexBytes) / static_cast<double>(samples.size()));
+    LUMINA_CHECK(dataBytes < samples.size() * 3);
+
+    {
+        LuminaRssiHistory history;
+        const auto start = std::chrono::steady_clock::now();
+        LUMINA_CHECK(history.Open(directory, "rssi", error));
+        std::printf("rssi history: reopened in %.1f ms\n", LuminaTest::SecondsSince(start) * 1000.0);
+
+        for (int device = 0; device < DeviceCount; ++device)
+        {
+            CheckQueries(history, samples, 0xC00000000000ull + static_cast<uint64_t>(device), endMs, "reopened");
+        }
+
+        const uint64_t address = samples.front().address;
+        std::printf("rssi history: query p50 hour %.3f ms, day %.3f ms, 3 days %.3f ms\n",
+            QueryMillis(history, address, endMs - HourMs, endMs, 360),
+            QueryMillis(history, address, endMs - DayMs, endMs, 96),
+            QueryMillis(history, address, startMs, endMs, 288));
+
+        // An unknown device has empty buckets
+        std::vector<Lumina::RssiHistoryPoint> points;
+        history.Query(1, startMs, endMs, 10, points);
+        LUMINA_CHECK(points.size() == 10 && points[0].count == 0);
+    }
+
+    std::filesystem::remove_all(directory);
+    return LuminaTest::Finish();
+}
@@ -0,0 +1,579 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+#include "LuminaArrowWriter.h"
+#include "LuminaScanExporter.h"
+#include "LuminaHelper.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using ColumnType = LuminaArrowWriter::ColumnType;
+
+    // Reads the parts of a FlatBuffers table the Arrow metadata uses
+    struct FbTable
+    {
+        const uint8_t* buffer = nullptr;
+        size_t position = 0;
+
+        template <typename T>
+        T Read(size_t at) const
+        {
+            T value;
+            std::memcpy(&value, buffer + at, sizeof(T));
+            return value;
+        }
+
+        // Position of a field's value, or 0 if it was left out
+        size_t Field(uint16_t slot) const
+        {
+            size_t vtable = position - Read<int32_t>(position);
+            uint16_t vtableSize = Read<uint16_t>(vtable);
+            uint16_t offset = 4u + 2u * slot < vtableSize ? Read<uint16_t>(vtable + 4 + 2 * slot) : 0;
+            return offset ? position + offset : 0;
+        }
+
+        template <typename T>
+        T Scalar(uint16_t slot, T fallback = T()) const
+        {
+            size_t at = Field(slot);
+            return at ? Read<T>(at) : fallback;
+        }
+
+        size_t Follow(size_t at) const { return at + Read<uint32_t>(at); }
+        bool Has(uint16_t slot) const { return Field(slot) != 0; }
+        FbTable Table(uint16_t slot) const { return { buffer, Follow(Field(slot)) }; }
+
+        std::string String(uint16_t slot) const
+        {
+            size_t at = Follow(Field(slot));
+            return std::string(reinterpret_cast<const char*>(buffer + at + 4), Read<uint32_t>(at));
+        }
+
+        // Element count and the position of the first element
+        std::pair<uint32_t, size_t> Vector(uint16_t slot) const
+        {
+            size_t at = Follow(Field(slot));
+            return { Read<uint32_t>(at), at + 4 };
+        }
+    };
+
+    struct ColumnInfo
+    {
+        std::string name;
+        uint8_t typeId = 0;
+        int bitWidth = 0;
+        bool isSigned = false;
+        bool isNullable = false;
+        int64_t dictionaryId = -1;
+    };
+
+    // One column of one record batch, decoded; strings hold text and binary alike, dictionary values resolved
+    struct ColumnValues
+    {
+        std::vector<int64_t> integers;
+        std::vector<float> floats;
+        std::vector<std::string> strings;
+        std::vector<bool> isValid;
+        int64_t nullCount = 0;
+    };
+
+    struct MessageInfo
+    {
+        uint8_t headerType;
+        int64_t dictionaryId = -1;
+        bool isDelta = false;
+        int64_t length = 0;
+    };
+
+    constexpr uint8_t HeaderSchema = 1;
+    constexpr uint8_t HeaderDictionaryBatch = 2;
+    constexpr uint8_t HeaderRecordBatch = 3;
+    constexpr uint8_t TypeInt = 2;
+    constexpr uint8_t TypeFloatingPoint = 3;
+    constexpr uint8_t TypeBinary = 4;
+    constexpr uint8_t TypeUtf8 = 5;
+    constexpr uint8_t TypeBool = 6;
+    constexpr uint8_t TypeTimestamp = 10;
+
+    // Just enough of an Arrow IPC stream reader for what LuminaArrowWriter produces
+    class StreamReader
+    {
+    public:
+        std::vector<ColumnInfo> columns;
+        std::vector<MessageInfo> messages;
+        std::vector<std::vector<ColumnValues>> batches;
+        std::map<int64_t, std::vector<std::string>> dictionaries;
+        bool isEndOfStream = false;
+        bool isFramingValid = true;
+
+        bool Read(const std::filesystem::path& path)
+        {
+            std::ifstream file(path, std::ios::binary);
+            m_Data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            size_t position = 0;
+            while (position + 8 <= m_Data.size())
+            {
+                uint32_t continuation = Read<uint32_t>(position);
+                int32_t metadataSize = Read<int32_t>(position + 4);
+                if (continuation != 0xFFFFFFFFu)
+                {
+                    return false;
+                }
+                if (metadataSize == 0)
+                {
+                    isEndOfStream = position + 8 == m_Data.size();
+                    return isEndOfStream;
+                }
+
+                size_t metadata = position + 8;
+                FbTable root{ m_Data.data(), metadata + Read<uint32_t>(metadata) };
+                int64_t bodyLength = root.Scalar<int64_t>(3);
+                size_t body = metadata + static_cast<size_t>(metadataSize);
+                isFramingValid = isFramingValid && body % 8 == 0 && bodyLength % 8 == 0 && root.Scalar<int16_t>(0) == 4;
+                if (body + static_cast<size_t>(bodyLength) > m_Data.size())
+                {
+                    return false;
+                }
+
+                MessageInfo message{ root.Scalar<uint8_t>(1) };
+                FbTable header = root.Table(2);
+                if (message.headerType == HeaderSchema)
+                {
+                    ReadSchema(header);
+                }
+                else if (message.headerType == HeaderDictionaryBatch)
+                {
+                    message.dictionaryId = header.Scalar<int64_t>(0);
+                    message.isDelta = header.Scalar<uint8_t>(2) != 0;
+                    message.length = ReadDictionary(header, body, message.dictionaryId, message.isDelta);
+                }
+                else if (message.headerType == HeaderRecordBatch)
+                {
+                    message.length = header.Scalar<int64_t>(0);
+                    batches.push_back(ReadRecordBatch(header, body));
+                }
+                messages.push_back(message);
+                position = body + static_cast<size_t>(bodyLength);
+            }
+            return false;
+        }
+
+        size_t GetRowCount() const
+        {
+            size_t rows = 0;
+            for (const MessageInfo& message : messages)
+            {
+                rows += message.headerType == HeaderRecordBatch ? static_cast<size_t>(message.length) : 0;
+            }
+            return rows;
+        }
+
+        size_t FindColumn(const std::string& name) const
+        {
+            for (size_t i = 0; i < columns.size(); ++i)
+            {
+                if (columns[i].name == name)
+                {
+                    return i;
+                }
+            }
+            return columns.size();
+        }
+
+    private:
+        std::vector<uint8_t> m_Data;
+
+        template <typename T>
+        T Read(size_t at) const
+        {
+            T value;
+            std::memcpy(&value, m_Data.data() + at, sizeof(T));
+            return value;
+        }
+
+        void ReadSchema(const FbTable& schema)
+        {
+            auto [count, first] = schema.Vector(1);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                FbTable field{ m_Data.data(), schema.Follow(first + 4 * i) };
+                ColumnInfo column;
+                column.name = field.String(0);
+                column.isNullable = field.Scalar<uint8_t>(1) != 0;
+                column.typeId = field.Scalar<uint8_t>(2);
+                if (column.typeId == TypeInt)
+                {
+                    FbTable type = field.Table(3);
+                    column.bitWidth = type.Scalar<int32_t>(0);
+                    column.isSigned = type.Scalar<uint8_t>(1) != 0;
+                }
+                if (field.Has(4))
+                {
+                    column.dictionaryId = field.Table(4).Scalar<int64_t>(0);
+                }
+                columns.push_back(column);
+            }
+        }
+
+        // Buffer i of a batch: start in the file and length
+        std::pair<size_t, size_t> Buffer(const FbTable& batch, size_t body, size_t index) const
+        {
+            auto [count, first] = batch.Vector(2);
+            if (index >= count)
+            {
+                return { body, 0 };
+            }
+            return { body + static_cast<size_t>(Read<int64_t>(first + 16 * index)), static_cast<size_t>(Read<int64_t>(first + 16 * index + 8)) };
+        }
+
+        std::vector<std::string> ReadStrings(const FbTable& batch, size_t body, size_t offsetsBuffer, size_t length) const
+        {
+            size_t offsets = Buffer(batch, body, offsetsBuffer).first;
+            size_t values = Buffer(batch, body, offsetsBuffer + 1).first;
+            std::vector<std::string> strings;
+            for (size_t i = 0; i < length; ++i)
+            {
+                int32_t start = Read<int32_t>(offsets + 4 * i);
+                int32_t end = Read<int32_t>(offsets + 4 * i + 4);
+                strings.emplace_back(reinterpret_cast<const char*>(m_Data.data() + values + start), static_cast<size_t>(end - start));
+            }
+            return strings;
+        }
+
+        int64_t ReadDictionary(const FbTable& header, size_t body, int64_t id, bool isDelta)
+        {
+            FbTable data = header.Table(1);
+            int64_t length = data.Scalar<int64_t>(0);
+            std::vector<std::string> entries = ReadStrings(data, body, 1, static_cast<size_t>(length));
+            std::vector<std::string>& dictionary = dictionaries[id];
+            if (!isDelta)
+            {
+                dictionary.clear();
+            }
+            dictionary.insert(dictionary.end(), entries.begin(), entries.end());
+            return length;
+        }
+
+        std::vector<ColumnValues> ReadRecordBatch(const FbTable& batch, size_t body) const
+        {
+            const size_t length = static_cast<size_t>(batch.Scalar<int64_t>(0));
+            auto [nodeCount, nodes] = batch.Vector(1);
+            std::vector<ColumnValues> values(columns.size());
+            size_t buffer = 0;
+            for (size_t c = 0; c < columns.size() && c < nodeCount; ++c)
+            {
+                const ColumnInfo& column = columns[c];
+                ColumnValues& out = values[c];
+                out.nullCount = Read<int64_t>(nodes + 16 * c + 8);
+                auto [validity, validityLength] = Buffer(batch, body, buffer++);
+                for (size_t i = 0; i < length; ++i)
+                {
+                    out.isValid.push_back(validityLength == 0 || (m_Data[validity + i / 8] >> (i % 8)) & 1);
+                }
+
+                if (column.dictionaryId >= 0)
+                {
+                    size_t indices = Buffer(batch, body, buffer++).first;
+                    const std::vector<std::string>& dictionary = dictionaries.at(column.dictionaryId);
+                    for (size_t i = 0; i < length; ++i)
+                    {
+                        out.strings.push_back(dictionary.at(static_cast<size_t>(Read<int32_t>(indices + 4 * i))));
+                    }
+                }
+                else if (column.typeId == TypeBinary || column.typeId == TypeUtf8)
+                {
+                    out.strings = ReadStrings(batch, body, buffer, length);
+                    buffer += 2;
+                }
+                else
+                {
+                    size_t data = Buffer(batch, body, buffer++).first;
+                    for (size_t i = 0; i < length; ++i)
+                    {
+                        if (column.typeId == TypeFloatingPoint)
+                        {
+                            out.floats.push_back(Read<float>(data + 4 * i));
+                        }
+                        else if (column.typeId == TypeBool)
+                        {
+                            out.integers.push_back((m_Data[data + i / 8] >> (i % 8)) & 1);
+                        }
+                        else if (column.typeId == TypeTimestamp || column.bitWidth == 64)
+                        {
+                            out.integers.push_back(Read<int64_t>(data + 8 * i));
+                        }
+                        else if (column.bitWidth == 32)
+                        {
+                            out.integers.push_back(column.isSigned ? Read<int32_t>(data + 4 * i) : Read<uint32_t>(data + 4 * i));
+                        }
+                        else if (column.bitWidth == 16)
+                        {
+                            out.integers.push_back(column.isSigned ? Read<int16_t>(data + 2 * i) : Read<uint16_t>(data + 2 * i));
+                        }
+                        else
+                        {
+                            out.integers.push_back(column.isSigned ? Read<int8_t>(data + i) : Read<uint8_t>(data + i));
+                        }
+                    }
+                }
+            }
+            return values;
+        }
+    };
+
+    // Schema, dictionary and record batch messages, delta dictionaries, nulls and every column type
+    void TestWriterRoundTrip(const std::filesystem::path& directory)
+    {
+        enum : int64_t { Id, Tag, Score, Flag, Blob, Small };
+        const std::vector<LuminaArrowWriter::Column> columns = {
+            { "id", ColumnType::Int64 },
+            { "tag", ColumnType::DictionaryUtf8 },
+            { "score", ColumnType::Float32, true },
+            { "flag", ColumnType::Bool },
+            { "blob", ColumnType::Binary },
+            { "small", ColumnType::Int16 },
+        };
+        const std::filesystem::path path = directory / "round-trip.arrows";
+        LuminaArrowWriter writer;
+        std::string error;
+        LUMINA_CHECK(writer.Open(path, columns, error));
+
+        const std::vector<std::vector<std::string>> tags = { { "a", "b", "a" }, { "b", "c", "d" }, { "d", "a" } };
+        int64_t id = 0;
+        for (size_t b = 0; b < tags.size(); ++b)
+        {
+            LuminaArrowWriter::Batch batch = writer.CreateBatch();
+            for (size_t i = 0; i < tags[b].size(); ++i, ++id)
+            {
+                batch.AppendInteger(Id, id * 1000000007);
+                batch.AppendBytes(Tag, tags[b][i]);
+                if (b == 0 && i == 1)
+                {
+                    batch.AppendNull(Score);
+                }
+                else
+                {
+                    batch.AppendFloat(Score, 0.5f * static_cast<float>(id));
+                }
+                batch.AppendBool(Flag, id % 3 == 0);
+                batch.AppendBytes(Blob, std::string(static_cast<size_t>(id), static_cast<char>('0' + id)));
+                batch.AppendInteger(Small, -static_cast<int16_t>(id));
+            }
+            LUMINA_CHECK(writer.WriteBatch(batch, error));
+        }
+
+        // A batch with a short column is refused whole
+        LuminaArrowWriter::Batch uneven = writer.CreateBatch();
+        uneven.AppendInteger(Id, 1);
+        LUMINA_CHECK(!writer.WriteBatch(uneven, error) && error.find("'tag' has 0 values") != std::string::npos);
+        writer.Close();
+
+        StreamReader reader;
+        LUMINA_CHECK(reader.Read(path) && reader.isEndOfStream && reader.isFramingValid);
+        LUMINA_CHECK(reader.columns.size() == columns.size() && reader.columns[Tag].dictionaryId == Tag);
+        LUMINA_CHECK(reader.columns[Score].isNullable && !reader.columns[Id].isNullable && reader.columns[Small].isSigned);
+
+        // The first dictionary is whole; later ones carry only new entries; a batch without any sends none
+        const std::vector<std::pair<uint8_t, int64_t>> expected = {
+            { HeaderSchema, 0 }, { HeaderDictionaryBatch, 2 }, { HeaderRecordBatch, 3 },
+            { HeaderDictionaryBatch, 2 }, { HeaderRecordBatch, 3 }, { HeaderRecordBatch, 2 } };
+        LUMINA_CHECK(reader.messages.size() == expected.size());
+        for (size_t i = 0; i < std::min(expected.size(), reader.messages.size()); ++i)
+        {
+            LUMINA_CHECK(reader.messages[i].headerType == expected[i].first && reader.messages[i].length == expected[i].second);
+        }
+        LUMINA_CHECK(reader.messages.size() > 3 && !reader.messages[1].isDelta && reader.messages[3].isDelta);
+        LUMINA_CHECK(reader.messages.size() > 3 && reader.messages[1].dictionaryId == Tag && reader.messages[3].dictionaryId == Tag);
+        LUMINA_CHECK((reader.dictionaries[Tag] == std::vector<std::string>{ "a", "b", "c", "d" }));
+
+        id = 0;
+        bool isEveryValueBack = reader.batches.size() == tags.size();
+        for (size_t b = 0; isEveryValueBack && b < tags.size(); ++b)
+        {
+            const std::vector<ColumnValues>& batch = reader.batches[b];
+            LUMINA_CHECK(batch[Score].nullCount == (b == 0 ? 1 : 0) && batch[Id].nullCount == 0);
+            for (size_t i = 0; i < tags[b].size(); ++i, ++id)
+            {
+                bool isNull = b == 0 && i == 1;
+                isEveryValueBack = isEveryValueBack && batch[Id].integers[i] == id * 1000000007 && batch[Tag].strings[i] == tags[b][i] &&
+                    batch[Score].isValid[i] == !isNull && (isNull || batch[Score].floats[i] == 0.5f * static_cast<float>(id)) &&
+                    batch[Flag].integers[i] == (id % 3 == 0) && batch[Blob].strings[i] == std::string(static_cast<size_t>(id), static_cast<char>('0' + id)) &&
+                    batch[Small].integers[i] == -id;
+            }
+        }
+        LUMINA_CHECK(isEveryValueBack);
+    }
+
+    Lumina::AdvertisementSample MakeAdvert(uint64_t address, Clock::time_point time, int16_t rssi, bool isScanResponse)
+    {
+        Lumina::AdvertisementSample sample;
+        sample.address = address;
+        sample.timestamp = time;
+        sample.rssi = rssi;
+        sample.advertisementType = isScanResponse ? Lumina::AdvertisementSample::ScanResponseType : 0;
+        const uint8_t flags = 0x06;
+        sample.AppendSection(0x01, &flags, 1);
+        const uint64_t data = address * 0x9E3779B97F4A7C15ull;
+        sample.AppendSection(0xFF, reinterpret_cast<const uint8_t*>(&data), sizeof(data));
+        return sample;
+    }
+
+    std::filesystem::path DevicesPath(const std::filesystem::path& advertsPath)
+    {
+        std::string name = advertsPath.filename().string();
+        return advertsPath.parent_path() / name.replace(name.find("-adverts"), 8, "-devices");
+    }
+
+    // A session through the exporter: every advert comes back in order, and the summary's interval columns
+    // are null for devices without an estimate
+    void TestExporterSession(const std::filesystem::path& directory)
+    {
+        constexpr uint64_t Regular = 0x0000A1B2C3D4E5F6ull;
+        constexpr uint64_t ScanResponseOnly = 0x0000112233445566ull;
+        constexpr uint64_t Brief = 0x0000665544332211ull;
+        LuminaScanExporter exporter;
+        std::string error;
+        LUMINA_CHECK(exporter.Start(directory, error) && exporter.IsRunning());
+
+        const Clock::time_point start = Clock::now();
+        const std::string regularName = "Alpha";
+        const std::string scanResponseName = "Beta";
+        std::vector<Lumina::AdvertisementSample> sent;
+        for (int i = 0; i < 20; ++i)
+        {
+            sent.push_back(MakeAdvert(Regular, start + std::chrono::milliseconds(100 * i), static_cast<int16_t>(-50 - i), false));
+            exporter.RecordAdvert(sent.back(), i == 0 ? &regularName : nullptr);
+            if (i < 10)
+            {
+                sent.push_back(MakeAdvert(ScanResponseOnly, start + std::chrono::milliseconds(100 * i + 3), -70, true));
+                exporter.RecordAdvert(sent.back(), i == 0 ? &scanResponseName : nullptr);
+            }
+            if (i < 3)
+            {
+                sent.push_back(MakeAdvert(Brief, start + std::chrono::milliseconds(100 * i + 5), -80, false));
+                exporter.RecordAdvert(sent.back(), nullptr);
+            }
+        }
+        exporter.Stop();
+        LUMINA_CHECK(!exporter.IsRunning());
+        LUMINA_CHECK(exporter.GetStats().adverts == sent.size() && exporter.GetStats().dropped == 0);
+
+        StreamReader adverts;
+        LUMINA_CHECK(adverts.Read(exporter.GetAdvertsPath()) && adverts.isEndOfStream && adverts.isFramingValid);
+        LUMINA_CHECK(adverts.GetRowCount() == sent.size() && adverts.batches.size() == 1);
+        if (adverts.batches.size() == 1 && adverts.GetRowCount() == sent.size())
+        {
+            const std::vector<ColumnValues>& batch = adverts.batches[0];
+            const size_t address = adverts.FindColumn("address");
+            const size_t name = adverts.FindColumn("name");
+            const size_t rssi = adverts.FindColumn("rssi");
+            const size_t type = adverts.FindColumn("advertisement_type");
+            const size_t payload = adverts.FindColumn("payload");
+            const size_t time = adverts.FindColumn("time");
+            bool isEveryRowBack = true;
+            for (size_t i = 0; i < sent.size(); ++i)
+            {
+                const Lumina::AdvertisementSample& sample = sent[i];
+                const std::string expectedName = sample.address == Regular ? regularName : sample.address == ScanResponseOnly ? scanResponseName : "";
+                isEveryRowBack = isEveryRowBack && batch[address].strings[i] == LuminaHelper::BluetoothAddressToString(sample.address) &&
+                    batch[name].strings[i] == expectedName && batch[rssi].integers[i] == sample.rssi &&
+                    batch[type].integers[i] == sample.advertisementType &&
+                    batch[payload].strings[i] == std::string(reinterpret_cast<const char*>(sample.payload), sample.payloadLength) &&
+                    (i == 0 || batch[time].integers[i] - batch[time].integers[0] ==
+                        std::chrono::duration_cast<std::chrono::microseconds>(sample.timestamp - sent[0].timestamp).count());
+            }
+            LUMINA_CHECK(isEveryRowBack);
+        }
+
+        StreamReader devices;
+        LUMINA_CHECK(devices.Read(DevicesPath(exporter.GetAdvertsPath())) && devices.isEndOfStream);
+        LUMINA_CHECK(devices.GetRowCount() == 3 && devices.batches.size() == 1);
+        const size_t interval = devices.FindColumn("interval_ms");
+        LUMINA_CHECK(interval < devices.columns.size() && devices.columns[interval].isNullable);
+        if (devices.batches.size() == 1 && devices.GetRowCount() == 3 && interval < devices.columns.size())
+        {
+            const std::vector<ColumnValues>& batch = devices.batches[0];
+            const size_t address = devices.FindColumn("address");
+            const size_t adverts = devices.FindColumn("adverts");
+            LUMINA_CHECK(batch[interval].nullCount == 2 && batch[devices.FindColumn("missed_ratio")].nullCount == 2);
+            for (size_t i = 0; i < 3; ++i)
+            {
+                if (batch[address].strings[i] == LuminaHelper::BluetoothAddressToString(Regular))
+                {
+                    LUMINA_CHECK(batch[interval].isValid[i] && std::fabs(batch[interval].floats[i] - 100.0f) < 1.0f && batch[adverts].integers[i] == 20);
+                }
+                else
+                {
+                    LUMINA_CHECK(!batch[interval].isValid[i] && !batch[devices.FindColumn("jitter_ms")].isValid[i]);
+                }
+            }
+        }
+    }
+
+    // A million adverts from 10000 devices through RecordAdvert, then read back
+    void BenchmarkExport(const std::filesystem::path& directory)
+    {
+        constexpr uint64_t DeviceCount = 10000;
+        constexpr uint64_t AdvertCount = 1000000;
+        std::vector<Lumina::AdvertisementSample> samples;
+        std::vector<std::string> names;
+        const Clock::time_point base = Clock::now();
+        for (uint64_t i = 0; i < DeviceCount; ++i)
+        {
+            samples.push_back(MakeAdvert(0x0000C0FFEE000000ull + i, base, static_cast<int16_t>(-40 - i % 60), i % 4 == 0));
+            names.push_back(i % 3 == 0 ? std::string() : "Sensor " + std::to_string(i));
+        }
+
+        LuminaScanExporter exporter;
+        std::string error;
+        LUMINA_CHECK(exporter.Start(directory, error));
+        auto start = Clock::now();
+        for (uint64_t i = 0; i < AdvertCount; ++i)
+        {
+            Lumina::AdvertisementSample& sample = samples[i % DeviceCount];
+            sample.timestamp = base + std::chrono::microseconds(i * 50);
+            exporter.RecordAdvert(sample, i < DeviceCount ? &names[i] : nullptr);
+        }
+        double recordSeconds = LuminaTest::SecondsSince(start);
+        exporter.Stop();
+        double totalSeconds = LuminaTest::SecondsSince(start);
+
+        LuminaScanExporter::Stats stats = exporter.GetStats();
+        LUMINA_CHECK(stats.adverts + stats.dropped == AdvertCount);
+        const uintmax_t fileSize = std::filesystem::file_size(exporter.GetAdvertsPath());
+
+        start = Clock::now();
+        StreamReader reader;
+        LUMINA_CHECK(reader.Read(exporter.GetAdvertsPath()) && reader.isFramingValid);
+        double readSeconds = LuminaTest::SecondsSince(start);
+        LUMINA_CHECK(reader.GetRowCount() == stats.adverts && reader.dictionaries[reader.FindColumn("address")].size() == DeviceCount);
+
+        std::printf("scan export: %llu adverts, %llu dropped, %llu row groups; RecordAdvert %.0f ns each, %.2f M adverts/s to disk\n",
+            static_cast<unsigned long long>(stats.adverts), static_cast<unsigned long long>(stats.dropped),
+            static_cast<unsigned long long>(stats.rowGroups), recordSeconds * 1e9 / AdvertCount, stats.adverts / totalSeconds / 1e6);
+        const double bytesPerAdvert = static_cast<double>(fileSize) / static_cast<double>(stats.adverts);
+        std::printf("scan export: %.1f MB per million adverts (%.1f bytes each, %u-byte payloads); read back in %.0f ms\n",
+            bytesPerAdvert, bytesPerAdvert, static_cast<unsigned>(samples[0].payloadLength), readSeconds * 1e3);
+    }
+}
+
+int main()
+{
+    const std::filesystem::path root = std::filesystem::temp_directory_path() /
+        ("lumina-export-test-" + std::to_string(Clock::now().time_since_epoch().count()));
+    std::filesystem::create_directories(root);
+    TestWriterRoundTrip(root);
+    TestExporterSession(root / "session");
+    BenchmarkExport(root / "benchmark");
+    std::filesystem::remove_all(root);
+    return LuminaTest::Finish();
+}
@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "LuminaScanMerger.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    using Sample = Lumina::AdvertisementSample;
+    using Clock = std::chrono::steady_clock;
+
+    Sample MakeSample(uint64_t address, uint8_t type, uint8_t tag, Clock::time_point time, int16_t rssi)
+    {
+        Sample sample;
+        sample.address = address;
+        sample.advertisementType = type;
+        sample.timestamp = time;
+        sample.rssi = rssi;
+        const uint8_t data[] = { static_cast<uint8_t>(address), tag };
+        sample.AppendSection(0xFF, data, sizeof(data));
+        return sample;
+    }
+
+    int CountAdapters(const Sample& sample)
+    {
+        int count = 0;
+        for (int8_t rssi : sample.adapterRssi)
+        {
+            count += rssi != Sample::NoRssi ? 1 : 0;
+        }
+        return count;
+    }
+
+    // Collects the merger's output; the callback runs on the merge thread
+    struct Sink
+    {
+        std::mutex mutex;
+        std::vector<Sample> samples;
+
+        void Attach(LuminaScanMerger& merger)
+        {
+            merger.HandleOnSample([this](const Sample& sample)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                samples.push_back(sample);
+            });
+        }
+
+        size_t Size()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return samples.size();
+        }
+    };
+
+    void WaitForEmitted(LuminaScanMerger& merger, uint64_t count)
+    {
+        auto deadline = Clock::now() + std::chrono::seconds(5);
+        while (merger.GetStats().emitted < count && Clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+
+    void TestSingleLanePassthrough()
+    {
+        LuminaScanMerger merger;
+        Sink sink;
+        sink.Attach(merger);
+        merger.Start(1);
+
+        // Delivered on the pushing thread before Push returns, whatever lane it names
+        merger.Push(3, MakeSample(0xA1, 0, 1, Clock::now(), -200));
+        merger.Push(0, MakeSample(0xA1, 0, 1, Clock::now(), -60));
+        LUMINA_CHECK(sink.Size() == 2);
+        LUMINA_CHECK(sink.samples[0].adapterIndex == 0 && sink.samples[0].adapterRssi[0] == -126);
+        LUMINA_CHECK(sink.samples[1].adapterRssi[0] == -60 && CountAdapters(sink.samples[1]) == 1);
+        merger.Stop();
+
+        LuminaScanMerger::Stats stats = merger.GetStats();
+        LUMINA_CHECK(stats.received == 2 && stats.emitted == 2 && stats.merged == 0);
+    }
+
+    // Every lane sees an overlapping subset of the adverts, with its own clock skew, pushed newest first.
+    // Each address sends an advert and a scan response 1 ms apart, and lane 0 hears one advert twice.
+    void TestFoldAndOrder(int laneCount)
+    {
+        constexpr int AdvertCount = 64;
+        constexpr int RepeatedAdvert = 5;
+        const auto window = std::chrono::milliseconds(200);
+
+        auto isSeen = [laneCount](int advert, int lane) { return lane == advert % laneCount || (advert * 7 + lane * 3) % 4 != 0; };
+        auto laneRssi = [](int advert, int lane) { return static_cast<int16_t>(-40 - (advert + 7 * lane) % 50); };
+        auto advertAddress = [](int advert) { return 0xC00000000000ull + static_cast<uint64_t>(advert / 2); };
+        auto advertType = [](int advert) { return static_cast<uint8_t>(advert % 2 == 0 ? 0 : Sample::ScanResponseType); };
+
+        LuminaScanMerger merger;
+        Sink sink;
+        sink.Attach(merger);
+        merger.Start(laneCount, window);
+
+        const Clock::time_point base = Clock::now();
+        uint64_t pushed = 0;
+        uint64_t expectedFolds = 0;
+        for (int lane = laneCount - 1; lane >= 0; --lane)
+        {
+            const auto skew = std::chrono::milliseconds(lane % 2 == 0 ? 2 : -2);
+            for (int advert = AdvertCount - 1; advert >= 0; --advert)
+            {
+                if (!isSeen(advert, lane))
+                {
+                    continue;
+                }
+                Sample sample = MakeSample(advertAddress(advert), advertType(advert), static_cast<uint8_t>(advert),
+                    base + std::chrono::milliseconds(advert) + skew, laneRssi(advert, lane));
+                merger.Push(lane, sample);
+                ++pushed;
+                if (lane == 0 && advert == RepeatedAdvert)
+                {
+                    merger.Push(lane, sample);  // A retransmission on the same adapter is not a duplicate sighting
+                    ++pushed;
+                }
+            }
+        }
+        for (int advert = 0; advert < AdvertCount; ++advert)
+        {
+            int lanes = 0;
+            for (int lane = 0; lane < laneCount; ++lane)
+            {
+                lanes += isSeen(advert, lane) ? 1 : 0;
+            }
+            expectedFolds += static_cast<uint64_t>(lanes - 1);
+        }
+        const uint64_t expectedEmitted = AdvertCount + 1;
+
+        // Released by the watermark, not by Stop's drain
+        WaitForEmitted(merger, expectedEmitted);
+        LuminaScanMerger::Stats stats = merger.GetStats();
+        merger.Stop();
+
+        LUMINA_CHECK(stats.received == pushed);
+        LUMINA_CHECK(stats.emitted == expectedEmitted);
+        LUMINA_CHECK(stats.merged == expectedFolds);
+        LUMINA_CHECK(sink.samples.size() == expectedEmitted);
+
+        bool isOrdered = true;
+        std::map<int, int> emittedPerAdvert;
+        for (size_t i = 0; i < sink.samples.size(); ++i)
+        {
+            const Sample& sample = sink.samples[i];
+            isOrdered = isOrdered && (i == 0 || sink.samples[i - 1].timestamp <= sample.timestamp);
+
+            const int advert = sample.payload[3];
+            LUMINA_CHECK(advertAddress(advert) == sample.address && advertType(advert) == sample.advertisementType);
+            ++emittedPerAdvert[advert];
+            LUMINA_CHECK(sample.adapterIndex < laneCount && sample.adapterRssi[sample.adapterIndex] != Sample::NoRssi);
+            if (advert == RepeatedAdvert)
+            {
+                continue;
+            }
+
+            // One sample per advert, carrying every lane that heard it and the strongest RSSI
+            int16_t strongest = -127;
+            for (int lane = 0; lane < laneCount; ++lane)
+            {
+                const int8_t expected = isSeen(advert, lane) ? static_cast<int8_t>(laneRssi(advert, lane)) : Sample::NoRssi;
+                LUMINA_CHECK(sample.adapterRssi[lane] == expected);
+                strongest = isSeen(advert, lane) ? std::max(strongest, laneRssi(advert, lane)) : strongest;
+            }
+            LUMINA_CHECK(sample.rssi == strongest);
+        }
+        LUMINA_CHECK(isOrdered);
+        LUMINA_CHECK(emittedPerAdvert.size() == AdvertCount && emittedPerAdvert[RepeatedAdvert] == 2);
+        std::printf("fold and order, %d lanes: %llu pushed, %llu folded, %llu emitted in timestamp order\n", laneCount,
+            static_cast<unsigned long long>(stats.received), static_cast<unsigned long long>(stats.merged),
+            static_cast<unsigned long long>(stats.emitted));
+    }
+
+    // Simulated adapters that each hear any given advert with the same probability, paced at an advertising
+    // interval longer than the reorder window. More lanes should discover the population in fewer rounds.
+    struct DiscoveryRun
+    {
+        double firstRoundShare = 0.0;
+        double meanRounds = 0.0;
+        double foldShare = 0.0;
+    };
+
+    DiscoveryRun RunDiscovery(int laneCount)
+    {
+        constexpr int DeviceCount = 500;
+        constexpr int Rounds = 24;
+        constexpr double HearProbability = 0.3;
+        const auto interval = std::chrono::milliseconds(25);
+
+        LuminaScanMerger merger;
+        std::vector<int> firstRound(DeviceCount, -1);
+        merger.HandleOnSample([&firstRound](const Sample& sample)
+        {
+            int& first = firstRound[sample.address - 0xD00000000000ull];
+            first = first < 0 ? sample.payload[3] : first;
+        });
+        merger.Start(laneCount);
+
+        std::mt19937 random(static_cast<unsigned>(29 + laneCount));
+        std::bernoulli_distribution hears(HearProbability);
+        uint64_t expectedFolds = 0;
+        auto roundStart = Clock::now();
+        for (int round = 0; round < Rounds; ++round)
+        {
+            for (int device = 0; device < DeviceCount; ++device)
+            {
+                const Clock::time_point now = Clock::now();
+                int lanes = 0;
+                for (int lane = 0; lane < laneCount; ++lane)
+                {
+                    if (hears(random))
+                    {
+                        merger.Push(lane, MakeSample(0xD00000000000ull + static_cast<uint64_t>(device), 0,
+                            static_cast<uint8_t>(round), now, static_cast<int16_t>(-50 - lane)));
+                        ++lanes;
+                    }
+                }
+                expectedFolds += lanes > 1 ? static_cast<uint64_t>(lanes - 1) : 0;
+            }
+            roundStart += interval;
+            std::this_thread::sleep_until(roundStart);
+        }
+        merger.Stop();
+
+        DiscoveryRun run;
+        double totalRounds = 0.0;
+        for (int first : firstRound)
+        {
+            run.firstRoundShare += first == 0 ? 1.0 : 0.0;
+            totalRounds += first >= 0 ? first + 1 : Rounds + 1;
+        }
+        run.firstRoundShare /= DeviceCount;
+        run.meanRounds = totalRounds / DeviceCount;
+        LuminaScanMerger::Stats stats = merger.GetStats();
+        LUMINA_CHECK(stats.received == stats.emitted + stats.merged);
+        run.foldShare = expectedFolds == 0 ? 1.0 : static_cast<double>(stats.merged) / static_cast<double>(expectedFolds);
+        return run;
+    }
+
+    void BenchmarkDiscovery()
+    {
+        double previousShare = -1.0;
+        for (int laneCount : { 1, 2, 4 })
+        {
+            DiscoveryRun run = RunDiscovery(laneCount);
+            std::printf("discovery, %d lane(s): %.1f%% of devices in the first round, %.2f rounds on average, %.1f%% of duplicate sightings folded\n",
+                laneCount, 100.0 * run.firstRoundShare, run.meanRounds, 100.0 * run.foldShare);
+            LUMINA_CHECK(run.firstRoundShare > previousShare);
+            // Sightings of one advert arrive microseconds apart; only a producer stalled past the window splits one
+            LUMINA_CHECK(run.foldShare >= 0.99);
+            previousShare = run.firstRoundShare;
+        }
+    }
+
+    // One producer thread per lane pushing as fast as it can; every lane hears the same devices
+    void BenchmarkThroughput()
+    {
+        constexpr int PerLane = 200000;
+        constexpr int DeviceCount = 5000;
+        for (int laneCount : { 1, 2, 4 })
+        {
+            LuminaScanMerger merger;
+            std::atomic<uint64_t> emitted = 0;
+            merger.HandleOnSample([&emitted](const Sample&) { ++emitted; });
+            merger.Start(laneCount);
+
+            auto start = Clock::now();
+            std::vector<std::thread> producers;
+            for (int lane = 0; lane < laneCount; ++lane)
+            {
+                producers.emplace_back([&merger, lane]()
+                {
+                    for (int i = 0; i < PerLane; ++i)
+                    {
+                        merger.Push(lane, MakeSample(0xE00000000000ull + static_cast<uint64_t>(i % DeviceCount), 0,
+                            static_cast<uint8_t>(i / DeviceCount), Clock::now(), -60));
+                    }
+                });
+            }
+            for (std::thread& producer : producers)
+            {
+                producer.join();
+            }
+            merger.Stop();
+            double seconds = LuminaTest::SecondsSince(start);
+
+            LuminaScanMerger::Stats stats = merger.GetStats();
+            LUMINA_CHECK(stats.received == static_cast<uint64_t>(PerLane) * static_cast<uint64_t>(laneCount));
+            LUMINA_CHECK(stats.emitted == emitted && stats.received == stats.emitted + stats.merged);
+            std::printf("throughput, %d lane(s): %.2f M sightings/s in, %llu out, %llu folded\n", laneCount,
+                static_cast<double>(stats.received) / seconds / 1e6, static_cast<unsigned long long>(stats.emitted),
+                static_cast<unsigned long long>(stats.merged));
+        }
+    }
+}
+
+int main()
+{
+    TestSingleLanePassthrough();
+    TestFoldAndOrder(2);
+    TestFoldAndOrder(4);
+    BenchmarkDiscovery();
+    BenchmarkThroughput();
+    return LuminaTest::Finish();
+}
@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+#include "LuminaScanProfile.h"
+#include "LuminaAdvertCoalescer.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using Sample = Lumina::AdvertisementSample;
+    using namespace std::chrono_literals;
+
+    void TestLookupAndHistogram()
+    {
+        for (size_t i = 0; i < Lumina::ScanProfileCount; ++i)
+        {
+            const Lumina::ScanProfile& profile = Lumina::GetScanProfile(static_cast<Lumina::ScanProfileId>(i));
+            LUMINA_CHECK(Lumina::FindScanProfile(profile.name) == &profile);
+            LUMINA_CHECK(profile.inRangeDbm == Lumina::ScanProfile::NoThreshold || profile.outOfRangeDbm < profile.inRangeDbm);
+        }
+        LUMINA_CHECK(!Lumina::FindScanProfile("long-range") && !Lumina::FindScanProfile(""));
+
+        Lumina::DiscoveryHistogram histogram;
+        LUMINA_CHECK(histogram.GetPercentileMs(0.5) == 0.0);
+        for (int ms : { 10, 20, 30, 60, 400, 700, 40000 })
+        {
+            histogram.Record(std::chrono::milliseconds(ms));
+        }
+        LUMINA_CHECK(histogram.GetCount() == 7 && histogram.GetBucket(0) == 2 && histogram.GetBucket(1) == 1);
+        LUMINA_CHECK(histogram.GetPercentileMs(0.5) == 100.0 && histogram.GetPercentileMs(1.0) == 40000.0);
+        LUMINA_CHECK(histogram.GetMaxMs() == 40000.0);
+    }
+
+    // One transmitted advert of the synthetic trace
+    struct Advert
+    {
+        uint32_t device;
+        Clock::duration time;
+        int16_t rssi;
+    };
+
+    struct Device
+    {
+        uint64_t address;
+        bool isNameInScanResponse;
+        Sample advert;
+        Sample scanResponse;
+    };
+
+    struct Trace
+    {
+        std::vector<Device> devices;
+        std::vector<Advert> adverts;    // In time order
+    };
+
+    // Devices at all distances, a third of them walking closer over the run; half keep their name in the scan response
+    Trace MakeTrace(uint32_t deviceCount, Clock::duration length)
+    {
+        std::mt19937 random(41);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        std::normal_distribution<double> noise(0.0, 4.0);
+        Trace trace;
+        for (uint32_t i = 0; i < deviceCount; ++i)
+        {
+            Device device;
+            device.address = 0xC00000000000ull + i;
+            device.isNameInScanResponse = i % 2 == 1;
+            const std::string name = "Device " + std::to_string(i);
+            const uint8_t flags = 0x06;
+            const uint16_t service = 0x180F;
+            device.advert.address = device.address;
+            device.advert.AppendSection(0x01, &flags, 1);
+            device.advert.AppendSection(0x03, reinterpret_cast<const uint8_t*>(&service), 2);
+            device.scanResponse.address = device.address;
+            device.scanResponse.advertisementType = Sample::ScanResponseType;
+            (device.isNameInScanResponse ? device.scanResponse : device.advert).AppendSection(0x09,
+                reinterpret_cast<const uint8_t*>(name.data()), name.size());
+            trace.devices.push_back(device);
+
+            const double baseRssi = -100.0 + 60.0 * unit(random);
+            const double approach = i % 3 == 0 ? 25.0 : 0.0;
+            const auto interval = std::chrono::duration_cast<Clock::duration>(100ms + 900ms * unit(random));
+            for (Clock::duration time = std::chrono::duration_cast<Clock::duration>(interval * unit(random)); time < length; time += interval)
+            {
+                double progress = std::chrono::duration<double>(time) / std::chrono::duration<double>(length);
+                double rssi = std::clamp(baseRssi + approach * progress + noise(random), -127.0, -20.0);
+                trace.adverts.push_back({ i, time, static_cast<int16_t>(rssi) });
+            }
+        }
+        std::sort(trace.adverts.begin(), trace.adverts.end(), [](const Advert& a, const Advert& b) { return a.time < b.time; });
+        return trace;
+    }
+
+    // How a platform applies a profile to what the radio hears
+    enum class Platform
+    {
+        Watcher,    // Windows: scanning mode, and in/out-of-range thresholds with a timeout
+        Bluez       // Linux: SetDiscoveryFilter's RSSI only; discovery always scans actively
+    };
+
+    struct ReplayResult
+    {
+        uint64_t delivered = 0;
+        uint32_t discovered = 0;
+        uint32_t named = 0;
+        Lumina::DiscoveryHistogram timeToDiscovery;
+        double nsPerSample = 0.0;
+    };
+
+    ReplayResult Replay(const Trace& trace, const Lumina::ScanProfile& profile, Platform platform)
+    {
+        struct State
+        {
+            bool isInRange = false;
+            std::optional<Clock::duration> firstAdvert;
+            std::optional<Clock::duration> belowSince;
+            bool isDiscovered = false;
+        };
+        std::vector<State> states(trace.devices.size());
+        const bool isActive = profile.isActive || platform == Platform::Bluez;
+        const bool hasThreshold = profile.inRangeDbm != Lumina::ScanProfile::NoThreshold;
+
+        // Which samples the platform hands over; then their ingest cost through the coalescer, timed apart
+        std::vector<Sample> delivered;
+        ReplayResult result;
+        for (const Advert& advert : trace.adverts)
+        {
+            State& state = states[advert.device];
+            state.firstAdvert = state.firstAdvert.value_or(advert.time);
+
+            bool isReported = !hasThreshold;
+            if (hasThreshold && platform == Platform::Bluez)
+            {
+                isReported = advert.rssi >= profile.inRangeDbm;
+            }
+            else if (hasThreshold)
+            {
+                if (!state.isInRange && advert.rssi >= profile.inRangeDbm)
+                {
+                    state.isInRange = true;
+                    state.belowSince.reset();
+                }
+                if (state.isInRange && advert.rssi < profile.outOfRangeDbm)
+                {
+                    state.belowSince = state.belowSince.value_or(advert.time);
+                    state.isInRange = advert.time - *state.belowSince < profile.outOfRangeTimeout;
+                }
+                else if (state.isInRange)
+                {
+                    state.belowSince.reset();
+                }
+                isReported = state.isInRange;
+            }
+            if (!isReported)
+            {
+                continue;
+            }
+
+            const Device& device = trace.devices[advert.device];
+            if (!state.isDiscovered)
+            {
+                state.isDiscovered = true;
+                ++result.discovered;
+                result.timeToDiscovery.Record(advert.time - *state.firstAdvert);
+            }
+            delivered.push_back(device.advert);
+            delivered.back().rssi = advert.rssi;
+            if (isActive)
+            {
+                delivered.push_back(device.scanResponse);
+                delivered.back().rssi = advert.rssi;
+            }
+        }
+
+        LuminaAdvertCoalescer coalescer;
+        auto start = Clock::now();
+        for (const Sample& sample : delivered)
+        {
+            LuminaAdvertCoalescer::MergeResult merge = coalescer.Merge(sample);
+            if (merge.isNew && !merge.record->name.empty())
+            {
+                ++result.named;
+            }
+            else if (merge.record && (merge.changed & LuminaAdvertCoalescer::ChangeName) && !merge.record->name.empty())
+            {
+                ++result.named;
+            }
+        }
+        result.nsPerSample = delivered.empty() ? 0.0 : LuminaTest::SecondsSince(start) * 1e9 / static_cast<double>(delivered.size());
+        result.delivered = delivered.size();
+        return result;
+    }
+
+    // The same trace through every profile, as the Windows watcher applies it and as the BlueZ discovery filter does
+    void BenchmarkProfiles()
+    {
+        constexpr uint32_t DeviceCount = 1500;
+        const Trace trace = MakeTrace(DeviceCount, 20s);
+        std::printf("scan profiles: %u devices, %zu adverts over 20 s\n", DeviceCount, trace.adverts.size());
+        std::printf("  %-13s %-7s %9s %10s %8s %8s %7s %9s\n", "profile", "on", "samples", "discovered", "p50 ms", "p95 ms", "named", "ns/sample");
+
+        for (size_t i = 0; i < Lumina::ScanProfileCount; ++i)
+        {
+            const Lumina::ScanProfile& profile = Lumina::GetScanProfile(static_cast<Lumina::ScanProfileId>(i));
+            ReplayResult watcher = Replay(trace, profile, Platform::Watcher);
+            ReplayResult bluez = Replay(trace, profile, Platform::Bluez);
+            for (const auto& [platform, result] : { std::pair{ "watcher", &watcher }, std::pair{ "bluez", &bluez } })
+            {
+                std::printf("  %-13s %-7s %9llu %10u %8.0f %8.0f %6.0f%% %9.1f\n", profile.name, platform,
+                    static_cast<unsigned long long>(result->delivered), result->discovered,
+                    result->timeToDiscovery.GetPercentileMs(0.5), result->timeToDiscovery.GetPercentileMs(0.95),
+                    result->discovered ? 100.0 * result->named / result->discovered : 0.0, result->nsPerSample);
+            }
+
+            // Every device is in the trace long enough to be heard without a threshold
+            const bool hasThreshold = profile.inRangeDbm != Lumina::ScanProfile::NoThreshold;
+            LUMINA_CHECK(hasThreshold ? watcher.discovered < DeviceCount : watcher.discovered == DeviceCount);
+            // Passive scans miss the scan responses, and with them the names kept there
+            LUMINA_CHECK(profile.isActive ? watcher.named == watcher.discovered : watcher.named < watcher.discovered);
+            // BlueZ scans actively whatever the profile, and its RSSI filter admits the same devices on first sight
+            LUMINA_CHECK(bluez.named == bluez.discovered && bluez.discovered == watcher.discovered);
+            LUMINA_CHECK(!profile.isActive || bluez.delivered <= watcher.delivered);
+        }
+    }
+}
+
+int main()
+{
+    TestLookupAndHistogram();
+    BenchmarkProfiles();
+    return LuminaTest::Finish();
+}
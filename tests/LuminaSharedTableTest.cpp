@@ -0,0 +1,166 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "LuminaSharedTable.h"
+#include "LuminaSharedTableReader.h"
+#include "LuminaTest.h"
+
+using namespace Lumina::SharedTable;
+
+namespace
+{
+    // Every field of a row is derived from one counter, so a reader can tell a torn row from a whole one
+    Row MakeRow(uint64_t address, int64_t counter)
+    {
+        Row row;
+        row.address = address;
+        row.lastSeenUnixMs = counter;
+        row.rssi = static_cast<int16_t>(counter & 0x7FFF);
+        row.flags = static_cast<uint8_t>(counter & FlagConnectable);
+        std::memset(row.name, 'a' + static_cast<int>(counter % 26), NameSize - 1);
+        return row;
+    }
+
+    bool IsConsistent(const Row& row)
+    {
+        if (row.rssi != static_cast<int16_t>(row.lastSeenUnixMs & 0x7FFF) ||
+            row.flags != static_cast<uint8_t>(row.lastSeenUnixMs & FlagConnectable))
+        {
+            return false;
+        }
+        const char expected = static_cast<char>('a' + static_cast<int>(row.lastSeenUnixMs % 26));
+        for (size_t i = 0; i + 1 < NameSize; ++i)
+        {
+            if (row.name[i] != expected)
+            {
+                return false;
+            }
+        }
+        return row.name[NameSize - 1] == '\0';
+    }
+
+    std::string TableName()
+    {
+        return "lumina-test-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+
+    void TestPublishAndClear()
+    {
+        const std::string name = TableName();
+        std::string error;
+        LuminaSharedTableWriter writer;
+        LUMINA_CHECK(writer.Open(name, error));
+
+        LuminaSharedTableReader reader;
+        LUMINA_CHECK(reader.Open(name, error));
+        LUMINA_CHECK(reader.IsOpen());
+        const uint64_t generation = reader.GetGeneration();
+
+        writer.Publish(MakeRow(1, 10));
+        writer.Publish(MakeRow(2, 20));
+        writer.Publish(MakeRow(1, 30)); // Same address updates its row in place
+        LUMINA_CHECK(reader.GetRowCount() == 2);
+
+        Row row;
+        LUMINA_CHECK(reader.ReadRow(0, row) && row.address == 1 && row.lastSeenUnixMs == 30);
+        LUMINA_CHECK(!reader.ReadRow(2, row));
+
+        writer.Clear();
+        LUMINA_CHECK(reader.GetRowCount() == 0);
+        LUMINA_CHECK(reader.GetGeneration() == generation + 1);
+
+        // A full table reuses the least recently seen row
+        for (uint32_t i = 0; i < Capacity; ++i)
+        {
+            writer.Publish(MakeRow(100 + i, 1000 + i));
+        }
+        writer.Publish(MakeRow(5000, 9000));
+        LUMINA_CHECK(reader.GetRowCount() == Capacity);
+        LUMINA_CHECK(reader.ReadRow(0, row) && row.address == 5000);
+
+        writer.Close();
+        LUMINA_CHECK(!reader.IsOpen());
+    }
+
+    // Readers validate every row while the writer keeps rewriting them; none may see a torn row
+    void TestConcurrentReaders()
+    {
+        constexpr int ReaderCount = 4;
+        constexpr uint32_t RowCount = 256;
+        constexpr auto Duration = std::chrono::milliseconds(500);
+
+        const std::string name = TableName();
+        std::string error;
+        LuminaSharedTableWriter writer;
+        LUMINA_CHECK(writer.Open(name, error));
+        for (uint32_t i = 0; i < RowCount; ++i)
+        {
+            writer.Publish(MakeRow(i, i));
+        }
+
+        std::atomic<bool> isDone = false;
+        std::atomic<uint64_t> rowsRead = 0;
+        std::atomic<uint64_t> rowsTorn = 0;
+        std::vector<std::thread> readers;
+        for (int r = 0; r < ReaderCount; ++r)
+        {
+            readers.emplace_back([&]()
+            {
+                // Own mapping per reader, as another process would have
+                LuminaSharedTableReader reader;
+                std::string readerError;
+                if (!reader.Open(name, readerError))
+                {
+                    rowsTorn.fetch_add(1);
+                    return;
+                }
+                std::vector<Row> rows;
+                uint64_t read = 0;
+                uint64_t torn = 0;
+                while (!isDone.load(std::memory_order_relaxed))
+                {
+                    reader.ReadAll(rows);
+                    for (const Row& row : rows)
+                    {
+                        torn += IsConsistent(row) ? 0 : 1;
+                    }
+                    read += rows.size();
+                }
+                rowsRead.fetch_add(read);
+                rowsTorn.fetch_add(torn);
+            });
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        int64_t counter = RowCount;
+        while (std::chrono::steady_clock::now() - start < Duration)
+        {
+            for (int i = 0; i < 1000; ++i, ++counter)
+            {
+                writer.Publish(MakeRow(static_cast<uint64_t>(counter % RowCount), counter));
+            }
+        }
+        const double seconds = LuminaTest::SecondsSince(start);
+        isDone = true;
+        for (std::thread& reader : readers)
+        {
+            reader.join();
+        }
+
+        std::printf("shared table: %.1fM publishes/s with %d readers, %.1fM rows/s read, %llu torn\n",
+            static_cast<double>(counter - RowCount) / seconds / 1e6, ReaderCount,
+            static_cast<double>(rowsRead.load()) / seconds / 1e6, static_cast<unsigned long long>(rowsTorn.load()));
+        LUMINA_CHECK(rowsRead.load() > 0);
+        LUMINA_CHECK(rowsTorn.load() == 0);
+    }
+}
+
+int main()
+{
+    TestPublishAndClear();
+    TestConcurrentReaders();
+    return LuminaTest::Finish();
+}
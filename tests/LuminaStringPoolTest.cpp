@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "LuminaStringPool.h"
+#include "LuminaDevice.h"
+#include "LuminaHelper.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    using Device = Lumina::BluetoothDevice;
+
+    std::string LowerAddress(uint64_t address)
+    {
+        std::string text = LuminaHelper::BluetoothAddressToString(address);
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return text;
+    }
+
+    void TestIntern()
+    {
+        LuminaStringPool& pool = LuminaStringPool::Get();
+        LUMINA_CHECK(pool.Intern("") == LuminaStringPool::EmptyId && pool.Lookup(LuminaStringPool::EmptyId).empty());
+
+        const size_t countBefore = pool.GetCount();
+        LuminaStringPool::Id first = pool.Intern("Heart Rate Sensor");
+        std::string copy = "Heart Rate Sensor";
+        LUMINA_CHECK(pool.Intern(copy) == first && pool.GetCount() == countBefore + 1);
+        LUMINA_CHECK(pool.Lookup(first) == "Heart Rate Sensor");
+        LUMINA_CHECK(pool.Intern("Heart Rate Sensor ") != first);
+        LUMINA_CHECK(pool.Lookup(0xFFFFFFF0u).empty()); // Unknown IDs read as empty
+
+        // References stay put while the pool grows
+        const std::string& reference = pool.Lookup(first);
+        for (int i = 0; i < 10000; ++i)
+        {
+            pool.Intern("growth " + std::to_string(i));
+        }
+        LUMINA_CHECK(&reference == &pool.Lookup(first) && reference == "Heart Rate Sensor");
+
+        // Threads racing on the same strings agree on their IDs
+        constexpr int ThreadCount = 4;
+        constexpr int Strings = 5000;
+        std::vector<std::vector<LuminaStringPool::Id>> ids(ThreadCount, std::vector<LuminaStringPool::Id>(Strings));
+        std::vector<std::thread> threads;
+        for (int t = 0; t < ThreadCount; ++t)
+        {
+            threads.emplace_back([&ids, t]()
+            {
+                for (int i = 0; i < Strings; ++i)
+                {
+                    int index = (i + t * 1237) % Strings; // Each thread starts elsewhere, so they collide on new strings
+                    ids[t][index] = LuminaStringPool::Get().Intern("race " + std::to_string(index));
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        bool isConsistent = true;
+        for (int i = 0; i < Strings; ++i)
+        {
+            for (int t = 1; t < ThreadCount; ++t)
+            {
+                isConsistent = isConsistent && ids[t][i] == ids[0][i];
+            }
+            isConsistent = isConsistent && pool.Lookup(ids[0][i]) == "race " + std::to_string(i);
+        }
+        LUMINA_CHECK(isConsistent);
+    }
+
+    // Platform IDs come back exactly, whether or not they end in the device's own address
+    void TestDeviceIds()
+    {
+        const uint64_t address = 0xAABBCCDDEEFFull;
+        const std::string adapterPrefix = "BluetoothLE#BluetoothLE00:1a:7d:da:71:13-";
+        const std::vector<std::string> ids = {
+            adapterPrefix + LowerAddress(address),                  // Windows
+            "bluez-" + LowerAddress(address),                       // Linux
+            adapterPrefix + LuminaHelper::BluetoothAddressToString(address), // Upper case: the address parses but is spelled differently
+            "SWD\\MMDEVAPI\\{0.0.0.00000000}.{4f4e9a2e-9e28-4a36}",  // Not an address at all
+            "short",
+        };
+        for (const std::string& id : ids)
+        {
+            Device device;
+            device.SetConnected(true);
+            device.SetDeviceId(id);
+            LUMINA_CHECK(device.GetDeviceId() == id);
+            LUMINA_CHECK(device.address == LuminaHelper::DeviceIdToAddress(id));
+            LUMINA_CHECK(device.IsConnected()); // Other flags survive
+        }
+
+        // IDs that end in their address share one prefix string; the rest are kept whole
+        Device a;
+        Device b;
+        a.SetDeviceId(adapterPrefix + LowerAddress(0x112233445566ull));
+        b.SetDeviceId(adapterPrefix + LowerAddress(0x665544332211ull));
+        LUMINA_CHECK(a.deviceIdPrefixId == b.deviceIdPrefixId && !(a.flags & Device::FlagOpaqueDeviceId));
+        LUMINA_CHECK(a.address == 0x112233445566ull && a.GetAddressString() == "11:22:33:44:55:66");
+
+        // Re-targeting an opaque device at an exact ID clears the opaque flag again
+        Device c;
+        c.SetDeviceId(ids[3]);
+        LUMINA_CHECK((c.flags & Device::FlagOpaqueDeviceId) != 0);
+        c.SetDeviceId(ids[0]);
+        LUMINA_CHECK(!(c.flags & Device::FlagOpaqueDeviceId) && c.GetDeviceId() == ids[0]);
+    }
+
+    // What a std::string costs on its own: the object, plus its heap buffer past the small-string capacity
+    size_t StringBytes(const std::string& value)
+    {
+        return sizeof(std::string) + (value.size() > 15 ? value.size() + 1 : 0);
+    }
+
+    // 100k devices as a long scan in a busy place meets them: a few common product names, many unique names,
+    // many unnamed, and IDs mostly in the address-suffixed form of two adapters
+    void BenchmarkPopulation()
+    {
+        constexpr size_t Count = 100000;
+        const std::vector<std::string> products = { "Mi Band", "Galaxy Buds", "AirPods", "Tile", "JBL Flip 5", "Fitbit Charge",
+            "LE-Bose QC35", "Polar H10", "[TV] Samsung 7 Series", "Govee_H5075" };
+        const std::vector<std::string> prefixes = { "BluetoothLE#BluetoothLE00:1a:7d:da:71:13-", "BluetoothLE#BluetoothLE5c:f3:70:8a:11:02-" };
+
+        std::vector<std::string> names;
+        std::vector<std::string> ids;
+        for (size_t i = 0; i < Count; ++i)
+        {
+            uint64_t address = 0xC00000000000ull + i * 7717;
+            switch (i % 10)
+            {
+            case 0: case 1: case 2: case 3: names.push_back(products[i % products.size()]); break;
+            case 4: case 5: names.push_back("Sensor " + std::to_string(i)); break;
+            case 6: names.push_back("Long unique device name #" + std::to_string(i)); break;
+            default: names.push_back(std::string()); break;
+            }
+            if (i % 20 == 0)
+            {
+                ids.push_back("BTHENUM\\{0000110b}_VID&0001000f_PID&1200\\7&" + std::to_string(i)); // Opaque
+            }
+            else if (i % 5 == 0)
+            {
+                ids.push_back("bluez-" + LowerAddress(address));
+            }
+            else
+            {
+                ids.push_back(prefixes[i % prefixes.size()] + LowerAddress(address));
+            }
+        }
+
+        LuminaStringPool& pool = LuminaStringPool::Get();
+        const size_t bytesBefore = pool.GetBytes();
+        const size_t countBefore = pool.GetCount();
+        std::vector<Device> devices(Count);
+        for (size_t i = 0; i < Count; ++i)
+        {
+            devices[i].SetName(names[i]);
+            devices[i].SetDeviceId(ids[i]);
+        }
+        const size_t poolBytes = pool.GetBytes() - bytesBefore;
+        const size_t poolStrings = pool.GetCount() - countBefore;
+
+        bool isEveryDeviceBack = true;
+        size_t opaque = 0;
+        for (size_t i = 0; i < Count; ++i)
+        {
+            isEveryDeviceBack = isEveryDeviceBack && devices[i].GetName() == names[i] && devices[i].GetDeviceId() == ids[i];
+            opaque += (devices[i].flags & Device::FlagOpaqueDeviceId) ? 1 : 0;
+        }
+        LUMINA_CHECK(isEveryDeviceBack);
+        LUMINA_CHECK(opaque == Count / 20);
+
+        // The same devices holding their strings themselves
+        size_t ownedBytes = 0;
+        for (size_t i = 0; i < Count; ++i)
+        {
+            ownedBytes += sizeof(uint64_t) + 4 + StringBytes(names[i]) + StringBytes(ids[i]);
+        }
+        const double pooled = static_cast<double>(sizeof(Device) * Count + poolBytes) / Count;
+        const double owned = static_cast<double>(ownedBytes) / Count;
+        std::printf("string pool: %zu devices, %zu distinct strings added (%.1f MB, %.0f bytes each)\n",
+            Count, poolStrings, poolBytes / 1e6, static_cast<double>(poolBytes) / static_cast<double>(poolStrings));
+        std::printf("string pool: %.1f bytes per device pooled (%zu-byte record + pool share) vs %.1f with owned strings\n",
+            pooled, sizeof(Device), owned);
+        LUMINA_CHECK(pooled < owned);
+        // Common names and the shared ID prefixes cost nothing per device
+        LUMINA_CHECK(poolStrings <= Count * 3 / 10 + Count / 20 + 10);
+    }
+}
+
+int main()
+{
+    TestIntern();
+    TestDeviceIds();
+    BenchmarkPopulation();
+    return LuminaTest::Finish();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// Shared by the test executables. Checks report and count failures instead of aborting, so one run shows
+// every broken expectation; Finish turns the count into the exit code CTest looks at.
+namespace LuminaTest
+{
+    inline int& FailureCount()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    inline int Finish()
+    {
+        if (FailureCount() != 0)
+        {
+            std::fprintf(stderr, "%d check(s) failed\n", FailureCount());
+            return 1;
+        }
+        std::printf("all checks passed\n");
+        return 0;
+    }
+
+    inline double SecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Nearest-rank percentile, p in [0, 1]. Sorts values.
+    inline double Percentile(std::vector<double>& values, double p)
+    {
+        if (values.empty())
+        {
+            return 0.0;
+        }
+        std::sort(values.begin(), values.end());
+        size_t index = static_cast<size_t>(p * static_cast<double>(values.size() - 1) + 0.5);
+        return values[std::min(index, values.size() - 1)];
+    }
+}
+
+#define LUMINA_CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++LuminaTest::FailureCount(); \
+        } \
+    } while (false)
@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include "LuminaWorkerPool.h"
+#include "LuminaTest.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using Priority = LuminaWorkerPool::Priority;
+
+    LuminaWorkerPool::Options Threads(int count)
+    {
+        LuminaWorkerPool::Options options;
+        options.threadCount = count;
+        return options;
+    }
+
+    // Holds every worker inside a task until Release, so whatever is submitted meanwhile queues up
+    class Gate
+    {
+    public:
+        void Block(LuminaWorkerPool& pool)
+        {
+            for (int i = 0; i < pool.GetThreadCount(); ++i)
+            {
+                pool.Submit([this]()
+                {
+                    ++m_Entered;
+                    while (!m_IsOpen)
+                    {
+                        std::this_thread::sleep_for(std::chrono::microseconds(100));
+                    }
+                }, Priority::High);
+            }
+            while (m_Entered < pool.GetThreadCount())
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+
+        void Release() { m_IsOpen = true; }
+
+    private:
+        std::atomic<int> m_Entered = 0;
+        std::atomic<bool> m_IsOpen = false;
+    };
+
+    // Burns roughly the same CPU time on every call; the result keeps it from being optimized away
+    uint64_t Work(uint64_t seed, int rounds)
+    {
+        uint64_t value = seed | 1;
+        for (int i = 0; i < rounds; ++i)
+        {
+            value ^= value << 13;
+            value ^= value >> 7;
+            value ^= value << 17;
+        }
+        return value;
+    }
+
+    // One worker: priorities strictly in order, and within one priority the newest task first
+    void TestPriorityOrderSingleWorker()
+    {
+        LuminaWorkerPool pool(Threads(1));
+        Gate gate;
+        gate.Block(pool);
+
+        std::vector<int> order;
+        const Priority priorities[] = { Priority::Background, Priority::Normal, Priority::High };
+        for (int i = 0; i < 9; ++i)
+        {
+            pool.Submit([&order, i]() { order.push_back(i); }, priorities[i % 3]);
+        }
+        gate.Release();
+        pool.WaitIdle();
+
+        const std::vector<int> expected = { 8, 5, 2, 7, 4, 1, 6, 3, 0 };
+        LUMINA_CHECK(order == expected);
+    }
+
+    // Several workers: no background task starts while a high one is still queued. A worker may have taken a
+    // high task without having started it yet, so up to threadCount - 1 can still be pending.
+    void TestPriorityOrderPoolWide()
+    {
+        constexpr int TaskCount = 200;
+        const int threadCount = 4;
+        LuminaWorkerPool pool(Threads(threadCount));
+        Gate gate;
+        gate.Block(pool);
+
+        std::atomic<int> highStarted = 0;
+        std::atomic<int> earlyBackground = 0;
+        for (int i = 0; i < TaskCount; ++i)
+        {
+            pool.Submit([&]()
+            {
+                if (highStarted < TaskCount - (threadCount - 1))
+                {
+                    ++earlyBackground;
+                }
+                Work(1, 2000);
+            }, Priority::Background);
+            pool.Submit([&]() { ++highStarted; Work(2, 2000); }, Priority::High);
+        }
+        gate.Release();
+        pool.WaitIdle();
+        LUMINA_CHECK(highStarted == TaskCount);
+        LUMINA_CHECK(earlyBackground == 0);
+    }
+
+    // All tasks submitted from inside one worker land on its own deque; while it waits for them, only the
+    // other workers can run them, so every one is stolen
+    void TestStealing()
+    {
+        constexpr int ChildCount = 2000;
+        const int threadCount = std::max(4, static_cast<int>(std::thread::hardware_concurrency()));
+        LuminaWorkerPool pool(Threads(threadCount));
+
+        std::atomic<int> done = 0;
+        std::mutex threadsMutex;
+        std::set<std::thread::id> childThreads;
+        std::thread::id parentThread;
+        pool.Submit([&]()
+        {
+            parentThread = std::this_thread::get_id();
+            for (int i = 0; i < ChildCount; ++i)
+            {
+                pool.Submit([&, i]()
+                {
+                    Work(static_cast<uint64_t>(i), 500);
+                    {
+                        std::lock_guard<std::mutex> lock(threadsMutex);
+                        childThreads.insert(std::this_thread::get_id());
+                    }
+                    ++done;
+                });
+            }
+            while (done < ChildCount)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        });
+        pool.WaitIdle();
+
+        LuminaWorkerPool::Stats stats = pool.GetStats();
+        LUMINA_CHECK(done == ChildCount);
+        LUMINA_CHECK(stats.executed == ChildCount + 1);
+        LUMINA_CHECK(stats.stolen >= ChildCount);
+        LUMINA_CHECK(childThreads.count(parentThread) == 0 && !childThreads.empty());
+        std::printf("stealing: %d tasks queued on one worker, %llu stolen by %zu of the other %d workers\n", ChildCount,
+            static_cast<unsigned long long>(stats.stolen), childThreads.size(), threadCount - 1);
+    }
+
+    // The sleep/wake handshake: a lost wakeup leaves a task queued with every worker asleep, and WaitIdle hangs.
+    // A watchdog turns a hang into a failure.
+    void TestWakeups()
+    {
+        std::atomic<bool> isDone = false;
+        std::atomic<uint64_t> progress = 0;
+        std::thread watchdog([&]()
+        {
+            uint64_t seen = progress;
+            auto lastChange = Clock::now();
+            while (!isDone)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                if (progress != seen)
+                {
+                    seen = progress;
+                    lastChange = Clock::now();
+                }
+                else if (Clock::now() - lastChange > std::chrono::seconds(20))
+                {
+                    std::fprintf(stderr, "worker pool stalled at step %llu: lost wakeup\n", static_cast<unsigned long long>(seen));
+                    std::_Exit(1);
+                }
+            }
+        });
+
+        const int threadCount = std::max(4, static_cast<int>(std::thread::hardware_concurrency()));
+        LuminaWorkerPool pool(Threads(threadCount));
+
+        // Idle pool woken by a single task, over and over
+        constexpr int Rounds = 20000;
+        std::atomic<int> ran = 0;
+        for (int round = 0; round < Rounds; ++round)
+        {
+            pool.Submit([&ran]() { ++ran; });
+            pool.WaitIdle();
+            ++progress;
+        }
+        LUMINA_CHECK(ran == Rounds);
+
+        // A chain where each task submits the next from its worker just before finishing: WaitIdle must not
+        // return while the next link is queued
+        constexpr int ChainLength = 20000;
+        std::atomic<int> links = 0;
+        std::function<void()> link = [&]()
+        {
+            ++progress;
+            if (++links < ChainLength)
+            {
+                pool.Submit(link);
+            }
+        };
+        for (int round = 0; round < 10; ++round)
+        {
+            links = 0;
+            pool.Submit(link);
+            pool.WaitIdle();
+            LUMINA_CHECK(links == ChainLength);
+        }
+
+        // Fan-out from workers: every task below the last level submits two more
+        constexpr int Depth = 14;
+        std::atomic<int> nodes = 0;
+        std::function<void(int)> node = [&](int level)
+        {
+            ++nodes;
+            ++progress;
+            if (level + 1 < Depth)
+            {
+                pool.Submit([&node, level]() { node(level + 1); });
+                pool.Submit([&node, level]() { node(level + 1); });
+            }
+        };
+        pool.Submit([&node]() { node(0); });
+        pool.WaitIdle();
+        LUMINA_CHECK(nodes == (1 << Depth) - 1);
+
+        isDone = true;
+        watchdog.join();
+        std::printf("wakeups: %d idle wakes, 10 chains of %d, a %d-task tree; no stall\n", Rounds, ChainLength, (1 << Depth) - 1);
+    }
+
+    // The same batch of equal CPU-bound tasks on 1..hardware_concurrency workers
+    void BenchmarkScaling()
+    {
+        constexpr int TaskCount = 20000;
+        constexpr int WorkRounds = 20000;
+        const int maxThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+        double baseline = 0.0;
+        for (int threads = 1; threads <= maxThreads; ++threads)
+        {
+            LuminaWorkerPool pool(Threads(threads));
+            std::atomic<uint64_t> sink = 0;
+            auto start = Clock::now();
+            for (int i = 0; i < TaskCount; ++i)
+            {
+                pool.Submit([&sink, i]() { sink += Work(static_cast<uint64_t>(i), WorkRounds); });
+            }
+            pool.WaitIdle();
+            double rate = TaskCount / LuminaTest::SecondsSince(start);
+            baseline = threads == 1 ? rate : baseline;
+            LUMINA_CHECK(pool.GetStats().executed == TaskCount);
+            std::printf("scaling: %2d worker(s) %8.0f tasks/s  %.2fx\n", threads, rate, rate / baseline);
+        }
+        std::printf("scaling: hardware_concurrency = %d\n", maxThreads);
+    }
+}
+
+int main()
+{
+    TestPriorityOrderSingleWorker();
+    TestPriorityOrderPoolWide();
+    TestStealing();
+    TestWakeups();
+    BenchmarkScaling();
+    return LuminaTest::Finish();
+}